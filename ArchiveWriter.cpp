@@ -0,0 +1,337 @@
+#include "ArchiveWriter.h"
+#include "Checksum.h"
+#include "Compat.h"
+#include "Config.h"
+#include <ctime>
+#include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+// 输出缓冲大小，合并小块写入
+constexpr size_t ARCHIVE_BUFFER_SIZE = 4 * 1024 * 1024;
+
+// ZIP签名
+constexpr uint32_t ZIP_LOCAL_HEADER_SIGNATURE = 0x04034b50;
+constexpr uint32_t ZIP_CENTRAL_HEADER_SIGNATURE = 0x02014b50;
+constexpr uint32_t ZIP_END_SIGNATURE = 0x06054b50;
+constexpr uint32_t ZIP64_END_SIGNATURE = 0x06064b50;
+constexpr uint32_t ZIP64_LOCATOR_SIGNATURE = 0x07064b50;
+
+// 解压所需版本：2.0为基本格式，4.5支持ZIP64
+constexpr uint16_t ZIP_VERSION = 20;
+constexpr uint16_t ZIP64_VERSION = 45;
+
+// 超出该值的字段改用ZIP64结构记录
+constexpr uint64_t ZIP_MAX_32 = 0xFFFFFFFF;
+constexpr uint64_t ZIP_MAX_16 = 0xFFFF;
+
+// tar块大小
+constexpr size_t TAR_BLOCK_SIZE = 512;
+
+// tar头中文件名字段长度，更长的名称使用GNU长文件名扩展
+constexpr size_t TAR_NAME_SIZE = 100;
+
+namespace {
+
+// 小端字节序写入
+class LittleEndianWriter {
+public:
+    void U16(uint16_t value) {
+        bytes.push_back(static_cast<uint8_t>(value));
+        bytes.push_back(static_cast<uint8_t>(value >> 8));
+    }
+    void U32(uint32_t value) {
+        U16(static_cast<uint16_t>(value));
+        U16(static_cast<uint16_t>(value >> 16));
+    }
+    void U64(uint64_t value) {
+        U32(static_cast<uint32_t>(value));
+        U32(static_cast<uint32_t>(value >> 32));
+    }
+    void Bytes(const std::string& text) {
+        bytes.insert(bytes.end(), text.begin(), text.end());
+    }
+
+    std::vector<uint8_t> bytes;
+};
+
+// 以八进制写入tar数字字段，位数不足时使用GNU的base-256格式
+void WriteTarNumber(char* field, size_t width, uint64_t value) {
+    if (value < (1ULL << (3 * (width - 1)))) {
+        snprintf(field, width, "%0*llo", static_cast<int>(width - 1), static_cast<unsigned long long>(value));
+        return;
+    }
+    memset(field, 0, width);
+    field[0] = static_cast<char>(0x80);
+    for (size_t i = width - 1; i > 0 && value > 0; i--) {
+        field[i] = static_cast<char>(value & 0xFF);
+        value >>= 8;
+    }
+}
+
+}
+
+ArchiveWriter::~ArchiveWriter() {
+    if (file) {
+        Close();
+    }
+}
+
+bool ArchiveWriter::ParseFormat(const std::string& name, Format& format) {
+    if (name == "zip") {
+        format = Format::Zip;
+        return true;
+    }
+    if (name == "tar") {
+        format = Format::Tar;
+        return true;
+    }
+    return false;
+}
+
+bool ArchiveWriter::Open(const std::string& path, Format archiveFormat) {
+    format = archiveFormat;
+    offset = 0;
+    fileCount = 0;
+    failed = false;
+    entries.clear();
+
+    if (path == "-") {
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        file = stdout;
+        toStdout = true;
+    }
+    else {
+        file = Compat::OpenFile(path.c_str(), "wb");
+        if (!file) {
+            Logger::Error("无法创建归档文件: " + path);
+            file = nullptr;
+            return false;
+        }
+        toStdout = false;
+    }
+    setvbuf(file, nullptr, _IOFBF, ARCHIVE_BUFFER_SIZE);
+
+    // 所有条目使用打开时的时间
+    std::time_t now = std::time(nullptr);
+    const std::tm tm = Compat::LocalTime(now);
+    dosTime = static_cast<uint16_t>((tm.tm_hour << 11) | (tm.tm_min << 5) | (tm.tm_sec / 2));
+    dosDate = static_cast<uint16_t>(((tm.tm_year - 80) << 9) | ((tm.tm_mon + 1) << 5) | tm.tm_mday);
+
+    Logger::Info("输出到归档: " + (toStdout ? std::string("标准输出") : path) +
+        (format == Format::Zip ? " (zip)" : " (tar)"));
+    return true;
+}
+
+bool ArchiveWriter::Write(const void* data, size_t size) {
+    if (failed) {
+        return false;
+    }
+    if (size > 0 && fwrite(data, 1, size, file) != size) {
+        Logger::Error("归档写入失败");
+        failed = true;
+        return false;
+    }
+    offset += size;
+    return true;
+}
+
+bool ArchiveWriter::Add(const std::string& name, const uint8_t* data, size_t size) {
+    if (!file) {
+        return false;
+    }
+    bool success = format == Format::Zip ? AddZip(name, data, size) : AddTar(name, data, size);
+    if (success) {
+        fileCount++;
+        Logger::Debug("已写入归档: " + name + " (" + std::to_string(size) + " 字节)");
+    }
+    return success;
+}
+
+bool ArchiveWriter::AddZip(const std::string& name, const uint8_t* data, size_t size) {
+    if (size >= ZIP_MAX_32 || name.size() > ZIP_MAX_16) {
+        Logger::Error("文件过大，无法写入ZIP: " + name);
+        return false;
+    }
+
+    // 内容已在内存中，本地文件头直接写入CRC和长度，不需要数据描述符
+    ZipEntry entry;
+    entry.name = name;
+    entry.crc = Checksum::Crc32(0, data, size);
+    entry.size = size;
+    entry.offset = offset;
+
+    LittleEndianWriter header;
+    header.U32(ZIP_LOCAL_HEADER_SIGNATURE);
+    header.U16(ZIP_VERSION);
+    header.U16(0);                              // 标志
+    header.U16(0);                              // 存储方式
+    header.U16(dosTime);
+    header.U16(dosDate);
+    header.U32(entry.crc);
+    header.U32(static_cast<uint32_t>(size));    // 压缩后长度
+    header.U32(static_cast<uint32_t>(size));    // 原始长度
+    header.U16(static_cast<uint16_t>(name.size()));
+    header.U16(0);                              // 扩展字段长度
+    header.Bytes(name);
+
+    if (!Write(header.bytes.data(), header.bytes.size()) || !Write(data, size)) {
+        return false;
+    }
+    entries.push_back(std::move(entry));
+    return true;
+}
+
+bool ArchiveWriter::WriteTarHeader(const std::string& name, uint64_t size, char type) {
+    char header[TAR_BLOCK_SIZE] = {};
+    memcpy(header, name.data(), std::min(name.size(), TAR_NAME_SIZE));
+    WriteTarNumber(header + 100, 8, 0644);                  // 权限
+    WriteTarNumber(header + 108, 8, 0);                     // uid
+    WriteTarNumber(header + 116, 8, 0);                     // gid
+    WriteTarNumber(header + 124, 12, size);
+    WriteTarNumber(header + 136, 12, static_cast<uint64_t>(std::time(nullptr)));
+    header[156] = type;
+    memcpy(header + 257, "ustar", 6);
+    memcpy(header + 263, "00", 2);
+
+    // 校验和按校验和字段为空格计算
+    memset(header + 148, ' ', 8);
+    unsigned int checksum = 0;
+    for (size_t i = 0; i < TAR_BLOCK_SIZE; i++) {
+        checksum += static_cast<uint8_t>(header[i]);
+    }
+    snprintf(header + 148, 8, "%06o", checksum);
+    header[155] = ' ';
+
+    return Write(header, TAR_BLOCK_SIZE);
+}
+
+bool ArchiveWriter::AddTar(const std::string& name, const uint8_t* data, size_t size) {
+    static const char padding[TAR_BLOCK_SIZE] = {};
+
+    // 超长文件名先写一个GNU长文件名条目
+    if (name.size() > TAR_NAME_SIZE) {
+        const size_t nameSize = name.size() + 1;
+        if (!WriteTarHeader("././@LongLink", nameSize, 'L') ||
+            !Write(name.c_str(), nameSize) ||
+            !Write(padding, (TAR_BLOCK_SIZE - nameSize % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE)) {
+            return false;
+        }
+    }
+
+    return WriteTarHeader(name, size, '0') && Write(data, size) &&
+        Write(padding, (TAR_BLOCK_SIZE - size % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE);
+}
+
+bool ArchiveWriter::FinishZip() {
+    const uint64_t centralOffset = offset;
+    LittleEndianWriter central;
+    for (const ZipEntry& entry : entries) {
+        const bool offset64 = entry.offset >= ZIP_MAX_32;
+        central.U32(ZIP_CENTRAL_HEADER_SIGNATURE);
+        central.U16(offset64 ? ZIP64_VERSION : ZIP_VERSION);     // 创建版本
+        central.U16(offset64 ? ZIP64_VERSION : ZIP_VERSION);     // 解压所需版本
+        central.U16(0);
+        central.U16(0);
+        central.U16(dosTime);
+        central.U16(dosDate);
+        central.U32(entry.crc);
+        central.U32(static_cast<uint32_t>(entry.size));
+        central.U32(static_cast<uint32_t>(entry.size));
+        central.U16(static_cast<uint16_t>(entry.name.size()));
+        central.U16(offset64 ? 12 : 0);                         // 扩展字段长度
+        central.U16(0);                                         // 注释长度
+        central.U16(0);                                         // 磁盘号
+        central.U16(0);                                         // 内部属性
+        central.U32(0);                                         // 外部属性
+        central.U32(offset64 ? static_cast<uint32_t>(ZIP_MAX_32) : static_cast<uint32_t>(entry.offset));
+        central.Bytes(entry.name);
+        if (offset64) {
+            // ZIP64扩展字段，只含本地文件头偏移
+            central.U16(0x0001);
+            central.U16(8);
+            central.U64(entry.offset);
+        }
+
+        // 分批写出，避免中央目录整体占用过多内存
+        if (central.bytes.size() >= ARCHIVE_BUFFER_SIZE) {
+            if (!Write(central.bytes.data(), central.bytes.size())) {
+                return false;
+            }
+            central.bytes.clear();
+        }
+    }
+    if (!Write(central.bytes.data(), central.bytes.size())) {
+        return false;
+    }
+    const uint64_t centralSize = offset - centralOffset;
+
+    LittleEndianWriter end;
+    const bool zip64 = entries.size() >= ZIP_MAX_16 || centralOffset >= ZIP_MAX_32 || centralSize >= ZIP_MAX_32;
+    if (zip64) {
+        const uint64_t zip64EndOffset = offset;
+        end.U32(ZIP64_END_SIGNATURE);
+        end.U64(44);                                            // 记录剩余长度
+        end.U16(ZIP64_VERSION);
+        end.U16(ZIP64_VERSION);
+        end.U32(0);
+        end.U32(0);
+        end.U64(entries.size());
+        end.U64(entries.size());
+        end.U64(centralSize);
+        end.U64(centralOffset);
+
+        end.U32(ZIP64_LOCATOR_SIGNATURE);
+        end.U32(0);
+        end.U64(zip64EndOffset);
+        end.U32(1);                                             // 磁盘总数
+    }
+
+    const uint16_t entryCount = static_cast<uint16_t>(zip64 ? ZIP_MAX_16 : entries.size());
+    end.U32(ZIP_END_SIGNATURE);
+    end.U16(0);
+    end.U16(0);
+    end.U16(entryCount);
+    end.U16(entryCount);
+    end.U32(zip64 ? static_cast<uint32_t>(ZIP_MAX_32) : static_cast<uint32_t>(centralSize));
+    end.U32(zip64 ? static_cast<uint32_t>(ZIP_MAX_32) : static_cast<uint32_t>(centralOffset));
+    end.U16(0);                                                 // 注释长度
+    return Write(end.bytes.data(), end.bytes.size());
+}
+
+bool ArchiveWriter::Close() {
+    if (!file) {
+        return false;
+    }
+
+    if (format == Format::Zip) {
+        FinishZip();
+    }
+    else {
+        // tar以两个全零块结尾
+        static const char zeros[TAR_BLOCK_SIZE * 2] = {};
+        Write(zeros, sizeof(zeros));
+    }
+
+    if (fflush(file) != 0) {
+        failed = true;
+    }
+    if (!toStdout && fclose(file) != 0) {
+        failed = true;
+    }
+    file = nullptr;
+
+    if (failed) {
+        Logger::Error("归档写入失败");
+        return false;
+    }
+    Logger::Info("归档完成: " + std::to_string(fileCount) + " 个文件, " +
+        std::to_string(offset / 1024) + " KB");
+    return true;
+}
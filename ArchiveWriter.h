@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 顺序写出的归档文件
+// 所有输出追加到同一个ZIP (存储方式，不再压缩) 或tar流中，只做大块顺序写入，
+// 可以写到标准输出直接交给下游工具；ZIP的中央目录在关闭时写在末尾，写出过程中无需回写
+class ArchiveWriter {
+public:
+    enum class Format {
+        Zip,
+        Tar,
+    };
+
+    ArchiveWriter() = default;
+    ~ArchiveWriter();
+
+    ArchiveWriter(const ArchiveWriter&) = delete;
+    ArchiveWriter& operator=(const ArchiveWriter&) = delete;
+
+    /**
+     * @brief 创建归档
+     * @param path 归档文件路径，"-"表示标准输出
+     * @param format 归档格式
+     * @return 成功返回true
+     */
+    bool Open(const std::string& path, Format format);
+
+    /**
+     * @brief 追加一个文件
+     * @param name 归档内的文件名
+     * @param data 文件内容
+     * @param size 内容长度
+     * @return 成功返回true
+     */
+    bool Add(const std::string& name, const uint8_t* data, size_t size);
+
+    /**
+     * @brief 写出归档结尾并关闭
+     * @return 所有写入都成功返回true
+     * @note ZIP在此写出中央目录，条目数或偏移超出32位范围时使用ZIP64结构
+     */
+    bool Close();
+
+    bool IsOpen() const { return file != nullptr; }
+
+    /**
+     * @brief 解析归档格式名称
+     * @param name zip或tar
+     * @param format 输出的格式
+     * @return 名称有效返回true
+     */
+    static bool ParseFormat(const std::string& name, Format& format);
+
+private:
+    // ZIP中央目录中的一项
+    struct ZipEntry {
+        std::string name;
+        uint32_t crc;
+        uint64_t size;
+        uint64_t offset;    // 本地文件头的偏移
+    };
+
+    bool Write(const void* data, size_t size);
+    bool AddZip(const std::string& name, const uint8_t* data, size_t size);
+    bool AddTar(const std::string& name, const uint8_t* data, size_t size);
+    bool WriteTarHeader(const std::string& name, uint64_t size, char type);
+    bool FinishZip();
+
+    FILE* file = nullptr;
+    bool toStdout = false;
+    bool failed = false;
+    Format format = Format::Zip;
+    uint64_t offset = 0;
+    size_t fileCount = 0;
+    uint16_t dosTime = 0;
+    uint16_t dosDate = 0;
+    std::vector<ZipEntry> entries;
+};
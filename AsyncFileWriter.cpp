@@ -0,0 +1,393 @@
+#include "AsyncFileWriter.h"
+#include "ImageProcessor.h"
+#include "Config.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define ASYNC_WRITER_IO_URING
+#endif
+#endif
+
+#ifdef ASYNC_WRITER_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// 线程池模式的写入线程数，写出受存储延迟限制，与CPU核数无关
+constexpr size_t WRITER_THREADS = 4;
+
+// io_uring每批提交的文件数，同时也是提交队列的长度
+constexpr unsigned RING_BATCH = 64;
+
+// 单次写入请求的最大长度，io_uring的长度字段为32位
+constexpr size_t RING_MAX_WRITE = 1u << 30;
+
+#ifdef ASYNC_WRITER_IO_URING
+
+// 直接通过系统调用使用的io_uring实例，不依赖liburing
+struct AsyncFileWriter::Ring {
+    int fd = -1;
+    void* sqMap = MAP_FAILED;
+    size_t sqMapSize = 0;
+    void* cqMap = MAP_FAILED;
+    size_t cqMapSize = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqesSize = 0;
+
+    unsigned* sqTail = nullptr;
+    unsigned* sqMask = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned* cqMask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    ~Ring() {
+        if (sqes != MAP_FAILED) munmap(sqes, sqesSize);
+        if (cqMap != MAP_FAILED && cqMap != sqMap) munmap(cqMap, cqMapSize);
+        if (sqMap != MAP_FAILED) munmap(sqMap, sqMapSize);
+        if (fd >= 0) close(fd);
+    }
+
+    /**
+     * @brief 创建实例并确认内核支持打开、写入和关闭操作
+     * @return 可用返回true
+     */
+    bool Setup() {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, RING_BATCH, &params));
+        if (fd < 0) {
+            return false;
+        }
+
+        sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMap) {
+            sqMapSize = cqMapSize = std::max(sqMapSize, cqMapSize);
+        }
+
+        sqMap = mmap(nullptr, sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sqMap == MAP_FAILED) {
+            return false;
+        }
+        cqMap = singleMap ? sqMap :
+            mmap(nullptr, cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cqMap == MAP_FAILED) {
+            return false;
+        }
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(
+            mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) {
+            return false;
+        }
+
+        uint8_t* sq = static_cast<uint8_t*>(sqMap);
+        uint8_t* cq = static_cast<uint8_t*>(cqMap);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        // 打开和关闭操作需要5.6以上的内核
+        constexpr unsigned PROBE_OPS = 256;
+        std::vector<uint8_t> probeBuffer(sizeof(io_uring_probe) + PROBE_OPS * sizeof(io_uring_probe_op));
+        io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(probeBuffer.data());
+        if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, PROBE_OPS) < 0) {
+            return false;
+        }
+        for (unsigned op : { IORING_OP_OPENAT, IORING_OP_WRITE, IORING_OP_CLOSE }) {
+            if (op >= probe->ops_len || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief 取得下一个提交项，调用方保证一批不超过RING_BATCH项
+     */
+    io_uring_sqe* Next(uint64_t userData) {
+        const unsigned tail = *sqTail;
+        const unsigned index = tail & *sqMask;
+        io_uring_sqe* sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->user_data = userData;
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        return sqe;
+    }
+
+    /**
+     * @brief 提交已准备的请求并等待全部完成
+     * @param count 请求数量
+     * @param results 按user_data存放各请求的返回值
+     * @return 系统调用失败返回false
+     */
+    bool SubmitAndWait(unsigned count, std::vector<int>& results) {
+        unsigned submitted = 0;
+        unsigned completed = 0;
+        while (completed < count) {
+            const int ret = static_cast<int>(syscall(__NR_io_uring_enter, fd, count - submitted, 1,
+                IORING_ENTER_GETEVENTS, nullptr, 0));
+            if (ret < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            submitted += ret;
+
+            unsigned head = *cqHead;
+            const unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head, ++completed) {
+                const io_uring_cqe& cqe = cqes[head & *cqMask];
+                results[static_cast<size_t>(cqe.user_data)] = cqe.res;
+            }
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+        }
+        return true;
+    }
+};
+
+void AsyncFileWriter::RingLoop() {
+    std::vector<Job> jobs;
+    std::vector<int> fds;
+    std::vector<size_t> written;
+    std::vector<int> results(RING_BATCH);
+    bool ringUsable = true;
+
+    while (TakeJobs(jobs, RING_BATCH)) {
+        if (!ringUsable) {
+            size_t failures = 0;
+            for (const Job& job : jobs) {
+                if (!ImageProcessor::WriteFileData(job.path, job.data)) {
+                    ++failures;
+                }
+            }
+            FinishJobs(jobs, failures);
+            continue;
+        }
+
+        const unsigned count = static_cast<unsigned>(jobs.size());
+        fds.assign(count, -1);
+        written.assign(count, 0);
+        bool ringFailed = false;
+
+        // 一次提交整批文件的打开请求
+        for (unsigned i = 0; i < count; ++i) {
+            io_uring_sqe* sqe = ring->Next(i);
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = reinterpret_cast<uint64_t>(jobs[i].path.c_str());
+            sqe->len = 0644;
+            sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+        }
+        if (ring->SubmitAndWait(count, results)) {
+            for (unsigned i = 0; i < count; ++i) {
+                fds[i] = results[i];
+            }
+        }
+        else {
+            ringFailed = true;
+        }
+
+        // 写入，短写时对剩余部分继续提交
+        while (!ringFailed) {
+            unsigned pending = 0;
+            for (unsigned i = 0; i < count; ++i) {
+                if (fds[i] < 0 || written[i] == jobs[i].data.size()) {
+                    continue;
+                }
+                io_uring_sqe* sqe = ring->Next(i);
+                sqe->opcode = IORING_OP_WRITE;
+                sqe->fd = fds[i];
+                sqe->addr = reinterpret_cast<uint64_t>(jobs[i].data.data() + written[i]);
+                sqe->len = static_cast<uint32_t>(std::min(jobs[i].data.size() - written[i], RING_MAX_WRITE));
+                sqe->off = written[i];
+                results[i] = 0;
+                ++pending;
+            }
+            if (pending == 0) {
+                break;
+            }
+            if (!ring->SubmitAndWait(pending, results)) {
+                ringFailed = true;
+                break;
+            }
+            for (unsigned i = 0; i < count; ++i) {
+                if (fds[i] < 0 || written[i] == jobs[i].data.size()) {
+                    continue;
+                }
+                if (results[i] <= 0) {
+                    // 写入失败的文件先关闭，记为失败
+                    close(fds[i]);
+                    fds[i] = -2;
+                    continue;
+                }
+                written[i] += results[i];
+            }
+        }
+
+        // 关闭
+        unsigned closing = 0;
+        for (unsigned i = 0; i < count && !ringFailed; ++i) {
+            if (fds[i] >= 0) {
+                io_uring_sqe* sqe = ring->Next(i);
+                sqe->opcode = IORING_OP_CLOSE;
+                sqe->fd = fds[i];
+                ++closing;
+            }
+        }
+        if (closing > 0 && !ring->SubmitAndWait(closing, results)) {
+            ringFailed = true;
+        }
+
+        size_t failures = 0;
+        if (ringFailed) {
+            // 提交失败后队列状态未知，本批及之后的文件改为同步写出
+            Logger::Warning("io_uring提交失败，改为同步写出");
+            ringUsable = false;
+            for (unsigned i = 0; i < count; ++i) {
+                if (fds[i] >= 0) {
+                    close(fds[i]);
+                }
+                if (!ImageProcessor::WriteFileData(jobs[i].path, jobs[i].data)) {
+                    ++failures;
+                }
+            }
+            FinishJobs(jobs, failures);
+            continue;
+        }
+        for (unsigned i = 0; i < count; ++i) {
+            if (fds[i] < 0 || results[i] < 0) {
+                Logger::Error("写入文件失败: " + jobs[i].path);
+                ++failures;
+            }
+        }
+        FinishJobs(jobs, failures);
+    }
+}
+
+#else
+
+struct AsyncFileWriter::Ring {
+};
+
+#endif
+
+AsyncFileWriter::~AsyncFileWriter() {
+    Finish();
+}
+
+bool AsyncFileWriter::Start(size_t maxInFlightBytes) {
+    if (running) {
+        return true;
+    }
+    maxInFlight = maxInFlightBytes;
+    inFlight = 0;
+    failedCount = 0;
+    stopping = false;
+
+#ifdef ASYNC_WRITER_IO_URING
+    ring = new Ring();
+    if (ring->Setup()) {
+        threads.emplace_back(&AsyncFileWriter::RingLoop, this);
+        running = true;
+        Logger::Debug("后台写出使用io_uring");
+        return true;
+    }
+    delete ring;
+    ring = nullptr;
+    Logger::Debug("io_uring不可用，后台写出使用线程池");
+#endif
+
+    for (size_t i = 0; i < WRITER_THREADS; ++i) {
+        threads.emplace_back(&AsyncFileWriter::PoolLoop, this);
+    }
+    running = true;
+    return true;
+}
+
+void AsyncFileWriter::Submit(const std::string& filePath, std::vector<uint8_t>&& data) {
+    const size_t size = data.size();
+    std::unique_lock<std::mutex> lock(mutex);
+    spaceReady.wait(lock, [&] { return inFlight == 0 || inFlight + size <= maxInFlight; });
+    inFlight += size;
+    queue.push_back({ filePath, std::move(data) });
+    queueReady.notify_one();
+}
+
+bool AsyncFileWriter::Finish() {
+    if (!running) {
+        return failedCount == 0;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    queueReady.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+    delete ring;
+    ring = nullptr;
+    running = false;
+
+    if (failedCount > 0) {
+        Logger::Error(std::to_string(failedCount) + " 个文件写出失败");
+    }
+    return failedCount == 0;
+}
+
+bool AsyncFileWriter::TakeJobs(std::vector<Job>& jobs, size_t maxCount) {
+    jobs.clear();
+    std::unique_lock<std::mutex> lock(mutex);
+    queueReady.wait(lock, [&] { return stopping || !queue.empty(); });
+    while (!queue.empty() && jobs.size() < maxCount) {
+        jobs.push_back(std::move(queue.front()));
+        queue.pop_front();
+    }
+    return !jobs.empty();
+}
+
+void AsyncFileWriter::FinishJobs(std::vector<Job>& jobs, size_t failures) {
+    size_t bytes = 0;
+    for (const Job& job : jobs) {
+        bytes += job.data.size();
+    }
+    jobs.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        inFlight -= bytes;
+        failedCount += failures;
+    }
+    spaceReady.notify_all();
+}
+
+void AsyncFileWriter::PoolLoop() {
+    std::vector<Job> jobs;
+    while (TakeJobs(jobs, 1)) {
+        size_t failures = 0;
+        for (const Job& job : jobs) {
+            if (!ImageProcessor::WriteFileData(job.path, job.data)) {
+                ++failures;
+            }
+        }
+        FinishJobs(jobs, failures);
+    }
+}
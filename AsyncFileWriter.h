@@ -0,0 +1,83 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 后台批量写出文件
+// 编码好的数据交给后台写出，合成线程不再等待打开、写入和关闭文件的存储延迟。
+// Linux上通过io_uring成批提交打开、写入和关闭请求，不可用时退回到写入线程池；
+// 在途数据总量有上限，写出跟不上时提交方阻塞等待，内存占用不会无限增长
+class AsyncFileWriter {
+public:
+    AsyncFileWriter() = default;
+    ~AsyncFileWriter();
+
+    AsyncFileWriter(const AsyncFileWriter&) = delete;
+    AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+    /**
+     * @brief 启动后台写出
+     * @param maxInFlightBytes 已提交但未写完的数据总量上限
+     * @return 成功启动返回true
+     */
+    bool Start(size_t maxInFlightBytes);
+
+    /**
+     * @brief 提交一个文件，已存在时覆盖
+     * @param filePath 文件路径
+     * @param data 文件内容，所有权转移给写出方
+     * @note 在途数据超出上限时阻塞到有文件写完；单个文件超过上限时等待队列清空后单独写出
+     */
+    void Submit(const std::string& filePath, std::vector<uint8_t>&& data);
+
+    /**
+     * @brief 等待全部文件写完并停止后台线程
+     * @return 所有文件都写入成功返回true，失败的文件已逐个记录日志
+     */
+    bool Finish();
+
+    bool IsRunning() const { return running; }
+
+private:
+    struct Job {
+        std::string path;
+        std::vector<uint8_t> data;
+    };
+
+    struct Ring;
+
+    /**
+     * @brief 取出待写文件，队列为空时等待
+     * @param jobs 输出的文件列表
+     * @param maxCount 最多取出的数量
+     * @return 已停止且队列为空时返回false
+     */
+    bool TakeJobs(std::vector<Job>& jobs, size_t maxCount);
+
+    /**
+     * @brief 一批文件写完后释放在途额度
+     * @param jobs 已处理的文件
+     * @param failures 其中失败的数量
+     */
+    void FinishJobs(std::vector<Job>& jobs, size_t failures);
+
+    void PoolLoop();
+    void RingLoop();
+
+    bool running = false;
+    bool stopping = false;
+    size_t maxInFlight = 0;
+    size_t inFlight = 0;
+    size_t failedCount = 0;
+    std::deque<Job> queue;
+    std::mutex mutex;
+    std::condition_variable queueReady;     // 有新文件或正在停止
+    std::condition_variable spaceReady;     // 在途数据减少
+    std::vector<std::thread> threads;
+    Ring* ring = nullptr;                   // io_uring实例，为空时使用线程池
+};
@@ -0,0 +1,39 @@
+#include "AtlasPacker.h"
+#include <algorithm>
+
+AtlasPacker::AtlasPacker(int maxWidth, int maxHeight, int padding)
+    : maxWidth(maxWidth), maxHeight(maxHeight), padding(padding) {
+}
+
+bool AtlasPacker::Insert(int width, int height, int& x, int& y) {
+    if (width <= 0 || height <= 0 || width > maxWidth || height > maxHeight) {
+        return false;
+    }
+
+    // 在已有货架中选高度浪费最小的
+    Shelf* best = nullptr;
+    for (Shelf& shelf : shelves) {
+        const int left = shelf.used == 0 ? 0 : shelf.used + padding;
+        if (height <= shelf.height && left + width <= maxWidth &&
+            (!best || shelf.height < best->height)) {
+            best = &shelf;
+        }
+    }
+
+    if (!best) {
+        // 另起一层货架
+        const int top = shelves.empty() ? 0 : shelves.back().y + shelves.back().height + padding;
+        if (top + height > maxHeight) {
+            return false;
+        }
+        shelves.push_back({ top, height, 0 });
+        best = &shelves.back();
+    }
+
+    x = best->used == 0 ? 0 : best->used + padding;
+    y = best->y;
+    best->used = x + width;
+    usedWidth = std::max(usedWidth, x + width);
+    usedHeight = std::max(usedHeight, y + height);
+    return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+
+// 货架式矩形装箱
+// 矩形按行(货架)从上到下排列，新矩形放入高度浪费最小的已有货架，放不下时另起一层。
+// 输入按高度从大到小排序时利用率较好，同一基础图像的合成结果尺寸相近，适合这种装箱方式
+class AtlasPacker {
+public:
+    /**
+     * @param maxWidth 图集最大宽度
+     * @param maxHeight 图集最大高度
+     * @param padding 相邻矩形之间的透明间隔，避免纹理采样时相互渗色
+     */
+    AtlasPacker(int maxWidth, int maxHeight, int padding);
+
+    /**
+     * @brief 放入一个矩形
+     * @param width 矩形宽度
+     * @param height 矩形高度
+     * @param x 输出的左上角横坐标
+     * @param y 输出的左上角纵坐标
+     * @return 放得下返回true，否则返回false且不改变状态
+     */
+    bool Insert(int width, int height, int& x, int& y);
+
+    /**
+     * @brief 已放入矩形的外接宽高，即图集实际需要的尺寸
+     */
+    int UsedWidth() const { return usedWidth; }
+    int UsedHeight() const { return usedHeight; }
+
+private:
+    struct Shelf {
+        int y;          // 货架顶部
+        int height;     // 货架高度，由首个矩形决定
+        int used;       // 已占用的宽度
+    };
+
+    int maxWidth;
+    int maxHeight;
+    int padding;
+    int usedWidth = 0;
+    int usedHeight = 0;
+    std::vector<Shelf> shelves;
+};
@@ -0,0 +1,294 @@
+#include "BatchRunner.h"
+#include "AsyncFileWriter.h"
+#include "BufferPool.h"
+#include "FgComposer.h"
+#include "LuaParser.h"
+#include "PartCache.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace fs = std::filesystem;
+
+static bool isImageName(const std::string& name) {
+    std::string extension = fs::path(name).extension().string();
+    return extension == ".png" || extension == ".PNG" || extension == ".qoi" || extension == ".QOI";
+}
+
+bool BatchRunner::Run() {
+    auto startTime = std::chrono::steady_clock::now();
+    BufferPool::SetHugePages(config.hugePages);
+
+    PfsArchive pfs;
+    if (!config.pfsPath.empty() && !pfs.Open(config.pfsPath)) {
+        return false;
+    }
+    if (!CollectJobs(pfs)) {
+        return false;
+    }
+    if (jobs.empty()) {
+        Logger::Error("没有找到含有图像的目录");
+        return false;
+    }
+
+    // 大目录先开始，小目录留到最后填补空闲的线程
+    std::stable_sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) { return a.weight > b.weight; });
+
+    // 坐标表只加载一次，所有目录的字段一起解析
+    LuaParser luaParser;
+    if (FgComposer::loadPositionTable(config, pfs, luaParser)) {
+        std::vector<std::string> fields;
+        for (const Job& job : jobs) {
+            fields.push_back(job.config.globalName);
+        }
+        std::sort(fields.begin(), fields.end());
+        fields.erase(std::unique(fields.begin(), fields.end()), fields.end());
+        if (luaParser.parseGroups(fields)) {
+            Logger::Info("Lua文件解析成功");
+        }
+        else {
+            Logger::Warning("Lua文件解析失败");
+        }
+    }
+
+    FgComposer::applyCodecOptions(config);
+
+    PartCache partCache;
+    const bool useCache = !config.cachePath.empty() && !pfs.IsOpen() && !config.dryRun;
+    if (useCache) {
+        partCache.Open(config.cachePath);
+    }
+
+    // 流式合成直接写文件，其他情况共用一个后台写出
+    AsyncFileWriter writer;
+    const bool streamRows = config.streamRows && config.outputFormat != "qoi" && !config.atlas && !config.delta;
+    if (!config.dryRun && !streamRows && config.writeQueueSize > 0) {
+        writer.Start(static_cast<size_t>(config.writeQueueSize) * 1024 * 1024);
+    }
+
+    FgComposer::SharedResources shared;
+    shared.luaParser = &luaParser;
+    shared.partCache = useCache ? &partCache : nullptr;
+    shared.pfs = pfs.IsOpen() ? &pfs : nullptr;
+    shared.writer = &writer;
+
+    const size_t hardwareThreads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    const size_t threadCount = config.batchThreads > 0 ? static_cast<size_t>(config.batchThreads) : hardwareThreads;
+    const size_t workerCount = std::min(threadCount, jobs.size());
+    Logger::Info("批量合成 " + std::to_string(jobs.size()) + " 个目录, " + std::to_string(workerCount) + " 个线程");
+
+#ifdef _OPENMP
+    // 各工作线程内的OpenMP并行 (PNG过滤和分带压缩) 平分CPU核心，避免总线程数成为工作线程数的平方
+    const int ompThreads = static_cast<int>(std::max<size_t>(1, hardwareThreads / workerCount));
+    const int savedOmpThreads = omp_get_max_threads();
+#endif
+
+    std::atomic<size_t> nextJob{ 0 };
+    auto worker = [&]() {
+#ifdef _OPENMP
+        omp_set_num_threads(ompThreads);
+#endif
+        for (size_t i = nextJob++; i < jobs.size(); i = nextJob++) {
+            Job& job = jobs[i];
+            Logger::Info("开始处理目录 " + std::to_string(i + 1) + "/" + std::to_string(jobs.size()) + ": " + job.config.inputDir);
+            try {
+                FgComposer composer(job.config, shared);
+                job.success = composer.process();
+            }
+            catch (const std::exception& e) {
+                Logger::Error("发生异常: " + std::string(e.what()));
+                job.success = false;
+            }
+            if (!job.success) {
+                Logger::Error("目录处理失败: " + job.config.inputDir);
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < workerCount; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+#ifdef _OPENMP
+    omp_set_num_threads(savedOmpThreads);
+#endif
+
+    bool success = true;
+    if (writer.IsRunning() && !writer.Finish()) {
+        success = false;
+    }
+    if (useCache) {
+        Logger::Info("缓存命中 " + std::to_string(partCache.HitCount()) +
+            ", 未命中 " + std::to_string(partCache.MissCount()));
+        partCache.Finish();
+    }
+    BufferPool::Trim();
+
+    size_t failCount = 0;
+    for (const Job& job : jobs) {
+        if (!job.success) {
+            Logger::Warning("失败的目录: " + job.config.inputDir);
+            failCount++;
+        }
+    }
+    Logger::Info("批量合成完成: 成功 " + std::to_string(jobs.size() - failCount) + ", 失败 " + std::to_string(failCount) +
+        ", 耗时 " + std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - startTime).count()) + " ms");
+    return success && failCount == 0;
+}
+
+bool BatchRunner::CollectJobs(const PfsArchive& pfs) {
+    if (!config.jobFile.empty()) {
+        std::vector<std::pair<std::string, std::string>> entries;
+        if (!ReadJobFile(entries)) {
+            return false;
+        }
+        for (const auto& [inputDir, outputDir] : entries) {
+            if (!pfs.IsOpen() && !fs::is_directory(inputDir)) {
+                Logger::Warning("任务文件中的目录不存在，跳过: " + inputDir);
+                continue;
+            }
+            AddJob(inputDir, outputDir, MeasureDirectory(pfs, inputDir));
+        }
+        return true;
+    }
+
+    // 递归模式下输出目录保持与输入相同的层级
+    for (const std::string& directory : DiscoverDirectories(pfs)) {
+        fs::path relative = fs::path(directory).lexically_relative(config.inputDir);
+        AddJob(directory, (fs::path(config.outputDir) / relative).lexically_normal().string(),
+            MeasureDirectory(pfs, directory));
+    }
+    return true;
+}
+
+std::vector<std::string> BatchRunner::DiscoverDirectories(const PfsArchive& pfs) const {
+    auto isOutputName = [](const std::string& name) {
+        const std::string suffix = "_output";
+        return name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+
+    std::vector<std::string> directories;
+    if (pfs.IsOpen()) {
+        for (const std::string& directory : pfs.Directories(config.inputDir)) {
+            const auto entries = pfs.List(directory);
+            if (std::any_of(entries.begin(), entries.end(), [](const PfsArchive::Entry* entry) { return isImageName(entry->name); })) {
+                directories.push_back(directory);
+            }
+        }
+        std::sort(directories.begin(), directories.end());
+        return directories;
+    }
+
+    const fs::path outputRoot = fs::path(config.outputDir).lexically_normal();
+    auto containsImages = [](const fs::path& directory) {
+        std::error_code ec;
+        for (const auto& entry : fs::directory_iterator(directory, ec)) {
+            if (entry.is_regular_file() && isImageName(entry.path().filename().string())) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    if (containsImages(config.inputDir)) {
+        directories.push_back(config.inputDir);
+    }
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(config.inputDir, fs::directory_options::skip_permission_denied, ec);
+        it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (ec) {
+            Logger::Warning("遍历目录失败: " + ec.message());
+            break;
+        }
+        if (!it->is_directory()) {
+            continue;
+        }
+        if (isOutputName(it->path().filename().string()) || it->path().lexically_normal() == outputRoot) {
+            it.disable_recursion_pending();
+            continue;
+        }
+        if (containsImages(it->path())) {
+            directories.push_back(it->path().string());
+        }
+    }
+    std::sort(directories.begin(), directories.end());
+    return directories;
+}
+
+bool BatchRunner::ReadJobFile(std::vector<std::pair<std::string, std::string>>& entries) const {
+    std::ifstream file(config.jobFile);
+    if (!file.is_open()) {
+        Logger::Error("无法打开任务文件: " + config.jobFile);
+        return false;
+    }
+
+    auto trim = [](std::string text) {
+        const char* spaces = " \t\r";
+        text.erase(0, text.find_first_not_of(spaces));
+        text.erase(text.find_last_not_of(spaces) + 1);
+        return text;
+    };
+
+    std::string line;
+    while (std::getline(file, line)) {
+        line = trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        const size_t tab = line.find('\t');
+        if (tab == std::string::npos) {
+            entries.emplace_back(line, "");
+        }
+        else {
+            entries.emplace_back(trim(line.substr(0, tab)), trim(line.substr(tab + 1)));
+        }
+    }
+    Logger::Info("已读取任务文件: " + config.jobFile + " (" + std::to_string(entries.size()) + " 个目录)");
+    return true;
+}
+
+uint64_t BatchRunner::MeasureDirectory(const PfsArchive& pfs, const std::string& directory) const {
+    uint64_t total = 0;
+    if (pfs.IsOpen()) {
+        for (const PfsArchive::Entry* entry : pfs.List(directory)) {
+            if (isImageName(entry->name)) {
+                total += entry->size;
+            }
+        }
+        return total;
+    }
+
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(directory, ec)) {
+        if (entry.is_regular_file() && isImageName(entry.path().filename().string())) {
+            total += entry.file_size(ec);
+        }
+    }
+    return total;
+}
+
+void BatchRunner::AddJob(const std::string& inputDir, const std::string& outputDir, uint64_t weight) {
+    Job job;
+    job.config = config;
+    job.config.inputDir = inputDir;
+    job.config.outputDir = outputDir;
+    job.config.InitializeDefaultValues();
+
+    // 任务文件未指定输出目录而命令行指定了时，各目录按字段名分开存放
+    if (outputDir.empty() && !config.outputDir.empty()) {
+        job.config.outputDir = (fs::path(config.outputDir) / job.config.globalName).string();
+    }
+    job.weight = weight;
+    jobs.push_back(std::move(job));
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Config.h"
+#include "PfsArchive.h"
+
+// 批量合成
+// 在一个进程中处理整个游戏的立绘目录：坐标表只加载和解析一次，部件缓存、部件归档和后台写出在各目录间共用。
+// 目录交给固定数量的工作线程并发处理，按图像总大小从大到小分派，小目录填补大目录留下的空闲
+class BatchRunner {
+public:
+    explicit BatchRunner(const Config& config) : config(config) {}
+
+    /**
+     * @brief 查找所有目录并逐个合成
+     * @return 全部目录都成功返回true
+     */
+    bool Run();
+
+private:
+    struct Job {
+        Config config;              // 本目录的配置
+        uint64_t weight = 0;        // 图像文件总大小，用于安排处理顺序
+        bool success = false;
+    };
+
+    /**
+     * @brief 从任务文件或递归查找得到所有目录
+     * @param pfs 部件归档，未打开时从文件系统查找
+     * @return 任务文件无法读取时返回false
+     */
+    bool CollectJobs(const PfsArchive& pfs);
+
+    /**
+     * @brief 递归查找输入目录下直接含有图像的目录，包括输入目录本身
+     * @param pfs 部件归档，未打开时从文件系统查找
+     * @return 目录列表，按路径排序
+     * @note 跳过以_output结尾的目录和输出目录，避免把上次的结果当作部件
+     */
+    std::vector<std::string> DiscoverDirectories(const PfsArchive& pfs) const;
+
+    /**
+     * @brief 读取任务文件
+     * @param entries 输出的(输入目录, 输出目录)列表，未指定输出目录时为空
+     * @return 无法打开时返回false
+     * @note 每行一个输入目录，可用制表符分隔指定输出目录；空行和以#开头的行被忽略
+     */
+    bool ReadJobFile(std::vector<std::pair<std::string, std::string>>& entries) const;
+
+    /**
+     * @brief 统计目录中图像文件的总大小
+     */
+    uint64_t MeasureDirectory(const PfsArchive& pfs, const std::string& directory) const;
+
+    /**
+     * @brief 添加一个目录
+     * @param inputDir 输入目录
+     * @param outputDir 输出目录，为空时按单目录模式的规则推导
+     * @param weight 图像文件总大小
+     */
+    void AddJob(const std::string& inputDir, const std::string& outputDir, uint64_t weight);
+
+    const Config& config;
+    std::vector<Job> jobs;
+};
@@ -0,0 +1,197 @@
+#include "BufferPool.h"
+#include "Config.h"
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <unordered_map>
+#include <new>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+// 最小块大小，更小的申请也按此分配
+constexpr size_t MIN_BLOCK_SIZE = 4096;
+
+// 达到该大小的块直接向系统申请页面，可使用大页
+constexpr size_t LARGE_BLOCK_SIZE = 2 * 1024 * 1024;
+
+// 小块的对齐，满足SIMD加载
+constexpr size_t BLOCK_ALIGNMENT = 64;
+
+// 默认缓存的空闲内存上限
+constexpr size_t DEFAULT_CACHE_LIMIT = 512 * 1024 * 1024;
+
+namespace {
+
+struct PoolState {
+    std::mutex mutex;
+    std::unordered_map<size_t, std::vector<uint8_t*>> freeBlocks;  // 容量 -> 空闲块
+    size_t cachedBytes = 0;
+    size_t cacheLimit = DEFAULT_CACHE_LIMIT;
+    std::atomic<bool> hugePages{ false };
+};
+
+PoolState& State() {
+    static PoolState state;
+    return state;
+}
+
+// 每个2的幂区间再分为4级，浪费不超过25%
+size_t BlockCapacity(size_t size) {
+    if (size <= MIN_BLOCK_SIZE) {
+        return MIN_BLOCK_SIZE;
+    }
+    size_t base = MIN_BLOCK_SIZE;
+    while (base * 2 < size) {
+        base *= 2;
+    }
+    size_t step = base / 4;
+    return (size + step - 1) / step * step;
+}
+
+#ifdef _WIN32
+
+uint8_t* AllocateLarge(size_t capacity, bool hugePages) {
+    // 大页需要锁定内存权限，申请失败时回退到普通页
+    if (hugePages) {
+        size_t largePage = GetLargePageMinimum();
+        if (largePage > 0 && capacity % largePage == 0) {
+            void* p = VirtualAlloc(nullptr, capacity, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            if (p) {
+                return static_cast<uint8_t*>(p);
+            }
+        }
+    }
+    return static_cast<uint8_t*>(VirtualAlloc(nullptr, capacity, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+}
+
+void FreeLarge(uint8_t* data, size_t) {
+    VirtualFree(data, 0, MEM_RELEASE);
+}
+
+#else
+
+uint8_t* AllocateLarge(size_t capacity, bool hugePages) {
+    if (!hugePages) {
+        void* p = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return p == MAP_FAILED ? nullptr : static_cast<uint8_t*>(p);
+    }
+
+    // 多映射一个大页后裁掉首尾，使起始地址按大页对齐
+    size_t mapped = capacity + LARGE_BLOCK_SIZE;
+    void* p = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        return nullptr;
+    }
+    uint8_t* base = static_cast<uint8_t*>(p);
+    uint8_t* aligned = reinterpret_cast<uint8_t*>(
+        (reinterpret_cast<uintptr_t>(base) + LARGE_BLOCK_SIZE - 1) & ~(uintptr_t)(LARGE_BLOCK_SIZE - 1));
+    size_t head = aligned - base;
+    if (head > 0) {
+        munmap(base, head);
+    }
+    size_t tail = mapped - head - capacity;
+    if (tail > 0) {
+        munmap(aligned + capacity, tail);
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(aligned, capacity, MADV_HUGEPAGE);
+#endif
+    return aligned;
+}
+
+void FreeLarge(uint8_t* data, size_t capacity) {
+    munmap(data, capacity);
+}
+
+#endif
+
+uint8_t* AllocateBlock(size_t capacity) {
+    if (capacity >= LARGE_BLOCK_SIZE) {
+        return AllocateLarge(capacity, State().hugePages.load(std::memory_order_relaxed));
+    }
+    return static_cast<uint8_t*>(::operator new(capacity, std::align_val_t(BLOCK_ALIGNMENT), std::nothrow));
+}
+
+void FreeBlock(uint8_t* data, size_t capacity) {
+    if (capacity >= LARGE_BLOCK_SIZE) {
+        FreeLarge(data, capacity);
+    }
+    else {
+        ::operator delete(data, std::align_val_t(BLOCK_ALIGNMENT));
+    }
+}
+
+}
+
+uint8_t* BufferPool::Acquire(size_t size, size_t& capacity) {
+    capacity = BlockCapacity(size);
+
+    PoolState& state = State();
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        auto it = state.freeBlocks.find(capacity);
+        if (it != state.freeBlocks.end() && !it->second.empty()) {
+            uint8_t* data = it->second.back();
+            it->second.pop_back();
+            state.cachedBytes -= capacity;
+            return data;
+        }
+    }
+
+    uint8_t* data = AllocateBlock(capacity);
+    if (!data) {
+        // 释放缓存后重试一次
+        Trim();
+        data = AllocateBlock(capacity);
+        if (!data) {
+            Logger::Error("内存不足: 无法分配 " + std::to_string(capacity) + " 字节");
+            throw std::bad_alloc();
+        }
+    }
+    return data;
+}
+
+void BufferPool::Release(uint8_t* data, size_t capacity) {
+    if (!data) {
+        return;
+    }
+
+    PoolState& state = State();
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (state.cachedBytes + capacity <= state.cacheLimit) {
+            state.freeBlocks[capacity].push_back(data);
+            state.cachedBytes += capacity;
+            return;
+        }
+    }
+    FreeBlock(data, capacity);
+}
+
+void BufferPool::SetHugePages(bool enabled) {
+    State().hugePages.store(enabled, std::memory_order_relaxed);
+}
+
+void BufferPool::SetCacheLimit(size_t bytes) {
+    PoolState& state = State();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.cacheLimit = bytes;
+}
+
+void BufferPool::Trim() {
+    PoolState& state = State();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    for (auto& [capacity, blocks] : state.freeBlocks) {
+        for (uint8_t* data : blocks) {
+            FreeBlock(data, capacity);
+        }
+        blocks.clear();
+    }
+    state.cachedBytes = 0;
+}
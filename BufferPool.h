@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+// 按大小分级复用的内存池
+// 归还的内存块按容量归入大小级别，之后同级别的申请直接复用而不再向系统申请；
+// 申请到的内容不做初始化，由调用方负责写入
+class BufferPool {
+public:
+    /**
+     * @brief 申请未初始化的内存块
+     * @param size 需要的字节数，必须大于0
+     * @param capacity 输出的实际容量，归还时原样传入
+     * @return 内存块指针，按64字节对齐
+     * @note 线程安全
+     */
+    static uint8_t* Acquire(size_t size, size_t& capacity);
+
+    /**
+     * @brief 归还内存块，缓存总量超过上限时直接释放
+     * @param data Acquire返回的指针
+     * @param capacity Acquire输出的容量
+     */
+    static void Release(uint8_t* data, size_t capacity);
+
+    /**
+     * @brief 设置大块内存是否使用大页
+     * @param enabled 启用后2MB以上的内存块尝试使用大页，系统不支持时自动回退
+     */
+    static void SetHugePages(bool enabled);
+
+    /**
+     * @brief 设置池中缓存的空闲内存上限
+     * @param bytes 字节数
+     * @note 只影响之后归还的内存块，已缓存的部分可用Trim释放
+     */
+    static void SetCacheLimit(size_t bytes);
+
+    /**
+     * @brief 释放池中缓存的全部空闲内存
+     */
+    static void Trim();
+
+    // 析构时自动归还的内存块，用于编解码等的临时数据
+    class Buffer {
+    public:
+        Buffer() = default;
+        explicit Buffer(size_t size) { Allocate(size); }
+        ~Buffer() { Reset(); }
+
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+        Buffer(Buffer&& other) noexcept { *this = static_cast<Buffer&&>(other); }
+        Buffer& operator=(Buffer&& other) noexcept {
+            if (this != &other) {
+                Reset();
+                ptr = other.ptr;
+                length = other.length;
+                blockCapacity = other.blockCapacity;
+                other.ptr = nullptr;
+                other.length = 0;
+                other.blockCapacity = 0;
+            }
+            return *this;
+        }
+
+        /**
+         * @brief 重新申请指定大小的内存，原内容丢弃，新内容未初始化
+         * @param size 字节数，容量足够时不重新申请
+         */
+        void Allocate(size_t size) {
+            if (size > blockCapacity) {
+                Reset();
+                ptr = BufferPool::Acquire(size, blockCapacity);
+            }
+            length = size;
+        }
+
+        /**
+         * @brief 调整大小并保留原有内容，超出部分未初始化
+         * @param size 字节数，容量不足时换用更大的块并复制原内容
+         */
+        void Resize(size_t size) {
+            if (size > blockCapacity) {
+                Buffer grown(size);
+                if (length > 0) {
+                    memcpy(grown.data(), ptr, length);
+                }
+                *this = static_cast<Buffer&&>(grown);
+            }
+            length = size;
+        }
+
+        /**
+         * @brief 归还内存块
+         */
+        void Reset() {
+            if (ptr) {
+                BufferPool::Release(ptr, blockCapacity);
+            }
+            ptr = nullptr;
+            length = 0;
+            blockCapacity = 0;
+        }
+
+        uint8_t* data() { return ptr; }
+        const uint8_t* data() const { return ptr; }
+        size_t size() const { return length; }
+        size_t capacity() const { return blockCapacity; }
+        uint8_t& operator[](size_t index) { return ptr[index]; }
+        const uint8_t& operator[](size_t index) const { return ptr[index]; }
+
+    private:
+        uint8_t* ptr = nullptr;
+        size_t length = 0;
+        size_t blockCapacity = 0;
+    };
+};
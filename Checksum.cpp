@@ -0,0 +1,351 @@
+#include "Checksum.h"
+#include <zlib.h>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define CHECKSUM_CLMUL 1
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <wmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CHECKSUM_TARGET_CLMUL
+#else
+#include <cpuid.h>
+#define CHECKSUM_TARGET_CLMUL __attribute__((target("pclmul,sse4.1")))
+#endif
+#endif
+
+// zlib接口的长度参数为uInt，超长数据分段处理
+constexpr size_t ZLIB_MAX_CHUNK = 1u << 30;
+
+#if defined(CHECKSUM_CLMUL)
+
+// 折叠所需的最小长度
+constexpr size_t CLMUL_MIN_SIZE = 64;
+
+static bool DetectClmul() {
+    unsigned int ecx = 0;
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    ecx = static_cast<unsigned int>(info[2]);
+#else
+    unsigned int eax = 0, ebx = 0, edx = 0;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+#endif
+    const unsigned int PCLMULQDQ = 1u << 1;
+    const unsigned int SSE41 = 1u << 19;
+    return (ecx & PCLMULQDQ) && (ecx & SSE41);
+}
+
+// 基于Intel "Fast CRC Computation Using PCLMULQDQ" 的位反射折叠实现
+// size必须不小于64且为16的倍数，crc为取反后的中间值
+CHECKSUM_TARGET_CLMUL
+static uint32_t Crc32Clmul(const uint8_t* buf, size_t size, uint32_t crc) {
+    alignas(16) static const uint64_t k1k2[] = { 0x0154442bd4, 0x01c6e41596 };
+    alignas(16) static const uint64_t k3k4[] = { 0x01751997d0, 0x00ccaa009e };
+    alignas(16) static const uint64_t k5k0[] = { 0x0163cd6124, 0x0000000000 };
+    alignas(16) static const uint64_t poly[] = { 0x01db710641, 0x01f7011641 };
+
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+    x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x00));
+    x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x10));
+    x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x20));
+    x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+    x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k1k2));
+
+    buf += 64;
+    size -= 64;
+
+    // 每次并行折叠64字节
+    while (size >= 64) {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+        y5 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x00));
+        y6 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x10));
+        y7 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x20));
+        y8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x30));
+
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+
+        buf += 64;
+        size -= 64;
+    }
+
+    // 折叠为128位
+    x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k3k4));
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    // 剩余的16字节块
+    while (size >= 16) {
+        x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf));
+
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+        buf += 16;
+        size -= 16;
+    }
+
+    // 128位折叠为64位
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+
+    x0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett约减到32位
+    x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(poly));
+
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+}
+
+#endif
+
+bool Checksum::HasHardwareCrc32() {
+#if defined(CHECKSUM_CLMUL)
+    static const bool supported = DetectClmul();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+uint32_t Checksum::Crc32(uint32_t crc, const uint8_t* data, size_t size) {
+#if defined(CHECKSUM_CLMUL)
+    if (size >= CLMUL_MIN_SIZE && HasHardwareCrc32()) {
+        size_t chunk = size & ~static_cast<size_t>(15);
+        crc = ~Crc32Clmul(data, chunk, ~crc);
+        data += chunk;
+        size -= chunk;
+    }
+#endif
+
+    while (size > 0) {
+        size_t chunk = size < ZLIB_MAX_CHUNK ? size : ZLIB_MAX_CHUNK;
+        crc = static_cast<uint32_t>(crc32(crc, data, static_cast<uInt>(chunk)));
+        data += chunk;
+        size -= chunk;
+    }
+    return crc;
+}
+
+uint32_t Checksum::Adler32(uint32_t adler, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        size_t chunk = size < ZLIB_MAX_CHUNK ? size : ZLIB_MAX_CHUNK;
+        adler = static_cast<uint32_t>(adler32(adler, data, static_cast<uInt>(chunk)));
+        data += chunk;
+        size -= chunk;
+    }
+    return adler;
+}
+
+// XXH64常量
+constexpr uint64_t XXH_PRIME1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t XXH_PRIME2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t XXH_PRIME3 = 0x165667B19E3779F9ull;
+constexpr uint64_t XXH_PRIME4 = 0x85EBCA77C2B2AE63ull;
+constexpr uint64_t XXH_PRIME5 = 0x27D4EB2F165667C5ull;
+
+static inline uint64_t RotateLeft(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint64_t Load64(const uint8_t* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t Load32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint64_t XxhRound(uint64_t acc, uint64_t input) {
+    acc += input * XXH_PRIME2;
+    acc = RotateLeft(acc, 31);
+    return acc * XXH_PRIME1;
+}
+
+static inline uint64_t XxhMerge(uint64_t acc, uint64_t value) {
+    acc ^= XxhRound(0, value);
+    return acc * XXH_PRIME1 + XXH_PRIME4;
+}
+
+uint64_t Checksum::Hash64(const uint8_t* data, size_t size, uint64_t seed) {
+    const uint8_t* p = data;
+    const uint8_t* end = data + size;
+    uint64_t hash;
+
+    if (size >= 32) {
+        uint64_t v1 = seed + XXH_PRIME1 + XXH_PRIME2;
+        uint64_t v2 = seed + XXH_PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XXH_PRIME1;
+        do {
+            v1 = XxhRound(v1, Load64(p));
+            v2 = XxhRound(v2, Load64(p + 8));
+            v3 = XxhRound(v3, Load64(p + 16));
+            v4 = XxhRound(v4, Load64(p + 24));
+            p += 32;
+        } while (p + 32 <= end);
+
+        hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+        hash = XxhMerge(hash, v1);
+        hash = XxhMerge(hash, v2);
+        hash = XxhMerge(hash, v3);
+        hash = XxhMerge(hash, v4);
+    }
+    else {
+        hash = seed + XXH_PRIME5;
+    }
+
+    hash += static_cast<uint64_t>(size);
+
+    for (; p + 8 <= end; p += 8) {
+        hash ^= XxhRound(0, Load64(p));
+        hash = RotateLeft(hash, 27) * XXH_PRIME1 + XXH_PRIME4;
+    }
+    if (p + 4 <= end) {
+        hash ^= static_cast<uint64_t>(Load32(p)) * XXH_PRIME1;
+        hash = RotateLeft(hash, 23) * XXH_PRIME2 + XXH_PRIME3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        hash ^= static_cast<uint64_t>(*p) * XXH_PRIME5;
+        hash = RotateLeft(hash, 11) * XXH_PRIME1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= XXH_PRIME2;
+    hash ^= hash >> 29;
+    hash *= XXH_PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+static inline uint32_t RotateLeft32(uint32_t value, int bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+static inline uint32_t LoadBigEndian32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+        (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+// 处理一个64字节的SHA-1分组
+static void Sha1Block(uint32_t state[5], const uint8_t* block) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+        w[i] = LoadBigEndian32(block + i * 4);
+    }
+    for (int i = 16; i < 80; i++) {
+        w[i] = RotateLeft32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+    for (int i = 0; i < 80; i++) {
+        uint32_t f, k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        }
+        else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        }
+        else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        }
+        else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+        uint32_t temp = RotateLeft32(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = RotateLeft32(b, 30);
+        b = a;
+        a = temp;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+void Checksum::Sha1(const uint8_t* data, size_t size, uint8_t digest[SHA1_SIZE]) {
+    uint32_t state[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+    size_t remaining = size;
+    const uint8_t* p = data;
+    for (; remaining >= 64; p += 64, remaining -= 64) {
+        Sha1Block(state, p);
+    }
+
+    // 末尾补1位和0，最后8字节为消息的位长度
+    uint8_t tail[128] = {};
+    memcpy(tail, p, remaining);
+    tail[remaining] = 0x80;
+    const size_t tailSize = remaining < 56 ? 64 : 128;
+    const uint64_t bitLength = static_cast<uint64_t>(size) * 8;
+    for (int i = 0; i < 8; i++) {
+        tail[tailSize - 1 - i] = static_cast<uint8_t>(bitLength >> (i * 8));
+    }
+    Sha1Block(state, tail);
+    if (tailSize == 128) {
+        Sha1Block(state, tail + 64);
+    }
+
+    for (int i = 0; i < 5; i++) {
+        digest[i * 4] = static_cast<uint8_t>(state[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(state[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(state[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(state[i]);
+    }
+}
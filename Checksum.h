@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// PNG/zlib使用的校验和、缓存使用的内容哈希与PFS归档使用的SHA-1
+class Checksum {
+public:
+    static constexpr size_t SHA1_SIZE = 20;
+
+    /**
+     * @brief 计算CRC-32 (与zlib的crc32一致)
+     * @param crc 之前数据的CRC，初始为0
+     * @param data 数据指针
+     * @param size 数据长度
+     * @return 更新后的CRC
+     * @note CPU支持PCLMULQDQ时使用无进位乘法折叠，否则回退到zlib
+     */
+    static uint32_t Crc32(uint32_t crc, const uint8_t* data, size_t size);
+
+    /**
+     * @brief 计算Adler-32 (与zlib的adler32一致)
+     * @param adler 之前数据的Adler，初始为1
+     * @param data 数据指针
+     * @param size 数据长度
+     * @return 更新后的Adler
+     */
+    static uint32_t Adler32(uint32_t adler, const uint8_t* data, size_t size);
+
+    /**
+     * @brief 计算64位内容哈希 (XXH64)
+     * @param data 数据指针
+     * @param size 数据长度
+     * @param seed 种子
+     * @return 哈希值
+     * @note 用于缓存键，不具备密码学强度
+     */
+    static uint64_t Hash64(const uint8_t* data, size_t size, uint64_t seed = 0);
+
+    /**
+     * @brief 计算SHA-1摘要
+     * @param data 数据指针
+     * @param size 数据长度
+     * @param digest 输出的20字节摘要
+     * @note 用于推导PFS归档的解密密钥
+     */
+    static void Sha1(const uint8_t* data, size_t size, uint8_t digest[SHA1_SIZE]);
+
+    /**
+     * @brief 检查当前CPU是否支持硬件CRC-32
+     * @return 支持返回true
+     */
+    static bool HasHardwareCrc32();
+};
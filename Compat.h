@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdio>
+#include <ctime>
+
+// CRT函数的跨平台封装
+// MSVC开启SDL检查时fopen、localtime等函数无法通过编译，需使用_s版本；其他平台没有这些函数，使用标准或POSIX版本
+class Compat {
+public:
+    /**
+     * @brief 打开文件
+     * @param path 文件路径
+     * @param mode 打开方式，与fopen相同
+     * @return 文件，失败返回nullptr
+     */
+    static FILE* OpenFile(const char* path, const char* mode) {
+#ifdef _MSC_VER
+        FILE* file = nullptr;
+        return fopen_s(&file, path, mode) == 0 ? file : nullptr;
+#else
+        return std::fopen(path, mode);
+#endif
+    }
+
+    /**
+     * @brief 转换为本地时间
+     * @param time 时间
+     * @return 本地时间的各字段
+     */
+    static std::tm LocalTime(std::time_t time) {
+        std::tm result = {};
+#ifdef _WIN32
+        localtime_s(&result, &time);
+#else
+        localtime_r(&time, &result);
+#endif
+        return result;
+    }
+};
@@ -0,0 +1,504 @@
+#include "ComposeServer.h"
+#include "Json.h"
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+using NativeSocket = SOCKET;
+constexpr NativeSocket INVALID_NATIVE_SOCKET = INVALID_SOCKET;
+constexpr int SEND_FLAGS = 0;
+static void closeNative(NativeSocket socket) { closesocket(socket); }
+static void shutdownNative(NativeSocket socket) { shutdown(socket, SD_BOTH); }
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+using NativeSocket = int;
+constexpr NativeSocket INVALID_NATIVE_SOCKET = -1;
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;    // 客户端先断开时不产生SIGPIPE
+static void closeNative(NativeSocket socket) { close(socket); }
+static void shutdownNative(NativeSocket socket) { shutdown(socket, SHUT_RDWR); }
+#endif
+
+// 请求头的长度上限
+constexpr size_t MAX_REQUEST_HEAD = 16 * 1024;
+
+// 等待新连接的时长，超时后检查是否需要停止
+constexpr int ACCEPT_WAIT_MS = 500;
+
+// 连接上等待请求数据的时长，超时后关闭连接，空闲或卡住的客户端不长期占用连接数
+constexpr int IDLE_TIMEOUT_MS = 30000;
+
+// 用于统计耗时分位数的最近请求数
+constexpr size_t LATENCY_SAMPLES = 4096;
+
+// 同时处理的连接数上限，超出时回复503
+constexpr size_t MAX_CONNECTIONS = 64;
+
+static NativeSocket toNative(uintptr_t socket) {
+    return static_cast<NativeSocket>(socket);
+}
+
+// 等待套接字可读，超时返回false；连接关闭或出错也视为可读，由随后的recv处理
+static bool waitReadable(NativeSocket socket, int timeoutMs) {
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(socket, &readable);
+    timeval timeout{ timeoutMs / 1000, (timeoutMs % 1000) * 1000 };
+    return select(static_cast<int>(socket) + 1, &readable, nullptr, nullptr, &timeout) > 0;
+}
+
+// URL解码，"+"视为空格
+static std::string decodeUrl(const std::string& text) {
+    std::string result;
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '%' && i + 2 < text.size() && isxdigit(static_cast<unsigned char>(text[i + 1])) &&
+            isxdigit(static_cast<unsigned char>(text[i + 2]))) {
+            result += static_cast<char>(std::stoi(text.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        }
+        else {
+            result += text[i] == '+' ? ' ' : text[i];
+        }
+    }
+    return result;
+}
+
+static const char* statusReason(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 431: return "Request Header Fields Too Large";
+    case 503: return "Service Unavailable";
+    default: return "Internal Server Error";
+    }
+}
+
+ComposeServer::ComposeServer(const Config& config)
+    : config(config), composer(config), cache(static_cast<size_t>(config.serveCacheSize) * 1024 * 1024) {
+}
+
+bool ComposeServer::Run(const std::function<bool()>& stopRequested) {
+    auto startTime = std::chrono::steady_clock::now();
+    FgComposer::applyCodecOptions(config);
+    if (!composer.prepare()) {
+        return false;
+    }
+    BuildCombinationIndex();
+    Logger::Info("部件加载完成，耗时 " + std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - startTime).count()) + " ms");
+
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        Logger::Error("无法初始化Winsock");
+        return false;
+    }
+#endif
+
+    // 只监听本机地址，不对外提供服务
+    NativeSocket listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listener == INVALID_NATIVE_SOCKET) {
+        Logger::Error("无法创建套接字");
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<uint16_t>(config.servePort));
+    if (bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0) {
+        Logger::Error("无法监听端口 " + std::to_string(config.servePort));
+        closeNative(listener);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return false;
+    }
+
+    Logger::Info("合成服务已启动: http://127.0.0.1:" + std::to_string(config.servePort) + "/，按Ctrl+C退出");
+
+    while (!stopRequested()) {
+        // 回收已结束的连接线程
+        std::vector<std::thread> finished;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.swap(finishedThreads);
+        }
+        for (std::thread& thread : finished) {
+            thread.join();
+        }
+
+        if (!waitReadable(listener, ACCEPT_WAIT_MS)) {
+            continue;
+        }
+        NativeSocket client = accept(listener, nullptr, nullptr);
+        if (client == INVALID_NATIVE_SOCKET) {
+            continue;
+        }
+        // 响应头和小图像不等待合并，直接发出
+        int noDelay = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+
+        // 连接线程结束前要先取得锁，因此线程一定在登记之后才会移出
+        std::lock_guard<std::mutex> lock(mutex);
+        if (connections.size() >= MAX_CONNECTIONS) {
+            SendResponse(static_cast<SocketHandle>(client), MakeError(503, "连接数过多"), false);
+            closeNative(client);
+            continue;
+        }
+        const SocketHandle handle = static_cast<SocketHandle>(client);
+        connections.emplace(handle, std::thread(&ComposeServer::ConnectionLoop, this, handle));
+    }
+
+    // 关闭监听和处理中的连接，等待连接线程退出
+    closeNative(listener);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (auto& [client, thread] : connections) {
+            shutdownNative(toNative(client));
+        }
+        connectionsDone.wait(lock, [&] { return connections.empty(); });
+    }
+    for (std::thread& thread : finishedThreads) {
+        thread.join();
+    }
+    finishedThreads.clear();
+#ifdef _WIN32
+    WSACleanup();
+#endif
+
+    Logger::Info("合成服务已停止: 请求 " + std::to_string(requestCount) + ", 缓存命中 " +
+        std::to_string(cache.HitCount()) + ", 未命中 " + std::to_string(cache.MissCount()));
+    return true;
+}
+
+void ComposeServer::BuildCombinationIndex() {
+    const std::vector<std::string>& names = composer.getPartNames();
+    partNames.insert(names.begin(), names.end());
+
+    std::stringstream json;
+    json << "{\n  \"combinations\": [\n";
+    const size_t total = static_cast<size_t>(composer.getCombinationCount());
+    for (size_t i = 0; i < total; i++) {
+        std::vector<std::string> parts = composer.getCombinationParts(i);
+        std::string name;
+        for (const std::string& part : parts) {
+            name += (name.empty() ? "" : "_") + part;
+        }
+        combinationIndex.emplace(name, i);
+
+        json << "    {\"name\": \"" << Json::Escape(name) << "\", \"parts\": [";
+        for (size_t j = 0; j < parts.size(); j++) {
+            json << (j > 0 ? ", " : "") << "\"" << Json::Escape(parts[j]) << "\"";
+        }
+        json << "]}" << (i + 1 < total ? "," : "") << "\n";
+    }
+    json << "  ]\n}\n";
+    combinationsJson = json.str();
+}
+
+void ComposeServer::ConnectionLoop(SocketHandle client) {
+    ServeConnection(client);
+
+    // 关闭和移出在同一把锁内完成，句柄被新连接复用时不会与旧登记冲突
+    std::lock_guard<std::mutex> lock(mutex);
+    closeNative(toNative(client));
+    auto it = connections.find(client);
+    finishedThreads.push_back(std::move(it->second));
+    connections.erase(it);
+    connectionsDone.notify_all();
+}
+
+void ComposeServer::ServeConnection(SocketHandle client) {
+    std::string buffer;
+    char chunk[4096];
+    for (;;) {
+        // 读到空行为止，同一连接上的后续请求留在缓冲中
+        size_t headEnd;
+        while ((headEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+            if (buffer.size() > MAX_REQUEST_HEAD) {
+                SendResponse(client, MakeError(431, "请求头过长"), false);
+                return;
+            }
+            if (!waitReadable(toNative(client), IDLE_TIMEOUT_MS)) {
+                Logger::Debug("连接空闲超时，关闭连接");
+                return;
+            }
+            int received = recv(toNative(client), chunk, sizeof(chunk), 0);
+            if (received <= 0) {
+                return;
+            }
+            buffer.append(chunk, static_cast<size_t>(received));
+        }
+        std::string head = buffer.substr(0, headEnd);
+        buffer.erase(0, headEnd + 4);
+
+        auto startTime = std::chrono::steady_clock::now();
+        Request request;
+        Response response;
+        if (ParseRequest(head, request)) {
+            response = Handle(request);
+        }
+        else {
+            // 无法确定请求边界，回复后关闭连接
+            response = MakeError(400, "无法解析请求");
+            request.keepAlive = false;
+        }
+        RecordLatency(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - startTime).count()));
+
+        if (!SendResponse(client, response, request.keepAlive) || !request.keepAlive) {
+            return;
+        }
+    }
+}
+
+bool ComposeServer::ParseRequest(const std::string& head, Request& request) {
+    std::istringstream lines(head);
+    std::string line;
+    if (!std::getline(lines, line)) {
+        return false;
+    }
+    if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+
+    // 请求行: 方法 目标 版本
+    std::istringstream requestLine(line);
+    std::string target;
+    std::string version;
+    if (!(requestLine >> request.method >> target >> version) || version.compare(0, 5, "HTTP/") != 0) {
+        return false;
+    }
+    request.keepAlive = version != "HTTP/1.0";
+
+    const size_t queryStart = target.find('?');
+    request.path = decodeUrl(target.substr(0, queryStart));
+    if (queryStart != std::string::npos) {
+        std::istringstream query(target.substr(queryStart + 1));
+        std::string pair;
+        while (std::getline(query, pair, '&')) {
+            const size_t equals = pair.find('=');
+            if (equals == std::string::npos) {
+                request.query[decodeUrl(pair)] = "";
+            }
+            else {
+                request.query[decodeUrl(pair.substr(0, equals))] = decodeUrl(pair.substr(equals + 1));
+            }
+        }
+    }
+
+    // 只关心Connection和Content-Length，带请求体的请求不支持
+    while (std::getline(lines, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        const size_t colon = line.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        const size_t valueStart = line.find_first_not_of(' ', colon + 1);
+        std::string name = line.substr(0, colon);
+        std::string value = valueStart == std::string::npos ? "" : line.substr(valueStart);
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+        std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+        if (name == "connection") {
+            request.keepAlive = value != "close";
+        }
+        else if (name == "content-length" && value != "0") {
+            return false;
+        }
+    }
+    return true;
+}
+
+ComposeServer::Response ComposeServer::Handle(const Request& request) {
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        requestCount++;
+    }
+    if (request.method != "GET") {
+        return MakeError(405, "只支持GET请求");
+    }
+    if (request.path == "/compose") {
+        return HandleCompose(request);
+    }
+    if (request.path == "/combinations") {
+        Response response;
+        response.text = combinationsJson;
+        return response;
+    }
+    if (request.path == "/stats") {
+        return HandleStats();
+    }
+    return MakeError(404, "未知路径: " + request.path);
+}
+
+ComposeServer::Response ComposeServer::HandleCompose(const Request& request) {
+    // 部件可以按组合名或逐个列出
+    std::vector<std::string> parts;
+    auto nameIt = request.query.find("name");
+    auto partsIt = request.query.find("parts");
+    if (nameIt != request.query.end()) {
+        auto indexIt = combinationIndex.find(nameIt->second);
+        if (indexIt == combinationIndex.end()) {
+            return MakeError(404, "未知组合: " + nameIt->second);
+        }
+        parts = composer.getCombinationParts(indexIt->second);
+    }
+    else if (partsIt != request.query.end()) {
+        std::istringstream list(partsIt->second);
+        std::string part;
+        while (std::getline(list, part, ',')) {
+            if (!part.empty()) {
+                parts.push_back(part);
+            }
+        }
+    }
+    if (parts.empty()) {
+        return MakeError(400, "需要指定name或parts参数");
+    }
+    for (const std::string& part : parts) {
+        if (!partNames.count(part)) {
+            return MakeError(404, "未知部件: " + part);
+        }
+    }
+
+    auto formatIt = request.query.find("format");
+    const std::string format = formatIt != request.query.end() ? formatIt->second : config.outputFormat;
+    if (format != "png" && format != "qoi" && format != "rgba") {
+        return MakeError(400, "未知格式: " + format);
+    }
+
+    std::string key = format + ":";
+    for (const std::string& part : parts) {
+        key += part + ",";
+    }
+
+    Response response;
+    response.image = cache.Find(key);
+    response.headers = std::string("X-Cache: ") + (response.image ? "hit" : "miss") + "\r\n";
+    if (!response.image) {
+        ImageData image;
+        if (!composer.composeParts(parts, image)) {
+            return MakeError(500, "合成失败");
+        }
+
+        auto result = std::make_shared<ResultCache::Result>();
+        result->width = image.width;
+        result->height = image.height;
+        result->posX = image.posX;
+        result->posY = image.posY;
+        bool encoded = true;
+        if (format == "rgba") {
+            result->body.assign(image.data.data(), image.data.data() + image.data.size());
+        }
+        else if (format == "qoi") {
+            encoded = ImageProcessor::EncodeQoi(image, result->body, config.writePosBack);
+        }
+        else {
+            encoded = ImageProcessor::EncodePng(image, result->body, ImageProcessor::GetPngEncodeOptions(), config.writePosBack);
+        }
+        ImageProcessor::FreeImage(image);
+        if (!encoded) {
+            return MakeError(500, "编码失败");
+        }
+        cache.Insert(key, result);
+        response.image = std::move(result);
+    }
+
+    response.contentType = format == "png" ? "image/png" : format == "qoi" ? "image/qoi" : "application/octet-stream";
+    response.headers += "X-Image-Width: " + std::to_string(response.image->width) + "\r\n" +
+        "X-Image-Height: " + std::to_string(response.image->height) + "\r\n" +
+        "X-Image-PosX: " + std::to_string(response.image->posX) + "\r\n" +
+        "X-Image-PosY: " + std::to_string(response.image->posY) + "\r\n";
+    return response;
+}
+
+ComposeServer::Response ComposeServer::HandleStats() const {
+    uint64_t requests;
+    std::vector<uint32_t> samples;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        requests = requestCount;
+        samples = latencies;
+    }
+
+    // 最近请求的耗时分位数，不含网络传输
+    auto percentile = [&](double fraction) -> uint32_t {
+        if (samples.empty()) {
+            return 0;
+        }
+        size_t rank = std::min(samples.size() - 1, static_cast<size_t>(fraction * samples.size()));
+        std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+        return samples[rank];
+    };
+
+    Response response;
+    response.text = "{\"requests\": " + std::to_string(requests) +
+        ", \"cacheHits\": " + std::to_string(cache.HitCount()) +
+        ", \"cacheMisses\": " + std::to_string(cache.MissCount()) +
+        ", \"cacheEntries\": " + std::to_string(cache.EntryCount()) +
+        ", \"cacheBytes\": " + std::to_string(cache.ByteCount()) +
+        ", \"latencyP50Us\": " + std::to_string(percentile(0.50)) +
+        ", \"latencyP99Us\": " + std::to_string(percentile(0.99)) + "}\n";
+    return response;
+}
+
+ComposeServer::Response ComposeServer::MakeError(int status, const std::string& message) {
+    Response response;
+    response.status = status;
+    response.text = "{\"error\": \"" + Json::Escape(message) + "\"}\n";
+    return response;
+}
+
+bool ComposeServer::SendResponse(SocketHandle client, const Response& response, bool keepAlive) {
+    const uint8_t* body = response.image ? response.image->body.data() : reinterpret_cast<const uint8_t*>(response.text.data());
+    const size_t bodySize = response.image ? response.image->body.size() : response.text.size();
+
+    std::string head = "HTTP/1.1 " + std::to_string(response.status) + " " + statusReason(response.status) + "\r\n" +
+        "Content-Type: " + response.contentType + "\r\n" +
+        "Content-Length: " + std::to_string(bodySize) + "\r\n" +
+        (keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n") +
+        response.headers + "\r\n";
+
+    auto sendAll = [&](const char* data, size_t size) {
+        while (size > 0) {
+            int sent = send(toNative(client), data, static_cast<int>(std::min<size_t>(size, 1 << 30)), SEND_FLAGS);
+            if (sent <= 0) {
+                return false;
+            }
+            data += sent;
+            size -= static_cast<size_t>(sent);
+        }
+        return true;
+    };
+    return sendAll(head.data(), head.size()) && sendAll(reinterpret_cast<const char*>(body), bodySize);
+}
+
+void ComposeServer::RecordLatency(uint32_t microseconds) {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    if (latencies.size() < LATENCY_SAMPLES) {
+        latencies.push_back(microseconds);
+    }
+    else {
+        latencies[latencyCursor] = microseconds;
+        latencyCursor = (latencyCursor + 1) % LATENCY_SAMPLES;
+    }
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Config.h"
+#include "FgComposer.h"
+#include "ResultCache.h"
+
+// 本机合成服务
+// 部件和坐标加载一次后常驻内存，通过127.0.0.1上的HTTP按需合成指定的组合，返回PNG、QOI或原始RGBA像素。
+// 合成结果按部件和格式保存在LRU缓存中，重复请求直接返回。每个连接由单独的线程处理，支持keep-alive，
+// 空闲的长连接不会占住其他客户端的处理线程，空闲超过30秒时关闭
+//   GET /compose?name=<组合名>[&format=png|qoi|rgba]      按输出文件名(不含扩展名)合成组合表中的组合
+//   GET /compose?parts=<部件1,部件2,...>[&format=...]     按图层顺序合成任意部件，首个为基础图像
+//   GET /combinations                                     组合表中所有组合及其部件 (JSON)
+//   GET /stats                                            请求数、缓存命中和处理耗时 (JSON)
+class ComposeServer {
+public:
+    explicit ComposeServer(const Config& config);
+
+    ComposeServer(const ComposeServer&) = delete;
+    ComposeServer& operator=(const ComposeServer&) = delete;
+
+    /**
+     * @brief 加载部件并提供服务，直到被要求停止
+     * @param stopRequested 返回true时停止服务
+     * @return 加载或监听失败返回false
+     */
+    bool Run(const std::function<bool()>& stopRequested);
+
+private:
+    // 套接字句柄，Windows上为SOCKET
+    using SocketHandle = uintptr_t;
+
+    struct Request {
+        std::string method;
+        std::string path;
+        std::unordered_map<std::string, std::string> query;
+        bool keepAlive = true;
+    };
+
+    struct Response {
+        int status = 200;
+        std::string contentType = "application/json";
+        std::string text;                                   // 文本内容，image为空时发送
+        std::shared_ptr<const ResultCache::Result> image;   // 图像内容
+        std::string headers;                                // 附加的响应头，每行以\r\n结尾
+    };
+
+    /**
+     * @brief 建立组合名索引和组合列表
+     */
+    void BuildCombinationIndex();
+
+    /**
+     * @brief 连接线程：处理连接上的请求，结束后关闭连接并把线程交给主线程回收
+     * @param client 客户端套接字
+     */
+    void ConnectionLoop(SocketHandle client);
+
+    /**
+     * @brief 处理一个连接上的所有请求
+     * @param client 客户端套接字
+     */
+    void ServeConnection(SocketHandle client);
+
+    /**
+     * @brief 解析请求行和请求头
+     * @param head 请求头，不含末尾的空行
+     * @param request 输出的请求
+     * @return 格式正确返回true
+     */
+    static bool ParseRequest(const std::string& head, Request& request);
+
+    Response Handle(const Request& request);
+    Response HandleCompose(const Request& request);
+    Response HandleStats() const;
+
+    /**
+     * @brief 生成错误响应
+     */
+    static Response MakeError(int status, const std::string& message);
+
+    /**
+     * @brief 发送响应
+     * @return 发送完整返回true
+     */
+    static bool SendResponse(SocketHandle client, const Response& response, bool keepAlive);
+
+    /**
+     * @brief 记录一次请求的处理耗时
+     */
+    void RecordLatency(uint32_t microseconds);
+
+    const Config& config;
+    FgComposer composer;
+    ResultCache cache;
+    std::unordered_set<std::string> partNames;              // 已加载的部件，用于区分部件不存在
+    std::unordered_map<std::string, size_t> combinationIndex;   // 组合名->组合序号
+    std::string combinationsJson;                           // /combinations的响应
+
+    std::unordered_map<SocketHandle, std::thread> connections;  // 处理中的连接及其线程，停止时关闭
+    std::vector<std::thread> finishedThreads;               // 连接已结束、等待回收的线程
+    std::mutex mutex;
+    std::condition_variable connectionsDone;                // 有连接结束
+
+    mutable std::mutex statsMutex;
+    uint64_t requestCount = 0;
+    std::vector<uint32_t> latencies;                        // 最近请求的处理耗时 (微秒)，循环使用
+    size_t latencyCursor = 0;
+};
@@ -1,10 +1,14 @@
 #include <chrono>
 #include <iomanip>
+#include <mutex>
 #include <sstream>
 #include <filesystem>
 #include "Config.h"
+#include "ImageProcessor.h"
+#include "ArchiveWriter.h"
+#include "Compat.h"
 
-// Config ķʵ
+// Config 的方法实现
 Config::Config(const std::string& inDir, const std::string& outDir, const std::string& luaFilePath)
     : inputDir(inDir), outputDir(outDir), luaPath(luaFilePath) {
     InitializeDefaultValues();
@@ -17,7 +21,12 @@ Config::Config(int argc, char* argv[]) {
 void Config::InitializeDefaultValues() {
     if (inputDir.empty()) return;
 
-    if (outputDir.empty()) {
+    // 从归档读取时输出到归档所在目录
+    if (outputDir.empty() && !pfsPath.empty()) {
+        std::filesystem::path archiveDir = std::filesystem::path(pfsPath).parent_path();
+        outputDir = (archiveDir / std::filesystem::path(inputDir).filename()).string() + "_output";
+    }
+    else if (outputDir.empty()) {
         outputDir = inputDir + "_output";
     }
 
@@ -58,9 +67,63 @@ Config Config::Parse(int argc, char* argv[]) {
         else if (arg == "--write-pos-back" || arg == "-w") {
             config.writePosBack = true;
         }
+        else if (arg == "--huge-pages") {
+            config.hugePages = true;
+        }
+        else if (arg == "--stream") {
+            config.streamRows = true;
+        }
+        else if (arg == "--dry-run" || arg == "-n") {
+            config.dryRun = true;
+        }
+        else if (arg == "--watch") {
+            config.watch = true;
+        }
+        else if (arg == "--recursive" || arg == "-r") {
+            config.recursive = true;
+        }
+        else if (arg == "--job-file") {
+            if (i + 1 >= argc) {
+                Logger::Error("--job-file 选项需要指定参数值");
+                config.helpRequested = true;
+                return config;
+            }
+            config.jobFile = argv[++i];
+        }
+        else if (arg == "--batch-threads") {
+            if (i + 1 >= argc) {
+                Logger::Error("--batch-threads 选项需要指定参数值");
+                config.helpRequested = true;
+                return config;
+            }
+            try {
+                config.batchThreads = std::stoi(argv[++i]);
+            }
+            catch (const std::exception&) {
+                Logger::Error("--batch-threads 选项的参数值无效: " + std::string(argv[i]));
+                config.helpRequested = true;
+                return config;
+            }
+        }
+        else if (arg == "--lua-index") {
+            if (i + 1 >= argc) {
+                Logger::Error("--lua-index 选项需要指定参数值");
+                config.helpRequested = true;
+                return config;
+            }
+            config.luaIndexDir = argv[++i];
+        }
+        else if (arg == "--bench-lua") {
+            if (i + 1 >= argc) {
+                Logger::Error("--bench-lua 选项需要指定参数值");
+                config.helpRequested = true;
+                return config;
+            }
+            config.benchLuaPath = argv[++i];
+        }
         else if (arg == "--lua-path" || arg == "-l") {
             if (i + 1 >= argc) {
-                Logger::Error("--lua-path ѡҪֵָ");
+                Logger::Error("--lua-path 选项需要指定参数值");
                 config.helpRequested = true;
                 return config;
             }
@@ -68,20 +131,153 @@ Config Config::Parse(int argc, char* argv[]) {
         }
         else if (arg == "--output" || arg == "-o") {
             if (i + 1 >= argc) {
-                Logger::Error("--output ѡҪֵָ");
+                Logger::Error("--output 选项需要指定参数值");
                 config.helpRequested = true;
                 return config;
             }
             config.outputDir = argv[++i];
         }
+        else if (arg == "--cache") {
+            if (i + 1 >= argc) {
+                Logger::Error("--cache 选项需要指定参数值");
+                config.helpRequested = true;
+                return config;
+            }
+            config.cachePath = argv[++i];
+        }
+        else if (arg == "--pfs") {
+            if (i + 1 >= argc) {
+                Logger::Error("--pfs 选项需要指定参数值");
+                config.helpRequested = true;
+                return config;
+            }
+            config.pfsPath = argv[++i];
+        }
+        else if (arg == "--format") {
+            if (i + 1 >= argc) {
+                Logger::Error("--format 选项需要指定参数值");
+                config.helpRequested = true;
+                return config;
+            }
+            config.outputFormat = argv[++i];
+        }
+        else if (arg == "--atlas") {
+            config.atlas = true;
+        }
+        else if (arg == "--archive" || arg == "--archive-format") {
+            if (i + 1 >= argc) {
+                Logger::Error(arg + " 选项需要指定参数值");
+                config.helpRequested = true;
+                return config;
+            }
+            if (arg == "--archive") config.archivePath = argv[++i];
+            else config.archiveFormat = argv[++i];
+        }
+        else if (arg == "--delta") {
+            config.delta = true;
+        }
+        else if (arg == "--atlas-size") {
+            if (i + 1 >= argc) {
+                Logger::Error("--atlas-size 选项需要指定参数值");
+                config.helpRequested = true;
+                return config;
+            }
+            try {
+                config.atlasSize = std::stoi(argv[++i]);
+            }
+            catch (const std::exception&) {
+                Logger::Error("--atlas-size 选项的参数值无效: " + std::string(argv[i]));
+                config.helpRequested = true;
+                return config;
+            }
+        }
+        else if (arg == "--write-queue") {
+            if (i + 1 >= argc) {
+                Logger::Error("--write-queue 选项需要指定参数值");
+                config.helpRequested = true;
+                return config;
+            }
+            try {
+                config.writeQueueSize = std::stoi(argv[++i]);
+            }
+            catch (const std::exception&) {
+                Logger::Error("--write-queue 选项的参数值无效: " + std::string(argv[i]));
+                config.helpRequested = true;
+                return config;
+            }
+        }
+        else if (arg == "--serve") {
+            if (i + 1 >= argc) {
+                Logger::Error("--serve 选项需要指定参数值");
+                config.helpRequested = true;
+                return config;
+            }
+            try {
+                config.servePort = std::stoi(argv[++i]);
+            }
+            catch (const std::exception&) {
+                Logger::Error("--serve 选项的参数值无效: " + std::string(argv[i]));
+                config.helpRequested = true;
+                return config;
+            }
+        }
+        else if (arg == "--serve-cache") {
+            if (i + 1 >= argc) {
+                Logger::Error("--serve-cache 选项需要指定参数值");
+                config.helpRequested = true;
+                return config;
+            }
+            try {
+                config.serveCacheSize = std::stoi(argv[++i]);
+            }
+            catch (const std::exception&) {
+                Logger::Error("--serve-cache 选项的参数值无效: " + std::string(argv[i]));
+                config.helpRequested = true;
+                return config;
+            }
+        }
+        else if (arg == "--png-skip-crc") {
+            config.pngSkipCrc = true;
+        }
+        else if (arg == "--png-encoder" || arg == "--png-level" || arg == "--png-filter" || arg == "--png-strategy" ||
+            arg == "--png-decoder") {
+            if (i + 1 >= argc) {
+                Logger::Error(arg + " 选项需要指定参数值");
+                config.helpRequested = true;
+                return config;
+            }
+            std::string value = argv[++i];
+            if (arg == "--png-encoder") config.pngEncoder = value;
+            else if (arg == "--png-level") config.pngLevel = value;
+            else if (arg == "--png-filter") config.pngFilter = value;
+            else if (arg == "--png-decoder") config.pngDecoder = value;
+            else config.pngStrategy = value;
+        }
+        else if (arg == "--png-target-speed" || arg == "--png-target-ratio") {
+            if (i + 1 >= argc) {
+                Logger::Error(arg + " 选项需要指定参数值");
+                config.helpRequested = true;
+                return config;
+            }
+            try {
+                double value = std::stod(argv[++i]);
+                if (arg == "--png-target-speed") config.pngTargetSpeed = value;
+                else config.pngTargetRatio = value;
+            }
+            catch (const std::exception&) {
+                Logger::Error(arg + " 选项的参数值无效: " + argv[i]);
+                config.helpRequested = true;
+                return config;
+            }
+        }
         else if (arg[0] == '-') {
-            Logger::Error("δ֪ѡ: " + arg);
+            Logger::Error("未知选项: " + arg);
             config.helpRequested = true;
             return config;
         }
         else {
             if (!config.inputDir.empty()) {
-                Logger::Error("ָֻһĿ¼");
+                Logger::Error("只能指定一个输入目录");
                 config.helpRequested = true;
                 return config;
             }
@@ -89,7 +285,7 @@ Config Config::Parse(int argc, char* argv[]) {
         }
     }
 
-    // ʼĬֵ͹
+    // 初始化默认值和规则
     if (!config.helpRequested) {
         config.InitializeDefaultValues();
         config.InitializeDefaultRules();
@@ -102,39 +298,139 @@ bool Config::Validate() const {
     if (helpRequested) {
         return true;
     }
-    if (inputDir.empty()) {
-        Logger::Error("ָĿ¼");
+    // 任务文件中列出了各个输入目录
+    if (inputDir.empty() && jobFile.empty()) {
+        Logger::Error("必须指定输入目录");
+        return false;
+    }
+    if (!jobFile.empty() && (recursive || !inputDir.empty())) {
+        Logger::Error("--job-file 不能与输入目录或 --recursive 同时使用");
+        return false;
+    }
+    if (!jobFile.empty() && !std::filesystem::exists(jobFile)) {
+        Logger::Error("任务文件不存在: " + jobFile);
+        return false;
+    }
+    if ((recursive || !jobFile.empty()) && !archivePath.empty()) {
+        Logger::Error("批量模式不支持 --archive");
+        return false;
+    }
+    if (watch && (recursive || !jobFile.empty() || !pfsPath.empty() || !archivePath.empty() || dryRun)) {
+        Logger::Error("--watch 不能与批量模式、--pfs、--archive 或 --dry-run 同时使用");
+        return false;
+    }
+    if (batchThreads < 0 || batchThreads > 256) {
+        Logger::Error("批量线程数必须在0-256之间: " + std::to_string(batchThreads));
         return false;
     }
-    if (!inputDir.empty() && !std::filesystem::exists(inputDir)) {
-        Logger::Error("Ŀ¼: " + inputDir);
+    // 从归档读取时输入目录和Lua路径可以是归档内的路径
+    if (!pfsPath.empty() && !std::filesystem::exists(pfsPath)) {
+        Logger::Error("PFS归档不存在: " + pfsPath);
         return false;
     }
-    if (!luaPath.empty() && !std::filesystem::exists(luaPath)) {
-        Logger::Error("Luaű·: " + luaPath);
+    if (pfsPath.empty() && !inputDir.empty() && !std::filesystem::exists(inputDir)) {
+        Logger::Error("输入目录不存在: " + inputDir);
+        return false;
+    }
+    if (pfsPath.empty() && !luaPath.empty() && !std::filesystem::exists(luaPath)) {
+        Logger::Error("Lua脚本路径不存在: " + luaPath);
+        return false;
+    }
+
+    if (outputFormat != "png" && outputFormat != "qoi") {
+        Logger::Error("未知的输出格式: " + outputFormat);
         return false;
     }
 
-    // ֤
+    ArchiveWriter::Format format;
+    if (!archiveFormat.empty() && !ArchiveWriter::ParseFormat(archiveFormat, format)) {
+        Logger::Error("未知的归档格式: " + archiveFormat);
+        return false;
+    }
+    if (atlas && delta) {
+        Logger::Error("--atlas 与 --delta 只能指定一个");
+        return false;
+    }
+    if (atlasSize < 64 || atlasSize > 65535) {
+        Logger::Error("图集尺寸必须在64-65535之间: " + std::to_string(atlasSize));
+        return false;
+    }
+    if (writeQueueSize < 0 || writeQueueSize > 65536) {
+        Logger::Error("写出队列上限必须在0-65536 MB之间: " + std::to_string(writeQueueSize));
+        return false;
+    }
+    if (servePort < 0 || servePort > 65535) {
+        Logger::Error("服务端口必须在0-65535之间 (0为不启动服务): " + std::to_string(servePort));
+        return false;
+    }
+    if (serveCacheSize < 0 || serveCacheSize > 65536) {
+        Logger::Error("服务缓存上限必须在0-65536 MB之间: " + std::to_string(serveCacheSize));
+        return false;
+    }
+    if (servePort > 0 && (recursive || !jobFile.empty() || watch || !archivePath.empty() || dryRun || atlas || delta)) {
+        Logger::Error("--serve 不能与批量模式、--watch、--archive、--dry-run、--atlas 或 --delta 同时使用");
+        return false;
+    }
+
+    // 验证PNG编码参数
+    if (!pngLevel.empty() && pngLevel != "auto") {
+        if (pngLevel.size() != 1 || pngLevel[0] < '0' || pngLevel[0] > '9') {
+            Logger::Error("PNG压缩级别必须为0-9或auto: " + pngLevel);
+            return false;
+        }
+    }
+    PngEncoderType encoder;
+    if (!pngEncoder.empty() && !ImageProcessor::ParsePngEncoder(pngEncoder, encoder)) {
+        Logger::Error("未知的PNG编码器: " + pngEncoder);
+        return false;
+    }
+    int value = 0;
+    if (!pngFilter.empty() && !ImageProcessor::ParsePngFilter(pngFilter, value)) {
+        Logger::Error("未知的PNG过滤器: " + pngFilter);
+        return false;
+    }
+    if (!pngStrategy.empty() && !ImageProcessor::ParsePngStrategy(pngStrategy, value)) {
+        Logger::Error("未知的PNG压缩策略: " + pngStrategy);
+        return false;
+    }
+    if (!pngDecoder.empty() && pngDecoder != "fast" && pngDecoder != "libpng") {
+        Logger::Error("未知的PNG解码器: " + pngDecoder);
+        return false;
+    }
+    if (pngTargetSpeed < 0 || pngTargetRatio < 0) {
+        Logger::Error("PNG自动调优目标不能为负数");
+        return false;
+    }
+    if (pngTargetSpeed > 0 && pngTargetRatio > 0) {
+        Logger::Error("--png-target-speed 与 --png-target-ratio 只能指定一个");
+        return false;
+    }
+
+    // 验证规则
     if (groupRule.empty()) {
-        Logger::Error("Ϊ");
+        Logger::Error("分组规则不能为空");
         return false;
     }
     if (partRules.empty()) {
-        Logger::Error("Ϊ");
+        Logger::Error("部件规则不能为空");
         return false;
     }
 
     return true;
 }
 
-// Logger ķʵ
+// Logger 的方法实现
 Logger::Level Logger::currentLevel = Logger::Level::INFO;
+bool Logger::useStderr = false;
 
 void Logger::SetLevel(Level level) {
     currentLevel = level;
 }
 
+void Logger::SetUseStderr(bool enabled) {
+    useStderr = enabled;
+}
+
 void Logger::Debug(const std::string& message) {
     Log(Level::DEBUG, message);
 }
@@ -158,12 +454,14 @@ void Logger::Log(Level level, const std::string& message) {
     auto time = std::chrono::system_clock::to_time_t(now);
 
     std::stringstream ss;
-    std::tm tm;
-    localtime_s(&tm, &time);
+    const std::tm tm = Compat::LocalTime(time);
     ss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
 
-    auto& output = (level >= Level::WARNING) ? std::cerr : std::cout;
+    auto& output = (useStderr || level >= Level::WARNING) ? std::cerr : std::cout;
 
+    // 批量模式下多个线程同时输出，整行加锁避免交错
+    static std::mutex outputMutex;
+    std::lock_guard<std::mutex> lock(outputMutex);
     output << "[" << ss.str() << "] "
         << "[" << LevelToString(level) << "] "
         << message << std::endl;
@@ -2,9 +2,10 @@
 
 #include <string>
 #include <iostream>
+#include <vector>
 
 struct Config {
-    // 
+    // 分类规则定义
     struct PartRule {
         std::string partName;
         std::string pattern;
@@ -14,20 +15,52 @@ struct Config {
         }
     };
 
-    // 
+    // 基础配置项
     bool helpRequested = false;
     bool verbose = false;
     bool writePosBack = false;
+    bool streamRows = false;        // 逐带合成并直接写出，不生成完整画布
+    bool hugePages = false;         // 大画布使用大页内存
+    bool dryRun = false;            // 只读取文件头，预估组合数量和画布大小，不解码也不输出
+    std::string benchLuaPath;       // 对比坐标表两种解析方式的耗时后退出
+    std::string luaIndexDir;        // 坐标表二进制索引的存放目录，空表示每次都解析脚本
     std::string inputDir;
     std::string outputDir;
     std::string luaPath;
     std::string globalName;
+    std::string cachePath;          // 已解码部件缓存文件，空表示不使用缓存
+    std::string pfsPath;            // 从PFS归档读取部件，此时inputDir为归档内的目录
+    std::string outputFormat = "png";   // 输出格式: png, qoi
+    bool atlas = false;             // 按基础图像把合成结果装入图集，并输出JSON索引
+    int atlasSize = 4096;           // 图集的最大宽高
+    bool delta = false;             // 基础图像只输出一次，组合只输出部件覆盖的区域
+    std::string archivePath;        // 输出到单个ZIP/tar归档，"-"为标准输出，空表示逐个写文件
+    std::string archiveFormat;      // zip, tar；空表示按扩展名判断
+    int writeQueueSize = 256;       // 后台写出的在途数据上限 (MB)，0表示在合成线程同步写出
+    bool recursive = false;         // 递归查找输入目录下所有含有图像的目录并批量合成
+    std::string jobFile;            // 批量任务文件，每行一个输入目录，可用制表符分隔指定输出目录
+    int batchThreads = 0;           // 批量模式同时处理的目录数，0表示与CPU核心数相同
+    bool watch = false;             // 合成一次后监视输入目录和坐标表，只重新合成受影响的组合
+    int servePort = 0;              // 本机合成服务的端口，0表示不启动服务
+    int serveCacheSize = 256;       // 合成服务缓存结果的上限 (MB)
 
-    // 
+    // PNG编码参数，空字符串表示使用默认值
+    std::string pngEncoder;         // libpng, parallel, fast
+    std::string pngLevel;           // 0-9 或 auto
+    std::string pngFilter;          // none, sub, up, avg, paeth, all
+    std::string pngStrategy;        // default, filtered, huffman, rle, fixed
+    double pngTargetSpeed = 0.0;    // auto模式的目标编码速度 (MB/s)
+    double pngTargetRatio = 0.0;    // auto模式的目标压缩率 (%)
+
+    // PNG解码参数
+    std::string pngDecoder;         // fast, libpng
+    bool pngSkipCrc = false;        // 跳过CRC和adler32校验
+
+    // 分类规则
     std::string groupRule;
     std::vector<PartRule> partRules;
 
-    // 캯
+    // 构造函数
     Config() = default;
     Config(const std::string& inDir, const std::string& outDir = "", const std::string& luaFilePath = "");
     explicit Config(int argc, char* argv[]);
@@ -49,6 +82,12 @@ public:
     };
 
     static void SetLevel(Level level);
+    static Level GetLevel() { return currentLevel; }
+
+    /**
+     * @brief 所有日志都输出到标准错误，标准输出留给归档等数据
+     */
+    static void SetUseStderr(bool enabled);
 
     static void Debug(const std::string& message);
     static void Info(const std::string& message);
@@ -57,6 +96,7 @@ public:
 
 private:
     static Level currentLevel;
+    static bool useStderr;
 
     static void Log(Level level, const std::string& message);
     static const char* LevelToString(Level level);
@@ -0,0 +1,502 @@
+#include "FastDeflate.h"
+#include "Checksum.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// 哈希表大小 (2^HASH_BITS项)
+constexpr int HASH_BITS = 16;
+
+// deflate参数
+constexpr size_t WINDOW_SIZE = 32768;
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t MAX_MATCH = 258;
+
+// 哈希表中的位置相对base存储，距离达到此值时整体平移，超过4GiB的输入不会回绕
+constexpr size_t REBASE_DISTANCE = size_t(1) << 31;
+
+// 每块最多的符号数，块越小Huffman表越贴合局部统计，但头部开销越大
+constexpr size_t BLOCK_TOKENS = 1 << 16;
+
+// 字面量/长度、距离、码长三种码表
+constexpr int LITLEN_CODES = 288;
+constexpr int DIST_CODES = 30;
+constexpr int CODELEN_CODES = 19;
+
+static const uint16_t LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t DIST_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t DIST_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+// 码长码表的写出顺序
+static const uint8_t CODELEN_ORDER[CODELEN_CODES] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+static inline int CountTrailingZeros(uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+static inline int HighestBit(uint32_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse(&index, value);
+    return static_cast<int>(index);
+#else
+    return 31 - __builtin_clz(value);
+#endif
+}
+
+static inline uint32_t Load32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint64_t Load64(const uint8_t* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// 匹配长度 -> 长度码序号 (0-28)
+static inline int LengthCode(size_t length) {
+    static uint8_t table[MAX_MATCH + 1];
+    static bool initialized = [] {
+        int code = 0;
+        for (size_t len = 3; len <= MAX_MATCH; len++) {
+            while (code < 28 && len >= LENGTH_BASE[code + 1]) code++;
+            table[len] = static_cast<uint8_t>(code);
+        }
+        return true;
+    }();
+    (void)initialized;
+    return table[length];
+}
+
+// 距离 -> 距离码序号 (0-29)
+static inline int DistCode(size_t dist) {
+    uint32_t d = static_cast<uint32_t>(dist - 1);
+    if (d < 4) return static_cast<int>(d);
+    int bits = HighestBit(d);
+    return bits * 2 + static_cast<int>((d >> (bits - 1)) & 1);
+}
+
+// 从低位开始写入的位流
+class FastDeflate::BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out(out) {}
+
+    void Put(uint32_t value, int count) {
+        bits |= static_cast<uint64_t>(value) << bitCount;
+        bitCount += count;
+        if (bitCount >= 32) {
+            size_t size = out.size();
+            out.resize(size + 4);
+            uint32_t word = static_cast<uint32_t>(bits);
+            out[size] = static_cast<uint8_t>(word);
+            out[size + 1] = static_cast<uint8_t>(word >> 8);
+            out[size + 2] = static_cast<uint8_t>(word >> 16);
+            out[size + 3] = static_cast<uint8_t>(word >> 24);
+            bits >>= 32;
+            bitCount -= 32;
+        }
+    }
+
+    // 补齐到字节边界
+    void Flush() {
+        while (bitCount > 0) {
+            out.push_back(static_cast<uint8_t>(bits));
+            bits >>= 8;
+            bitCount -= 8;
+        }
+        bits = 0;
+        bitCount = 0;
+    }
+
+private:
+    std::vector<uint8_t>& out;
+    uint64_t bits = 0;
+    int bitCount = 0;
+};
+
+void FastDeflate::BuildCodeLengths(const uint32_t* freq, int count, int maxBits, uint8_t* lengths) {
+    memset(lengths, 0, count);
+
+    // 按频率升序排列出现过的符号
+    std::vector<int> symbols;
+    for (int i = 0; i < count; i++) {
+        if (freq[i] > 0) symbols.push_back(i);
+    }
+
+    // 至少两个符号才能构成完整的码树
+    for (int i = 0; symbols.size() < 2 && i < count; i++) {
+        if (freq[i] == 0) symbols.push_back(i);
+    }
+    std::stable_sort(symbols.begin(), symbols.end(), [&](int a, int b) { return freq[a] < freq[b]; });
+
+    // Moffat-Katajainen原地算法计算最优码长
+    const int n = static_cast<int>(symbols.size());
+    std::vector<uint32_t> a(n);
+    for (int i = 0; i < n; i++) {
+        a[i] = std::max<uint32_t>(freq[symbols[i]], 1);
+    }
+
+    a[0] += a[1];
+    int root = 0, leaf = 2;
+    for (int next = 1; next < n - 1; next++) {
+        if (leaf >= n || a[root] < a[leaf]) {
+            a[next] = a[root];
+            a[root++] = next;
+        }
+        else {
+            a[next] = a[leaf++];
+        }
+
+        if (leaf >= n || (root < next && a[root] < a[leaf])) {
+            a[next] += a[root];
+            a[root++] = next;
+        }
+        else {
+            a[next] += a[leaf++];
+        }
+    }
+
+    a[n - 2] = 0;
+    for (int next = n - 3; next >= 0; next--) {
+        a[next] = a[a[next]] + 1;
+    }
+
+    int available = 1, used = 0, depth = 0;
+    root = n - 2;
+    int next = n - 1;
+    while (available > 0) {
+        while (root >= 0 && static_cast<int>(a[root]) == depth) {
+            used++;
+            root--;
+        }
+        while (available > used) {
+            a[next--] = depth;
+            available--;
+        }
+        available = 2 * used;
+        depth++;
+        used = 0;
+    }
+
+    // 统计各码长的数量，超出maxBits时调整并保持Kraft等式成立
+    int lengthCount[32] = {};
+    for (int i = 0; i < n; i++) {
+        lengthCount[std::min<uint32_t>(a[i], 31)]++;
+    }
+    for (int i = maxBits + 1; i < 32; i++) {
+        lengthCount[maxBits] += lengthCount[i];
+        lengthCount[i] = 0;
+    }
+    uint32_t total = 0;
+    for (int i = maxBits; i > 0; i--) {
+        total += static_cast<uint32_t>(lengthCount[i]) << (maxBits - i);
+    }
+    while (total != (1u << maxBits)) {
+        lengthCount[maxBits]--;
+        for (int i = maxBits - 1; i > 0; i--) {
+            if (lengthCount[i]) {
+                lengthCount[i]--;
+                lengthCount[i + 1] += 2;
+                break;
+            }
+        }
+        total--;
+    }
+
+    // 频率最低的符号分配最长的码
+    int index = 0;
+    for (int bits = maxBits; bits > 0; bits--) {
+        for (int k = 0; k < lengthCount[bits]; k++) {
+            lengths[symbols[index++]] = static_cast<uint8_t>(bits);
+        }
+    }
+}
+
+void FastDeflate::BuildCodes(const uint8_t* lengths, int count, uint16_t* codes) {
+    int lengthCount[16] = {};
+    for (int i = 0; i < count; i++) {
+        lengthCount[lengths[i]]++;
+    }
+    lengthCount[0] = 0;
+
+    int nextCode[16] = {};
+    int code = 0;
+    for (int bits = 1; bits < 16; bits++) {
+        code = (code + lengthCount[bits - 1]) << 1;
+        nextCode[bits] = code;
+    }
+
+    // deflate从低位开始写入，码字需按位反转
+    for (int i = 0; i < count; i++) {
+        int len = lengths[i];
+        if (len == 0) {
+            codes[i] = 0;
+            continue;
+        }
+        uint32_t value = static_cast<uint32_t>(nextCode[len]++);
+        uint32_t reversed = 0;
+        for (int b = 0; b < len; b++) {
+            reversed = (reversed << 1) | ((value >> b) & 1);
+        }
+        codes[i] = static_cast<uint16_t>(reversed);
+    }
+}
+
+void FastDeflate::WriteBlock(const Token* tokens, size_t count, bool final, BitWriter& writer) {
+    // 统计频率
+    uint32_t litFreq[LITLEN_CODES] = {};
+    uint32_t distFreq[DIST_CODES] = {};
+    for (size_t i = 0; i < count; i++) {
+        const Token& token = tokens[i];
+        if (token.dist == 0) {
+            litFreq[token.litLen]++;
+        }
+        else {
+            litFreq[257 + LengthCode(token.litLen)]++;
+            distFreq[DistCode(token.dist)]++;
+        }
+    }
+    litFreq[256] = 1;
+
+    uint8_t litLengths[LITLEN_CODES];
+    uint8_t distLengths[DIST_CODES];
+    BuildCodeLengths(litFreq, 286, 15, litLengths);
+    BuildCodeLengths(distFreq, DIST_CODES, 15, distLengths);
+    litLengths[286] = litLengths[287] = 0;
+
+    int litCount = 286;
+    while (litCount > 257 && litLengths[litCount - 1] == 0) litCount--;
+    int distCount = DIST_CODES;
+    while (distCount > 1 && distLengths[distCount - 1] == 0) distCount--;
+
+    // 码长序列的游程编码: 16重复前值3-6次, 17重复0共3-10次, 18重复0共11-138次
+    uint8_t allLengths[LITLEN_CODES + DIST_CODES];
+    memcpy(allLengths, litLengths, litCount);
+    memcpy(allLengths + litCount, distLengths, distCount);
+    const int totalLengths = litCount + distCount;
+
+    struct CodeLenSymbol {
+        uint8_t symbol;
+        uint8_t extra;
+    };
+    std::vector<CodeLenSymbol> rle;
+    uint32_t codeLenFreq[CODELEN_CODES] = {};
+    auto emit = [&](uint8_t symbol, uint8_t extra) {
+        rle.push_back({ symbol, extra });
+        codeLenFreq[symbol]++;
+    };
+
+    for (int i = 0; i < totalLengths;) {
+        uint8_t value = allLengths[i];
+        int run = 1;
+        while (i + run < totalLengths && allLengths[i + run] == value) run++;
+        i += run;
+
+        if (value == 0) {
+            while (run >= 11) {
+                int n = std::min(run, 138);
+                emit(18, static_cast<uint8_t>(n - 11));
+                run -= n;
+            }
+            if (run >= 3) {
+                emit(17, static_cast<uint8_t>(run - 3));
+                run = 0;
+            }
+        }
+        else {
+            emit(value, 0);
+            run--;
+            while (run >= 3) {
+                int n = std::min(run, 6);
+                emit(16, static_cast<uint8_t>(n - 3));
+                run -= n;
+            }
+        }
+        while (run-- > 0) {
+            emit(value, 0);
+        }
+    }
+
+    uint8_t codeLenLengths[CODELEN_CODES];
+    uint16_t codeLenCodes[CODELEN_CODES];
+    BuildCodeLengths(codeLenFreq, CODELEN_CODES, 7, codeLenLengths);
+    BuildCodes(codeLenLengths, CODELEN_CODES, codeLenCodes);
+
+    int codeLenCount = CODELEN_CODES;
+    while (codeLenCount > 4 && codeLenLengths[CODELEN_ORDER[codeLenCount - 1]] == 0) codeLenCount--;
+
+    uint16_t litCodes[LITLEN_CODES];
+    uint16_t distCodes[DIST_CODES];
+    BuildCodes(litLengths, LITLEN_CODES, litCodes);
+    BuildCodes(distLengths, DIST_CODES, distCodes);
+
+    // 块头
+    writer.Put(final ? 1 : 0, 1);
+    writer.Put(2, 2);
+    writer.Put(litCount - 257, 5);
+    writer.Put(distCount - 1, 5);
+    writer.Put(codeLenCount - 4, 4);
+    for (int i = 0; i < codeLenCount; i++) {
+        writer.Put(codeLenLengths[CODELEN_ORDER[i]], 3);
+    }
+    for (const auto& item : rle) {
+        writer.Put(codeLenCodes[item.symbol], codeLenLengths[item.symbol]);
+        if (item.symbol == 16) writer.Put(item.extra, 2);
+        else if (item.symbol == 17) writer.Put(item.extra, 3);
+        else if (item.symbol == 18) writer.Put(item.extra, 7);
+    }
+
+    // 块数据
+    for (size_t i = 0; i < count; i++) {
+        const Token& token = tokens[i];
+        if (token.dist == 0) {
+            writer.Put(litCodes[token.litLen], litLengths[token.litLen]);
+            continue;
+        }
+        int lengthCode = LengthCode(token.litLen);
+        writer.Put(litCodes[257 + lengthCode], litLengths[257 + lengthCode]);
+        if (LENGTH_EXTRA[lengthCode]) {
+            writer.Put(token.litLen - LENGTH_BASE[lengthCode], LENGTH_EXTRA[lengthCode]);
+        }
+        int distCode = DistCode(token.dist);
+        writer.Put(distCodes[distCode], distLengths[distCode]);
+        if (DIST_EXTRA[distCode]) {
+            writer.Put(token.dist - DIST_BASE[distCode], DIST_EXTRA[distCode]);
+        }
+    }
+    writer.Put(litCodes[256], litLengths[256]);
+}
+
+// 从两处比较，返回相同字节数，不超过limit
+static inline size_t MatchLength(const uint8_t* a, const uint8_t* b, size_t limit) {
+    size_t len = 0;
+    while (len + 8 <= limit) {
+        uint64_t diff = Load64(a + len) ^ Load64(b + len);
+        if (diff) {
+            return len + (CountTrailingZeros(diff) >> 3);
+        }
+        len += 8;
+    }
+    while (len < limit && a[len] == b[len]) len++;
+    return len;
+}
+
+void FastDeflate::Compress(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    // zlib头: 32K窗口, 最快压缩级别
+    out.push_back(0x78);
+    out.push_back(0x01);
+
+    BitWriter writer(out);
+    std::vector<uint32_t> hashTable(size_t(1) << HASH_BITS, 0);
+    std::vector<Token> tokens;
+    tokens.reserve(BLOCK_TOKENS);
+
+    auto hash = [](uint32_t value) {
+        return (value * 2654435761u) >> (32 - HASH_BITS);
+    };
+    // 槽位保存pos - base + 1，0表示空
+    size_t base = 0;
+    auto insert = [&](size_t pos) {
+        hashTable[hash(Load32(data + pos))] = static_cast<uint32_t>(pos - base + 1);
+    };
+
+    size_t pos = 0;
+    while (pos < size) {
+        // 只需保留窗口内的候选，更早的位置清空
+        if (pos - base >= REBASE_DISTANCE) {
+            const size_t shift = pos - base - WINDOW_SIZE;
+            for (uint32_t& slot : hashTable) {
+                slot = slot > shift ? static_cast<uint32_t>(slot - shift) : 0;
+            }
+            base += shift;
+        }
+
+        size_t bestLength = 0;
+        size_t bestDist = 0;
+
+        if (pos + MIN_MATCH <= size) {
+            uint32_t value = Load32(data + pos);
+            uint32_t& slot = hashTable[hash(value)];
+            size_t limit = std::min(MAX_MATCH, size - pos);
+
+            // 哈希候选
+            if (slot != 0) {
+                size_t candidate = base + slot - 1;
+                size_t dist = pos - candidate;
+                if (dist <= WINDOW_SIZE && Load32(data + candidate) == value) {
+                    bestLength = MIN_MATCH + MatchLength(data + candidate + MIN_MATCH, data + pos + MIN_MATCH, limit - MIN_MATCH);
+                    bestDist = dist;
+                }
+            }
+            slot = static_cast<uint32_t>(pos - base + 1);
+
+            // 透明区域过滤后多为同值长串，直接检测距离为1的游程
+            if (bestLength < 32 && pos > 0 && value == data[pos - 1] * 0x01010101u) {
+                size_t length = MatchLength(data + pos - 1, data + pos, limit);
+                if (length > bestLength) {
+                    bestLength = length;
+                    bestDist = 1;
+                }
+            }
+        }
+
+        if (bestLength >= MIN_MATCH) {
+            tokens.push_back({ static_cast<uint16_t>(bestLength), static_cast<uint16_t>(bestDist) });
+
+            // 短匹配逐字节更新哈希，长匹配只更新末尾
+            size_t end = pos + bestLength;
+            size_t insertFrom = bestLength <= 16 ? pos + 1 : end - 4;
+            for (size_t p = insertFrom; p < end && p + MIN_MATCH <= size; p++) {
+                insert(p);
+            }
+            pos = end;
+        }
+        else {
+            tokens.push_back({ data[pos], 0 });
+            pos++;
+        }
+
+        if (tokens.size() >= BLOCK_TOKENS) {
+            WriteBlock(tokens.data(), tokens.size(), pos >= size, writer);
+            tokens.clear();
+        }
+    }
+
+    if (!tokens.empty() || size == 0) {
+        WriteBlock(tokens.data(), tokens.size(), true, writer);
+    }
+    writer.Flush();
+
+    uint32_t adler = Checksum::Adler32(1, data, size);
+    out.push_back(static_cast<uint8_t>(adler >> 24));
+    out.push_back(static_cast<uint8_t>(adler >> 16));
+    out.push_back(static_cast<uint8_t>(adler >> 8));
+    out.push_back(static_cast<uint8_t>(adler));
+}
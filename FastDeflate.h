@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// 面向立绘数据的快速deflate压缩器
+// 单候选哈希匹配 + 游程检测的贪心LZ77，每块按实际符号频率生成动态Huffman表
+class FastDeflate {
+public:
+    /**
+     * @brief 压缩为完整的zlib流 (含zlib头和adler32)
+     * @param data 待压缩数据
+     * @param size 数据长度
+     * @param out 输出缓冲，压缩结果追加到末尾
+     */
+    static void Compress(const uint8_t* data, size_t size, std::vector<uint8_t>& out);
+
+private:
+    class BitWriter;
+
+    // LZ77符号：dist为0时litLen为字面量，否则为匹配长度
+    struct Token {
+        uint16_t litLen;
+        uint16_t dist;
+    };
+
+    /**
+     * @brief 将一组符号编码为一个动态Huffman块
+     * @param tokens 符号列表
+     * @param count 符号数量
+     * @param final 是否为最后一块
+     * @param writer 位写入器
+     */
+    static void WriteBlock(const Token* tokens, size_t count, bool final, BitWriter& writer);
+
+    /**
+     * @brief 按频率生成长度受限的Huffman码长
+     * @param freq 各符号频率
+     * @param count 符号数量
+     * @param maxBits 最大码长
+     * @param lengths 输出的码长
+     */
+    static void BuildCodeLengths(const uint32_t* freq, int count, int maxBits, uint8_t* lengths);
+
+    /**
+     * @brief 由码长生成位反转后的规范Huffman码
+     * @param lengths 码长
+     * @param count 符号数量
+     * @param codes 输出的码字
+     */
+    static void BuildCodes(const uint8_t* lengths, int count, uint16_t* codes);
+};
@@ -1,311 +1,1685 @@
 #include "FgComposer.h"
+#include "AtlasPacker.h"
+#include "FileWatcher.h"
+#include "Json.h"
+#include "QoiCodec.h"
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <unordered_set>
 
 namespace fs = std::filesystem;
 
-FgComposer::FgComposer(const Config& config) : config(config) {
-    Logger::Debug("FgComposerʼʼ");
+// 加载当前文件时提前预读的文件数
+constexpr size_t PREFETCH_DEPTH = 4;
 
-    // Lua·Lua
-    if (!config.luaPath.empty()) {
-        if (luaParser.loadLuaFile(config.luaPath)) {
+// 流式合成时每次生成的行数
+constexpr int STREAM_BAND_ROWS = 32;
 
-            // 
-            if (luaParser.parseGroups(config.globalName)) {
-                Logger::Info("Luaļɹ");
-            }
-            else {
-                Logger::Warning("Luaļʧ");
-            }
+// 图集中相邻合成结果之间的透明间隔
+constexpr int ATLAS_PADDING = 2;
+
+// 监视模式每次等待文件变化的时长，超时后检查是否需要停止
+constexpr int WATCH_WAIT_MS = 500;
+
+// PFS归档中坐标表的默认路径
+static const char* const PFS_POSITION_TABLE = "system/table/list_windows.tbl";
+
+// 由配置得到PNG编码参数，auto压缩级别保持默认值，由调优决定
+static PngEncodeOptions makePngEncodeOptions(const Config& config) {
+    PngEncodeOptions options;
+    if (!config.pngEncoder.empty()) {
+        ImageProcessor::ParsePngEncoder(config.pngEncoder, options.encoder);
+    }
+    if (!config.pngLevel.empty() && config.pngLevel != "auto") {
+        options.level = std::stoi(config.pngLevel);
+    }
+    if (!config.pngFilter.empty()) {
+        ImageProcessor::ParsePngFilter(config.pngFilter, options.filters);
+    }
+    if (!config.pngStrategy.empty()) {
+        ImageProcessor::ParsePngStrategy(config.pngStrategy, options.strategy);
+    }
+    return options;
+}
+
+static PngDecodeOptions makePngDecodeOptions(const Config& config) {
+    PngDecodeOptions options;
+    options.fastPath = config.pngDecoder != "libpng";
+    options.verifyCrc = !config.pngSkipCrc;
+    return options;
+}
+
+static bool isQoiExtension(const std::string& extension) {
+    return extension == ".qoi" || extension == ".QOI";
+}
+
+FgComposer::FgComposer(const Config& config) : FgComposer(config, SharedResources()) {
+}
+
+FgComposer::FgComposer(const Config& config, const SharedResources& shared)
+    : config(config),
+    batchMode(shared.luaParser || shared.partCache || shared.pfs || shared.writer),
+    luaParser(shared.luaParser ? shared.luaParser : ownLuaParser.get()),
+    partCache(shared.partCache ? *shared.partCache : ownPartCache),
+    pfs(shared.pfs ? *shared.pfs : ownPfs),
+    writer(shared.writer ? *shared.writer : ownWriter) {
+    Logger::Debug("FgComposer初始化开始");
+
+    // 从归档读取时先打开归档，坐标表也可以直接从归档中读取
+    if (!config.pfsPath.empty() && !shared.pfs) {
+        ownPfs.Open(config.pfsPath);
+    }
+
+    // 共享的坐标表已由调用方加载并解析了本目录的字段
+    if (shared.luaParser) {
+        Logger::Debug("使用共享的坐标表");
+    }
+    else if (loadPositionTable(config, pfs, *luaParser)) {
+        if (luaParser->parseGroups(config.globalName)) {
+            Logger::Info("Lua文件解析成功");
         }
         else {
-            Logger::Warning("Luaļʧ: " + config.luaPath);
+            Logger::Warning("Lua文件解析失败");
         }
     }
-    else {
-        Logger::Info("δLua·ʹϢ");
+
+    Logger::Debug("FgComposer初始化完成");
+}
+
+bool FgComposer::loadPositionTable(const Config& config, const PfsArchive& pfs, LuaParser& parser) {
+    // 如果有Lua路径，加载Lua解析器
+    parser.setIndexDirectory(config.luaIndexDir);
+    std::string luaSource = config.luaPath;
+    bool luaLoaded = false;
+    if (!config.luaPath.empty() && (!pfs.IsOpen() || fs::exists(config.luaPath))) {
+        luaLoaded = parser.loadLuaFile(config.luaPath);
+    }
+    else if (pfs.IsOpen()) {
+        // 未指定时使用引擎存放坐标表的默认位置，归档中没有则使用内置坐标
+        const std::string tableName = config.luaPath.empty() ? PFS_POSITION_TABLE : config.luaPath;
+        if (const PfsArchive::Entry* entry = pfs.Find(tableName)) {
+            BufferPool::Buffer scratch;
+            const uint8_t* data = pfs.Read(*entry, scratch);
+            luaSource = tableName;
+            luaLoaded = parser.loadLuaBuffer(reinterpret_cast<const char*>(data), entry->size,
+                config.pfsPath + ":" + tableName);
+        }
     }
 
-    Logger::Debug("FgComposerʼ");
+    if (luaSource.empty()) {
+        Logger::Info("未配置Lua路径，将使用内置坐标信息");
+    }
+    else if (!luaLoaded) {
+        Logger::Warning("Lua文件加载失败: " + luaSource);
+    }
+    return luaLoaded;
+}
+
+void FgComposer::applyCodecOptions(const Config& config) {
+    ImageProcessor::SetPngDecodeOptions(makePngDecodeOptions(config));
+    if (config.pngLevel == "auto") {
+        Logger::Warning("批量和服务模式不支持自动调优PNG编码参数，使用默认压缩级别");
+    }
+    ImageProcessor::SetPngEncodeOptions(makePngEncodeOptions(config));
 }
 
 FgComposer::~FgComposer() {
-    Logger::Debug("ʼFgComposerԴ");
+    Logger::Debug("开始清理FgComposer资源");
 
-    // Դ
+    // 清理资源
     int freedCount = 0;
-    for (auto& [filename, image] : images) {
+    for (auto& image : partImages) {
         ImageProcessor::FreeImage(image);
         freedCount++;
     }
 
-    Logger::Debug("ͷ " + std::to_string(freedCount) + " ͼԴ");
+    Logger::Debug("已释放 " + std::to_string(freedCount) + " 个图像资源");
+
+    // 归还内存池中缓存的空闲内存，批量模式下留给其他目录复用
+    if (!batchMode) {
+        BufferPool::Trim();
+    }
 }
 
 bool FgComposer::process() {
-    Logger::Info("ʼ");
+    Logger::Info("开始处理流程");
+
+    // 1. 加载分类图像并生成组合
+    if (!prepare()) {
+        return false;
+    }
+
+    // 只预估时不解码也不输出
+    if (config.dryRun) {
+        return forecastCombinations();
+    }
+
+    // 3. 保存组合
+    Logger::Info("开始保存图像组合");
+    if (!composeImages()) {
+        Logger::Error("图像合成和保存失败");
+        return false;
+    }
+
+    Logger::Info("处理流程完成");
+    return true;
+}
+
+bool FgComposer::prepare() {
+    BufferPool::SetHugePages(config.hugePages);
 
-    // 1. طͼ
-    Logger::Info("ʼغͷĿ¼еͼ");
+    Logger::Info("开始加载和分类目录中的图像");
     if (!loadAndClassifyImages()) {
-        Logger::Error("ͼغͷʧ");
+        Logger::Error("图像加载和分类失败");
         return false;
     }
-    //Logger::Info("ͼغͷɣ " + std::to_string(images.size()) + " ͼ");
+    //Logger::Info("图像加载和分类完成，共加载 " + std::to_string(images.size()) + " 个图像");
 
-    // 2. 
-    Logger::Info("ʼͼ");
+    // 2. 生成组合
+    Logger::Info("开始生成图像组合");
     if (!generateCombinations()) {
-        Logger::Error("ͼʧ");
+        Logger::Error("图像组合生成失败");
         return false;
     }
-    //Logger::Info("ͼɣ " + std::to_string(combinations.size()) + " ");
+    //Logger::Info("图像组合生成完成，共生成 " + std::to_string(combinations.size()) + " 个组合");
+    return true;
+}
 
-    // 3. 
-    Logger::Info("ʼͼ");
-    if (!composeImages()) {
-        Logger::Error("ͼϳɺͱʧ");
+bool FgComposer::composeParts(const std::vector<std::string>& names, ImageData& result) const {
+    if (names.empty() || names.size() >= INVALID_PART) {
+        return false;
+    }
+    std::vector<PartId> ids;
+    for (const std::string& name : names) {
+        auto it = partIds.find(name);
+        if (it == partIds.end()) {
+            Logger::Debug("部件不存在: " + name);
+            return false;
+        }
+        ids.push_back(it->second);
+    }
+
+    Combination combination;
+    combination.ids = ids.data();
+    combination.count = ids.size();
+    return composeCombination(combination, result);
+}
+
+std::vector<std::string> FgComposer::getCombinationParts(size_t index) const {
+    std::vector<std::string> names;
+    Combination combination = getCombination(index);
+    for (size_t j = 0; j < combination.count; j++) {
+        names.push_back(partNames[combination.ids[j]]);
+    }
+    return names;
+}
+
+bool FgComposer::addPart(const std::string& name, const uint8_t* data, size_t size) {
+    const bool isQoi = size >= 4 && memcmp(data, "qoif", 4) == 0;
+    const bool readPos = !luaParser->Loaded();
+    ImageData image;
+    if (!(isQoi ? QoiCodec::Decode(data, size, image, readPos) : ImageProcessor::LoadPngFromMemory(data, size, image, readPos))) {
+        Logger::Warning("图像加载失败: " + name);
+        return false;
+    }
+    if (!image.data.AlphaSpans()) {
+        ImageProcessor::UpdateAlphaSpans(image);
+    }
+    if (luaParser->Loaded()) {
+        const auto& [x, y] = luaParser->getFilePos(config.globalName, name);
+        image.posX = x;
+        image.posY = y;
+    }
+
+    // 替换已有部件时分类不变
+    const bool replaced = partIds.count(name) > 0;
+    PartId id = storePart(name, image);
+    if (id == INVALID_PART) {
+        ImageProcessor::FreeImage(image);
+        return false;
+    }
+    if (!replaced) {
+        classifyPart(name, id);
+    }
+    return true;
+}
+
+bool FgComposer::setPartPosition(const std::string& name, int x, int y) {
+    auto it = partIds.find(name);
+    if (it == partIds.end()) {
+        return false;
+    }
+    partImages[it->second].posX = x;
+    partImages[it->second].posY = y;
+    return true;
+}
+
+bool FgComposer::loadPositionBuffer(const char* text, size_t size, const std::string& sourceName) {
+    if (!luaParser->loadLuaBuffer(text, size, sourceName) || !luaParser->parseGroups(config.globalName)) {
+        Logger::Warning("坐标表加载失败: " + sourceName);
         return false;
     }
+    for (size_t id = 0; id < partImages.size(); id++) {
+        const auto& [x, y] = luaParser->getFilePos(config.globalName, partNames[id]);
+        partImages[id].posX = x;
+        partImages[id].posY = y;
+    }
+    return true;
+}
+
+std::string FgComposer::getCombinationName(size_t index) const {
+    std::string name;
+    Combination combination = getCombination(index);
+    for (size_t j = 0; j < combination.count; j++) {
+        if (j > 0) {
+            name += "_";
+        }
+        name += partNames[combination.ids[j]];
+    }
+    return name;
+}
+
+bool FgComposer::measureCombination(size_t index, ImageData& canvas) const {
+    std::vector<Layer> layers;
+    return layoutCombination(getCombination(index), layers, canvas);
+}
 
-    Logger::Info("");
+bool FgComposer::composeCombinationInto(size_t index, const ImageSpan& canvas) const {
+    Combination combination = getCombination(index);
+    std::vector<Layer> layers;
+    ImageData header;
+    if (!layoutCombination(combination, layers, header) || !checkLayers(combination, layers)) {
+        return false;
+    }
+    if (canvas.width != header.width || canvas.height != header.height || canvas.channels != 4) {
+        Logger::Error("画布尺寸与组合不符: " + getCombinationName(index));
+        return false;
+    }
+    composeLayers(layers, canvas);
     return true;
 }
 
+bool FgComposer::watch(const std::function<bool()>& stopRequested) {
+    if (!process()) {
+        return false;
+    }
+    watching = true;
+    buildPartUsage();
+
+    // 坐标表可能不在输入目录中，另外监视其所在目录
+    FileWatcher watcher;
+    if (!watcher.AddDirectory(config.inputDir)) {
+        return false;
+    }
+    const fs::path luaFile = config.luaPath.empty() ? fs::path() : fs::absolute(config.luaPath).lexically_normal();
+    if (!config.luaPath.empty() && !watcher.AddDirectory(luaFile.parent_path().string())) {
+        Logger::Warning("无法监视坐标表: " + config.luaPath);
+    }
+    Logger::Info(std::string("开始监视输入目录") + (config.luaPath.empty() ? "" : "和坐标表") +
+        (watcher.UsesNotification() ? "" : " (定时扫描)") + "，按Ctrl+C退出");
+
+    std::vector<std::string> changed;
+    while (!stopRequested()) {
+        if (!watcher.Wait(WATCH_WAIT_MS, changed)) {
+            continue;
+        }
+
+        auto startTime = std::chrono::steady_clock::now();
+        bool positionsChanged = false;
+        std::vector<std::string> partFiles;
+        for (const std::string& filepath : changed) {
+            const fs::path path(filepath);
+            std::error_code ec;
+            if (!config.luaPath.empty() && path.filename() == luaFile.filename() &&
+                fs::equivalent(path.parent_path(), luaFile.parent_path(), ec)) {
+                positionsChanged = true;
+                continue;
+            }
+            std::string extension = path.extension().string();
+            if ((extension == ".png" || extension == ".PNG" || isQoiExtension(extension)) &&
+                fs::equivalent(path.parent_path(), config.inputDir, ec)) {
+                partFiles.push_back(filepath);
+            }
+        }
+        if (!positionsChanged && partFiles.empty()) {
+            continue;
+        }
+
+        applyChanges(partFiles, positionsChanged);
+        Logger::Info("更新完成，耗时 " + std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - startTime).count()) + " ms");
+    }
+
+    Logger::Info("停止监视");
+    return true;
+}
+
+void FgComposer::buildPartUsage() {
+    // 先统计每个部件被引用的次数，再按部件ID分段填入组合序号
+    partUsageOffsets.assign(partImages.size() + 1, 0);
+    const size_t totalCombinations = combinationCount();
+    for (PartId id : combinationTable) {
+        if (id != INVALID_PART) {
+            partUsageOffsets[id + 1]++;
+        }
+    }
+    for (size_t id = 0; id < partImages.size(); id++) {
+        partUsageOffsets[id + 1] += partUsageOffsets[id];
+    }
+
+    partUsage.resize(partUsageOffsets.back());
+    std::vector<uint32_t> cursor(partUsageOffsets.begin(), partUsageOffsets.end() - 1);
+    for (size_t i = 0; i < totalCombinations; i++) {
+        Combination combination = getCombination(i);
+        for (size_t j = 0; j < combination.count; j++) {
+            partUsage[cursor[combination.ids[j]]++] = static_cast<uint32_t>(i);
+        }
+    }
+}
+
+bool FgComposer::applyChanges(const std::vector<std::string>& changedFiles, bool positionsChanged) {
+    std::vector<bool> dirtyParts(partImages.size(), false);
+
+    // 先更新坐标表，之后重新解码的部件直接使用新坐标
+    if (positionsChanged) {
+        reloadPositionTable(dirtyParts);
+    }
+
+    bool structureChanged = false;
+    for (const std::string& filepath : changedFiles) {
+        const fs::path path(filepath);
+        const std::string filename = path.stem().string();
+        std::error_code ec;
+        const bool exists = fs::is_regular_file(path, ec);
+        auto idIt = partIds.find(filename);
+
+        // 新增或删除的文件改变组合表，稍后统一重新扫描
+        if (idIt == partIds.end() || !exists) {
+            if (exists || idIt != partIds.end()) {
+                Logger::Info((exists ? "新增部件: " : "删除部件: ") + filename);
+                structureChanged = true;
+            }
+            continue;
+        }
+
+        ImageData image;
+        if (!decodePartFile(filepath, isQoiExtension(path.extension().string()), image)) {
+            Logger::Warning("部件加载失败，保留原有图像: " + filepath);
+            continue;
+        }
+        if (!image.data.AlphaSpans()) {
+            ImageProcessor::UpdateAlphaSpans(image);
+        }
+        if (luaParser->Loaded()) {
+            const auto& [x, y] = luaParser->getFilePos(config.globalName, filename);
+            image.posX = x;
+            image.posY = y;
+        }
+
+        const PartId id = idIt->second;
+        ImageProcessor::FreeImage(partImages[id]);
+        partImages[id] = std::move(image);
+        dirtyParts[id] = true;
+        Logger::Info("已重新解码部件: " + filename);
+    }
+
+    bool partsRemoved = false;
+    if (structureChanged && !rebuildCombinations(dirtyParts, partsRemoved)) {
+        return false;
+    }
+    return recomposeParts(dirtyParts, partsRemoved);
+}
+
+bool FgComposer::reloadPositionTable(std::vector<bool>& dirtyParts) {
+    // 在新的解析器中加载，成功后整体替换；保存到一半或有语法错误时保留原有坐标
+    auto candidate = std::make_unique<LuaParser>();
+    candidate->setIndexDirectory(config.luaIndexDir);
+    // 与部件相同，读入缓冲后解析，不映射可能正被重写的文件
+    BufferPool::Buffer script;
+    if (!MappedFile::ReadAll(config.luaPath, script) ||
+        !candidate->loadLuaBuffer(reinterpret_cast<const char*>(script.data()), script.size(), config.luaPath) ||
+        !candidate->parseGroups(config.globalName)) {
+        Logger::Warning("坐标表加载失败，保留原有坐标: " + config.luaPath);
+        return false;
+    }
+    // 监视模式不与批量模式同时使用，解析器总是本对象所有
+    ownLuaParser = std::move(candidate);
+    luaParser = ownLuaParser.get();
+
+    size_t movedCount = 0;
+    for (size_t id = 0; id < partImages.size(); id++) {
+        const auto& [x, y] = luaParser->getFilePos(config.globalName, partNames[id]);
+        ImageData& image = partImages[id];
+        if (image.posX != x || image.posY != y) {
+            image.posX = x;
+            image.posY = y;
+            dirtyParts[id] = true;
+            movedCount++;
+        }
+    }
+    Logger::Info("坐标表已重新加载，" + std::to_string(movedCount) + " 个部件的坐标改变");
+    return true;
+}
+
+bool FgComposer::rebuildCombinations(std::vector<bool>& dirtyParts, bool& partsRemoved) {
+    Logger::Info("部件增加或删除，重新生成组合");
+
+    // 已解码的部件按文件名保留，重新扫描时只解码新增的文件
+    std::unordered_set<std::string> oldNames(partNames.begin(), partNames.end());
+    std::unordered_set<std::string> dirtyNames;
+    for (size_t id = 0; id < partImages.size(); id++) {
+        if (dirtyParts[id]) {
+            dirtyNames.insert(partNames[id]);
+        }
+        retainedParts.emplace(partNames[id], std::move(partImages[id]));
+    }
+    partImages.clear();
+    partNames.clear();
+    partIds.clear();
+    groups.clear();
+
+    const bool success = loadAndClassifyImages() && generateCombinations();
+
+    // 没有被沿用的就是已删除的部件
+    partsRemoved = !retainedParts.empty();
+    for (auto& [name, image] : retainedParts) {
+        ImageProcessor::FreeImage(image);
+    }
+    retainedParts.clear();
+    if (!success) {
+        return false;
+    }
+
+    buildPartUsage();
+    dirtyParts.assign(partImages.size(), false);
+    for (size_t id = 0; id < partImages.size(); id++) {
+        dirtyParts[id] = dirtyNames.count(partNames[id]) > 0 || oldNames.count(partNames[id]) == 0;
+    }
+    return true;
+}
+
+bool FgComposer::recomposeParts(const std::vector<bool>& dirtyParts, bool allGroups) {
+    // 引用了变化部件的组合
+    std::vector<uint32_t> affected;
+    for (size_t id = 0; id < dirtyParts.size(); id++) {
+        if (dirtyParts[id]) {
+            affected.insert(affected.end(), partUsage.begin() + partUsageOffsets[id],
+                partUsage.begin() + partUsageOffsets[id + 1]);
+        }
+    }
+    std::sort(affected.begin(), affected.end());
+    affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+
+    const bool groupedOutput = config.atlas || config.delta;
+    if (allGroups && !groupedOutput) {
+        Logger::Info("已删除部件的组合不再输出，原有的输出文件保留");
+    }
+    if (affected.empty() && !(allGroups && groupedOutput)) {
+        Logger::Info("没有组合引用变化的部件");
+        return true;
+    }
+
+    const bool streamRows = config.streamRows && config.outputFormat != "qoi" && !groupedOutput;
+    if (!streamRows && config.writeQueueSize > 0) {
+        writer.Start(static_cast<size_t>(config.writeQueueSize) * 1024 * 1024);
+    }
+
+    int successCount = 0;
+    int failCount = 0;
+    if (groupedOutput) {
+        // 图集和差分按基础图像整段输出，重新输出受影响的各段
+        const size_t totalCombinations = combinationCount();
+        size_t next = 0;
+        for (size_t begin = 0, end; begin < totalCombinations; begin = end) {
+            end = baseRunEnd(begin);
+            while (next < affected.size() && affected[next] < begin) {
+                next++;
+            }
+            if (!allGroups && (next == affected.size() || affected[next] >= end)) {
+                continue;
+            }
+            const PartId baseId = combinationTable[begin * combinationWidth];
+            const bool success = config.atlas ? composeAtlasGroup(begin, end, partNames[baseId]) :
+                composeDeltaGroup(begin, end, baseId);
+            if (success) {
+                successCount++;
+            }
+            else {
+                failCount++;
+            }
+        }
+    }
+    else {
+        ImageData result;
+        for (uint32_t index : affected) {
+            if (composeSeparateFile(index, streamRows, result)) {
+                successCount++;
+            }
+            else {
+                failCount++;
+            }
+        }
+        ImageProcessor::FreeImage(result);
+    }
+
+    if (writer.IsRunning() && !writer.Finish()) {
+        failCount++;
+    }
+    Logger::Info("重新合成完成: " + std::string(groupedOutput ? "基础图像" : "组合") + " 成功 " +
+        std::to_string(successCount) + ", 失败 " + std::to_string(failCount));
+    return failCount == 0;
+}
+
 bool FgComposer::loadAndClassifyImages() {
-    Logger::Debug("ʼغͷĿ¼еͼ: " + config.inputDir);
+    Logger::Debug("开始加载和分类目录中的图像: " + config.inputDir);
+
+    // 批量模式下解码参数和部件缓存由调用方统一准备
+    if (!batchMode) {
+        ImageProcessor::SetPngDecodeOptions(makePngDecodeOptions(config));
+    }
+
+    if (!config.pfsPath.empty() && !pfs.IsOpen()) {
+        return false;
+    }
+    if (!config.cachePath.empty() && pfs.IsOpen()) {
+        Logger::Warning("从PFS归档读取时不使用部件缓存");
+    }
+    else if (!config.cachePath.empty() && !config.dryRun && !batchMode && !watching) {
+        partCache.Open(config.cachePath);
+    }
+    auto startTime = std::chrono::steady_clock::now();
 
     try {
         int loadedCount = 0;
         int skippedCount = 0;
 
-        for (const auto& entry : fs::directory_iterator(config.inputDir)) {
-            if (!entry.is_regular_file()) {
-                continue;
+        // 先列出全部图像文件，以便提前预读后续文件
+        std::vector<fs::path> imageFiles;
+        std::vector<const PfsArchive::Entry*> archivedFiles;    // 与imageFiles一一对应，从目录读取时为空
+        auto isImageFile = [&](const fs::path& path) {
+            // 只处理PNG和QOI图片
+            std::string extension = path.extension().string();
+            if (extension != ".png" && extension != ".PNG" && !isQoiExtension(extension)) {
+                Logger::Debug("跳过非图像文件: " + path.string());
+                skippedCount++;
+                return false;
+            }
+            return true;
+        };
+        if (pfs.IsOpen()) {
+            for (const PfsArchive::Entry* entry : pfs.List(config.inputDir)) {
+                if (isImageFile(entry->name)) {
+                    imageFiles.push_back(entry->name);
+                    archivedFiles.push_back(entry);
+                }
             }
+            if (imageFiles.empty()) {
+                Logger::Warning("PFS归档中没有找到图像: " + config.inputDir);
+            }
+        }
+        else {
+            for (const auto& entry : fs::directory_iterator(config.inputDir)) {
+                if (entry.is_regular_file() && isImageFile(entry.path())) {
+                    imageFiles.push_back(entry.path());
+                }
+            }
+        }
 
-            std::string filepath = entry.path().string();
-            std::string extension = entry.path().extension().string();
+        auto prefetch = [&](size_t index) {
+            if (pfs.IsOpen()) {
+                pfs.Prefetch(*archivedFiles[index]);
+            }
+            else {
+                MappedFile::Prefetch(imageFiles[index].string());
+            }
+        };
+        for (size_t i = 0; i < std::min(PREFETCH_DEPTH, imageFiles.size()); i++) {
+            prefetch(i);
+        }
 
-            // ֻPNGͼƬ
-            if (extension != ".png" && extension != ".PNG") {
-                Logger::Debug("PNGļ: " + filepath);
-                skippedCount++;
-                continue;
+        for (size_t fileIndex = 0; fileIndex < imageFiles.size(); fileIndex++) {
+            const fs::path& path = imageFiles[fileIndex];
+            if (fileIndex + PREFETCH_DEPTH < imageFiles.size()) {
+                prefetch(fileIndex + PREFETCH_DEPTH);
             }
 
-            std::string filename = entry.path().stem().string();
-            Logger::Info("ͼļ: " + filename);
+            std::string filepath = path.string();
+            std::string filename = path.stem().string();
+            const bool isQoi = isQoiExtension(path.extension().string());
+            Logger::Info("处理图像文件: " + filename);
 
-            // ͼ
+            // 加载图像
             ImageData image;
             bool loadSuccess = false;
-            if (luaParser.Loaded()) {
-                Logger::Debug("ͼ: " + filename);
-                loadSuccess = ImageProcessor::LoadPng(filepath, image);
+            auto retained = retainedParts.find(filename);
+            if (retained != retainedParts.end()) {
+                // 重新扫描时未变化的部件沿用已解码的数据
+                Logger::Debug("沿用已解码的图像: " + filename);
+                image = std::move(retained->second);
+                retainedParts.erase(retained);
+                loadSuccess = true;
+            }
+            else if (pfs.IsOpen()) {
+                Logger::Debug("从归档加载图像: " + filename);
+                loadSuccess = loadArchivedImage(*archivedFiles[fileIndex], isQoi, image);
             }
             else {
-                Logger::Debug("ʹͼ: " + filename);
-                loadSuccess = ImageProcessor::LoadPngWithPos(filepath, image);
+                loadSuccess = decodePartFile(filepath, isQoi, image);
             }
 
             if (!loadSuccess) {
-                Logger::Warning("ͼʧ: " + filepath);
+                Logger::Warning("图像加载失败: " + filepath);
                 skippedCount++;
                 continue;
             }
 
-            // 
-            if (luaParser.Loaded()) {
-                const auto& [x, y] = luaParser.getFilePos(config.globalName, filename);
+            // 未经缓存加载的部件在此计算非透明范围
+            if (!config.dryRun && !image.data.AlphaSpans()) {
+                ImageProcessor::UpdateAlphaSpans(image);
+            }
+
+            // 更新坐标
+            if (luaParser->Loaded()) {
+                const auto& [x, y] = luaParser->getFilePos(config.globalName, filename);
                 image.posX = x;
                 image.posY = y;
             }
-            // 洢ͼ
-            images[filename] = std::move(image);
-            loadedCount++;
-
-            // 
-            std::string groupName = getGroupName(filename);
-            if (groupName.empty()) {
-                Logger::Warning("޷ʶͼ: " + filename);
+            PartId id = storePart(filename, image);
+            if (id == INVALID_PART) {
+                skippedCount++;
                 continue;
             }
+            loadedCount++;
+            classifyPart(filename, id);
+        }
 
-            std::string partName = getPartName(filename);
-            if (partName.empty()) {
-                Logger::Warning("޷ʶͼ񲿼: " + filename);
-                continue;
-            }
+        Logger::Info("图像加载完成: 成功 " + std::to_string(loadedCount) +
+            ", 跳过 " + std::to_string(skippedCount) +
+            ", 总组数 " + std::to_string(groups.size()));
+        Logger::Info("加载耗时 " + std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - startTime).count()) + " ms");
 
-            // ӵӦͲ
-            groups[groupName].parts[partName].files.push_back(filename);
-            Logger::Info("ͼ: " + filename + " -> [" + groupName + "], [" + partName + "]");
+        if (!config.cachePath.empty() && !batchMode && !watching) {
+            Logger::Info("缓存命中 " + std::to_string(partCache.HitCount()) +
+                ", 未命中 " + std::to_string(partCache.MissCount()));
+            partCache.Finish();
         }
-
-        Logger::Info("ͼ: ɹ " + std::to_string(loadedCount) +
-            ",  " + std::to_string(skippedCount) +
-            ",  " + std::to_string(groups.size()));
         return true;
     }
     catch (const fs::filesystem_error& ex) {
-        Logger::Error("ļϵͳ: " + std::string(ex.what()));
+        Logger::Error("文件系统错误: " + std::string(ex.what()));
         return false;
     }
     catch (const std::exception& ex) {
-        Logger::Error("ͼʱ쳣: " + std::string(ex.what()));
+        Logger::Error("加载图像时发生异常: " + std::string(ex.what()));
         return false;
     }
 }
 
+FgComposer::PartId FgComposer::storePart(const std::string& filename, ImageData& image) {
+    // 同名文件沿用已有ID
+    auto idIt = partIds.find(filename);
+    if (idIt != partIds.end()) {
+        ImageProcessor::FreeImage(partImages[idIt->second]);
+        partImages[idIt->second] = std::move(image);
+        return idIt->second;
+    }
+    if (partImages.size() >= INVALID_PART) {
+        Logger::Warning("部件数量超过上限 " + std::to_string(INVALID_PART) + "，跳过: " + filename);
+        return INVALID_PART;
+    }
+    const PartId id = static_cast<PartId>(partImages.size());
+    partIds.emplace(filename, id);
+    partImages.push_back(std::move(image));
+    partNames.push_back(filename);
+    return id;
+}
+
+void FgComposer::classifyPart(const std::string& filename, PartId id) {
+    std::string groupName = getGroupName(filename);
+    if (groupName.empty()) {
+        Logger::Warning("无法识别图像组名: " + filename);
+        return;
+    }
+
+    std::string partName = getPartName(filename);
+    if (partName.empty()) {
+        Logger::Warning("无法识别图像部件名: " + filename);
+        return;
+    }
+
+    // 添加到对应的组和部件
+    groups[groupName].parts[partName].files.push_back(id);
+    Logger::Info("图像分类: " + filename + " -> 组[" + groupName + "], 部件[" + partName + "]");
+}
+
+bool FgComposer::decodePartFile(const std::string& filepath, bool isQoi, ImageData& image) {
+    const std::string filename = fs::path(filepath).stem().string();
+    if (config.dryRun) {
+        // 只读取文件头，图像数据为空，仅供生成组合和预估画布
+        PngInfo info;
+        const bool success = isQoi ? ImageProcessor::ProbeQoi(filepath, info) : ImageProcessor::ProbePng(filepath, info);
+        image.width = info.width;
+        image.height = info.height;
+        image.channels = 4;
+        image.posX = info.posX;
+        image.posY = info.posY;
+        return success;
+    }
+    if (watching) {
+        // 变化的文件可能正被截断重写，读入缓冲后再解码，不映射文件
+        BufferPool::Buffer contents;
+        if (!MappedFile::ReadAll(filepath, contents)) {
+            Logger::Error("无法读取文件: " + filepath);
+            return false;
+        }
+        Logger::Debug("重新加载图像: " + filename);
+        const bool readPos = !luaParser->Loaded();
+        if (isQoi) {
+            return QoiCodec::Decode(contents.data(), contents.size(), image, readPos);
+        }
+        return ImageProcessor::LoadPngFromMemory(contents.data(), contents.size(), image, readPos);
+    }
+    if (isQoi) {
+        // QOI解码本身很快，不经过缓存
+        Logger::Debug("加载QOI图像: " + filename);
+        return ImageProcessor::LoadQoi(filepath, image, !luaParser->Loaded());
+    }
+    if (!config.cachePath.empty() && !watching) {
+        Logger::Debug("通过缓存加载图像: " + filename);
+        return partCache.Load(filepath, !luaParser->Loaded(), image);
+    }
+    if (luaParser->Loaded()) {
+        Logger::Debug("加载图像: " + filename);
+        return ImageProcessor::LoadPng(filepath, image);
+    }
+    Logger::Debug("使用内置坐标加载图像: " + filename);
+    return ImageProcessor::LoadPngWithPos(filepath, image);
+}
+
+bool FgComposer::loadArchivedImage(const PfsArchive::Entry& entry, bool isQoi, ImageData& image) {
+    // 未加密的条目直接从映射解码，加密条目先解密到临时缓冲
+    BufferPool::Buffer scratch;
+    const uint8_t* data = pfs.Read(entry, scratch);
+    const bool readPos = !luaParser->Loaded();
+
+    if (config.dryRun) {
+        PngInfo info;
+        if (!(isQoi ? QoiCodec::Probe(data, entry.size, info) : ImageProcessor::ProbePngFromMemory(data, entry.size, info))) {
+            return false;
+        }
+        image.width = info.width;
+        image.height = info.height;
+        image.channels = 4;
+        image.posX = info.posX;
+        image.posY = info.posY;
+        return true;
+    }
+    if (isQoi) {
+        return QoiCodec::Decode(data, entry.size, image, readPos);
+    }
+    return ImageProcessor::LoadPngFromMemory(data, entry.size, image, readPos);
+}
+
 bool FgComposer::generateCombinations() {
-    Logger::Debug("ʼͼ");
+    Logger::Debug("开始生成图像组合");
+
+    // 组合表每行的宽度取各组图层数的最大值
+    combinationTable.clear();
+    combinationWidth = 1;
+    for (const auto& [groupName, group] : groups) {
+        size_t layerCount = 1;
+        for (const auto& [partName, part] : group.parts) {
+            if (partName != "base" && !part.files.empty()) {
+                layerCount++;
+            }
+        }
+        combinationWidth = std::max(combinationWidth, layerCount);
+    }
 
     int totalCombinations = 0;
+    std::vector<PartId> row(combinationWidth);
 
     for (const auto& [groupName, group] : groups) {
 
-        Logger::Info(": " + groupName);
+        Logger::Info("处理组: " + groupName);
 
-        // л
+        // 必须有基础层
         auto baseIt = group.parts.find("base");
         if (baseIt == group.parts.end() || baseIt->second.files.empty()) {
-            Logger::Warning(" " + groupName + " ȱٻ(base)");
+            Logger::Warning("组 " + groupName + " 缺少基础层(base)，跳过");
             continue;
         }
 
-        // ռ
-        std::vector<std::vector<std::string>> partFiles;
+        // 收集所有其他部件
+        std::vector<std::vector<PartId>> partFiles;
 
         for (const auto& [partName, part] : group.parts) {
             if (partName != "base" && !part.files.empty()) {
                 partFiles.push_back(part.files);
-                Logger::Debug(" " + groupName + "  " + partName + "  " +
-                    std::to_string(part.files.size()) + " ļ");
+                Logger::Debug("组 " + groupName + " 部件 " + partName + " 有 " +
+                    std::to_string(part.files.size()) + " 个文件");
             }
         }
 
-        // Ϊÿͼ
-        Logger::Debug(" " + groupName + "  " + std::to_string(baseIt->second.files.size()) + " ͼ");
+        // 为每个基础图像生成组合
+        Logger::Debug("组 " + groupName + " 有 " + std::to_string(baseIt->second.files.size()) + " 个基础图像");
+
+        std::fill(row.begin(), row.end(), INVALID_PART);
+        for (PartId baseId : baseIt->second.files) {
+            row[0] = baseId;
 
-        for (const std::string& baseFile : baseIt->second.files) {
-            // ûֻлͼ
+            // 如果没有其他部件，只有基础图像
             if (partFiles.empty()) {
-                Combination combo;
-                combo.components = { baseFile };
-                combo.outputFilename = makeOutputFilename({ baseFile });
-                combinations.push_back(combo);
+                combinationTable.insert(combinationTable.end(), row.begin(), row.end());
                 totalCombinations++;
-                Logger::Debug("ɻ: " + combo.outputFilename);
+                Logger::Debug("生成基础组合: " + partNames[baseId]);
                 continue;
             }
 
-            // ʹõѿ
+            // 使用笛卡尔积生成器生成所有组合
             CombinationGenerator generator(partFiles);
             int groupCombinations = 0;
             while (generator.hasMore()) {
-                std::vector<std::string> otherParts = generator.getNext();
-
-                Combination combo;
-                combo.components = { baseFile };
-                combo.components.insert(combo.components.end(), otherParts.begin(), otherParts.end());
-                combo.outputFilename = makeOutputFilename(combo.components);
-
-                combinations.push_back(combo);
+                generator.getNext(row.data() + 1);
+                combinationTable.insert(combinationTable.end(), row.begin(), row.end());
                 groupCombinations++;
                 totalCombinations++;
             }
 
-            Logger::Info("ͼ " + baseFile + "  " + std::to_string(groupCombinations) + " ");
+            Logger::Info("基础图像 " + partNames[baseId] + " 生成了 " + std::to_string(groupCombinations) + " 个组合");
         }
     }
 
-    Logger::Info("ɣܹ " + std::to_string(totalCombinations) + " ");
+    Logger::Info("组合生成完成，总共 " + std::to_string(totalCombinations) + " 个组合，组合表 " +
+        std::to_string(combinationTable.size() * sizeof(PartId) / 1024) + " KB");
     return true;
 }
 
+size_t FgComposer::baseRunEnd(size_t begin) const {
+    const size_t totalCombinations = combinationCount();
+    const PartId baseId = combinationTable[begin * combinationWidth];
+    size_t end = begin + 1;
+    while (end < totalCombinations && combinationTable[end * combinationWidth] == baseId) {
+        end++;
+    }
+    return end;
+}
+
+FgComposer::Combination FgComposer::getCombination(size_t index) const {
+    Combination combination;
+    combination.ids = combinationTable.data() + index * combinationWidth;
+    combination.count = combinationWidth;
+    while (combination.count > 0 && combination.ids[combination.count - 1] == INVALID_PART) {
+        combination.count--;
+    }
+    return combination;
+}
+
 bool FgComposer::composeImages() {
-    Logger::Debug("ʼϳͼ");
+    Logger::Debug("开始合成图像");
 
-    // ȷĿ¼
-    if (!fs::exists(config.outputDir)) {
-        Logger::Info("Ŀ¼: " + config.outputDir);
+    if (!config.archivePath.empty()) {
+        // 输出到归档时不创建输出目录
+        ArchiveWriter::Format format = ArchiveWriter::Format::Zip;
+        if (!config.archiveFormat.empty()) {
+            ArchiveWriter::ParseFormat(config.archiveFormat, format);
+        }
+        else if (fs::path(config.archivePath).extension() == ".tar") {
+            format = ArchiveWriter::Format::Tar;
+        }
+        if (!archive.Open(config.archivePath, format)) {
+            return false;
+        }
+    }
+    else if (!fs::exists(config.outputDir)) {
+        // 确保输出目录存在
+        Logger::Info("创建输出目录: " + config.outputDir);
         try {
             fs::create_directories(config.outputDir);
-            Logger::Debug("Ŀ¼ɹ");
+            Logger::Debug("输出目录创建成功");
         }
         catch (const fs::filesystem_error& ex) {
-            Logger::Error("Ŀ¼ʧ: " + std::string(ex.what()));
+            Logger::Error("创建输出目录失败: " + std::string(ex.what()));
             return false;
         }
     }
     else {
-        Logger::Debug("Ŀ¼Ѵ: " + config.outputDir);
+        Logger::Debug("输出目录已存在: " + config.outputDir);
+    }
+
+    // 确定PNG编码参数
+    const bool qoiOutput = config.outputFormat == "qoi";
+    if (!qoiOutput && batchMode) {
+        pngOptionsSummary = ImageProcessor::DescribePngOptions(ImageProcessor::GetPngEncodeOptions());
+    }
+    else if (!qoiOutput && !setupPngOptions()) {
+        return false;
+    }
+    const bool streamRows = config.streamRows && !qoiOutput && !config.atlas && !config.delta && !archive.IsOpen();
+    if (config.streamRows && (config.atlas || config.delta)) {
+        Logger::Warning("图集和差分模式不使用流式合成");
+    }
+    else if (config.streamRows && archive.IsOpen()) {
+        Logger::Warning("输出到归档时不使用流式合成");
+    }
+    else if (config.streamRows && qoiOutput) {
+        Logger::Warning("流式合成只支持PNG输出，QOI输出将生成完整画布");
+    }
+    if (streamRows && ImageProcessor::GetPngEncodeOptions().encoder != PngEncoderType::Libpng) {
+        Logger::Warning("流式合成只支持libpng编码器，将使用libpng输出");
     }
 
+    // 编码后的数据交给后台写出，流式合成直接写文件；批量模式下由调用方启动和结束
+    if (!batchMode && !archive.IsOpen() && !streamRows && config.writeQueueSize > 0) {
+        writer.Start(static_cast<size_t>(config.writeQueueSize) * 1024 * 1024);
+    }
+
+    bool success = false;
+    if (config.atlas) {
+        success = composeAtlases();
+    }
+    else if (config.delta) {
+        success = composeDeltas();
+    }
+    else {
+        success = composeSeparateFiles(streamRows);
+    }
+
+    // 归档的中央目录在全部输出之后写出
+    if (archive.IsOpen() && !archive.Close()) {
+        success = false;
+    }
+    if (!batchMode && writer.IsRunning() && !writer.Finish()) {
+        success = false;
+    }
+    return success;
+}
+
+bool FgComposer::composeSeparateFiles(bool streamRows) {
     int successCount = 0;
     int failCount = 0;
 
-    for (size_t i = 0; i < combinations.size(); ++i) {
-        const auto& combination = combinations[i];
-        if (combination.components.empty()) {
-            Logger::Warning(" #" + std::to_string(i));
+    // 画布在各组合间复用，尺寸不超过已有容量时不再重新分配
+    ImageData result;
+    const size_t totalCombinations = combinationCount();
+    for (size_t i = 0; i < totalCombinations; ++i) {
+        if (getCombination(i).empty()) {
+            Logger::Warning("跳过空组合 #" + std::to_string(i));
             continue;
         }
+        if (composeSeparateFile(i, streamRows, result)) {
+            successCount++;
+        }
+        else {
+            failCount++;
+        }
+    }
 
-        Logger::Info(" " + std::to_string(i + 1) + "/" + std::to_string(combinations.size()) +
-            ": " + combination.outputFilename);
+    ImageProcessor::FreeImage(result);
 
-        // ӻͼʼ
-        const std::string& baseFile = combination.components[0];
-        auto baseIt = images.find(baseFile);
-        if (baseIt == images.end()) {
-            Logger::Error("ͼδҵ: " + baseFile);
+    Logger::Info("图像合成完成: 成功 " + std::to_string(successCount) +
+        ", 失败 " + std::to_string(failCount));
+    if (config.outputFormat != "qoi") {
+        Logger::Info("PNG编码参数: " + pngOptionsSummary);
+    }
+
+    return failCount == 0; // 如果所有都成功才返回true
+}
+
+bool FgComposer::composeSeparateFile(size_t index, bool streamRows, ImageData& result) {
+    Combination combination = getCombination(index);
+    std::string outputFilename = makeOutputFilename(combination);
+    Logger::Info("处理组合 " + std::to_string(index + 1) + "/" + std::to_string(combinationCount()) +
+        ": " + outputFilename);
+
+    // 流式模式下合成与写出同时进行
+    if (streamRows) {
+        std::string outputPath = (fs::path(config.outputDir) / outputFilename).string();
+        Logger::Debug("流式保存图像到: " + outputPath);
+        if (!composeCombinationStreamed(combination, outputPath)) {
+            Logger::Error("图像保存失败");
+            return false;
+        }
+        Logger::Info("图像保存成功");
+        return true;
+    }
+
+    if (!composeCombination(combination, result)) {
+        return false;
+    }
+
+    // 保存最终图像
+    if (!saveImage(outputFilename, result, config.writePosBack)) {
+        Logger::Error("图像保存失败");
+        return false;
+    }
+    Logger::Info("图像保存成功");
+    return true;
+}
+
+bool FgComposer::layoutCombination(Combination combination, std::vector<Layer>& layers, ImageData& canvas) const {
+    layers.clear();
+    for (size_t j = 0; j < combination.count; ++j) {
+        const ImageData& image = partImages[combination.ids[j]];
+        layers.push_back({ ImageView(image), image.posX, image.posY });
+    }
+    if (layers.empty()) {
+        return false;
+    }
+
+    // 画布为所有部件矩形的并集
+    int left = layers[0].x;
+    int top = layers[0].y;
+    int right = layers[0].x + layers[0].view.width;
+    int bottom = layers[0].y + layers[0].view.height;
+    for (const Layer& layer : layers) {
+        left = std::min(left, layer.x);
+        top = std::min(top, layer.y);
+        right = std::max(right, layer.x + layer.view.width);
+        bottom = std::max(bottom, layer.y + layer.view.height);
+    }
+    canvas.width = right - left;
+    canvas.height = bottom - top;
+    canvas.channels = 4;
+    canvas.posX = left;
+    canvas.posY = top;
+
+    for (Layer& layer : layers) {
+        layer.x -= left;
+        layer.y -= top;
+    }
+    return true;
+}
+
+bool FgComposer::saveImage(const std::string& filename, const ImageData& image, bool writePos) {
+    std::string outputPath = (fs::path(config.outputDir) / filename).string();
+
+    // 归档和后台写出模式先编码到内存
+    if (archive.IsOpen() || writer.IsRunning()) {
+        std::vector<uint8_t> encoded;
+        bool encodedOk = config.outputFormat == "qoi" ? ImageProcessor::EncodeQoi(image, encoded, writePos) :
+            ImageProcessor::EncodePng(image, encoded, ImageProcessor::GetPngEncodeOptions(), writePos);
+        if (!encodedOk) {
+            return false;
+        }
+        if (archive.IsOpen()) {
+            return archive.Add(filename, encoded.data(), encoded.size());
+        }
+        Logger::Debug("提交图像到后台写出: " + outputPath);
+        writer.Submit(outputPath, std::move(encoded));
+        return true;
+    }
+
+    Logger::Debug("保存图像到: " + outputPath);
+    if (config.outputFormat == "qoi") {
+        return ImageProcessor::SaveQoi(outputPath, image, writePos);
+    }
+    if (writePos) {
+        return ImageProcessor::SavePngWithPos(outputPath, image);
+    }
+    return ImageProcessor::SavePng(outputPath, image);
+}
+
+bool FgComposer::saveText(const std::string& filename, const std::string& text) {
+    if (archive.IsOpen()) {
+        return archive.Add(filename, reinterpret_cast<const uint8_t*>(text.data()), text.size());
+    }
+
+    std::string outputPath = (fs::path(config.outputDir) / filename).string();
+    if (writer.IsRunning()) {
+        writer.Submit(outputPath, std::vector<uint8_t>(text.begin(), text.end()));
+        return true;
+    }
+    std::ofstream file(outputPath, std::ios::binary);
+    if (!file.is_open()) {
+        Logger::Error("无法打开文件进行写入: " + outputPath);
+        return false;
+    }
+    file << text;
+    if (!file) {
+        Logger::Error("写入文件失败: " + outputPath);
+        return false;
+    }
+    Logger::Debug("成功保存文件: " + outputPath);
+    return true;
+}
+
+bool FgComposer::checkLayers(Combination combination, const std::vector<Layer>& layers) const {
+    for (const Layer& layer : layers) {
+        if (!layer.view.pixels || layer.view.channels != 4) {
+            Logger::Error("无效的部件图像: " + makeOutputFilename(combination));
+            return false;
+        }
+    }
+    return true;
+}
+
+void FgComposer::composeLayers(const std::vector<Layer>& layers, const ImageSpan& canvas) {
+    // 基础图像复制到位后其余部件原地叠加
+    const Layer& base = layers[0];
+    if (base.x > 0 || base.y > 0 || base.x + base.view.width < canvas.width || base.y + base.view.height < canvas.height) {
+        ImageProcessor::Clear(canvas);
+    }
+    ImageProcessor::CopyInto(canvas, base.view, base.x, base.y);
+    for (size_t k = 1; k < layers.size(); k++) {
+        ImageProcessor::BlendInto(canvas, layers[k].view, layers[k].x, layers[k].y);
+    }
+}
+
+bool FgComposer::composeCombination(Combination combination, ImageData& result) const {
+    std::vector<Layer> layers;
+    if (!layoutCombination(combination, layers, result) || !checkLayers(combination, layers)) {
+        return false;
+    }
+
+    // 画布只分配一次
+    result.data.AllocateUninitialized(static_cast<size_t>(result.width) * result.height * 4);
+    composeLayers(layers, ImageSpan(result));
+    return true;
+}
+
+bool FgComposer::composeCombinationStreamed(Combination combination, const std::string& outputPath) const {
+    std::vector<Layer> layers;
+    ImageData header;
+    if (!layoutCombination(combination, layers, header) || !checkLayers(combination, layers)) {
+        return false;
+    }
+
+    // 每带是画布中的若干行，图层按相对该带的位置复制或叠加，超出部分自动裁剪
+    const size_t rowBytes = static_cast<size_t>(header.width) * 4;
+    auto produceRows = [&](int firstRow, int rowCount, uint8_t* rows) {
+        ImageSpan band(rows, header.width, rowCount, 4, rowBytes);
+        ImageProcessor::Clear(band);
+        ImageProcessor::CopyInto(band, layers[0].view, layers[0].x, layers[0].y - firstRow);
+        for (size_t k = 1; k < layers.size(); k++) {
+            ImageProcessor::BlendInto(band, layers[k].view, layers[k].x, layers[k].y - firstRow);
+        }
+        return true;
+    };
+
+    return ImageProcessor::SavePngStreamed(outputPath, header, config.writePosBack, STREAM_BAND_ROWS, produceRows);
+}
+
+bool FgComposer::composeAtlases() {
+    Logger::Info("图集模式: 最大尺寸 " + std::to_string(config.atlasSize) + "x" + std::to_string(config.atlasSize));
+
+    // 同一基础图像的组合在组合表中相邻
+    int successCount = 0;
+    int failCount = 0;
+    const size_t totalCombinations = combinationCount();
+    for (size_t begin = 0, end; begin < totalCombinations; begin = end) {
+        end = baseRunEnd(begin);
+        if (composeAtlasGroup(begin, end, partNames[combinationTable[begin * combinationWidth]])) {
+            successCount++;
+        }
+        else {
             failCount++;
+        }
+    }
+
+    Logger::Info("图集合成完成: 成功 " + std::to_string(successCount) +
+        ", 失败 " + std::to_string(failCount));
+    if (config.outputFormat != "qoi") {
+        Logger::Info("PNG编码参数: " + pngOptionsSummary);
+    }
+    return failCount == 0;
+}
+
+bool FgComposer::composeAtlasGroup(size_t begin, size_t end, const std::string& baseName) {
+    Logger::Info("合成图集: " + baseName + " (" + std::to_string(end - begin) + " 个组合)");
+
+    // 先只做布局得到每个结果的尺寸
+    std::vector<AtlasSprite> sprites;
+    std::vector<Layer> layers;
+    bool success = true;
+    for (size_t i = begin; i < end; i++) {
+        ImageData canvas;
+        if (!layoutCombination(getCombination(i), layers, canvas)) {
+            success = false;
             continue;
         }
+        sprites.push_back({ i, -1, 0, 0, canvas.width, canvas.height, canvas.posX, canvas.posY });
+    }
+
+    // 按高度从大到小装箱，当前各页都放不下时新开一页
+    std::vector<size_t> order(sprites.size());
+    for (size_t k = 0; k < order.size(); k++) {
+        order[k] = k;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return sprites[a].height > sprites[b].height;
+    });
 
-        ImageData result = baseIt->second;
+    std::vector<AtlasPacker> packers;
+    std::vector<bool> dedicatedPages;
+    for (size_t k : order) {
+        AtlasSprite& sprite = sprites[k];
 
-        // ˳
-        for (size_t j = 1; j < combination.components.size(); ++j) {
-            const std::string& componentFile = combination.components[j];
-            auto componentIt = images.find(componentFile);
-            if (componentIt == images.end()) {
-                Logger::Warning("ͼδҵ: " + componentFile + "ò");
-                continue;
+        // 超过最大尺寸的结果独占一页，页面与结果同样大小，不与其他结果共用
+        if (sprite.width > config.atlasSize || sprite.height > config.atlasSize) {
+            const std::string name = fs::path(makeOutputFilename(getCombination(sprite.combination))).stem().string();
+            Logger::Warning("合成结果超过图集尺寸，单独成页: " + name + " (" + std::to_string(sprite.width) + "x" +
+                std::to_string(sprite.height) + " > " + std::to_string(config.atlasSize) + ")");
+            packers.emplace_back(sprite.width, sprite.height, ATLAS_PADDING);
+            packers.back().Insert(sprite.width, sprite.height, sprite.x, sprite.y);
+            dedicatedPages.push_back(true);
+            sprite.page = static_cast<int>(packers.size() - 1);
+            continue;
+        }
+
+        for (size_t page = 0; page < packers.size() && sprite.page < 0; page++) {
+            if (!dedicatedPages[page] && packers[page].Insert(sprite.width, sprite.height, sprite.x, sprite.y)) {
+                sprite.page = static_cast<int>(page);
             }
-            const ImageData& componentData = componentIt->second;
-            // ϳ
-            result = ImageProcessor::Blend(result, componentData);
         }
+        if (sprite.page < 0) {
+            packers.emplace_back(config.atlasSize, config.atlasSize, ATLAS_PADDING);
+            packers.back().Insert(sprite.width, sprite.height, sprite.x, sprite.y);
+            dedicatedPages.push_back(false);
+            sprite.page = static_cast<int>(packers.size() - 1);
+        }
+    }
 
-        // ͼ
-        std::string outputPath = config.outputDir + "\\" + combination.outputFilename;
-        Logger::Debug("ͼ: " + outputPath);
+    // 逐页分配画布，各组合直接合成到图集中的对应区域
+    std::vector<std::string> pageFiles;
+    std::vector<std::pair<int, int>> pageSizes;
+    ImageData atlas;
+    for (size_t page = 0; page < packers.size(); page++) {
+        atlas.width = packers[page].UsedWidth();
+        atlas.height = packers[page].UsedHeight();
+        atlas.channels = 4;
+        atlas.posX = 0;
+        atlas.posY = 0;
+        atlas.data.AllocateUninitialized(static_cast<size_t>(atlas.width) * atlas.height * 4);
+        ImageSpan atlasSpan(atlas);
+        ImageProcessor::Clear(atlasSpan);
 
-        bool success = false;
-        if (config.writePosBack) {
-            success = ImageProcessor::SavePngWithPos(outputPath, result);
+        for (const AtlasSprite& sprite : sprites) {
+            if (sprite.page != static_cast<int>(page)) {
+                continue;
+            }
+            Combination combination = getCombination(sprite.combination);
+            ImageData canvas;
+            if (!layoutCombination(combination, layers, canvas) || !checkLayers(combination, layers)) {
+                success = false;
+                continue;
+            }
+            composeLayers(layers, atlasSpan.SubView(sprite.x, sprite.y, sprite.width, sprite.height));
         }
-        else {
-            success = ImageProcessor::SavePng(outputPath, result);
+
+        std::string pageFile = baseName + "_atlas" + std::to_string(page) + "." + config.outputFormat;
+        Logger::Debug("保存图集页: " + pageFile + " (" + std::to_string(atlas.width) + "x" +
+            std::to_string(atlas.height) + ")");
+        if (!saveImage(pageFile, atlas, false)) {
+            Logger::Error("图集页保存失败: " + pageFile);
+            success = false;
         }
-        ImageProcessor::FreeImage(result);
+        pageFiles.push_back(pageFile);
+        pageSizes.push_back({ atlas.width, atlas.height });
+    }
+    ImageProcessor::FreeImage(atlas);
+
+    if (!writeAtlasIndex(baseName + "_atlas.json", pageFiles, pageSizes, sprites)) {
+        success = false;
+    }
+    Logger::Info("图集 " + baseName + ": " + std::to_string(sprites.size()) + " 个组合, " +
+        std::to_string(packers.size()) + " 页");
+    return success;
+}
 
-        if (success) {
+bool FgComposer::writeAtlasIndex(const std::string& indexFile, const std::vector<std::string>& pageFiles,
+    const std::vector<std::pair<int, int>>& pageSizes, const std::vector<AtlasSprite>& sprites) {
+    // 合成结果按组合顺序列出，name为不含扩展名的输出文件名，posX/posY为合成结果原本的坐标
+    std::stringstream json;
+    json << "{\n  \"pages\": [\n";
+    for (size_t page = 0; page < pageFiles.size(); page++) {
+        json << "    {\"file\": \"" << Json::Escape(pageFiles[page]) << "\", \"width\": " << pageSizes[page].first <<
+            ", \"height\": " << pageSizes[page].second << "}" << (page + 1 < pageFiles.size() ? "," : "") << "\n";
+    }
+    json << "  ],\n  \"sprites\": [\n";
+    for (size_t k = 0; k < sprites.size(); k++) {
+        const AtlasSprite& sprite = sprites[k];
+        std::string name = fs::path(makeOutputFilename(getCombination(sprite.combination))).stem().string();
+        json << "    {\"name\": \"" << Json::Escape(name) << "\", \"page\": " << sprite.page <<
+            ", \"x\": " << sprite.x << ", \"y\": " << sprite.y <<
+            ", \"width\": " << sprite.width << ", \"height\": " << sprite.height <<
+            ", \"posX\": " << sprite.posX << ", \"posY\": " << sprite.posY << "}" <<
+            (k + 1 < sprites.size() ? "," : "") << "\n";
+    }
+    json << "  ]\n}\n";
+
+    if (!saveText(indexFile, json.str())) {
+        Logger::Error("图集索引写入失败: " + indexFile);
+        return false;
+    }
+    return true;
+}
+
+bool FgComposer::composeDeltas() {
+    Logger::Info("差分模式: 每个基础图像输出一次，组合只输出部件覆盖的区域");
+
+    int successCount = 0;
+    int failCount = 0;
+    const size_t totalCombinations = combinationCount();
+    for (size_t begin = 0, end; begin < totalCombinations; begin = end) {
+        end = baseRunEnd(begin);
+        if (composeDeltaGroup(begin, end, combinationTable[begin * combinationWidth])) {
             successCount++;
-            Logger::Info("ͼ񱣴ɹ");
         }
         else {
             failCount++;
-            Logger::Error("ͼ񱣴ʧ");
         }
     }
 
-    Logger::Info("ͼϳ: ɹ " + std::to_string(successCount) +
-        ", ʧ " + std::to_string(failCount));
+    Logger::Info("差分合成完成: 成功 " + std::to_string(successCount) +
+        ", 失败 " + std::to_string(failCount));
+    if (config.outputFormat != "qoi") {
+        Logger::Info("PNG编码参数: " + pngOptionsSummary);
+    }
+    return failCount == 0;
+}
+
+bool FgComposer::composeDeltaGroup(size_t begin, size_t end, PartId baseId) {
+    const std::string& baseName = partNames[baseId];
+    Logger::Info("差分合成: " + baseName + " (" + std::to_string(end - begin) + " 个组合)");
+
+    std::stringstream json;
+    bool success = true;
+
+    // 基础图像只写出一次
+    const ImageData& base = partImages[baseId];
+    const std::string baseFile = baseName + "_base." + config.outputFormat;
+    if (!saveImage(baseFile, base, config.writePosBack)) {
+        Logger::Error("基础图像保存失败: " + baseFile);
+        return false;
+    }
+    json << "{\n  \"base\": {\"file\": \"" << Json::Escape(baseFile) << "\", \"posX\": " << base.posX <<
+        ", \"posY\": " << base.posY << ", \"width\": " << base.width << ", \"height\": " << base.height <<
+        "},\n  \"combinations\": [\n";
+
+    uint64_t fullBytes = 0;
+    uint64_t patchBytes = 0;
+    std::vector<Layer> layers;
+    ImageData patch;
+    for (size_t i = begin; i < end; i++) {
+        Combination combination = getCombination(i);
+        ImageData canvas;
+        if (!layoutCombination(combination, layers, canvas) || !checkLayers(combination, layers)) {
+            success = false;
+            continue;
+        }
+
+        // 变化区域为各部件非透明像素外接矩形的并集，透明像素叠加后不改变画布
+        int left = canvas.width;
+        int top = canvas.height;
+        int right = 0;
+        int bottom = 0;
+        for (size_t k = 1; k < layers.size(); k++) {
+            const Layer& layer = layers[k];
+            int layerLeft = layer.view.width;
+            int layerTop = layer.view.height;
+            int layerRight = 0;
+            int layerBottom = 0;
+            if (layer.view.alphaSpans) {
+                for (int y = 0; y < layer.view.height; y++) {
+                    const AlphaSpan& span = layer.view.alphaSpans[y];
+                    if (span.begin < span.end) {
+                        layerLeft = std::min(layerLeft, static_cast<int>(span.begin));
+                        layerRight = std::max(layerRight, static_cast<int>(span.end));
+                        layerTop = std::min(layerTop, y);
+                        layerBottom = y + 1;
+                    }
+                }
+            }
+            else {
+                layerLeft = 0;
+                layerTop = 0;
+                layerRight = layer.view.width;
+                layerBottom = layer.view.height;
+            }
+            if (layerLeft >= layerRight) {
+                continue;
+            }
+            left = std::min(left, std::max(0, layer.x + layerLeft));
+            top = std::min(top, std::max(0, layer.y + layerTop));
+            right = std::max(right, std::min(canvas.width, layer.x + layerRight));
+            bottom = std::max(bottom, std::min(canvas.height, layer.y + layerBottom));
+        }
+
+        std::string name = fs::path(makeOutputFilename(combination)).stem().string();
+        json << "    {\"name\": \"" << Json::Escape(name) << "\", \"posX\": " << canvas.posX <<
+            ", \"posY\": " << canvas.posY << ", \"width\": " << canvas.width << ", \"height\": " << canvas.height <<
+            ", \"patch\": ";
+        fullBytes += static_cast<uint64_t>(canvas.width) * canvas.height * 4;
+
+        if (left >= right || top >= bottom) {
+            json << "null}";
+        }
+        else {
+            // 只合成变化区域：图层坐标平移到区域原点，区域外的部分被裁剪
+            patch.width = right - left;
+            patch.height = bottom - top;
+            patch.channels = 4;
+            patch.posX = canvas.posX + left;
+            patch.posY = canvas.posY + top;
+            patch.data.AllocateUninitialized(static_cast<size_t>(patch.width) * patch.height * 4);
+            for (Layer& layer : layers) {
+                layer.x -= left;
+                layer.y -= top;
+            }
+            composeLayers(layers, ImageSpan(patch));
+            patchBytes += patch.data.size();
+
+            std::string patchFile = name + "_delta." + config.outputFormat;
+            if (!saveImage(patchFile, patch, config.writePosBack)) {
+                Logger::Error("差分图像保存失败: " + patchFile);
+                success = false;
+            }
+            json << "{\"file\": \"" << Json::Escape(patchFile) << "\", \"x\": " << left << ", \"y\": " << top <<
+                ", \"width\": " << patch.width << ", \"height\": " << patch.height << "}}";
+        }
+        json << (i + 1 < end ? "," : "") << "\n";
+    }
+    ImageProcessor::FreeImage(patch);
+    json << "  ]\n}\n";
+
+    std::string manifestFile = baseName + "_delta.json";
+    if (!saveText(manifestFile, json.str())) {
+        Logger::Error("差分清单写入失败: " + manifestFile);
+        return false;
+    }
+
+    Logger::Info("差分 " + baseName + ": 输出像素 " + std::to_string(patchBytes / 1024) + " KB, 完整输出需 " +
+        std::to_string(fullBytes / 1024) + " KB");
+    return success;
+}
+
+bool FgComposer::forecastCombinations() const {
+    Logger::Debug("开始预估合成结果");
+
+    uint64_t totalBytes = 0;
+    uint64_t maxCanvasBytes = 0;
+    int maxWidth = 0;
+    int maxHeight = 0;
+    std::vector<Layer> layers;
+    const size_t totalCombinations = combinationCount();
+    for (size_t i = 0; i < totalCombinations; ++i) {
+        Combination combination = getCombination(i);
+        ImageData canvas;
+        if (!layoutCombination(combination, layers, canvas)) {
+            continue;
+        }
+
+        uint64_t canvasBytes = static_cast<uint64_t>(canvas.width) * canvas.height * 4;
+        totalBytes += canvasBytes;
+        if (canvasBytes > maxCanvasBytes) {
+            maxCanvasBytes = canvasBytes;
+            maxWidth = canvas.width;
+            maxHeight = canvas.height;
+        }
+        Logger::Debug("预估组合 " + makeOutputFilename(combination) + ": " +
+            std::to_string(canvas.width) + "x" + std::to_string(canvas.height) +
+            " 坐标 " + std::to_string(canvas.posX) + "," + std::to_string(canvas.posY));
+    }
+
+    // 已解码部件常驻内存，合成时另需一张画布
+    uint64_t partBytes = 0;
+    for (const auto& image : partImages) {
+        partBytes += static_cast<uint64_t>(image.width) * image.height * 4;
+    }
+
+    const double mb = 1024.0 * 1024.0;
+    Logger::Info("预估完成: 组合 " + std::to_string(totalCombinations) +
+        ", 最大画布 " + std::to_string(maxWidth) + "x" + std::to_string(maxHeight) +
+        ", 未解码输出总量 " + std::to_string(static_cast<uint64_t>(totalBytes / mb)) + " MB");
+    Logger::Info("预估内存: 部件 " + std::to_string(static_cast<uint64_t>(partBytes / mb)) +
+        " MB, 峰值约 " + std::to_string(static_cast<uint64_t>((partBytes + maxCanvasBytes) / mb)) + " MB");
+    return true;
+}
+
+bool FgComposer::setupPngOptions() {
+    PngEncodeOptions options = makePngEncodeOptions(config);
+
+    if (config.pngLevel == "auto") {
+        tunePngOptions(options);
+    }
+    else {
+        pngOptionsSummary = ImageProcessor::DescribePngOptions(options);
+    }
+
+    ImageProcessor::SetPngEncodeOptions(options);
+    return true;
+}
+
+void FgComposer::tunePngOptions(PngEncodeOptions& options) {
+    Logger::Info("开始自动调优PNG编码参数");
+
+    // 抽样：在所有组合中均匀选取若干个进行试编码
+    const size_t maxSamples = 4;
+    std::vector<ImageData> samples;
+    const size_t totalCombinations = combinationCount();
+    size_t sampleCount = std::min(maxSamples, totalCombinations);
+    for (size_t k = 0; k < sampleCount; ++k) {
+        Combination combination = getCombination(k * totalCombinations / sampleCount);
+        if (combination.empty()) {
+            continue;
+        }
+        ImageData sample;
+        if (composeCombination(combination, sample) && ImageProcessor::IsValid(sample)) {
+            samples.push_back(std::move(sample));
+        }
+    }
+
+    if (samples.empty()) {
+        Logger::Warning("没有可用于试编码的样本，使用默认PNG编码参数");
+        pngOptionsSummary = ImageProcessor::DescribePngOptions(options);
+        return;
+    }
+
+    double rawBytes = 0;
+    for (const auto& sample : samples) {
+        rawBytes += static_cast<double>(sample.data.size());
+    }
+
+    // 候选参数，已显式指定的项不参与搜索
+    std::vector<int> levels = { 1, 3, 6, 9 };
+    std::vector<int> filters = { PNG_FILTER_NONE, PNG_FILTER_UP, PNG_FILTER_PAETH, PNG_ALL_FILTERS };
+    std::vector<int> strategies = { -1, Z_RLE };
+    if (!config.pngFilter.empty()) {
+        filters = { options.filters };
+    }
+    if (!config.pngStrategy.empty()) {
+        strategies = { options.strategy };
+    }
+
+    struct Trial {
+        PngEncodeOptions options;
+        double bytes;
+        double speed;   // MB/s
+    };
+    std::vector<Trial> trials;
+
+    for (int level : levels) {
+        for (int filter : filters) {
+            for (int strategy : strategies) {
+                PngEncodeOptions candidate;
+                candidate.encoder = options.encoder;
+                candidate.level = level;
+                candidate.filters = filter;
+                candidate.strategy = strategy;
+
+                double bytes = 0;
+                bool ok = true;
+                auto start = std::chrono::steady_clock::now();
+                for (const auto& sample : samples) {
+                    std::vector<uint8_t> encoded;
+                    if (!ImageProcessor::EncodePng(sample, encoded, candidate)) {
+                        ok = false;
+                        break;
+                    }
+                    bytes += static_cast<double>(encoded.size());
+                }
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                if (!ok) {
+                    continue;
+                }
+
+                double speed = rawBytes / (1024.0 * 1024.0) / std::max(seconds, 1e-9);
+                trials.push_back({ candidate, bytes, speed });
+                Logger::Debug("试编码 " + ImageProcessor::DescribePngOptions(candidate) +
+                    ": " + std::to_string(static_cast<long long>(bytes)) + " 字节, " +
+                    std::to_string(speed) + " MB/s");
+            }
+        }
+    }
+
+    if (trials.empty()) {
+        Logger::Warning("PNG试编码失败，使用默认PNG编码参数");
+        pngOptionsSummary = ImageProcessor::DescribePngOptions(options);
+        return;
+    }
+
+    auto smallest = std::min_element(trials.begin(), trials.end(),
+        [](const Trial& a, const Trial& b) { return a.bytes < b.bytes; });
+    auto fastest = std::max_element(trials.begin(), trials.end(),
+        [](const Trial& a, const Trial& b) { return a.speed < b.speed; });
+
+    const Trial* chosen = nullptr;
+    if (config.pngTargetSpeed > 0) {
+        // 满足速度目标的参数中选体积最小的，都不满足则选最快的
+        for (const auto& trial : trials) {
+            if (trial.speed >= config.pngTargetSpeed && (!chosen || trial.bytes < chosen->bytes)) {
+                chosen = &trial;
+            }
+        }
+        if (!chosen) {
+            Logger::Warning("没有参数能达到目标编码速度，选择最快的参数");
+            chosen = &*fastest;
+        }
+    }
+    else {
+        // 满足压缩率目标的参数中选最快的；未指定目标时允许比最小体积大5%
+        double maxBytes = config.pngTargetRatio > 0 ? rawBytes * config.pngTargetRatio / 100.0 : smallest->bytes * 1.05;
+        for (const auto& trial : trials) {
+            if (trial.bytes <= maxBytes && (!chosen || trial.speed > chosen->speed)) {
+                chosen = &trial;
+            }
+        }
+        if (!chosen) {
+            Logger::Warning("没有参数能达到目标压缩率，选择体积最小的参数");
+            chosen = &*smallest;
+        }
+    }
 
-    return failCount == 0; // жɹŷtrue
+    options = chosen->options;
+    pngOptionsSummary = ImageProcessor::DescribePngOptions(options) +
+        " (自动调优: 样本 " + std::to_string(samples.size()) +
+        ", 压缩率 " + std::to_string(chosen->bytes / rawBytes * 100.0) + "%" +
+        ", 编码速度 " + std::to_string(chosen->speed) + " MB/s)";
+    Logger::Info("自动选择PNG编码参数: " + pngOptionsSummary);
 }
 
 std::string FgComposer::getGroupName(const std::string& filename) const {
@@ -314,57 +1688,57 @@ std::string FgComposer::getGroupName(const std::string& filename) const {
     if (regex_search(filename, match, groupRegex)) {
         char first_char = match[1].str()[0];
         std::string groupName = std::string(1, first_char);
-        Logger::Debug("ȡ: " + filename + " -> " + groupName);
+        Logger::Debug("提取组名: " + filename + " -> " + groupName);
         return groupName;
     }
-    Logger::Debug("޷ȡ: " + filename);
+    Logger::Debug("无法提取组名: " + filename);
     return "";
 }
 
 std::string FgComposer::getPartName(const std::string& filename) const {
     for (const auto& rule : config.partRules) {
         if (std::regex_search(filename, std::regex(rule.pattern))) {
-            Logger::Debug("ʶ𲿼: " + filename + " -> " + rule.partName);
+            Logger::Debug("识别部件: " + filename + " -> " + rule.partName);
             return rule.partName;
         }
     }
-    Logger::Debug("޷ʶ𲿼: " + filename);
+    Logger::Debug("无法识别部件: " + filename);
     return "";
 }
 
-std::string FgComposer::makeOutputFilename(const std::vector<std::string>& components) const {
+std::string FgComposer::makeOutputFilename(Combination combination) const {
     std::string result;
-    for (const auto& component : components) {
-        result += component;
+    for (size_t j = 0; j < combination.count; ++j) {
+        result += partNames[combination.ids[j]];
         result += "_";
     }
-    result.pop_back(); // Ƴһ"_"
+    result.pop_back(); // 移除最后一个"_"
 
-    result += ".png";
+    result += "." + config.outputFormat;
 
-    Logger::Debug("ļ: " + result);
+    Logger::Debug("生成输出文件名: " + result);
     return result;
 }
 
 
 //std::pair<int, int> FgComposer::getPos(const std::string& filename, const std::string& group) const {
-//    Logger::Debug("ȡͼ: " + filename + " (: " + group + ")");
+//    Logger::Debug("获取图像坐标: " + filename + " (组: " + group + ")");
 //
-//    // ȴLuaȡ
+//    // 优先从Lua解析器获取坐标
 //    if (luaParser.Loaded()) {
 //        Pos pos = luaParser.getFilePos(group, filename);
-//        Logger::Debug("Luaȡ: (" + std::to_string(pos.x) + ", " + std::to_string(pos.y) + ")");
+//        Logger::Debug("从Lua获取坐标: (" + std::to_string(pos.x) + ", " + std::to_string(pos.y) + ")");
 //        return { pos.x, pos.y };
 //    }
 //
-//    // ͼ񻺴лȡ꣨LoadPngWithPosѾ꣩
+//    // 从图像缓存中获取坐标（如果LoadPngWithPos已经设置了坐标）
 //    auto it = images.find(filename);
 //    if (it != images.end()) {
-//        Logger::Debug("ͼ񻺴ȡ: (" + std::to_string(it->second.posX) + ", " + std::to_string(it->second.posY) + ")");
+//        Logger::Debug("从图像缓存获取坐标: (" + std::to_string(it->second.posX) + ", " + std::to_string(it->second.posY) + ")");
 //        return { it->second.posX, it->second.posY };
 //    }
 //
-//    // Ĭ
-//    Logger::Debug("ʹĬ: (0, 0)");
+//    // 默认坐标
+//    Logger::Debug("使用默认坐标: (0, 0)");
 //    return { 0, 0 };
 //}
\ No newline at end of file
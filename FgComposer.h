@@ -1,86 +1,258 @@
 #pragma once
 
 #include <map>
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <regex>
 #include <unordered_map>
 #include <filesystem>
+#include <functional>
+#include <memory>
 #include "LuaParser.h"
 #include "ImageProcessor.h"
+#include "PartCache.h"
+#include "PfsArchive.h"
+#include "ArchiveWriter.h"
+#include "AsyncFileWriter.h"
 #include "Config.h"
 
 class FgComposer {
 public:
-    // ϣһĺϳɽ
+    // 部件ID：扫描时为每个文件分配的序号，用作部件数组的下标
+    using PartId = uint16_t;
+    static constexpr PartId INVALID_PART = 0xFFFF;
+
+    // 组合：一个完整的合成结果，按图层顺序排列的部件ID，首个为基础图像
+    // 指向组合表中的一行，不持有数据
     struct Combination {
-        std::vector<std::string> components;  // ļ
-        std::string outputFilename;           // ļ
+        const PartId* ids = nullptr;
+        size_t count = 0;
 
-        Combination() = default;
-        Combination(const std::vector<std::string>& files, const std::string& output)
-            : components(files), outputFilename(output) {
-        }
+        bool empty() const { return count == 0; }
     };
 
-    // ṹ
+    // 部件分类结构
     struct Part {
-        std::vector<std::string> files;           // ڸ÷ļ
+        std::vector<PartId> files;                // 属于该分类的文件ID
 
         Part() = default;
     };
 
-    // ṹĸ (a~z)
+    // 组结构：按字母分组 (a~z)
     struct Group {
-        std::map<std::string, Part> parts; // ӳ
+        std::map<std::string, Part> parts; // 部件分类映射
 
         Group() = default;
     };
 
+    // 批量模式下各目录共用的资源，为空的项由合成器自行创建
+    struct SharedResources {
+        LuaParser* luaParser = nullptr;     // 已加载坐标表并解析了各目录的字段
+        PartCache* partCache = nullptr;     // 部件缓存，由调用方在全部目录完成后写出
+        const PfsArchive* pfs = nullptr;    // 已打开的部件归档
+        AsyncFileWriter* writer = nullptr;  // 已启动的后台写出，由调用方结束
+    };
+
     explicit FgComposer(const Config& config);
+
+    /**
+     * @brief 使用共享资源构造，用于批量模式
+     * @param config 本目录的配置
+     * @param shared 共享资源
+     * @note 批量模式下PNG编解码参数由调用方统一设置，合成器不再修改
+     */
+    FgComposer(const Config& config, const SharedResources& shared);
     ~FgComposer();
 
     /**
-     * @brief ִкϳ
-     * @return ɹtrueʧܷfalse
+     * @brief 加载坐标表：优先使用指定的Lua路径，从归档读取时默认使用归档中的坐标表
+     * @param config 配置
+     * @param pfs 部件归档，未打开时只从文件加载
+     * @param parser 坐标解析器
+     * @return 加载成功返回true；未配置坐标表或加载失败返回false
+     */
+    static bool loadPositionTable(const Config& config, const PfsArchive& pfs, LuaParser& parser);
+
+    /**
+     * @brief 设置PNG编解码参数
+     * @param config 配置
+     * @note auto压缩级别需要合成样本，此处使用默认级别
+     */
+    static void applyCodecOptions(const Config& config);
+
+    /**
+     * @brief 执行合成流程
+     * @return 成功返回true，失败返回false
      */
     bool process();
 
     /**
-     * @brief ȡͳϢ
-     * @return ϳɵ
+     * @brief 只加载部件并生成组合表，不合成也不输出，用于按需合成
+     * @return 成功返回true
+     */
+    bool prepare();
+
+    /**
+     * @brief 按部件文件名合成一个组合
+     * @param names 部件文件名，按图层顺序排列，首个为基础图像；可以是组合表以外的搭配
+     * @param result 输出的合成图像，已有缓冲容量足够时直接复用
+     * @return 部件不存在或无效时返回false
+     * @note 只读取已加载的部件，可在多个线程同时调用
+     */
+    bool composeParts(const std::vector<std::string>& names, ImageData& result) const;
+
+    /**
+     * @brief 已加载的部件文件名，下标为部件ID
+     */
+    const std::vector<std::string>& getPartNames() const { return partNames; }
+
+    /**
+     * @brief 组合表中一个组合的部件文件名
+     * @param index 组合序号，小于getCombinationCount()
+     * @return 按图层顺序排列的部件文件名
+     */
+    std::vector<std::string> getCombinationParts(size_t index) const;
+
+    /**
+     * @brief 从内存加载一个部件并按文件名分类，不经过文件系统
+     * @param name 部件文件名，不含扩展名，用于分类和查找坐标
+     * @param data PNG或QOI数据，按文件头区分
+     * @param size 数据长度
+     * @return 解码失败或部件数量超过上限返回false
+     * @note 已加载坐标表时使用表中的坐标，否则读取图像中的坐标注释；同名部件替换图像数据。
+     *       加载完成后调用generateCombinations生成组合表
+     */
+    bool addPart(const std::string& name, const uint8_t* data, size_t size);
+
+    /**
+     * @brief 设置部件的坐标
+     * @param name 部件文件名
+     * @param x 坐标
+     * @param y 坐标
+     * @return 部件不存在返回false
+     */
+    bool setPartPosition(const std::string& name, int x, int y);
+
+    /**
+     * @brief 从内存加载坐标表，按config.globalName解析并更新已加载部件的坐标
+     * @param text 脚本内容
+     * @param size 内容长度
+     * @param sourceName 脚本名称，用于错误信息
+     * @return 加载或解析失败返回false
+     */
+    bool loadPositionBuffer(const char* text, size_t size, const std::string& sourceName);
+
+    /**
+     * @brief 按已加载的部件生成所有可能的组合
+     * @return 成功返回true
+     * @note 重新调用时替换原有组合表
+     */
+    bool generateCombinations();
+
+    /**
+     * @brief 组合的名称，即不含扩展名的输出文件名
+     * @param index 组合序号，小于getCombinationCount()
+     */
+    std::string getCombinationName(size_t index) const;
+
+    /**
+     * @brief 计算组合的画布尺寸和坐标，不合成
+     * @param index 组合序号，小于getCombinationCount()
+     * @param canvas 输出画布的尺寸和坐标，不分配像素
+     * @return 组合非空返回true
+     */
+    bool measureCombination(size_t index, ImageData& canvas) const;
+
+    /**
+     * @brief 合成组合到调用方提供的画布
+     * @param index 组合序号，小于getCombinationCount()
+     * @param canvas 目标画布，尺寸须与measureCombination的结果相同，行距可以更大
+     * @return 部件无效或画布尺寸不符返回false
+     * @note 只读取已加载的部件，可在多个线程同时调用
      */
-    int getCombinationCount() const { return combinations.size(); }
+    bool composeCombinationInto(size_t index, const ImageSpan& canvas) const;
+
+    /**
+     * @brief 监视模式：完整合成一次后监视输入目录和坐标表，只重新合成受影响的组合
+     * @param stopRequested 返回true时停止监视
+     * @return 首次合成失败返回false
+     * @note 部件保持解码状态常驻内存；修改的部件只重新解码该文件，坐标表变化时只处理坐标改变的部件；
+     *       增加或删除部件时重新扫描目录并生成组合表，未变化的部件不重新解码
+     */
+    bool watch(const std::function<bool()>& stopRequested);
+
+    /**
+     * @brief 获取处理统计信息
+     * @return 合成的组合数量
+     */
+    int getCombinationCount() const { return static_cast<int>(combinationCount()); }
 
 private:
     const Config& config;
-    std::unordered_map<std::string, Group> groups;           // ->ӳ
-    std::unordered_map<std::string, ImageData> images;       // ļ->ͼ
+    std::unordered_map<std::string, Group> groups;           // 组名->组映射，只在扫描和生成组合时使用
+    std::vector<ImageData> partImages;                       // 部件ID->图像数据
+    std::vector<std::string> partNames;                      // 部件ID->文件名
+    std::unordered_map<std::string, PartId> partIds;         // 文件名->部件ID
+
+    std::vector<PartId> combinationTable;                    // 所有组合，每行combinationWidth个ID，不足处填INVALID_PART
+    size_t combinationWidth = 0;                             // 组合表每行的ID个数
+    std::vector<uint32_t> partUsageOffsets;                  // 监视模式：部件ID->partUsage中的起始位置，末尾多一项
+    std::vector<uint32_t> partUsage;                         // 监视模式：按部件ID排列的引用该部件的组合序号
+    std::unordered_map<std::string, ImageData> retainedParts; // 重新扫描时沿用的已解码部件，文件名->图像
+    bool watching = false;                                   // 已完成首次合成，进入监视模式
+    std::unique_ptr<LuaParser> ownLuaParser = std::make_unique<LuaParser>();   // 监视模式重新加载时整体替换
+    PartCache ownPartCache;
+    PfsArchive ownPfs;
+    AsyncFileWriter ownWriter;
+    const bool batchMode;                                    // 使用共享资源，编解码参数由调用方设置
+    LuaParser* luaParser;                                    // Lua坐标解析器
+    PartCache& partCache;                                    // 已解码部件缓存
+    const PfsArchive& pfs;                                   // 部件来源归档，未打开时从输入目录读取
+    ArchiveWriter archive;                                   // 归档输出，未打开时逐个写文件
+    AsyncFileWriter& writer;                                 // 后台写出，未启动时同步写文件
+    std::string pngOptionsSummary;                           // 实际使用的PNG编码参数
 
-    std::vector<Combination> combinations;                   // 
-    LuaParser luaParser;                                     // Lua
+    // 合成图层：部件视图及其在画布中的位置
+    struct Layer {
+        ImageView view;
+        int x;
+        int y;
+    };
 
-    // ѿ
+    // 图集中的一个合成结果
+    struct AtlasSprite {
+        size_t combination;     // 组合序号
+        int page;               // 所在图集页，-1表示未放入
+        int x;                  // 在图集页中的位置
+        int y;
+        int width;
+        int height;
+        int posX;               // 合成结果原本的坐标
+        int posY;
+    };
+
+    // 笛卡尔积生成器
     class CombinationGenerator {
     private:
-        const std::vector<std::vector<std::string>>& arrays;
+        const std::vector<std::vector<PartId>>& arrays;
         std::vector<size_t> indices;
         bool hasNext;
 
     public:
-        CombinationGenerator(const std::vector<std::vector<std::string>>& arr)
+        CombinationGenerator(const std::vector<std::vector<PartId>>& arr)
             : arrays(arr), indices(arr.size(), 0), hasNext(!arr.empty()) {
         }
 
         bool hasMore() const { return hasNext; }
 
-        std::vector<std::string> getNext() {
-            std::vector<std::string> result;
+        // 当前组合写入out，out需有arrays.size()个位置
+        void getNext(PartId* out) {
             for (size_t i = 0; i < arrays.size(); ++i) {
-                result.push_back(arrays[i][indices[i]]);
+                out[i] = arrays[i][indices[i]];
             }
 
-            // λ㷨
+            // 进位算法
             for (int i = arrays.size() - 1; i >= 0; --i) {
                 indices[i]++;
                 if (indices[i] < arrays[i].size()) break;
@@ -88,60 +260,275 @@ private:
                 if (i == 0) hasNext = false;
             }
 
-            return result;
         }
     };
 
     /**
-     * @brief ɨĿ¼, زͼ
-     * @return ɹtrue
+     * @brief 组合总数
+     */
+    size_t combinationCount() const {
+        return combinationWidth == 0 ? 0 : combinationTable.size() / combinationWidth;
+    }
+
+    /**
+     * @brief 取组合表中的一行
+     * @param index 组合序号
+     * @return 指向组合表的组合，末尾的填充ID不计入
+     */
+    Combination getCombination(size_t index) const;
+
+    /**
+     * @brief 扫描目录或归档中的目录, 加载并分类所有图像
+     * @return 成功返回true
      */
     bool loadAndClassifyImages();
 
     /**
-     * @brief пܵ
-     * @return ɹtrue
+     * @brief 为部件分配ID并保存图像数据，同名部件沿用已有ID并替换图像
+     * @param filename 部件文件名
+     * @param image 图像数据，保存后被移走
+     * @return 部件ID，数量超过上限时返回INVALID_PART
      */
-    bool generateCombinations();
+    PartId storePart(const std::string& filename, ImageData& image);
+
+    /**
+     * @brief 按文件名把部件加入所属的组和分类，无法识别时只记录警告
+     */
+    void classifyPart(const std::string& filename, PartId id);
+
+    /**
+     * @brief 从输入目录解码一个部件文件
+     * @param filepath 文件路径
+     * @param isQoi 是否为QOI格式
+     * @param image 输出的图像数据，预估模式下只有尺寸和坐标
+     * @return 成功返回true
+     * @note 监视模式下部件缓存已写出，不再经过缓存；文件读入缓冲后解码而不映射，避免文件被截断时访问映射出错
+     */
+    bool decodePartFile(const std::string& filepath, bool isQoi, ImageData& image);
+
+    /**
+     * @brief 从PFS归档加载部件
+     * @param entry 归档条目
+     * @param isQoi 是否为QOI格式
+     * @param image 输出的图像数据，预估模式下只有尺寸和坐标
+     * @return 成功返回true
+     */
+    bool loadArchivedImage(const PfsArchive::Entry& entry, bool isQoi, ImageData& image);
 
     /**
-     * @brief ִͼϳ
-     * @return ɹtrue
+     * @brief 建立部件到组合的反向索引
+     */
+    void buildPartUsage();
+
+    /**
+     * @brief 处理一批文件变化
+     * @param changedFiles 输入目录中变化的图像文件
+     * @param positionsChanged 坐标表是否变化
+     * @return 重新合成全部成功返回true
+     */
+    bool applyChanges(const std::vector<std::string>& changedFiles, bool positionsChanged);
+
+    /**
+     * @brief 重新加载坐标表并更新部件坐标
+     * @param dirtyParts 坐标改变的部件被标记
+     * @return 加载成功返回true，失败时保留原有坐标
+     */
+    bool reloadPositionTable(std::vector<bool>& dirtyParts);
+
+    /**
+     * @brief 部件增加或删除后重新扫描目录并生成组合表
+     * @param dirtyParts 输入为已变化的部件，输出为新部件ID下已变化或新增的部件
+     * @param partsRemoved 输出是否有部件被删除
+     * @return 成功返回true
+     */
+    bool rebuildCombinations(std::vector<bool>& dirtyParts, bool& partsRemoved);
+
+    /**
+     * @brief 重新合成引用了变化部件的组合
+     * @param dirtyParts 部件ID->是否变化
+     * @param allGroups 图集和差分模式下重新输出全部基础图像，用于部件被删除后
+     * @return 全部成功返回true
+     */
+    bool recomposeParts(const std::vector<bool>& dirtyParts, bool allGroups);
+
+    /**
+     * @brief 执行图像合成
+     * @return 成功返回true
      */
     bool composeImages();
 
     /**
-     * @brief ļȡĸ
-     * @param filename ļ
-     * @return ַ
+     * @brief 逐个合成组合并分别保存
+     * @param streamRows 是否逐带合成并直接写出
+     * @return 全部成功返回true
+     */
+    bool composeSeparateFiles(bool streamRows);
+
+    /**
+     * @brief 合成一个组合并保存为单独的文件
+     * @param index 组合序号，组合不能为空
+     * @param streamRows 是否逐带合成并直接写出
+     * @param result 复用的画布
+     * @return 成功返回true
+     */
+    bool composeSeparateFile(size_t index, bool streamRows, ImageData& result);
+
+    /**
+     * @brief 计算组合的画布和各图层位置
+     * @param combination 组合
+     * @param layers 输出的图层
+     * @param canvas 输出画布的尺寸和坐标，不分配像素
+     * @return 组合非空返回true
+     */
+    bool layoutCombination(Combination combination, std::vector<Layer>& layers, ImageData& canvas) const;
+
+    /**
+     * @brief 检查图层是否都是有效的RGBA图像
+     * @param combination 组合，用于错误信息
+     * @param layers 图层
+     * @return 全部有效返回true
+     */
+    bool checkLayers(Combination combination, const std::vector<Layer>& layers) const;
+
+    /**
+     * @brief 将已布局的图层合成到画布
+     * @param layers 图层，坐标相对画布
+     * @param canvas 目标画布，可以是更大图像中的一块区域
+     */
+    static void composeLayers(const std::vector<Layer>& layers, const ImageSpan& canvas);
+
+    /**
+     * @brief 合成单个组合
+     * @param combination 组合
+     * @param result 输出的合成图像，已有缓冲容量足够时直接复用
+     * @return 成功返回true
+     */
+    bool composeCombination(Combination combination, ImageData& result) const;
+
+    /**
+     * @brief 逐带合成单个组合并直接写出PNG，不生成完整画布
+     * @param combination 组合
+     * @param outputPath 输出文件路径
+     * @return 成功返回true
+     */
+    bool composeCombinationStreamed(Combination combination, const std::string& outputPath) const;
+
+    /**
+     * @brief 同一基础图像的一段组合的末尾
+     * @param begin 首个组合序号
+     * @return 基础图像不同的首个组合序号，或组合总数
+     * @note 生成组合时同一基础图像的组合相邻排列
+     */
+    size_t baseRunEnd(size_t begin) const;
+
+    /**
+     * @brief 按输出格式保存图像到输出目录或归档
+     * @param filename 输出文件名
+     * @param image 图像数据
+     * @param writePos 是否写入坐标信息
+     * @return 成功返回true
+     */
+    bool saveImage(const std::string& filename, const ImageData& image, bool writePos);
+
+    /**
+     * @brief 保存文本文件到输出目录或归档
+     * @param filename 输出文件名
+     * @param text 文件内容
+     * @return 成功返回true
+     */
+    bool saveText(const std::string& filename, const std::string& text);
+
+    /**
+     * @brief 差分模式：每个基础图像写出一次，各组合只写出部件覆盖的区域并生成清单
+     * @return 全部成功返回true
+     */
+    bool composeDeltas();
+
+    /**
+     * @brief 写出一个基础图像及其各组合的差分区域
+     * @param begin 首个组合序号
+     * @param end 末尾组合序号 (不含)
+     * @param baseId 基础图像ID
+     * @return 全部成功返回true
+     */
+    bool composeDeltaGroup(size_t begin, size_t end, PartId baseId);
+
+    /**
+     * @brief 图集模式：按基础图像把合成结果装入图集并写出索引
+     * @return 全部成功返回true
+     */
+    bool composeAtlases();
+
+    /**
+     * @brief 合成同一基础图像的所有组合，装入一个或多个图集页
+     * @param begin 首个组合序号
+     * @param end 末尾组合序号 (不含)
+     * @param baseName 基础图像文件名，用作图集和索引的文件名前缀
+     * @return 全部成功返回true
+     */
+    bool composeAtlasGroup(size_t begin, size_t end, const std::string& baseName);
+
+    /**
+     * @brief 写出图集索引
+     * @param indexFile 索引文件名
+     * @param pageFiles 各图集页的文件名
+     * @param pageSizes 各图集页的宽高
+     * @param sprites 合成结果在图集中的位置
+     * @return 成功返回true
+     */
+    bool writeAtlasIndex(const std::string& indexFile, const std::vector<std::string>& pageFiles,
+        const std::vector<std::pair<int, int>>& pageSizes, const std::vector<AtlasSprite>& sprites);
+
+    /**
+     * @brief 只根据文件头预估每个组合的画布大小和内存需求
+     * @return 成功返回true
+     */
+    bool forecastCombinations() const;
+
+    /**
+     * @brief 根据配置确定并设置PNG编码参数
+     * @return 成功返回true
+     */
+    bool setupPngOptions();
+
+    /**
+     * @brief 抽样试编码，自动选择满足目标的PNG编码参数
+     * @param options 输入为显式指定的参数，输出为选中的参数
+     */
+    void tunePngOptions(PngEncodeOptions& options);
+
+    /**
+     * @brief 从文件名提取组名（首字母）
+     * @param filename 文件名
+     * @return 组名字符串
      */
     std::string getGroupName(const std::string& filename) const;
 
     /**
-     * @brief ȷļ
-     * @param filename ļ
-     * @return ƣַʾƥκι
+     * @brief 确定文件所属部件分类
+     * @param filename 文件名
+     * @return 部件名称，空字符串表示不匹配任何规则
      */
     std::string getPartName(const std::string& filename) const;
 
     /**
-     * @brief ȡͼ
-     * @param filename ļ
-     * @param group 
-     * @return  (x, y)
+     * @brief 获取图像的坐标
+     * @param filename 文件名
+     * @param group 组名
+     * @return 坐标对 (x, y)
      */
     //std::pair<int, int> getPos(const std::string& filename, const std::string& group) const;
 
     /**
-     * @brief ļ
-     * @param components ļб
-     * @return ļ
+     * @brief 生成输出文件名
+     * @param combination 组合
+     * @return 输出文件名
      */
-    std::string makeOutputFilename(const std::vector<std::string>& components) const;
+    std::string makeOutputFilename(Combination combination) const;
 
     /**
-     * @brief ϲϳ
-     * @return ɹtrue
+     * @brief 生成所有组合并合成
+     * @return 成功返回true
      */
     //bool generateAndCompose();
 };
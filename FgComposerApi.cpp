@@ -0,0 +1,230 @@
+#include "FgComposerApi.h"
+#include "BufferPool.h"
+#include "FgComposer.h"
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+
+// 合成器句柄：配置须先于合成器构造，合成器只保存其引用
+struct afc_composer {
+    Config config;
+    std::unique_ptr<FgComposer> composer;
+    std::vector<std::string> combinationNames;      // afc_get_combination_name返回的字符串
+};
+
+// 存在的合成器数量，最后一个销毁时释放内存池中的空闲内存
+static std::atomic<int> composerCount{ 0 };
+
+void afc_set_log_level(int level) {
+    switch (level) {
+    case AFC_LOG_DEBUG: Logger::SetLevel(Logger::Level::DEBUG); break;
+    case AFC_LOG_INFO: Logger::SetLevel(Logger::Level::INFO); break;
+    case AFC_LOG_WARNING: Logger::SetLevel(Logger::Level::WARNING); break;
+    default: Logger::SetLevel(Logger::Level::ERROR); break;
+    }
+}
+
+void afc_set_log_stderr(int use_stderr) {
+    Logger::SetUseStderr(use_stderr != 0);
+}
+
+afc_composer* afc_create(void) {
+    try {
+        auto handle = std::make_unique<afc_composer>();
+        handle->config.InitializeDefaultRules();
+        handle->composer = std::make_unique<FgComposer>(handle->config);
+        composerCount++;
+        return handle.release();
+    }
+    catch (const std::exception& ex) {
+        Logger::Error("创建合成器失败: " + std::string(ex.what()));
+        return nullptr;
+    }
+}
+
+void afc_destroy(afc_composer* composer) {
+    if (!composer) {
+        return;
+    }
+    delete composer;
+    if (--composerCount == 0) {
+        BufferPool::Trim();
+    }
+}
+
+int afc_load_positions(afc_composer* composer, const char* text, size_t size, const char* global_name) {
+    if (!composer || !text || !global_name) {
+        return 0;
+    }
+    try {
+        composer->config.globalName = global_name;
+        return composer->composer->loadPositionBuffer(text, size, global_name);
+    }
+    catch (const std::exception& ex) {
+        Logger::Error("加载坐标表时发生异常: " + std::string(ex.what()));
+        return 0;
+    }
+}
+
+int afc_add_part(afc_composer* composer, const char* name, const void* data, size_t size) {
+    if (!composer || !name || !data) {
+        return 0;
+    }
+    try {
+        return composer->composer->addPart(name, static_cast<const uint8_t*>(data), size);
+    }
+    catch (const std::exception& ex) {
+        Logger::Error("加载部件时发生异常: " + std::string(ex.what()));
+        return 0;
+    }
+}
+
+int afc_set_part_position(afc_composer* composer, const char* name, int x, int y) {
+    if (!composer || !name) {
+        return 0;
+    }
+    try {
+        return composer->composer->setPartPosition(name, x, y);
+    }
+    catch (const std::exception& ex) {
+        Logger::Error("设置部件坐标时发生异常: " + std::string(ex.what()));
+        return 0;
+    }
+}
+
+int afc_generate(afc_composer* composer) {
+    if (!composer) {
+        return -1;
+    }
+    try {
+        if (!composer->composer->generateCombinations()) {
+            return -1;
+        }
+        const int count = composer->composer->getCombinationCount();
+        composer->combinationNames.clear();
+        for (int i = 0; i < count; i++) {
+            composer->combinationNames.push_back(composer->composer->getCombinationName(i));
+        }
+        return count;
+    }
+    catch (const std::exception& ex) {
+        Logger::Error("生成组合时发生异常: " + std::string(ex.what()));
+        return -1;
+    }
+}
+
+size_t afc_get_combination_count(const afc_composer* composer) {
+    return composer ? composer->combinationNames.size() : 0;
+}
+
+const char* afc_get_combination_name(const afc_composer* composer, size_t index) {
+    if (!composer || index >= composer->combinationNames.size()) {
+        return nullptr;
+    }
+    return composer->combinationNames[index].c_str();
+}
+
+int afc_get_combination_info(const afc_composer* composer, size_t index, afc_image_info* info) {
+    if (!composer || !info || index >= composer->combinationNames.size()) {
+        return 0;
+    }
+    try {
+        ImageData canvas;
+        if (!composer->composer->measureCombination(index, canvas)) {
+            return 0;
+        }
+        info->width = canvas.width;
+        info->height = canvas.height;
+        info->pos_x = canvas.posX;
+        info->pos_y = canvas.posY;
+        return 1;
+    }
+    catch (const std::exception& ex) {
+        Logger::Error("计算组合尺寸时发生异常: " + std::string(ex.what()));
+        return 0;
+    }
+}
+
+int afc_compose(const afc_composer* composer, size_t index, void* pixels, size_t stride) {
+    afc_image_info info;
+    if (!pixels || !afc_get_combination_info(composer, index, &info)) {
+        return 0;
+    }
+    if (stride < static_cast<size_t>(info.width) * 4) {
+        Logger::Error("行距小于画布宽度: " + std::to_string(stride));
+        return 0;
+    }
+    try {
+        ImageSpan canvas(static_cast<uint8_t*>(pixels), info.width, info.height, 4, stride, info.pos_x, info.pos_y);
+        return composer->composer->composeCombinationInto(index, canvas);
+    }
+    catch (const std::exception& ex) {
+        Logger::Error("合成组合时发生异常: " + std::string(ex.what()));
+        return 0;
+    }
+}
+
+int afc_encode_png(const void* pixels, size_t stride, const afc_image_info* info, int write_pos,
+    const char* encoder, int level, void** png_data, size_t* png_size) {
+    if (!pixels || !info || !png_data || !png_size || info->width <= 0 || info->height <= 0) {
+        return 0;
+    }
+    const size_t rowBytes = static_cast<size_t>(info->width) * 4;
+    if (stride < rowBytes) {
+        return 0;
+    }
+
+    PngEncodeOptions options = ImageProcessor::GetPngEncodeOptions();
+    if (encoder && !ImageProcessor::ParsePngEncoder(encoder, options.encoder)) {
+        Logger::Error("未知的PNG编码器: " + std::string(encoder));
+        return 0;
+    }
+    if (level < -1 || level > 9) {
+        Logger::Error("压缩级别必须在0-9之间，或为-1使用默认: " + std::to_string(level));
+        return 0;
+    }
+    if (level >= 0) {
+        options.level = level;
+    }
+
+    try {
+        // 行紧密排列时直接引用调用方的像素，否则先拼成连续的画布
+        ImageData image;
+        image.width = info->width;
+        image.height = info->height;
+        image.channels = 4;
+        image.posX = info->pos_x;
+        image.posY = info->pos_y;
+        const uint8_t* source = static_cast<const uint8_t*>(pixels);
+        if (stride == rowBytes) {
+            image.data = PixelBuffer::View(source, rowBytes * info->height, nullptr);
+        }
+        else {
+            image.data.AllocateUninitialized(rowBytes * info->height);
+            for (int y = 0; y < info->height; y++) {
+                memcpy(image.data.data() + y * rowBytes, source + y * stride, rowBytes);
+            }
+        }
+
+        std::vector<uint8_t> encoded;
+        if (!ImageProcessor::EncodePng(image, encoded, options, write_pos != 0)) {
+            return 0;
+        }
+        void* result = std::malloc(encoded.size());
+        if (!result) {
+            return 0;
+        }
+        memcpy(result, encoded.data(), encoded.size());
+        *png_data = result;
+        *png_size = encoded.size();
+        return 1;
+    }
+    catch (const std::exception& ex) {
+        Logger::Error("编码PNG时发生异常: " + std::string(ex.what()));
+        return 0;
+    }
+}
+
+void afc_free(void* data) {
+    std::free(data);
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+/*
+ * 立绘合成库的C接口
+ * 部件、坐标表和输出都在内存中传递，不读写文件，供资源管线在进程内调用。
+ * 典型流程：afc_create -> afc_load_positions(可选) -> afc_add_part ... -> afc_generate
+ *          -> afc_get_combination_info / afc_compose -> afc_encode_png -> afc_free
+ * 使用静态库时定义AFC_STATIC；使用动态库时不需要额外定义。
+ * 同一合成器的afc_get_combination_info和afc_compose可在多个线程同时调用，其余函数不能与它们并发。
+ */
+
+#include <stddef.h>
+
+#if defined(AFC_STATIC)
+#define AFC_API
+#elif defined(_WIN32)
+#ifdef AFC_BUILD_DLL
+#define AFC_API __declspec(dllexport)
+#else
+#define AFC_API __declspec(dllimport)
+#endif
+#else
+#define AFC_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct afc_composer afc_composer;
+
+/* 日志级别 */
+enum {
+    AFC_LOG_DEBUG = 0,
+    AFC_LOG_INFO = 1,
+    AFC_LOG_WARNING = 2,
+    AFC_LOG_ERROR = 3
+};
+
+/* 合成结果的尺寸和坐标 */
+typedef struct afc_image_info {
+    int width;
+    int height;
+    int pos_x;
+    int pos_y;
+} afc_image_info;
+
+/**
+ * @brief 设置日志级别，对所有合成器生效
+ */
+AFC_API void afc_set_log_level(int level);
+
+/**
+ * @brief 设置日志写到标准错误还是标准输出，对所有合成器和整个进程生效
+ * @param use_stderr 非0时写到标准错误，0时写到标准输出(默认)
+ * @note 宿主程序自己使用标准输出时应在创建合成器前设置
+ */
+AFC_API void afc_set_log_stderr(int use_stderr);
+
+/**
+ * @brief 创建合成器，使用默认的分组和部件分类规则
+ * @return 失败返回NULL
+ */
+AFC_API afc_composer* afc_create(void);
+
+/**
+ * @brief 销毁合成器并释放所有部件
+ * @note 最后一个合成器销毁时同时释放内部缓存的空闲内存
+ */
+AFC_API void afc_destroy(afc_composer* composer);
+
+/**
+ * @brief 从内存加载坐标表
+ * @param text Lua脚本内容
+ * @param size 内容长度
+ * @param global_name 坐标表中的字段名，如"chr_no"
+ * @return 成功返回非0
+ * @note 已加载的部件立即改用表中的坐标；之后加载的部件也使用表中的坐标而不读取图像中的坐标注释
+ */
+AFC_API int afc_load_positions(afc_composer* composer, const char* text, size_t size, const char* global_name);
+
+/**
+ * @brief 从内存加载一个部件
+ * @param name 部件文件名，不含扩展名，用于分类和查找坐标
+ * @param data PNG或QOI数据，按文件头区分
+ * @param size 数据长度
+ * @return 成功返回非0
+ * @note 数据在返回后即可释放；同名部件替换原有图像
+ */
+AFC_API int afc_add_part(afc_composer* composer, const char* name, const void* data, size_t size);
+
+/**
+ * @brief 设置部件的坐标，覆盖坐标表或图像中的坐标
+ * @return 成功返回非0，部件不存在或失败返回0
+ */
+AFC_API int afc_set_part_position(afc_composer* composer, const char* name, int x, int y);
+
+/**
+ * @brief 按已加载的部件生成组合表
+ * @return 组合数量，失败返回-1
+ * @note 增加部件后需要重新调用，组合序号随之改变
+ */
+AFC_API int afc_generate(afc_composer* composer);
+
+/**
+ * @brief 组合数量
+ */
+AFC_API size_t afc_get_combination_count(const afc_composer* composer);
+
+/**
+ * @brief 组合的名称，即命令行版本的输出文件名(不含扩展名)
+ * @return 序号越界返回NULL；字符串在下次调用afc_generate前有效
+ */
+AFC_API const char* afc_get_combination_name(const afc_composer* composer, size_t index);
+
+/**
+ * @brief 组合的画布尺寸和坐标，用于分配afc_compose的缓冲
+ * @return 成功返回非0
+ */
+AFC_API int afc_get_combination_info(const afc_composer* composer, size_t index, afc_image_info* info);
+
+/**
+ * @brief 合成一个组合到调用方提供的缓冲
+ * @param pixels RGBA像素缓冲，至少stride * height字节
+ * @param stride 相邻两行的字节距离，不小于width * 4
+ * @return 成功返回非0
+ */
+AFC_API int afc_compose(const afc_composer* composer, size_t index, void* pixels, size_t stride);
+
+/**
+ * @brief 将RGBA像素编码为PNG
+ * @param pixels RGBA像素
+ * @param stride 相邻两行的字节距离，不小于width * 4
+ * @param info 图像尺寸和坐标
+ * @param write_pos 非0时写入坐标注释
+ * @param encoder 编码器名称：libpng、parallel、fast；NULL使用默认
+ * @param level 压缩级别0-9，-1使用默认，其他值返回0
+ * @param png_data 输出的PNG数据，由afc_free释放
+ * @param png_size 输出的数据长度
+ * @return 成功返回非0
+ */
+AFC_API int afc_encode_png(const void* pixels, size_t stride, const afc_image_info* info, int write_pos,
+    const char* encoder, int level, void** png_data, size_t* png_size);
+
+/**
+ * @brief 释放本库分配的内存
+ */
+AFC_API void afc_free(void* data);
+
+#ifdef __cplusplus
+}
+#endif
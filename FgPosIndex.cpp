@@ -0,0 +1,322 @@
+#include "FgPosIndex.h"
+#include "Checksum.h"
+#include "Config.h"
+#include "ImageProcessor.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+
+// 索引文件标识与格式版本，格式变化时递增版本号使旧索引失效
+static const char INDEX_MAGIC[4] = { 'A', 'F', 'P', 'I' };
+constexpr uint32_t FORMAT_VERSION = 2;
+
+// 平均每个桶的键数，越大索引越小、建立越慢
+constexpr uint32_t KEYS_PER_BUCKET = 4;
+
+// 单个桶尝试的位移上限，超出时换一个种子重建
+constexpr uint32_t MAX_DISPLACEMENT = 1u << 24;
+constexpr int MAX_SEED_ATTEMPTS = 8;
+
+constexpr uint32_t EMPTY_SLOT = 0xFFFFFFFFu;
+constexpr uint64_t SECTION_ALIGNMENT = 8;
+
+namespace {
+
+uint64_t KeyHash(uint64_t seed, std::string_view name) {
+    return Checksum::Hash64(reinterpret_cast<const uint8_t*>(name.data()), name.size(), seed);
+}
+
+// 组内文件的键同时包含组下标，不同组的同名文件互不冲突
+uint64_t FileSeed(uint64_t seed, uint32_t group) {
+    return seed + group + 1;
+}
+
+// 哈希的低32位选桶，与位移混合后的高32位选槽
+uint32_t BucketOf(uint64_t hash, uint32_t bucketCount) {
+    return static_cast<uint32_t>(((hash & 0xFFFFFFFFu) * bucketCount) >> 32);
+}
+
+uint32_t SlotOf(uint64_t hash, uint32_t displacement, uint32_t count) {
+    uint64_t h = hash ^ (displacement * 0x9E3779B97F4A7C15ull);
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    return static_cast<uint32_t>(((h >> 32) * count) >> 32);
+}
+
+/**
+ * @brief 按哈希-位移法建立最小完美哈希
+ * @param hashes 各键的哈希
+ * @param buckets 输出各桶的位移
+ * @param slots 输出各槽位对应的键下标
+ * @return 成功返回true；哈希重复或位移超出上限时返回false，应换种子重试
+ */
+bool BuildPerfectHash(const std::vector<uint64_t>& hashes, std::vector<uint32_t>& buckets, std::vector<uint32_t>& slots) {
+    const uint32_t count = static_cast<uint32_t>(hashes.size());
+    const uint32_t bucketCount = std::max<uint32_t>(1, (count + KEYS_PER_BUCKET - 1) / KEYS_PER_BUCKET);
+
+    std::vector<std::vector<uint32_t>> members(bucketCount);
+    for (uint32_t i = 0; i < count; i++) {
+        members[BucketOf(hashes[i], bucketCount)].push_back(i);
+    }
+
+    // 先安置键多的桶，空槽较多时更容易找到位移
+    std::vector<uint32_t> order(bucketCount);
+    for (uint32_t i = 0; i < bucketCount; i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&members](uint32_t a, uint32_t b) {
+        return members[a].size() > members[b].size();
+    });
+
+    buckets.assign(bucketCount, 0);
+    slots.assign(count, EMPTY_SLOT);
+    std::vector<uint32_t> candidate;
+    for (uint32_t bucket : order) {
+        const std::vector<uint32_t>& keys = members[bucket];
+        if (keys.empty()) {
+            break;
+        }
+
+        bool placed = false;
+        for (uint32_t displacement = 0; displacement < MAX_DISPLACEMENT && !placed; displacement++) {
+            candidate.clear();
+            placed = true;
+            for (uint32_t key : keys) {
+                uint32_t slot = SlotOf(hashes[key], displacement, count);
+                if (slots[slot] != EMPTY_SLOT || std::find(candidate.begin(), candidate.end(), slot) != candidate.end()) {
+                    placed = false;
+                    break;
+                }
+                candidate.push_back(slot);
+            }
+            if (placed) {
+                for (size_t i = 0; i < keys.size(); i++) {
+                    slots[candidate[i]] = keys[i];
+                }
+                buckets[bucket] = displacement;
+            }
+        }
+        if (!placed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 追加一段数据并按8字节对齐，返回其偏移
+uint64_t AppendSection(std::vector<uint8_t>& output, const void* data, size_t size) {
+    output.resize((output.size() + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT);
+    uint64_t offset = output.size();
+    if (size > 0) {
+        output.insert(output.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+    }
+    return offset;
+}
+
+bool SectionFits(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t fileSize) {
+    return offset % SECTION_ALIGNMENT == 0 && offset <= fileSize && count <= (fileSize - offset) / elementSize;
+}
+
+}
+
+bool FgPosIndex::Open(const std::string& path, uint64_t sourceHash, uint64_t sourceSize) {
+    groups = nullptr;
+    mapped.Close();
+    if (!std::filesystem::exists(path)) {
+        return false;
+    }
+    if (!mapped.Open(path) || !ValidateMapped(sourceHash, sourceSize)) {
+        Logger::Warning("坐标索引无效或版本不符，将重新生成: " + path);
+        groups = nullptr;
+        mapped.Close();
+        return false;
+    }
+    return true;
+}
+
+bool FgPosIndex::ValidateMapped(uint64_t sourceHash, uint64_t sourceSize) {
+    const uint8_t* base = mapped.data();
+    const uint64_t size = mapped.size();
+    if (size < sizeof(Header)) {
+        return false;
+    }
+
+    Header header;
+    memcpy(&header, base, sizeof(header));
+    if (memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 || header.formatVersion != FORMAT_VERSION ||
+        header.sourceHash != sourceHash || header.sourceSize != sourceSize) {
+        return false;
+    }
+    if (Checksum::Hash64(base + sizeof(Header), size - sizeof(Header)) != header.contentHash) {
+        return false;
+    }
+    if (header.groupBucketCount == 0 || header.fileBucketCount == 0 ||
+        !SectionFits(header.groupOffset, header.groupCount, sizeof(Group), size) ||
+        !SectionFits(header.fileOffset, header.fileCount, sizeof(File), size) ||
+        !SectionFits(header.groupSlotOffset, header.groupCount, sizeof(uint32_t), size) ||
+        !SectionFits(header.fileSlotOffset, header.fileCount, sizeof(uint32_t), size) ||
+        !SectionFits(header.groupBucketOffset, header.groupBucketCount, sizeof(uint32_t), size) ||
+        !SectionFits(header.fileBucketOffset, header.fileBucketCount, sizeof(uint32_t), size) ||
+        header.namesOffset > size || header.namesSize > size - header.namesOffset) {
+        return false;
+    }
+
+    const Group* groupTable = reinterpret_cast<const Group*>(base + header.groupOffset);
+    const File* fileTable = reinterpret_cast<const File*>(base + header.fileOffset);
+    const uint32_t* groupSlotTable = reinterpret_cast<const uint32_t*>(base + header.groupSlotOffset);
+    const uint32_t* fileSlotTable = reinterpret_cast<const uint32_t*>(base + header.fileSlotOffset);
+
+    // 查找时直接按下标访问，这里一次性检查所有下标和名称范围
+    auto nameFits = [&header](uint32_t offset, uint32_t length) {
+        return offset <= header.namesSize && length <= header.namesSize - offset;
+    };
+    for (uint32_t i = 0; i < header.groupCount; i++) {
+        const Group& group = groupTable[i];
+        if (!nameFits(group.nameOffset, group.nameLength) || group.firstFile > header.fileCount ||
+            group.fileCount > header.fileCount - group.firstFile || groupSlotTable[i] >= header.groupCount) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header.fileCount; i++) {
+        if (!nameFits(fileTable[i].nameOffset, fileTable[i].nameLength) || fileSlotTable[i] >= header.fileCount) {
+            return false;
+        }
+    }
+
+    seed = header.seed;
+    groupCount = header.groupCount;
+    fileCount = header.fileCount;
+    groupBucketCount = header.groupBucketCount;
+    fileBucketCount = header.fileBucketCount;
+    groups = groupTable;
+    files = fileTable;
+    groupSlots = groupSlotTable;
+    fileSlots = fileSlotTable;
+    groupBuckets = reinterpret_cast<const uint32_t*>(base + header.groupBucketOffset);
+    fileBuckets = reinterpret_cast<const uint32_t*>(base + header.fileBucketOffset);
+    names = reinterpret_cast<const char*>(base + header.namesOffset);
+    return true;
+}
+
+int32_t FgPosIndex::FindGroup(std::string_view name) const {
+    if (groupCount == 0) {
+        return -1;
+    }
+    const uint64_t hash = KeyHash(seed, name);
+    const uint32_t index = groupSlots[SlotOf(hash, groupBuckets[BucketOf(hash, groupBucketCount)], groupCount)];
+    const Group& group = groups[index];
+    return Name(group.nameOffset, group.nameLength) == name ? static_cast<int32_t>(index) : -1;
+}
+
+const FgPosIndex::File* FgPosIndex::FindFile(uint32_t group, std::string_view name) const {
+    if (fileCount == 0 || group >= groupCount) {
+        return nullptr;
+    }
+    const uint64_t hash = KeyHash(FileSeed(seed, group), name);
+    const uint32_t index = fileSlots[SlotOf(hash, fileBuckets[BucketOf(hash, fileBucketCount)], fileCount)];
+
+    // 不在表中的键也会落到某个槽位，需确认属于该组且名称相同
+    const Group& owner = groups[group];
+    const File& file = files[index];
+    if (index < owner.firstFile || index - owner.firstFile >= owner.fileCount ||
+        Name(file.nameOffset, file.nameLength) != name) {
+        return nullptr;
+    }
+    return &file;
+}
+
+bool FgPosIndex::Write(const std::string& path, uint64_t sourceHash, uint64_t sourceSize,
+    const std::vector<SourceGroup>& sourceGroups) {
+    std::vector<Group> groupTable;
+    std::vector<File> fileTable;
+    std::string namePool;
+    groupTable.reserve(sourceGroups.size());
+    for (const SourceGroup& source : sourceGroups) {
+        Group group{};
+        group.nameOffset = static_cast<uint32_t>(namePool.size());
+        group.nameLength = static_cast<uint32_t>(source.name.size());
+        group.firstFile = static_cast<uint32_t>(fileTable.size());
+        group.fileCount = static_cast<uint32_t>(source.files.size());
+        namePool += source.name;
+        for (const SourceFile& sourceFile : source.files) {
+            File file{};
+            file.nameOffset = static_cast<uint32_t>(namePool.size());
+            file.nameLength = static_cast<uint32_t>(sourceFile.name.size());
+            file.x = sourceFile.x;
+            file.y = sourceFile.y;
+            namePool += sourceFile.name;
+            fileTable.push_back(file);
+        }
+        groupTable.push_back(group);
+    }
+
+    // 极少数情况下两个键的哈希相同或某个桶无法安置，换种子重建
+    Header header{};
+    std::vector<uint32_t> groupBucketTable, groupSlotTable, fileBucketTable, fileSlotTable;
+    bool built = false;
+    for (int attempt = 0; attempt < MAX_SEED_ATTEMPTS && !built; attempt++) {
+        header.seed = sourceHash + attempt * 0x9E3779B97F4A7C15ull;
+
+        std::vector<uint64_t> hashes;
+        hashes.reserve(groupTable.size());
+        for (const Group& group : groupTable) {
+            hashes.push_back(KeyHash(header.seed, std::string_view(namePool).substr(group.nameOffset, group.nameLength)));
+        }
+        built = BuildPerfectHash(hashes, groupBucketTable, groupSlotTable);
+
+        hashes.clear();
+        hashes.reserve(fileTable.size());
+        for (uint32_t g = 0; g < groupTable.size() && built; g++) {
+            for (uint32_t i = 0; i < groupTable[g].fileCount; i++) {
+                const File& file = fileTable[groupTable[g].firstFile + i];
+                hashes.push_back(KeyHash(FileSeed(header.seed, g),
+                    std::string_view(namePool).substr(file.nameOffset, file.nameLength)));
+            }
+        }
+        built = built && BuildPerfectHash(hashes, fileBucketTable, fileSlotTable);
+    }
+    if (!built) {
+        Logger::Warning("无法为坐标表建立完美哈希，可能含有重复的名称");
+        return false;
+    }
+
+    std::vector<uint8_t> output(sizeof(Header));
+    memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.formatVersion = FORMAT_VERSION;
+    header.sourceHash = sourceHash;
+    header.sourceSize = sourceSize;
+    header.groupCount = static_cast<uint32_t>(groupTable.size());
+    header.fileCount = static_cast<uint32_t>(fileTable.size());
+    header.groupBucketCount = static_cast<uint32_t>(groupBucketTable.size());
+    header.fileBucketCount = static_cast<uint32_t>(fileBucketTable.size());
+    header.groupOffset = AppendSection(output, groupTable.data(), groupTable.size() * sizeof(Group));
+    header.fileOffset = AppendSection(output, fileTable.data(), fileTable.size() * sizeof(File));
+    header.groupSlotOffset = AppendSection(output, groupSlotTable.data(), groupSlotTable.size() * sizeof(uint32_t));
+    header.fileSlotOffset = AppendSection(output, fileSlotTable.data(), fileSlotTable.size() * sizeof(uint32_t));
+    header.groupBucketOffset = AppendSection(output, groupBucketTable.data(), groupBucketTable.size() * sizeof(uint32_t));
+    header.fileBucketOffset = AppendSection(output, fileBucketTable.data(), fileBucketTable.size() * sizeof(uint32_t));
+    header.namesOffset = AppendSection(output, namePool.data(), namePool.size());
+    header.namesSize = namePool.size();
+    header.contentHash = Checksum::Hash64(output.data() + sizeof(Header), output.size() - sizeof(Header));
+    memcpy(output.data(), &header, sizeof(header));
+
+    // 临时文件名带时间戳，避免并发进程互相覆盖
+    const std::string tempPath = path + ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    std::error_code ec;
+    bool success = ImageProcessor::WriteFileData(tempPath, output);
+    if (success) {
+        std::filesystem::rename(tempPath, path, ec);
+        success = !ec;
+    }
+    if (!success) {
+        Logger::Warning("写入坐标索引失败: " + path + (ec ? " (" + ec.message() + ")" : ""));
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+
+    Logger::Info("坐标索引已生成: " + path + " (" + std::to_string(groupTable.size()) + " 个组, " +
+        std::to_string(fileTable.size()) + " 个文件)");
+    return true;
+}
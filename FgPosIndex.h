@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "MappedFile.h"
+
+// 坐标表的二进制索引
+// 解析过的fgpos表按源文件内容哈希保存为紧凑的索引文件，之后的运行直接映射索引，
+// 不再执行或扫描脚本。组名和(组, 文件名)分别用最小完美哈希定位，查找只计算一次哈希、
+// 比较一次名称，不分配字符串
+class FgPosIndex {
+public:
+    // 建立索引时的输入
+    struct SourceFile {
+        std::string name;
+        int32_t x;
+        int32_t y;
+    };
+
+    struct SourceGroup {
+        std::string name;
+        std::vector<SourceFile> files;
+    };
+
+    // 索引中的组，文件在files中连续存放
+    struct Group {
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        uint32_t firstFile;
+        uint32_t fileCount;
+    };
+
+    struct File {
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        int32_t x;
+        int32_t y;
+    };
+
+    FgPosIndex() = default;
+
+    FgPosIndex(const FgPosIndex&) = delete;
+    FgPosIndex& operator=(const FgPosIndex&) = delete;
+
+    /**
+     * @brief 映射索引文件并校验
+     * @param path 索引文件路径
+     * @param sourceHash 源文件内容哈希
+     * @param sourceSize 源文件长度
+     * @return 索引有效且对应该源文件时返回true
+     */
+    bool Open(const std::string& path, uint64_t sourceHash, uint64_t sourceSize);
+
+    bool IsOpen() const { return groups != nullptr; }
+
+    /**
+     * @brief 生成索引文件
+     * @param path 索引文件路径
+     * @param sourceHash 源文件内容哈希
+     * @param sourceSize 源文件长度
+     * @param sourceGroups 按源文件中的顺序排列的组，组名和组内文件名不能重复
+     * @return 成功返回true
+     * @note 先写入临时文件再替换，其他进程已映射的旧索引不受影响
+     */
+    static bool Write(const std::string& path, uint64_t sourceHash, uint64_t sourceSize,
+        const std::vector<SourceGroup>& sourceGroups);
+
+    /**
+     * @brief 按名称查找组
+     * @param name 组名
+     * @return 组下标，不存在时返回-1
+     */
+    int32_t FindGroup(std::string_view name) const;
+
+    /**
+     * @brief 查找组内的文件
+     * @param group 组下标
+     * @param name 文件名
+     * @return 文件指针，不存在时返回nullptr
+     */
+    const File* FindFile(uint32_t group, std::string_view name) const;
+
+    uint32_t GroupCount() const { return groupCount; }
+    const Group& GroupAt(uint32_t index) const { return groups[index]; }
+    const File& FileAt(uint32_t index) const { return files[index]; }
+
+    std::string_view Name(uint32_t offset, uint32_t length) const {
+        return std::string_view(names + offset, length);
+    }
+
+private:
+    // 文件头，按本机字节序存储
+    struct Header {
+        char magic[4];
+        uint32_t formatVersion;
+        uint64_t sourceHash;
+        uint64_t sourceSize;
+        uint64_t seed;              // 完美哈希的种子
+        uint32_t groupCount;
+        uint32_t fileCount;
+        uint32_t groupBucketCount;
+        uint32_t fileBucketCount;
+        uint64_t groupOffset;       // Group[groupCount]
+        uint64_t fileOffset;        // File[fileCount]
+        uint64_t groupSlotOffset;   // uint32_t[groupCount]，槽位->组下标
+        uint64_t fileSlotOffset;    // uint32_t[fileCount]，槽位->文件下标
+        uint64_t groupBucketOffset; // uint32_t[groupBucketCount]，各桶的位移
+        uint64_t fileBucketOffset;  // uint32_t[fileBucketCount]
+        uint64_t namesOffset;
+        uint64_t namesSize;
+        uint64_t contentHash;       // 文件头之后全部内容的哈希，截断或损坏的索引不会被使用
+    };
+
+    /**
+     * @brief 校验映射内容并设置各数组指针
+     * @return 有效返回true
+     */
+    bool ValidateMapped(uint64_t sourceHash, uint64_t sourceSize);
+
+    MappedFile mapped;
+    uint64_t seed = 0;
+    uint32_t groupCount = 0;
+    uint32_t fileCount = 0;
+    uint32_t groupBucketCount = 0;
+    uint32_t fileBucketCount = 0;
+    const Group* groups = nullptr;
+    const File* files = nullptr;
+    const uint32_t* groupSlots = nullptr;
+    const uint32_t* fileSlots = nullptr;
+    const uint32_t* groupBuckets = nullptr;
+    const uint32_t* fileBuckets = nullptr;
+    const char* names = nullptr;
+};
@@ -0,0 +1,589 @@
+#include "FgPosTable.h"
+#include <cmath>
+#include <cstdlib>
+#include <unordered_map>
+
+namespace {
+
+bool IsNameStart(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+bool IsNameChar(char c) {
+    return IsNameStart(c) || (c >= '0' && c <= '9');
+}
+
+bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// 作为值出现的关键字，其余关键字说明脚本不是纯字面量
+bool IsLiteralKeyword(const std::string& name) {
+    return name == "true" || name == "false" || name == "nil";
+}
+
+bool IsKeyword(const std::string& name) {
+    static const char* const KEYWORDS[] = {
+        "and", "break", "do", "else", "elseif", "end", "for", "function", "goto", "if",
+        "in", "local", "not", "or", "repeat", "return", "then", "until", "while",
+    };
+    for (const char* keyword : KEYWORDS) {
+        if (name == keyword) {
+            return true;
+        }
+    }
+    return IsLiteralKeyword(name);
+}
+
+}
+
+bool FgPosTable::Parse(const char* data, size_t size) {
+    source = data;
+    sourceSize = size;
+    pos = 0;
+    line = 1;
+    groups.clear();
+    entries.clear();
+    names.clear();
+    error.clear();
+
+    // 与luaL_loadfile一样跳过UTF-8 BOM和首行的#注释
+    if (size >= 3 && static_cast<uint8_t>(data[0]) == 0xEF && static_cast<uint8_t>(data[1]) == 0xBB &&
+        static_cast<uint8_t>(data[2]) == 0xBF) {
+        pos = 3;
+    }
+    if (pos < size && data[pos] == '#') {
+        while (pos < size && data[pos] != '\n') {
+            pos++;
+        }
+    }
+
+    bool found = false;
+    if (!Next()) {
+        return false;
+    }
+    while (token != Token::End) {
+        if (IsSymbol(';')) {
+            if (!Next()) return false;
+            continue;
+        }
+        bool isFgPos = token == Token::Name && text == "fgpos";
+        if (!ParseStatement()) {
+            return false;
+        }
+        found = found || isFgPos;
+    }
+    if (!found) {
+        return Fail("未找到fgpos表");
+    }
+    return true;
+}
+
+bool FgPosTable::Next() {
+    // 跳过空白和注释
+    while (pos < sourceSize) {
+        char c = source[pos];
+        if (c == '\n') {
+            line++;
+            pos++;
+        }
+        else if (c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v') {
+            pos++;
+        }
+        else if (c == '-' && pos + 1 < sourceSize && source[pos + 1] == '-') {
+            if (!SkipComment()) return false;
+        }
+        else {
+            break;
+        }
+    }
+
+    if (pos >= sourceSize) {
+        token = Token::End;
+        return true;
+    }
+
+    char c = source[pos];
+    if (IsNameStart(c)) {
+        size_t start = pos;
+        while (pos < sourceSize && IsNameChar(source[pos])) {
+            pos++;
+        }
+        text.assign(source + start, pos - start);
+        token = Token::Name;
+        return true;
+    }
+    if (IsDigit(c) || (c == '.' && pos + 1 < sourceSize && IsDigit(source[pos + 1]))) {
+        return ReadNumber();
+    }
+    if (c == '"' || c == '\'') {
+        pos++;
+        return ReadString(c);
+    }
+    if (c == '[' && pos + 1 < sourceSize && (source[pos + 1] == '[' || source[pos + 1] == '=')) {
+        size_t level = pos + 1;
+        while (level < sourceSize && source[level] == '=') {
+            level++;
+        }
+        if (level < sourceSize && source[level] == '[') {
+            token = Token::String;
+            return ReadLongBracket(true);
+        }
+    }
+
+    // 其余字符作为符号交给语法分析判断
+    token = Token::Symbol;
+    symbol = c;
+    pos++;
+    return true;
+}
+
+bool FgPosTable::SkipComment() {
+    pos += 2;
+    if (pos < sourceSize && source[pos] == '[') {
+        size_t level = pos + 1;
+        while (level < sourceSize && source[level] == '=') {
+            level++;
+        }
+        if (level < sourceSize && source[level] == '[') {
+            return ReadLongBracket(false);
+        }
+    }
+    while (pos < sourceSize && source[pos] != '\n') {
+        pos++;
+    }
+    return true;
+}
+
+bool FgPosTable::ReadLongBracket(bool keepText) {
+    // [==[ ... ]==]，结束标记中等号数量与开始相同
+    size_t equals = 0;
+    pos++;
+    while (source[pos] == '=') {
+        equals++;
+        pos++;
+    }
+    pos++;
+
+    // 紧跟开始标记的换行不属于内容
+    if (pos < sourceSize && source[pos] == '\r') pos++;
+    if (pos < sourceSize && source[pos] == '\n') {
+        line++;
+        pos++;
+    }
+
+    size_t start = pos;
+    while (pos < sourceSize) {
+        if (source[pos] == ']') {
+            size_t end = pos + 1;
+            size_t count = 0;
+            while (end < sourceSize && source[end] == '=') {
+                end++;
+                count++;
+            }
+            if (count == equals && end < sourceSize && source[end] == ']') {
+                if (keepText) {
+                    text.assign(source + start, pos - start);
+                }
+                pos = end + 1;
+                return true;
+            }
+        }
+        if (source[pos] == '\n') {
+            line++;
+        }
+        pos++;
+    }
+    return Fail("长字符串或长注释未结束");
+}
+
+bool FgPosTable::ReadString(char quote) {
+    text.clear();
+    while (pos < sourceSize) {
+        char c = source[pos++];
+        if (c == quote) {
+            token = Token::String;
+            return true;
+        }
+        if (c == '\n') {
+            return Fail("字符串未结束");
+        }
+        if (c != '\\') {
+            text += c;
+            continue;
+        }
+
+        if (pos >= sourceSize) {
+            break;
+        }
+        char e = source[pos++];
+        switch (e) {
+        case 'n': text += '\n'; break;
+        case 't': text += '\t'; break;
+        case 'r': text += '\r'; break;
+        case 'a': text += '\a'; break;
+        case 'b': text += '\b'; break;
+        case 'f': text += '\f'; break;
+        case 'v': text += '\v'; break;
+        case '\\': text += '\\'; break;
+        case '"': text += '"'; break;
+        case '\'': text += '\''; break;
+        case '\n': text += '\n'; line++; break;
+        case 'x': {
+            int high = pos < sourceSize ? HexValue(source[pos]) : -1;
+            int low = pos + 1 < sourceSize ? HexValue(source[pos + 1]) : -1;
+            if (high < 0 || low < 0) {
+                return Fail("无效的\\x转义");
+            }
+            text += static_cast<char>(high * 16 + low);
+            pos += 2;
+            break;
+        }
+        case 'z':
+            while (pos < sourceSize && (source[pos] == ' ' || source[pos] == '\t' || source[pos] == '\r' ||
+                source[pos] == '\n')) {
+                if (source[pos] == '\n') line++;
+                pos++;
+            }
+            break;
+        default:
+            if (IsDigit(e)) {
+                int value = e - '0';
+                for (int i = 0; i < 2 && pos < sourceSize && IsDigit(source[pos]); i++) {
+                    value = value * 10 + (source[pos++] - '0');
+                }
+                if (value > 255) {
+                    return Fail("转义字符超出范围");
+                }
+                text += static_cast<char>(value);
+                break;
+            }
+            // \u{...}等少见转义交给Lua处理
+            return Fail("不支持的转义字符");
+        }
+    }
+    return Fail("字符串未结束");
+}
+
+bool FgPosTable::ReadNumber() {
+    size_t start = pos;
+    token = Token::Number;
+
+    if (source[pos] == '0' && pos + 1 < sourceSize && (source[pos + 1] == 'x' || source[pos + 1] == 'X')) {
+        pos += 2;
+        uint64_t value = 0;
+        size_t digits = 0;
+        for (; pos < sourceSize && HexValue(source[pos]) >= 0; pos++, digits++) {
+            value = value * 16 + HexValue(source[pos]);
+        }
+        if (digits == 0 || digits > 16) {
+            return Fail("无效的十六进制数");
+        }
+        integer = static_cast<int64_t>(value);
+        number = static_cast<double>(integer);
+        numberIsInteger = true;
+    }
+    else {
+        bool isFloat = false;
+        while (pos < sourceSize && IsDigit(source[pos])) pos++;
+        if (pos < sourceSize && source[pos] == '.') {
+            isFloat = true;
+            pos++;
+            while (pos < sourceSize && IsDigit(source[pos])) pos++;
+        }
+        if (pos < sourceSize && (source[pos] == 'e' || source[pos] == 'E')) {
+            isFloat = true;
+            pos++;
+            if (pos < sourceSize && (source[pos] == '+' || source[pos] == '-')) pos++;
+            if (pos >= sourceSize || !IsDigit(source[pos])) {
+                return Fail("无效的数字");
+            }
+            while (pos < sourceSize && IsDigit(source[pos])) pos++;
+        }
+
+        std::string literal(source + start, pos - start);
+        number = std::strtod(literal.c_str(), nullptr);
+        // 超出64位的整数按浮点数处理，与Lua一致
+        numberIsInteger = !isFloat && literal.size() <= 18;
+        integer = numberIsInteger ? std::strtoll(literal.c_str(), nullptr, 10) : 0;
+    }
+
+    // 数字后紧跟字母说明是不认识的写法
+    if (pos < sourceSize && (IsNameChar(source[pos]) || source[pos] == '.')) {
+        return Fail("无效的数字");
+    }
+    return true;
+}
+
+bool FgPosTable::ParseStatement() {
+    if (token != Token::Name || IsKeyword(text)) {
+        return Fail("只支持全局变量的字面量赋值");
+    }
+    std::string name = text;
+    if (!Next()) return false;
+    if (!IsSymbol('=')) {
+        return Fail("只支持全局变量的字面量赋值");
+    }
+    if (!Next()) return false;
+
+    if (name != "fgpos") {
+        return ParseValue();
+    }
+    if (!IsSymbol('{')) {
+        return Fail("fgpos不是表");
+    }
+    // 重复赋值时以最后一次为准
+    groups.clear();
+    entries.clear();
+    names.clear();
+    return ParseFgPos();
+}
+
+bool FgPosTable::ParseValue() {
+    if (IsSymbol('{')) {
+        return SkipTable();
+    }
+    if (IsSymbol('-')) {
+        if (!Next()) return false;
+        if (token != Token::Number) {
+            return Fail("不是字面量");
+        }
+        return Next();
+    }
+    if (token == Token::Number || token == Token::String ||
+        (token == Token::Name && IsLiteralKeyword(text))) {
+        return Next();
+    }
+    return Fail("不是字面量");
+}
+
+bool FgPosTable::SkipTable() {
+    if (!Next()) return false;
+    int64_t positional = 0;
+    std::string key;
+    bool hasKey = false;
+    while (!IsSymbol('}')) {
+        if (!ParseKey(key, positional, hasKey) || !ParseValue()) {
+            return false;
+        }
+        if (IsSymbol(',') || IsSymbol(';')) {
+            if (!Next()) return false;
+        }
+        else if (!IsSymbol('}')) {
+            return Fail("表构造缺少分隔符");
+        }
+    }
+    return Next();
+}
+
+bool FgPosTable::ParseFgPos() {
+    if (!Next()) return false;
+    int64_t positional = 0;
+    std::string key;
+    bool hasKey = false;
+    std::unordered_map<std::string, size_t> groupIndex;
+
+    while (!IsSymbol('}')) {
+        if (!ParseKey(key, positional, hasKey)) {
+            return false;
+        }
+        if (IsSymbol('{')) {
+            Group group;
+            group.nameOffset = AddName(key);
+            group.nameLength = static_cast<uint32_t>(key.size());
+            group.firstEntry = static_cast<uint32_t>(entries.size());
+            group.entryCount = 0;
+            if (!ParseGroup(group.entryCount)) {
+                return false;
+            }
+            // 同名的组后者覆盖前者
+            auto [it, inserted] = groupIndex.emplace(key, groups.size());
+            if (inserted) {
+                groups.push_back(group);
+            }
+            else {
+                groups[it->second] = group;
+            }
+        }
+        else if (!ParseValue()) {
+            return false;
+        }
+
+        if (IsSymbol(',') || IsSymbol(';')) {
+            if (!Next()) return false;
+        }
+        else if (!IsSymbol('}')) {
+            return Fail("表构造缺少分隔符");
+        }
+    }
+    return Next();
+}
+
+bool FgPosTable::ParseGroup(uint32_t& count) {
+    if (!Next()) return false;
+    int64_t positional = 0;
+    std::string key;
+    bool hasKey = false;
+
+    while (!IsSymbol('}')) {
+        if (!ParseKey(key, positional, hasKey)) {
+            return false;
+        }
+        if (IsSymbol('{')) {
+            Entry entry;
+            entry.nameOffset = AddName(key);
+            entry.nameLength = static_cast<uint32_t>(key.size());
+            if (!ParseEntry(entry)) {
+                return false;
+            }
+            entries.push_back(entry);
+            count++;
+        }
+        else if (!ParseValue()) {
+            return false;
+        }
+
+        if (IsSymbol(',') || IsSymbol(';')) {
+            if (!Next()) return false;
+        }
+        else if (!IsSymbol('}')) {
+            return Fail("表构造缺少分隔符");
+        }
+    }
+    return Next();
+}
+
+bool FgPosTable::ParseEntry(Entry& entry) {
+    entry.x = 0;
+    entry.y = 0;
+    entry.hasX = false;
+    entry.hasY = false;
+
+    if (!Next()) return false;
+    int64_t positional = 0;
+    std::string key;
+    bool hasKey = false;
+
+    while (!IsSymbol('}')) {
+        if (!ParseKey(key, positional, hasKey)) {
+            return false;
+        }
+        const bool isX = hasKey && key == "x";
+        const bool isY = hasKey && key == "y";
+        if ((isX || isY) && token == Token::String) {
+            // 数字字符串在Lua中也算数值，交给Lua处理
+            return Fail("坐标为字符串");
+        }
+        if ((isX || isY) && (token == Token::Number || IsSymbol('-'))) {
+            int64_t value = 0;
+            if (!ParseInteger(value)) {
+                return false;
+            }
+            (isX ? entry.x : entry.y) = static_cast<int32_t>(value);
+            (isX ? entry.hasX : entry.hasY) = true;
+        }
+        else {
+            // 坐标被赋为非数值时视为缺少该坐标
+            if (isX) entry.hasX = false;
+            if (isY) entry.hasY = false;
+            if (!ParseValue()) {
+                return false;
+            }
+        }
+
+        if (IsSymbol(',') || IsSymbol(';')) {
+            if (!Next()) return false;
+        }
+        else if (!IsSymbol('}')) {
+            return Fail("表构造缺少分隔符");
+        }
+    }
+    return Next();
+}
+
+bool FgPosTable::ParseKey(std::string& key, int64_t& positional, bool& hasKey) {
+    if (IsSymbol('[')) {
+        // [表达式] = 值，只支持字符串和整数
+        if (!Next()) return false;
+        if (token == Token::String) {
+            key = text;
+            if (!Next()) return false;
+        }
+        else {
+            int64_t value = 0;
+            if (!ParseInteger(value)) {
+                return false;
+            }
+            key = std::to_string(value);
+        }
+        if (!IsSymbol(']')) {
+            return Fail("缺少]");
+        }
+        if (!Next()) return false;
+        if (!IsSymbol('=')) {
+            return Fail("缺少=");
+        }
+        hasKey = true;
+        return Next();
+    }
+
+    if (token == Token::Name && !IsKeyword(text)) {
+        // 名称后是=时为键，否则是以变量为值的无键字段，不属于字面量
+        std::string name = text;
+        if (!Next()) return false;
+        if (!IsSymbol('=')) {
+            return Fail("不是字面量");
+        }
+        key = std::move(name);
+        hasKey = true;
+        return Next();
+    }
+
+    // 无键字段使用从1开始的序号作为键
+    key = std::to_string(++positional);
+    hasKey = false;
+    return true;
+}
+
+bool FgPosTable::ParseInteger(int64_t& value) {
+    bool negative = false;
+    if (IsSymbol('-')) {
+        negative = true;
+        if (!Next()) return false;
+    }
+    if (token != Token::Number) {
+        return Fail("不是数值");
+    }
+    if (numberIsInteger) {
+        value = integer;
+    }
+    else if (std::floor(number) == number && std::fabs(number) < 9.0e18) {
+        value = static_cast<int64_t>(number);
+    }
+    else {
+        // 非整数坐标的取整方式随Lua版本不同，交给Lua处理
+        return Fail("坐标不是整数");
+    }
+    if (negative) {
+        value = -value;
+    }
+    return Next();
+}
+
+bool FgPosTable::Fail(const std::string& message) {
+    error = "第" + std::to_string(line) + "行: " + message;
+    return false;
+}
+
+uint32_t FgPosTable::AddName(const std::string& name) {
+    uint32_t offset = static_cast<uint32_t>(names.size());
+    names += name;
+    return offset;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// fgpos坐标表的字面量解析器
+// 只接受由常量和表构造器组成的赋值语句，如 fgpos = { group = { file = {x = 1, y = 2} } }，
+// 一遍扫描源码直接得到扁平的组和坐标数组，不经过Lua虚拟机；含有函数调用、运算等
+// 其他语法时解析失败，由调用方改用Lua执行脚本
+class FgPosTable {
+public:
+    // 组：entries中从firstEntry开始的entryCount项
+    struct Group {
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        uint32_t firstEntry;
+        uint32_t entryCount;
+    };
+
+    // 文件坐标，缺少x或y时对应标志为false
+    struct Entry {
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        int32_t x;
+        int32_t y;
+        bool hasX;
+        bool hasY;
+    };
+
+    /**
+     * @brief 解析脚本源码
+     * @param data 源码
+     * @param size 源码长度
+     * @return 脚本只含字面量赋值且定义了fgpos表时返回true
+     * @note 多次给fgpos赋值时以最后一次为准，与执行脚本的结果一致
+     */
+    bool Parse(const char* data, size_t size);
+
+    /**
+     * @brief 解析失败的原因和位置
+     */
+    const std::string& Error() const { return error; }
+
+    const std::vector<Group>& Groups() const { return groups; }
+    const std::vector<Entry>& Entries() const { return entries; }
+
+    std::string_view Name(uint32_t offset, uint32_t length) const {
+        return std::string_view(names).substr(offset, length);
+    }
+
+private:
+    enum class Token {
+        End,
+        Name,
+        String,
+        Number,
+        Symbol,
+    };
+
+    // 词法分析
+    bool Next();
+    bool SkipComment();
+    bool ReadLongBracket(bool keepText);
+    bool ReadString(char quote);
+    bool ReadNumber();
+
+    // 语法分析，Skip系列只检查语法不保存结果
+    bool ParseStatement();
+    bool ParseValue();
+    bool SkipTable();
+    bool ParseFgPos();
+    bool ParseGroup(uint32_t& count);
+    bool ParseEntry(Entry& entry);
+
+    /**
+     * @brief 读取表字段的键
+     * @param key 输出的键，数字键转换为十进制文本，与lua_tostring一致
+     * @param positional 无键字段的序号，遇到无键字段时递增
+     * @param hasKey 输出是否为显式键；为false时当前记号为字段值的开始
+     * @return 语法错误返回false
+     */
+    bool ParseKey(std::string& key, int64_t& positional, bool& hasKey);
+
+    /**
+     * @brief 读取数值常量，允许前置负号
+     * @param value 输出的整数值
+     * @return 不是数值或不是整数时返回false
+     */
+    bool ParseInteger(int64_t& value);
+
+    bool Fail(const std::string& message);
+    bool IsSymbol(char c) const { return token == Token::Symbol && symbol == c; }
+
+    uint32_t AddName(const std::string& name);
+
+    const char* source = nullptr;
+    size_t sourceSize = 0;
+    size_t pos = 0;
+    int line = 1;
+
+    Token token = Token::End;
+    char symbol = 0;
+    std::string text;           // 名称或字符串的内容
+    double number = 0;
+    bool numberIsInteger = false;
+    int64_t integer = 0;
+
+    std::vector<Group> groups;
+    std::vector<Entry> entries;
+    std::string names;          // 所有组名和文件名依次存放
+    std::string error;
+};
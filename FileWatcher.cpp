@@ -0,0 +1,212 @@
+#include "FileWatcher.h"
+#include "Config.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#if defined(__linux__)
+#define FILE_WATCHER_INOTIFY
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// 定时扫描的间隔
+constexpr int SCAN_INTERVAL_MS = 200;
+
+// 收到变化后等待后续事件的间隔，超过此时间没有新事件视为保存完成
+constexpr int SETTLE_MS = 50;
+
+// 合并事件的最长时间，持续写入时也要及时返回
+constexpr int MAX_SETTLE_MS = 500;
+
+FileWatcher::~FileWatcher() {
+#ifdef FILE_WATCHER_INOTIFY
+    if (notifyHandle >= 0) {
+        close(notifyHandle);
+    }
+#endif
+}
+
+bool FileWatcher::AddDirectory(const std::string& directory) {
+    std::error_code ec;
+    if (!fs::is_directory(directory, ec)) {
+        Logger::Error("监视的目录不存在: " + directory);
+        return false;
+    }
+    for (const Directory& existing : directories) {
+        if (fs::equivalent(existing.path, directory, ec)) {
+            return true;
+        }
+    }
+
+    Directory entry;
+    entry.path = directory;
+#ifdef FILE_WATCHER_INOTIFY
+    if (notifyHandle < 0 && !notifyFailed) {
+        notifyHandle = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        notifyFailed = notifyHandle < 0;
+    }
+    if (notifyHandle >= 0) {
+        entry.watch = inotify_add_watch(notifyHandle, directory.c_str(),
+            IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE);
+        if (entry.watch < 0) {
+            // 已添加的目录也改为定时扫描
+            Logger::Warning("inotify监视失败，改为定时扫描: " + directory);
+            close(notifyHandle);
+            notifyHandle = -1;
+            notifyFailed = true;
+        }
+    }
+#endif
+    directories.push_back(std::move(entry));
+
+    // 定时扫描需要初始状态作为比较基准
+    if (notifyHandle < 0) {
+        for (Directory& watched : directories) {
+            if (watched.files.empty()) {
+                watched.files = ListFiles(watched.path);
+            }
+        }
+    }
+    return true;
+}
+
+bool FileWatcher::Wait(int timeoutMs, std::vector<std::string>& changed) {
+    changed.clear();
+    auto found = [&](int waitMs) {
+        return notifyHandle >= 0 ? ReadEvents(waitMs, changed) : Scan(changed);
+    };
+
+    if (notifyHandle >= 0) {
+        if (!found(timeoutMs)) {
+            return false;
+        }
+    }
+    else {
+        // 定时扫描：每个间隔比较一次，直到超时
+        bool any = false;
+        for (int waited = 0; !any && waited < timeoutMs; waited += SCAN_INTERVAL_MS) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(std::min(SCAN_INTERVAL_MS, timeoutMs - waited)));
+            any = found(0);
+        }
+        if (!any) {
+            return false;
+        }
+    }
+
+    // 合并同一次保存的后续事件
+    const int settleMs = notifyHandle >= 0 ? SETTLE_MS : SCAN_INTERVAL_MS;
+    for (int settled = 0; settled < MAX_SETTLE_MS; settled += settleMs) {
+        if (notifyHandle < 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(settleMs));
+        }
+        if (!found(settleMs)) {
+            break;
+        }
+    }
+
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    return !changed.empty();
+}
+
+bool FileWatcher::ReadEvents(int timeoutMs, std::vector<std::string>& changed) {
+#ifdef FILE_WATCHER_INOTIFY
+    pollfd descriptor{ notifyHandle, POLLIN, 0 };
+    if (poll(&descriptor, 1, timeoutMs) <= 0) {
+        return false;
+    }
+
+    alignas(inotify_event) char buffer[16 * 1024];
+    bool any = false;
+    for (;;) {
+        ssize_t length = read(notifyHandle, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+        for (ssize_t offset = 0; offset < length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            // 事件队列溢出时无法知道哪些文件变了，视为全部变化
+            if (event->mask & IN_Q_OVERFLOW) {
+                Logger::Warning("文件变化事件过多，重新检查所有文件");
+                for (const Directory& directory : directories) {
+                    for (const auto& [name, stamp] : ListFiles(directory.path)) {
+                        changed.push_back((fs::path(directory.path) / name).string());
+                    }
+                }
+                any = true;
+                continue;
+            }
+            if (event->len == 0 || (event->mask & IN_ISDIR)) {
+                continue;
+            }
+            for (const Directory& directory : directories) {
+                if (directory.watch == event->wd) {
+                    changed.push_back((fs::path(directory.path) / event->name).string());
+                    any = true;
+                    break;
+                }
+            }
+        }
+    }
+    return any;
+#else
+    (void)timeoutMs;
+    (void)changed;
+    return false;
+#endif
+}
+
+bool FileWatcher::Scan(std::vector<std::string>& changed) {
+    bool any = false;
+    for (Directory& directory : directories) {
+        std::map<std::string, Stamp> files = ListFiles(directory.path);
+
+        // 两个有序表同时遍历，找出新建、修改和删除的文件
+        auto oldIt = directory.files.begin();
+        auto newIt = files.begin();
+        while (oldIt != directory.files.end() || newIt != files.end()) {
+            std::string name;
+            if (newIt == files.end() || (oldIt != directory.files.end() && oldIt->first < newIt->first)) {
+                name = (oldIt++)->first;
+            }
+            else if (oldIt == directory.files.end() || newIt->first < oldIt->first) {
+                name = (newIt++)->first;
+            }
+            else {
+                const bool modified = oldIt->second != newIt->second;
+                name = newIt->first;
+                ++oldIt;
+                ++newIt;
+                if (!modified) {
+                    continue;
+                }
+            }
+            changed.push_back((fs::path(directory.path) / name).string());
+            any = true;
+        }
+        directory.files = std::move(files);
+    }
+    return any;
+}
+
+std::map<std::string, FileWatcher::Stamp> FileWatcher::ListFiles(const std::string& directory) {
+    std::map<std::string, Stamp> files;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(directory, ec)) {
+        std::error_code entryError;
+        if (!entry.is_regular_file(entryError)) {
+            continue;
+        }
+        Stamp stamp{ entry.last_write_time(entryError), entry.file_size(entryError) };
+        if (!entryError) {
+            files.emplace(entry.path().filename().string(), stamp);
+        }
+    }
+    return files;
+}
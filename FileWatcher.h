@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+// 监视目录中的文件变化
+// Linux上使用inotify，只在文件写完关闭、移入、移出或删除时通知，不会读到写了一半的文件；
+// 其他平台或inotify不可用时定时比较文件的修改时间和大小。
+// 编辑器保存时常先写临时文件再改名，因此监视所在目录，由调用方按文件名筛选
+class FileWatcher {
+public:
+    FileWatcher() = default;
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    /**
+     * @brief 添加要监视的目录，不包括子目录
+     * @param directory 目录路径，已添加过的目录被忽略
+     * @return 成功返回true
+     */
+    bool AddDirectory(const std::string& directory);
+
+    /**
+     * @brief 等待文件变化
+     * @param timeoutMs 没有变化时最长等待的毫秒数
+     * @param changed 输出新建、修改或删除的文件路径，已去重
+     * @return 有变化返回true
+     * @note 收到变化后继续等待到没有新事件为止，一次保存产生的多个事件合并返回
+     */
+    bool Wait(int timeoutMs, std::vector<std::string>& changed);
+
+    /**
+     * @brief 是否使用系统通知，false表示定时扫描
+     */
+    bool UsesNotification() const { return notifyHandle >= 0; }
+
+private:
+    // 定时扫描时记录的文件状态
+    struct Stamp {
+        std::filesystem::file_time_type time;
+        uintmax_t size;
+
+        bool operator!=(const Stamp& other) const { return time != other.time || size != other.size; }
+    };
+
+    struct Directory {
+        std::string path;
+        int watch = -1;                             // inotify监视描述符
+        std::map<std::string, Stamp> files;         // 文件名->状态，只在定时扫描时使用
+    };
+
+    /**
+     * @brief 读取inotify事件
+     * @param timeoutMs 最长等待的毫秒数
+     * @param changed 追加发生变化的文件路径
+     * @return 读到事件返回true
+     */
+    bool ReadEvents(int timeoutMs, std::vector<std::string>& changed);
+
+    /**
+     * @brief 扫描所有目录并与上次的状态比较
+     * @param changed 追加发生变化的文件路径
+     * @return 有变化返回true
+     */
+    bool Scan(std::vector<std::string>& changed);
+
+    /**
+     * @brief 读取目录中所有文件的状态
+     */
+    static std::map<std::string, Stamp> ListFiles(const std::string& directory);
+
+    int notifyHandle = -1;                          // inotify实例，-1表示定时扫描
+    bool notifyFailed = false;                      // inotify不可用，不再尝试
+    std::vector<Directory> directories;
+};
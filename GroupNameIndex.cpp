@@ -0,0 +1,53 @@
+#include "GroupNameIndex.h"
+#include <algorithm>
+
+void GroupNameIndex::Clear() {
+    names.clear();
+    nameOffsets.assign(1, 0);
+    suffixes.clear();
+}
+
+uint32_t GroupNameIndex::Add(std::string_view name) {
+    names += name;
+    nameOffsets.push_back(static_cast<uint32_t>(names.size()));
+    return Size() - 1;
+}
+
+void GroupNameIndex::Build() {
+    suffixes.clear();
+    suffixes.reserve(names.size());
+    for (uint32_t i = 0; i < Size(); i++) {
+        const uint32_t length = nameOffsets[i + 1] - nameOffsets[i];
+        for (uint32_t offset = 0; offset < length; offset++) {
+            suffixes.push_back({ i, offset });
+        }
+    }
+    std::sort(suffixes.begin(), suffixes.end(), [this](const Suffix& a, const Suffix& b) {
+        return SuffixText(a) < SuffixText(b);
+    });
+}
+
+std::vector<uint32_t> GroupNameIndex::FindSubstring(std::string_view field) const {
+    std::vector<uint32_t> result;
+    if (field.empty()) {
+        result.reserve(Size());
+        for (uint32_t i = 0; i < Size(); i++) {
+            result.push_back(i);
+        }
+        return result;
+    }
+
+    // 只比较后缀的前field.size()个字符，以field开头的后缀在排序后连续
+    auto first = std::lower_bound(suffixes.begin(), suffixes.end(), field,
+        [this](const Suffix& suffix, std::string_view key) { return SuffixText(suffix).substr(0, key.size()) < key; });
+    auto last = std::upper_bound(first, suffixes.end(), field,
+        [this](std::string_view key, const Suffix& suffix) { return key < SuffixText(suffix).substr(0, key.size()); });
+    for (auto it = first; it != last; ++it) {
+        result.push_back(it->name);
+    }
+
+    // 同一组名可能有多个后缀匹配
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
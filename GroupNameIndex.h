@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 组名的前缀与子串索引
+// 所有组名的全部后缀按字典序排列，子串查询即对后缀的前缀查询，两次二分得到匹配范围，
+// 多个字段可以共用同一个索引而不必逐个扫描所有组名
+class GroupNameIndex {
+public:
+    void Clear();
+
+    /**
+     * @brief 添加组名，下标按添加顺序从0开始
+     * @param name 组名
+     * @return 组下标
+     */
+    uint32_t Add(std::string_view name);
+
+    /**
+     * @brief 添加完所有组名后排列后缀
+     */
+    void Build();
+
+    /**
+     * @brief 查找包含指定字段的组
+     * @param field 字段，空字段匹配所有组
+     * @return 升序排列的组下标，不重复
+     */
+    std::vector<uint32_t> FindSubstring(std::string_view field) const;
+
+    uint32_t Size() const { return static_cast<uint32_t>(nameOffsets.size()) - 1; }
+
+    std::string_view NameAt(uint32_t index) const {
+        return std::string_view(names).substr(nameOffsets[index], nameOffsets[index + 1] - nameOffsets[index]);
+    }
+
+private:
+    struct Suffix {
+        uint32_t name;
+        uint32_t offset;            // 在组名中的起始位置
+    };
+
+    std::string_view SuffixText(const Suffix& suffix) const {
+        return NameAt(suffix.name).substr(suffix.offset);
+    }
+
+    std::string names;                              // 所有组名依次存放
+    std::vector<uint32_t> nameOffsets = { 0 };      // 第i个组名为[nameOffsets[i], nameOffsets[i + 1])
+    std::vector<Suffix> suffixes;
+};
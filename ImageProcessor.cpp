@@ -1,419 +1,251 @@
 #include "ImageProcessor.h"
+#include "PixelKernels.h"
+#include "PngEncoder.h"
+#include "PngDecoder.h"
+#include "QoiCodec.h"
+#include "MappedFile.h"
+#include "Compat.h"
 #include <png.h>
+#include <zlib.h>
 #include <fstream>
 #include <csetjmp>
 #include <cstring>
 #include <algorithm>
+#include <chrono>
+#include <filesystem>
 
-// PNGļǩ
+// PNG文件签名
 constexpr size_t PNG_SIGNATURE_SIZE = 8;
 
-bool ImageProcessor::LoadPng(const std::string& filePath, ImageData& imageData) {
-    // ļ
-    FILE* file;
-    errno_t err= fopen_s(&file, filePath.c_str(), "rb");
-    if (!file || err != 0) {
-        Logger::Error("޷PNGļ: " + filePath);
-        return false;
-    }
+// 块头长度 (长度+类型) 和CRC长度
+constexpr size_t PNG_CHUNK_HEADER_SIZE = 8;
+constexpr size_t PNG_CHUNK_CRC_SIZE = 4;
 
-    // PNGǩ
-    png_byte signature[PNG_SIGNATURE_SIZE];
-    if (fread(signature, 1, PNG_SIGNATURE_SIZE, file) != PNG_SIGNATURE_SIZE ||
-        png_sig_cmp(signature, 0, PNG_SIGNATURE_SIZE) != 0) {
-        fclose(file);
-        Logger::Error("ļЧPNGʽ: " + filePath);
-        return false;
-    }
+static inline uint32_t ReadBigEndian32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+        (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
 
-    // ʼlibpngṹ
-    png_structp pngPtr = nullptr;
-    png_infop infoPtr = nullptr;
+PngEncodeOptions ImageProcessor::pngEncodeOptions;
+PngDecodeOptions ImageProcessor::pngDecodeOptions;
 
-    if (!InitPngRead(pngPtr, infoPtr)) {
-        fclose(file);
+bool ImageProcessor::LoadPng(const std::string& filePath, ImageData& imageData) {
+    // 映射文件后直接解码，不复制文件内容
+    MappedFile file;
+    if (!file.Open(filePath)) {
+        Logger::Error("无法打开文件: " + filePath);
         return false;
     }
 
-    // ô
-    if (setjmp(png_jmpbuf(pngPtr))) {
-        CleanupPngRead(pngPtr, infoPtr);
-        fclose(file);
+    if (!DecodePng(file.data(), file.size(), imageData, false, filePath)) {
         return false;
     }
 
-    // ļ
-    png_init_io(pngPtr, file);
-    png_set_sig_bytes(pngPtr, PNG_SIGNATURE_SIZE);
-
-    // ȡPNGϢ
-    png_read_info(pngPtr, infoPtr);
-
-    // ȡͼϢ
-    png_uint_32 width = png_get_image_width(pngPtr, infoPtr);
-    png_uint_32 height = png_get_image_height(pngPtr, infoPtr);
-    png_byte colorType = png_get_color_type(pngPtr, infoPtr);
-    png_byte bitDepth = png_get_bit_depth(pngPtr, infoPtr);
+    Logger::Debug("成功加载PNG图像: " + filePath +
+        " (" + std::to_string(imageData.width) + "x" +
+        std::to_string(imageData.height) + ")");
 
-    // תΪ8λ
-    if (bitDepth == 16) {
-        png_set_strip_16(pngPtr);
-    }
+    return true;
+}
 
-    // ɫͼ
-    if (colorType == PNG_COLOR_TYPE_PALETTE) {
-        png_set_palette_to_rgb(pngPtr);
+bool ImageProcessor::LoadPngWithPos(const std::string& filePath, ImageData& imageData) {
+    // 映射文件后直接解码，不复制文件内容
+    MappedFile file;
+    if (!file.Open(filePath)) {
+        Logger::Error("无法打开文件: " + filePath);
+        return false;
     }
 
-    // Ҷͼ
-    if (colorType == PNG_COLOR_TYPE_GRAY && bitDepth < 8) {
-        png_set_expand_gray_1_2_4_to_8(pngPtr);
+    if (!DecodePng(file.data(), file.size(), imageData, true, filePath)) {
+        return false;
     }
 
-    // ͸ͨ
-    if (png_get_valid(pngPtr, infoPtr, PNG_INFO_tRNS)) {
-        png_set_tRNS_to_alpha(pngPtr);
-    }
+    Logger::Debug("成功加载PNG图像: " + filePath +
+        " (" + std::to_string(imageData.width) + "x" +
+        std::to_string(imageData.height) + ")");
 
-    // ʽΪRGBA
-    if (colorType == PNG_COLOR_TYPE_RGB ||
-        colorType == PNG_COLOR_TYPE_GRAY ||
-        colorType == PNG_COLOR_TYPE_PALETTE) {
-        png_set_add_alpha(pngPtr, 0xFF, PNG_FILLER_AFTER);
-    }
+    return true;
+}
 
-    if (colorType == PNG_COLOR_TYPE_GRAY ||
-        colorType == PNG_COLOR_TYPE_GRAY_ALPHA) {
-        png_set_gray_to_rgb(pngPtr);
+bool ImageProcessor::LoadPngFromMemory(const uint8_t* pngData, size_t dataSize, ImageData& imageData, bool readPos) {
+    if (!pngData || dataSize < PNG_SIGNATURE_SIZE) {
+        Logger::Error("无效的PNG数据");
+        return false;
     }
 
-    // Ϣ
-    png_read_update_info(pngPtr, infoPtr);
-
-    // ȡºϢ
-    width = png_get_image_width(pngPtr, infoPtr);
-    height = png_get_image_height(pngPtr, infoPtr);
-    colorType = png_get_color_type(pngPtr, infoPtr);
-
-    // ȷͨ
-    int channels = 4; // ĬRGBA
-
-    // ͼ
-    imageData.width = static_cast<int>(width);
-    imageData.height = static_cast<int>(height);
-    imageData.channels = channels;
-    imageData.data.resize(width * height * channels);
-
-    // ָ
-    png_bytep* rowPointers = new png_bytep[height];
-    for (png_uint_32 y = 0; y < height; y++) {
-        rowPointers[y] = &imageData.data[y * width * channels];
+    if (!DecodePng(pngData, dataSize, imageData, readPos, "内存数据")) {
+        return false;
     }
 
-    // ȡͼ
-    png_read_image(pngPtr, rowPointers);
-
-    // ȡ
-    png_read_end(pngPtr, nullptr);
-
-    // 
-    delete[] rowPointers;
-    CleanupPngRead(pngPtr, infoPtr);
-    fclose(file);
-
-    Logger::Debug("ɹPNGͼ: " + filePath +
-        " (" + std::to_string(width) + "x" +
-        std::to_string(height) + ")");
+    Logger::Debug("成功从内存加载PNG图像 (" +
+        std::to_string(imageData.width) + "x" +
+        std::to_string(imageData.height) + ")");
 
     return true;
 }
 
-bool ImageProcessor::LoadPngWithPos(const std::string& filePath, ImageData& imageData) {
-    // ļ
-    FILE* file;
-    errno_t err = fopen_s(&file, filePath.c_str(), "rb");
-    if (!file || err != 0) {
-        Logger::Error("޷PNGļ: " + filePath);
-        return false;
-    }
-
-    // PNGǩ
-    png_byte signature[PNG_SIGNATURE_SIZE];
-    if (fread(signature, 1, PNG_SIGNATURE_SIZE, file) != PNG_SIGNATURE_SIZE ||
-        png_sig_cmp(signature, 0, PNG_SIGNATURE_SIZE) != 0) {
-        fclose(file);
-        Logger::Error("ļЧPNGʽ: " + filePath);
+bool ImageProcessor::ProbePng(const std::string& filePath, PngInfo& info) {
+    // 映射后只访问文件头所在的页面
+    MappedFile file;
+    if (!file.Open(filePath, false)) {
+        Logger::Error("无法打开文件: " + filePath);
         return false;
     }
 
-    // ʼlibpngṹ
-    png_structp pngPtr = nullptr;
-    png_infop infoPtr = nullptr;
-
-    if (!InitPngRead(pngPtr, infoPtr)) {
-        fclose(file);
+    if (!ProbePngFromMemory(file.data(), file.size(), info)) {
+        Logger::Error("无法读取PNG文件头: " + filePath);
         return false;
     }
+    return true;
+}
 
-    // ô
-    if (setjmp(png_jmpbuf(pngPtr))) {
-        CleanupPngRead(pngPtr, infoPtr);
-        fclose(file);
+bool ImageProcessor::ProbePngFromMemory(const uint8_t* pngData, size_t dataSize, PngInfo& info) {
+    info = PngInfo();
+    if (!pngData || dataSize < PNG_SIGNATURE_SIZE || png_sig_cmp(pngData, 0, PNG_SIGNATURE_SIZE) != 0) {
         return false;
     }
 
-    // ļ
-    png_init_io(pngPtr, file);
-    png_set_sig_bytes(pngPtr, PNG_SIGNATURE_SIZE);
-
-    // ȡPNGϢ
-    png_read_info(pngPtr, infoPtr);
+    // 首个块必须是IHDR
+    size_t offset = PNG_SIGNATURE_SIZE;
+    bool hasHeader = false;
+    while (offset + PNG_CHUNK_HEADER_SIZE <= dataSize) {
+        const uint32_t length = ReadBigEndian32(pngData + offset);
+        const uint8_t* type = pngData + offset + 4;
+        const uint8_t* chunk = pngData + offset + PNG_CHUNK_HEADER_SIZE;
+        if (length > dataSize - offset - PNG_CHUNK_HEADER_SIZE) {
+            break;
+        }
 
-    // ȡtEXt:tEXtcomment?pos,209,511,232,192
-    png_textp text_ptr = nullptr;
-    int num_text = 0;
-    int x = 0, y = 0;
-
-    png_get_text(pngPtr, infoPtr, &text_ptr, &num_text);
-    if (num_text > 0) {
-        for (int i = 0; i < num_text; i++) {
-            if (strcmp(text_ptr[i].key, "comment") == 0) {
-                if (sscanf_s(text_ptr[i].text, "pos,%d,%d", &x, &y) == 2) {
-                    break;
+        if (!hasHeader) {
+            if (memcmp(type, "IHDR", 4) != 0 || length != 13) {
+                return false;
+            }
+            uint32_t width = ReadBigEndian32(chunk);
+            uint32_t height = ReadBigEndian32(chunk + 4);
+            if (width == 0 || height == 0 || width > PNG_UINT_31_MAX || height > PNG_UINT_31_MAX) {
+                return false;
+            }
+            info.width = static_cast<int>(width);
+            info.height = static_cast<int>(height);
+            hasHeader = true;
+        }
+        else if (memcmp(type, "IDAT", 4) == 0 || memcmp(type, "IEND", 4) == 0) {
+            break;
+        }
+        else if (!info.hasPos && memcmp(type, "tEXt", 4) == 0) {
+            // tEXt块:tEXtcomment?pos,209,511,232,192
+            const char* text = reinterpret_cast<const char*>(chunk);
+            const size_t keyLength = strnlen(text, length);
+            if (keyLength < length && strcmp(text, "comment") == 0) {
+                std::string value(text + keyLength + 1, length - keyLength - 1);
+                info.hasPos = ParsePosComment(value, info.posX, info.posY);
+                if (!info.hasPos) {
+                    info.posX = 0;
+                    info.posY = 0;
                 }
             }
         }
-    }
-    Logger::Info("tEXtеλϢ: " + std::to_string(x) + "," + std::to_string(y));
-
-
-    // ȡͼϢ
-    png_uint_32 width = png_get_image_width(pngPtr, infoPtr);
-    png_uint_32 height = png_get_image_height(pngPtr, infoPtr);
-    png_byte colorType = png_get_color_type(pngPtr, infoPtr);
-    png_byte bitDepth = png_get_bit_depth(pngPtr, infoPtr);
-
-    // תΪ8λ
-    if (bitDepth == 16) {
-        png_set_strip_16(pngPtr);
-    }
-
-    // ɫͼ
-    if (colorType == PNG_COLOR_TYPE_PALETTE) {
-        png_set_palette_to_rgb(pngPtr);
-    }
-
-    // Ҷͼ
-    if (colorType == PNG_COLOR_TYPE_GRAY && bitDepth < 8) {
-        png_set_expand_gray_1_2_4_to_8(pngPtr);
-    }
-
-    // ͸ͨ
-    if (png_get_valid(pngPtr, infoPtr, PNG_INFO_tRNS)) {
-        png_set_tRNS_to_alpha(pngPtr);
-    }
-
-    // ʽΪRGBA
-    if (colorType == PNG_COLOR_TYPE_RGB ||
-        colorType == PNG_COLOR_TYPE_GRAY ||
-        colorType == PNG_COLOR_TYPE_PALETTE) {
-        png_set_add_alpha(pngPtr, 0xFF, PNG_FILLER_AFTER);
-    }
-
-    if (colorType == PNG_COLOR_TYPE_GRAY ||
-        colorType == PNG_COLOR_TYPE_GRAY_ALPHA) {
-        png_set_gray_to_rgb(pngPtr);
-    }
-
-    // Ϣ
-    png_read_update_info(pngPtr, infoPtr);
 
-    // ȡºϢ
-    width = png_get_image_width(pngPtr, infoPtr);
-    height = png_get_image_height(pngPtr, infoPtr);
-    colorType = png_get_color_type(pngPtr, infoPtr);
-
-    // ȷͨ
-    int channels = 4; // ĬRGBA
-
-    // ͼ
-    imageData.posX = x;
-    imageData.posY = y;
-    imageData.width = static_cast<int>(width);
-    imageData.height = static_cast<int>(height);
-    imageData.channels = channels;
-    imageData.data.resize(width * height * channels);
-
-    // ָ
-    png_bytep* rowPointers = new png_bytep[height];
-    for (png_uint_32 y = 0; y < height; y++) {
-        rowPointers[y] = &imageData.data[y * width * channels];
+        offset += PNG_CHUNK_HEADER_SIZE + length + PNG_CHUNK_CRC_SIZE;
     }
 
-    // ȡͼ
-    png_read_image(pngPtr, rowPointers);
-
-    // ȡ
-    png_read_end(pngPtr, nullptr);
-
-    // 
-    delete[] rowPointers;
-    CleanupPngRead(pngPtr, infoPtr);
-    fclose(file);
-
-    Logger::Debug("ɹPNGͼ: " + filePath +
-        " (" + std::to_string(width) + "x" +
-        std::to_string(height) + ")");
-
-    return true;
+    return hasHeader;
 }
 
-bool ImageProcessor::LoadPngFromMemory(const uint8_t* pngData, size_t dataSize, ImageData& imageData) {
-    if (!pngData || dataSize < PNG_SIGNATURE_SIZE) {
-        Logger::Error("ЧPNG");
+bool ImageProcessor::SavePng(const std::string& filePath, const ImageData& imageData) {
+    if (!IsValid(imageData)) {
+        Logger::Error("无效的图像数据");
         return false;
     }
 
-    // PNGǩ
-    if (png_sig_cmp(pngData, 0, PNG_SIGNATURE_SIZE) != 0) {
-        Logger::Error("ڴݲЧPNGʽ");
+    // 非libpng编码器先编码到内存再写出
+    if (pngEncodeOptions.encoder != PngEncoderType::Libpng) {
+        std::vector<uint8_t> pngData;
+        if (!PngEncoder::Encode(imageData, pngData, pngEncodeOptions, false)) {
+            return false;
+        }
+        return WriteFileData(filePath, pngData);
+    }
+
+    // 打开文件
+    FILE* file = Compat::OpenFile(filePath.c_str(), "wb");
+    if (!file) {
+        Logger::Error("无法创建PNG文件: " + filePath);
         return false;
     }
 
-    // ʼlibpngṹ
+    // 初始化libpng结构
     png_structp pngPtr = nullptr;
     png_infop infoPtr = nullptr;
 
-    if (!InitPngRead(pngPtr, infoPtr)) {
+    if (!InitPngWrite(pngPtr, infoPtr)) {
+        fclose(file);
         return false;
     }
 
-    // ô
+    // 设置错误处理
     if (setjmp(png_jmpbuf(pngPtr))) {
-        CleanupPngRead(pngPtr, infoPtr);
+        CleanupPngWrite(pngPtr, infoPtr);
+        fclose(file);
         return false;
     }
 
-    // ڴȡṹ
-    struct PngMemoryReader {
-        const uint8_t* data;
-        size_t size;
-        size_t offset;
-    };
-
-    PngMemoryReader reader;
-    reader.data = pngData;
-    reader.size = dataSize;
-    reader.offset = PNG_SIGNATURE_SIZE; // ǩ
-
-    // öȡ
-    png_set_read_fn(pngPtr, &reader, [](png_structp pngPtr, png_bytep data, png_size_t length) {
-        PngMemoryReader* reader = static_cast<PngMemoryReader*>(png_get_io_ptr(pngPtr));
-
-        if (reader->offset + length > reader->size) {
-            png_error(pngPtr, "ȡڴ淶Χ");
-            return;
-        }
-
-        memcpy(data, reader->data + reader->offset, length);
-        reader->offset += length;
-        });
-
-    // ǩֽ
-    png_set_sig_bytes(pngPtr, PNG_SIGNATURE_SIZE);
-
-    // ȡPNGϢ
-    png_read_info(pngPtr, infoPtr);
-
-    // ȡͼϢ
-    png_uint_32 width = png_get_image_width(pngPtr, infoPtr);
-    png_uint_32 height = png_get_image_height(pngPtr, infoPtr);
-    png_byte colorType = png_get_color_type(pngPtr, infoPtr);
-    png_byte bitDepth = png_get_bit_depth(pngPtr, infoPtr);
-
-    // תΪ8λ
-    if (bitDepth == 16) {
-        png_set_strip_16(pngPtr);
-    }
-
-    // ɫͼ
-    if (colorType == PNG_COLOR_TYPE_PALETTE) {
-        png_set_palette_to_rgb(pngPtr);
-    }
-
-    // Ҷͼ
-    if (colorType == PNG_COLOR_TYPE_GRAY && bitDepth < 8) {
-        png_set_expand_gray_1_2_4_to_8(pngPtr);
-    }
-
-    // ͸ͨ
-    if (png_get_valid(pngPtr, infoPtr, PNG_INFO_tRNS)) {
-        png_set_tRNS_to_alpha(pngPtr);
-    }
-
-    // ʽΪRGBA
-    if (colorType == PNG_COLOR_TYPE_RGB ||
-        colorType == PNG_COLOR_TYPE_GRAY ||
-        colorType == PNG_COLOR_TYPE_PALETTE) {
-        png_set_add_alpha(pngPtr, 0xFF, PNG_FILLER_AFTER);
-    }
+    // 设置文件输出
+    png_init_io(pngPtr, file);
+    ApplyPngEncodeOptions(pngPtr, pngEncodeOptions);
 
-    if (colorType == PNG_COLOR_TYPE_GRAY ||
-        colorType == PNG_COLOR_TYPE_GRAY_ALPHA) {
-        png_set_gray_to_rgb(pngPtr);
+    // 设置PNG信息
+    int colorType = PNG_COLOR_TYPE_RGBA;
+    if (imageData.channels == 3) {
+        colorType = PNG_COLOR_TYPE_RGB;
     }
 
-    // Ϣ
-    png_read_update_info(pngPtr, infoPtr);
-
-    // ȡºϢ
-    width = png_get_image_width(pngPtr, infoPtr);
-    height = png_get_image_height(pngPtr, infoPtr);
+    png_set_IHDR(pngPtr, infoPtr, imageData.width, imageData.height,
+        8, colorType, PNG_INTERLACE_NONE,
+        PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
 
-    // ͼ
-    imageData.width = static_cast<int>(width);
-    imageData.height = static_cast<int>(height);
-    imageData.channels = 4; // RGBA
-    imageData.data.resize(width * height * 4);
+    // 写入信息
+    png_write_info(pngPtr, infoPtr);
 
-    // ָ
-    png_bytep* rowPointers = new png_bytep[height];
-    for (png_uint_32 y = 0; y < height; y++) {
-        rowPointers[y] = &imageData.data[y * width * 4];
+    // 逐行写入图像数据，无需行指针表
+    const size_t rowBytes = static_cast<size_t>(imageData.width) * imageData.channels;
+    for (int y = 0; y < imageData.height; y++) {
+        png_write_row(pngPtr, imageData.data.data() + y * rowBytes);
     }
 
-    // ȡͼ
-    png_read_image(pngPtr, rowPointers);
-
-    // ȡ
-    png_read_end(pngPtr, nullptr);
-
-    // 
-    delete[] rowPointers;
-    CleanupPngRead(pngPtr, infoPtr);
+    // 写入结束
+    png_write_end(pngPtr, nullptr);
 
-    Logger::Debug("ɹڴPNGͼ (" +
-        std::to_string(width) + "x" +
-        std::to_string(height) + ")");
+    // 清理
+    CleanupPngWrite(pngPtr, infoPtr);
+    fclose(file);
 
+    Logger::Debug("成功保存PNG图像: " + filePath);
     return true;
 }
 
-bool ImageProcessor::SavePng(const std::string& filePath, const ImageData& imageData) {
+bool ImageProcessor::SavePngWithPos(const std::string& filePath, const ImageData& imageData) {
     if (!IsValid(imageData)) {
-        Logger::Error("Чͼ");
+        Logger::Error("无效的图像数据");
         return false;
     }
 
-    // ļ
-    FILE* file;
-    errno_t err = fopen_s(&file, filePath.c_str(), "wb");
+    if (pngEncodeOptions.encoder != PngEncoderType::Libpng) {
+        std::vector<uint8_t> pngData;
+        if (!PngEncoder::Encode(imageData, pngData, pngEncodeOptions, true)) {
+            return false;
+        }
+        return WriteFileData(filePath, pngData);
+    }
+
+    // 打开文件
+    FILE* file = Compat::OpenFile(filePath.c_str(), "wb");
     if (!file) {
-        Logger::Error("޷PNGļ: " + filePath);
+        Logger::Error("无法创建PNG文件: " + filePath);
         return false;
     }
 
-    // ʼlibpngṹ
+    // 初始化libpng结构
     png_structp pngPtr = nullptr;
     png_infop infoPtr = nullptr;
 
@@ -422,17 +254,18 @@ bool ImageProcessor::SavePng(const std::string& filePath, const ImageData& image
         return false;
     }
 
-    // ô
+    // 设置错误处理
     if (setjmp(png_jmpbuf(pngPtr))) {
         CleanupPngWrite(pngPtr, infoPtr);
         fclose(file);
         return false;
     }
 
-    // ļ
+    // 设置文件输出
     png_init_io(pngPtr, file);
+    ApplyPngEncodeOptions(pngPtr, pngEncodeOptions);
 
-    // PNGϢ
+    // 设置PNG信息
     int colorType = PNG_COLOR_TYPE_RGBA;
     if (imageData.channels == 3) {
         colorType = PNG_COLOR_TYPE_RGB;
@@ -442,115 +275,152 @@ bool ImageProcessor::SavePng(const std::string& filePath, const ImageData& image
         8, colorType, PNG_INTERLACE_NONE,
         PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
 
-    // дϢ
+    // 写入坐标信息:tEXtcomment?pos,209,511,232,192
+    char key[] = "comment";
+    std::string posStr = FormatPosComment(imageData);
+    png_text text;
+    text.compression = PNG_TEXT_COMPRESSION_NONE;
+    text.key = key;
+    text.text = const_cast<char*>(posStr.c_str());
+    text.text_length = posStr.length();
+    png_set_text(pngPtr, infoPtr, &text, 1);
+
+    // 写入信息
     png_write_info(pngPtr, infoPtr);
 
-    // ָ
-    png_bytep* rowPointers = new png_bytep[imageData.height];
+    // 逐行写入图像数据，无需行指针表
+    const size_t rowBytes = static_cast<size_t>(imageData.width) * imageData.channels;
     for (int y = 0; y < imageData.height; y++) {
-        rowPointers[y] = const_cast<png_bytep>(&imageData.data[y * imageData.width * imageData.channels]);
+        png_write_row(pngPtr, imageData.data.data() + y * rowBytes);
     }
 
-    // дͼ
-    png_write_image(pngPtr, rowPointers);
-
-    // д
+    // 写入结束
     png_write_end(pngPtr, nullptr);
 
-    // 
-    delete[] rowPointers;
+    // 清理
     CleanupPngWrite(pngPtr, infoPtr);
     fclose(file);
 
-    Logger::Debug("ɹPNGͼ: " + filePath);
+    Logger::Debug("成功保存PNG图像及坐标: " + filePath);
     return true;
 }
 
-bool ImageProcessor::SavePngWithPos(const std::string& filePath, const ImageData& imageData) {
-    if (!IsValid(imageData)) {
-        Logger::Error("Чͼ");
+bool ImageProcessor::SavePngStreamed(const std::string& filePath, const ImageData& header, bool writePos, int bandRows,
+    const std::function<bool(int firstRow, int rowCount, uint8_t* rows)>& produceRows) {
+    if (header.width <= 0 || header.height <= 0 || bandRows <= 0) {
+        Logger::Error("无效的图像参数");
         return false;
     }
 
-    // ļ
-    FILE* file;
-    errno_t err = fopen_s(&file, filePath.c_str(), "wb");
+    // 行缓冲需在setjmp之前构造，出错时正常析构
+    const size_t rowBytes = static_cast<size_t>(header.width) * 4;
+    BufferPool::Buffer band(rowBytes * bandRows);
+    std::string posStr = FormatPosComment(header);
+
+    // 先写入临时文件，全部写完后再替换，中途失败时不在输出路径留下不完整的PNG
+    const std::string tempPath = filePath + ".tmp" +
+        std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    auto discard = [&tempPath]() {
+        std::error_code ec;
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    };
+
+    // 打开文件
+    FILE* file = Compat::OpenFile(tempPath.c_str(), "wb");
     if (!file) {
-        Logger::Error("޷PNGļ: " + filePath);
+        Logger::Error("无法创建PNG文件: " + filePath);
         return false;
     }
 
-    // ʼlibpngṹ
+    // 初始化libpng结构
     png_structp pngPtr = nullptr;
     png_infop infoPtr = nullptr;
 
     if (!InitPngWrite(pngPtr, infoPtr)) {
         fclose(file);
-        return false;
+        return discard();
     }
 
-    // ô
+    // 设置错误处理
     if (setjmp(png_jmpbuf(pngPtr))) {
         CleanupPngWrite(pngPtr, infoPtr);
         fclose(file);
-        return false;
+        return discard();
     }
 
-    // ļ
+    // 设置文件输出
     png_init_io(pngPtr, file);
+    ApplyPngEncodeOptions(pngPtr, pngEncodeOptions);
 
-    // PNGϢ
-    int colorType = PNG_COLOR_TYPE_RGBA;
-    if (imageData.channels == 3) {
-        colorType = PNG_COLOR_TYPE_RGB;
-    }
-
-    png_set_IHDR(pngPtr, infoPtr, imageData.width, imageData.height,
-        8, colorType, PNG_INTERLACE_NONE,
+    png_set_IHDR(pngPtr, infoPtr, header.width, header.height,
+        8, PNG_COLOR_TYPE_RGBA, PNG_INTERLACE_NONE,
         PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
 
-    // дϢ:tEXtcomment?pos,209,511,232,192
-    char key[] = "comment";
-    std::string posStr = "pos," + std::to_string(imageData.posX) + "," + std::to_string(imageData.posY) + "," +
-        std::to_string(imageData.posX + imageData.width) + "," + std::to_string(imageData.posY + imageData.height);
-    png_text text;
-    text.compression = PNG_TEXT_COMPRESSION_NONE;
-    text.key = key;
-    text.text = const_cast<char*>(posStr.c_str());
-    text.text_length = posStr.length();
-    png_set_text(pngPtr, infoPtr, &text, 1);
+    if (writePos) {
+        char key[] = "comment";
+        png_text text;
+        text.compression = PNG_TEXT_COMPRESSION_NONE;
+        text.key = key;
+        text.text = const_cast<char*>(posStr.c_str());
+        text.text_length = posStr.length();
+        png_set_text(pngPtr, infoPtr, &text, 1);
+    }
 
-    // дϢ
+    // 写入信息
     png_write_info(pngPtr, infoPtr);
 
-    // ָ
-    png_bytep* rowPointers = new png_bytep[imageData.height];
-    for (int y = 0; y < imageData.height; y++) {
-        rowPointers[y] = const_cast<png_bytep>(&imageData.data[y * imageData.width * imageData.channels]);
+    // 逐带生成并写入
+    for (int y = 0; y < header.height; y += bandRows) {
+        int rowCount = std::min(bandRows, header.height - y);
+        if (!produceRows(y, rowCount, band.data())) {
+            Logger::Error("生成图像行失败: " + filePath);
+            CleanupPngWrite(pngPtr, infoPtr);
+            fclose(file);
+            return discard();
+        }
+        for (int i = 0; i < rowCount; i++) {
+            png_write_row(pngPtr, band.data() + i * rowBytes);
+        }
     }
 
-    // дͼ
-    png_write_image(pngPtr, rowPointers);
-
-    // д
+    // 写入结束
     png_write_end(pngPtr, nullptr);
 
-    // 
-    delete[] rowPointers;
+    // 清理
     CleanupPngWrite(pngPtr, infoPtr);
-    fclose(file);
+    if (fclose(file) != 0) {
+        Logger::Error("写入文件失败: " + filePath);
+        return discard();
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, filePath, ec);
+    if (ec) {
+        Logger::Error("写入文件失败: " + filePath + " (" + ec.message() + ")");
+        return discard();
+    }
 
-    Logger::Debug("ɹPNGͼ: " + filePath);
+    Logger::Debug("成功流式保存PNG图像: " + filePath);
     return true;
 }
 
 bool ImageProcessor::EncodePng(const ImageData& imageData, std::vector<uint8_t>& pngData) {
+    return EncodePng(imageData, pngData, pngEncodeOptions);
+}
+
+bool ImageProcessor::EncodePng(const ImageData& imageData, std::vector<uint8_t>& pngData, const PngEncodeOptions& options,
+    bool writePos) {
     if (!IsValid(imageData)) {
-        Logger::Error("Чͼ");
+        Logger::Error("无效的图像数据");
         return false;
     }
 
-    // ʼlibpngṹ
+    if (options.encoder != PngEncoderType::Libpng) {
+        return PngEncoder::Encode(imageData, pngData, options, writePos);
+    }
+
+    // 初始化libpng结构
     png_structp pngPtr = nullptr;
     png_infop infoPtr = nullptr;
 
@@ -558,13 +428,13 @@ bool ImageProcessor::EncodePng(const ImageData& imageData, std::vector<uint8_t>&
         return false;
     }
 
-    // ô
+    // 设置错误处理
     if (setjmp(png_jmpbuf(pngPtr))) {
         CleanupPngWrite(pngPtr, infoPtr);
         return false;
     }
 
-    // ڴдṹ
+    // 创建内存写入结构
     struct PngMemoryWriter {
         std::vector<uint8_t>* data;
     };
@@ -572,15 +442,16 @@ bool ImageProcessor::EncodePng(const ImageData& imageData, std::vector<uint8_t>&
     PngMemoryWriter writer;
     writer.data = &pngData;
 
-    // д뺯
+    // 设置写入函数
     png_set_write_fn(pngPtr, &writer, [](png_structp pngPtr, png_bytep data, png_size_t length) {
         PngMemoryWriter* writer = static_cast<PngMemoryWriter*>(png_get_io_ptr(pngPtr));
         size_t oldSize = writer->data->size();
         writer->data->resize(oldSize + length);
         memcpy(writer->data->data() + oldSize, data, length);
         }, nullptr);
+    ApplyPngEncodeOptions(pngPtr, options);
 
-    // PNGϢ
+    // 设置PNG信息
     int colorType = PNG_COLOR_TYPE_RGBA;
     if (imageData.channels == 3) {
         colorType = PNG_COLOR_TYPE_RGB;
@@ -590,54 +461,242 @@ bool ImageProcessor::EncodePng(const ImageData& imageData, std::vector<uint8_t>&
         8, colorType, PNG_INTERLACE_NONE,
         PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
 
-    // дϢ
+    // 坐标信息与SavePngWithPos写入的注释相同
+    char key[] = "comment";
+    std::string posStr;
+    if (writePos) {
+        posStr = FormatPosComment(imageData);
+        png_text text;
+        text.compression = PNG_TEXT_COMPRESSION_NONE;
+        text.key = key;
+        text.text = const_cast<char*>(posStr.c_str());
+        text.text_length = posStr.length();
+        png_set_text(pngPtr, infoPtr, &text, 1);
+    }
+
+    // 写入信息
     png_write_info(pngPtr, infoPtr);
 
-    // ָ
-    png_bytep* rowPointers = new png_bytep[imageData.height];
+    // 逐行写入图像数据，无需行指针表
+    const size_t rowBytes = static_cast<size_t>(imageData.width) * imageData.channels;
     for (int y = 0; y < imageData.height; y++) {
-        rowPointers[y] = const_cast<png_bytep>(&imageData.data[y * imageData.width * imageData.channels]);
+        png_write_row(pngPtr, imageData.data.data() + y * rowBytes);
     }
 
-    // дͼ
-    png_write_image(pngPtr, rowPointers);
-
-    // д
+    // 写入结束
     png_write_end(pngPtr, nullptr);
 
-    // 
-    delete[] rowPointers;
+    // 清理
     CleanupPngWrite(pngPtr, infoPtr);
 
-    Logger::Debug("ɹPNGͼڴ (" +
-        std::to_string(pngData.size()) + " ֽ)");
+    Logger::Debug("成功编码PNG图像到内存 (" +
+        std::to_string(pngData.size()) + " 字节)");
+
+    return true;
+}
+
+void ImageProcessor::SetPngEncodeOptions(const PngEncodeOptions& options) {
+    pngEncodeOptions = options;
+    Logger::Debug("PNG编码参数: " + DescribePngOptions(options));
+}
+
+const PngEncodeOptions& ImageProcessor::GetPngEncodeOptions() {
+    return pngEncodeOptions;
+}
+
+void ImageProcessor::SetPngDecodeOptions(const PngDecodeOptions& options) {
+    pngDecodeOptions = options;
+}
+
+const PngDecodeOptions& ImageProcessor::GetPngDecodeOptions() {
+    return pngDecodeOptions;
+}
+
+bool ImageProcessor::LoadQoi(const std::string& filePath, ImageData& imageData, bool readPos) {
+    MappedFile file;
+    if (!file.Open(filePath)) {
+        Logger::Error("无法打开文件: " + filePath);
+        return false;
+    }
+
+    if (!QoiCodec::Decode(file.data(), file.size(), imageData, readPos)) {
+        Logger::Error("QOI解码失败: " + filePath);
+        return false;
+    }
+
+    Logger::Debug("成功加载QOI图像: " + filePath +
+        " (" + std::to_string(imageData.width) + "x" +
+        std::to_string(imageData.height) + ")");
+    return true;
+}
+
+bool ImageProcessor::ProbeQoi(const std::string& filePath, PngInfo& info) {
+    // 坐标信息在文件末尾，只访问首尾两页
+    MappedFile file;
+    if (!file.Open(filePath, false)) {
+        Logger::Error("无法打开文件: " + filePath);
+        return false;
+    }
+
+    if (!QoiCodec::Probe(file.data(), file.size(), info)) {
+        Logger::Error("无法读取QOI文件头: " + filePath);
+        return false;
+    }
+    return true;
+}
+
+bool ImageProcessor::SaveQoi(const std::string& filePath, const ImageData& imageData, bool writePos) {
+    if (!IsValid(imageData)) {
+        Logger::Error("无效的图像数据");
+        return false;
+    }
+
+    std::vector<uint8_t> qoiData;
+    if (!EncodeQoi(imageData, qoiData, writePos)) {
+        Logger::Error("QOI编码失败: " + filePath);
+        return false;
+    }
+    return WriteFileData(filePath, qoiData);
+}
+
+bool ImageProcessor::EncodeQoi(const ImageData& imageData, std::vector<uint8_t>& qoiData, bool writePos) {
+    if (!IsValid(imageData)) {
+        Logger::Error("无效的图像数据");
+        return false;
+    }
+    return QoiCodec::Encode(ImageView(imageData), qoiData, writePos ? FormatPosComment(imageData) : std::string());
+}
+
+// 过滤器与压缩策略的名称表
+static const std::pair<const char*, int> PNG_FILTER_NAMES[] = {
+    { "none", PNG_FILTER_NONE },
+    { "sub", PNG_FILTER_SUB },
+    { "up", PNG_FILTER_UP },
+    { "avg", PNG_FILTER_AVG },
+    { "paeth", PNG_FILTER_PAETH },
+    { "all", PNG_ALL_FILTERS },
+};
+
+static const std::pair<const char*, int> PNG_STRATEGY_NAMES[] = {
+    { "default", Z_DEFAULT_STRATEGY },
+    { "filtered", Z_FILTERED },
+    { "huffman", Z_HUFFMAN_ONLY },
+    { "rle", Z_RLE },
+    { "fixed", Z_FIXED },
+};
+
+static const std::pair<const char*, PngEncoderType> PNG_ENCODER_NAMES[] = {
+    { "libpng", PngEncoderType::Libpng },
+    { "parallel", PngEncoderType::Parallel },
+    { "fast", PngEncoderType::Fast },
+};
+
+bool ImageProcessor::ParsePngEncoder(const std::string& name, PngEncoderType& encoder) {
+    for (const auto& [encoderName, value] : PNG_ENCODER_NAMES) {
+        if (name == encoderName) {
+            encoder = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ImageProcessor::ParsePngFilter(const std::string& name, int& filters) {
+    for (const auto& [filterName, value] : PNG_FILTER_NAMES) {
+        if (name == filterName) {
+            filters = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ImageProcessor::ParsePngStrategy(const std::string& name, int& strategy) {
+    for (const auto& [strategyName, value] : PNG_STRATEGY_NAMES) {
+        if (name == strategyName) {
+            strategy = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string ImageProcessor::DescribePngOptions(const PngEncodeOptions& options) {
+    std::string filterName = std::to_string(options.filters);
+    for (const auto& [name, value] : PNG_FILTER_NAMES) {
+        if (value == options.filters) {
+            filterName = name;
+            break;
+        }
+    }
+
+    std::string strategyName = options.strategy < 0 ? "libpng" : std::to_string(options.strategy);
+    for (const auto& [name, value] : PNG_STRATEGY_NAMES) {
+        if (value == options.strategy) {
+            strategyName = name;
+            break;
+        }
+    }
+
+    std::string encoderName;
+    for (const auto& [name, value] : PNG_ENCODER_NAMES) {
+        if (value == options.encoder) {
+            encoderName = name;
+            break;
+        }
+    }
+
+    return "encoder=" + encoderName + ", level=" + std::to_string(options.level) +
+        ", filter=" + filterName + ", strategy=" + strategyName;
+}
+
+std::string ImageProcessor::FormatPosComment(const ImageData& imageData) {
+    // 格式: pos,左,上,右,下
+    return "pos," + std::to_string(imageData.posX) + "," + std::to_string(imageData.posY) + "," +
+        std::to_string(imageData.posX + imageData.width) + "," + std::to_string(imageData.posY + imageData.height);
+}
 
+bool ImageProcessor::ParsePosComment(const std::string& text, int& x, int& y) {
+    if (text.compare(0, 4, "pos,") != 0) {
+        return false;
+    }
+    const char* cursor = text.c_str() + 4;
+    char* end = nullptr;
+    const long left = strtol(cursor, &end, 10);
+    if (end == cursor || *end != ',') {
+        return false;
+    }
+    cursor = end + 1;
+    const long top = strtol(cursor, &end, 10);
+    if (end == cursor) {
+        return false;
+    }
+    x = static_cast<int>(left);
+    y = static_cast<int>(top);
     return true;
 }
 
 ImageData ImageProcessor::CreateImage(int width, int height, int channels, uint32_t fillColor) {
     if (width <= 0 || height <= 0 || (channels != 3 && channels != 4)) {
-        Logger::Error("Чͼ");
+        Logger::Error("无效的图像参数");
         return ImageData();
     }
 
     ImageData image(width, height, channels);
 
-    // ȡɫ
+    // 提取颜色分量
     uint8_t r = (fillColor >> 24) & 0xFF;
     uint8_t g = (fillColor >> 16) & 0xFF;
     uint8_t b = (fillColor >> 8) & 0xFF;
     uint8_t a = fillColor & 0xFF;
 
-    // ͼ
-    for (int i = 0; i < width * height * channels; i += channels) {
-        image.data[i] = r;
-        image.data[i + 1] = g;
-        image.data[i + 2] = b;
-
-        if (channels == 4) {
-            image.data[i + 3] = a;
-        }
+    // 填充图像
+    size_t pixelCount = static_cast<size_t>(width) * height;
+    if (channels == 4) {
+        PixelKernels::FillRGBA(image.data.data(), pixelCount, r, g, b, a);
+    }
+    else {
+        PixelKernels::FillRGB(image.data.data(), pixelCount, r, g, b);
     }
 
     return image;
@@ -647,111 +706,150 @@ bool ImageProcessor::CopyImageRegion(const ImageData& source, ImageData& dest,
     int srcX, int srcY, int destX, int destY,
     int width, int height) {
     if (!IsValid(source) || !IsValid(dest)) {
-        Logger::Error("Чͼ");
+        Logger::Error("无效的图像数据");
         return false;
     }
 
-    // ԴǷЧ
+    // 检查源区域是否有效
     if (srcX < 0 || srcY < 0 ||
         srcX + width > source.width ||
         srcY + height > source.height) {
-        Logger::Error("Դͼ򳬳Χ");
+        Logger::Error("源图像区域超出范围");
         return false;
     }
 
-    // ĿǷЧ
+    // 检查目标区域是否有效
     if (destX < 0 || destY < 0 ||
         destX + width > dest.width ||
         destY + height > dest.height) {
-        Logger::Error("Ŀͼ򳬳Χ");
+        Logger::Error("目标图像区域超出范围");
         return false;
     }
 
-    // ͨǷƥ
+    // 检查通道数是否匹配
     if (source.channels != dest.channels) {
-        Logger::Error("ԴĿͼͨƥ");
+        Logger::Error("源和目标图像通道数不匹配");
         return false;
     }
 
-    // и
-    for (int y = 0; y < height; y++) {
-        int srcOffset = ((srcY + y) * source.width + srcX) * source.channels;
-        int destOffset = ((destY + y) * dest.width + destX) * dest.channels;
-
-        memcpy(&dest.data[destOffset], &source.data[srcOffset], width * source.channels);
-    }
-
+    CopyInto(ImageSpan(dest), ImageView(source).SubView(srcX, srcY, width, height), destX, destY);
     return true;
 }
 
 ImageData ImageProcessor::Blend(const ImageData& bg, const ImageData& fg, int x, int y) {
     if (!IsValid(bg)) {
-        Logger::Error("Чıͼ");
+        Logger::Error("无效的背景图像数据");
         return ImageData();
     }
     if (!IsValid(fg)) {
-        Logger::Error("Чǰͼ");
+        Logger::Error("无效的前景图像数据");
         return ImageData();
     }
-    if (bg.channels != 4 || fg.channels != 4) {
-        Logger::Error("ͼͨƥ");
+
+    ImageData result;
+    if (!Blend(ImageView(bg), ImageView(fg), result, x, y)) {
         return ImageData();
     }
-    // 
-    ImageData result = bg;
+    return result;
+}
+
+bool ImageProcessor::Blend(const ImageView& bg, const ImageView& fg, ImageData& result, int x, int y) {
+    if (bg.channels != 4 || fg.channels != 4) {
+        Logger::Error("图像通道数不匹配");
+        return false;
+    }
 
     if (x == 0 && y == 0) {
         x = fg.posX - bg.posX;
         y = fg.posY - bg.posY;
     }
 
-    // չ
-    if (x < 0) {
-        result.data.insert(result.data.begin(), -x * result.channels, 0);
-        result.width += -x;
-        x = 0;
-    }
-    if (y < 0) {
-        result.data.insert(result.data.begin(), -y * result.width * result.channels, 0);
-        result.height += -y;
-        y = 0;
-    }
-    if (x + fg.width > result.width) {
-        result.data.insert(result.data.end(), (x + fg.width - result.width) * result.channels, 0);
-        result.width = x + fg.width;
-    }
-    if (y + fg.height > result.height) {
-        result.data.insert(result.data.end(), (y + fg.height - result.height) * result.width * result.channels, 0);
-        result.height = y + fg.height;
-    }
-
-    // »ͼƬ
-    result.posX = std::min(bg.posX, fg.posX);
-    result.posY = std::min(bg.posY, fg.posY);
-    // »ͼƬĳߴ
-    result.width = std::max(bg.posX + bg.width, fg.posX + fg.width) - result.posX;
-    result.height = std::max(bg.posY + bg.height, fg.posY + fg.height) - result.posY;
-
-    // ػ
-    for (int i = 0; i < fg.height; i++) {
-        for (int j = 0; j < fg.width; j++) {
-            int destX = x + j;
-            int destY = y + i;
-            uint8_t r, g, b, a;
-            if (GetPixel(fg, j, i, r, g, b, a)) {
-                // 
-                uint8_t& dr = result.data[(destY * result.width + destX) * result.channels];
-                uint8_t& dg = result.data[(destY * result.width + destX) * result.channels + 1];
-                uint8_t& db = result.data[(destY * result.width + destX) * result.channels + 2];
-                uint8_t& da = result.data[(destY * result.width + destX) * result.channels + 3];
-                dr = (r * a + dr * (255 - a)) / 255;
-                dg = (g * a + dg * (255 - a)) / 255;
-                db = (b * a + db * (255 - a)) / 255;
-                da = a + da * (255 - a) / 255;
-            }
+    // 结果画布为两者矩形的并集，一次分配到位
+    const int left = std::min(0, x);
+    const int top = std::min(0, y);
+    const int right = std::max(bg.width, x + fg.width);
+    const int bottom = std::max(bg.height, y + fg.height);
+
+    result.width = right - left;
+    result.height = bottom - top;
+    result.channels = 4;
+    result.posX = bg.posX + left;
+    result.posY = bg.posY + top;
+    result.data.AllocateUninitialized(static_cast<size_t>(result.width) * result.height * 4);
+
+    // 背景未覆盖整个画布时先清零
+    ImageSpan canvas(result);
+    if (result.width != bg.width || result.height != bg.height) {
+        Clear(canvas);
+    }
+    CopyInto(canvas, bg, -left, -top);
+    BlendInto(canvas, fg, x - left, y - top);
+    return true;
+}
+
+void ImageProcessor::CopyInto(const ImageSpan& dest, const ImageView& source, int x, int y) {
+    const int firstX = std::max(0, x);
+    const int lastX = std::min(dest.width, x + source.width);
+    const int firstY = std::max(0, y);
+    const int lastY = std::min(dest.height, y + source.height);
+    if (firstX >= lastX || firstY >= lastY) {
+        return;
+    }
+
+    const size_t bytes = static_cast<size_t>(lastX - firstX) * dest.channels;
+    for (int row = firstY; row < lastY; row++) {
+        memcpy(dest.Row(row) + static_cast<size_t>(firstX) * dest.channels,
+            source.Row(row - y) + static_cast<size_t>(firstX - x) * source.channels, bytes);
+    }
+}
+
+void ImageProcessor::BlendInto(const ImageSpan& dest, const ImageView& fg, int x, int y) {
+    // 前景中可见的列和行
+    const int firstX = std::max(0, -x);
+    const int lastX = std::min(fg.width, dest.width - x);
+    const int firstY = std::max(0, -y);
+    const int lastY = std::min(fg.height, dest.height - y);
+
+    // 透明度为0的像素不改变结果，有行范围信息时只处理非透明部分
+    for (int i = firstY; i < lastY; i++) {
+        int begin = firstX;
+        int end = lastX;
+        if (fg.alphaSpans) {
+            begin = std::max(begin, static_cast<int>(fg.alphaSpans[i].begin));
+            end = std::min(end, static_cast<int>(fg.alphaSpans[i].end));
+        }
+        if (begin < end) {
+            PixelKernels::BlendRgba(fg.Row(i) + static_cast<size_t>(begin) * 4,
+                dest.Row(y + i) + static_cast<size_t>(x + begin) * 4, end - begin);
         }
     }
-    return result;
+}
+
+void ImageProcessor::Clear(const ImageSpan& dest) {
+    const size_t bytes = static_cast<size_t>(dest.width) * dest.channels;
+    if (dest.stride == bytes) {
+        memset(dest.pixels, 0, bytes * dest.height);
+        return;
+    }
+    for (int y = 0; y < dest.height; y++) {
+        memset(dest.Row(y), 0, bytes);
+    }
+}
+
+void ImageProcessor::UpdateAlphaSpans(ImageData& image) {
+    if (!IsValid(image) || image.channels != 4) {
+        return;
+    }
+
+    auto holder = std::make_shared<std::vector<AlphaSpan>>(image.height);
+    const uint8_t* pixels = static_cast<const ImageData&>(image).data.data();
+    const size_t rowBytes = static_cast<size_t>(image.width) * 4;
+    for (int y = 0; y < image.height; y++) {
+        size_t begin, end;
+        PixelKernels::FindAlphaSpan(pixels + y * rowBytes, image.width, begin, end);
+        (*holder)[y] = { static_cast<uint32_t>(begin), static_cast<uint32_t>(end) };
+    }
+    image.data.SetAlphaSpans(std::shared_ptr<const AlphaSpan>(holder, holder->data()));
 }
 
 bool ImageProcessor::IsPosValid(const ImageData& image, int x, int y) {
@@ -815,39 +913,50 @@ bool ImageProcessor::GetPixel(const ImageData& image, int x, int y,
 
 ImageData ImageProcessor::ConvertToRGBA(const ImageData& image) {
     if (!IsValid(image)) {
-        Logger::Error("Чͼ");
+        Logger::Error("无效的图像数据");
         return ImageData();
     }
 
     if (image.channels == 4) {
-        // ѾRGBAʽֱӷظ
+        // 已经是RGBA格式，直接返回副本
         ImageData result = image;
         return result;
     }
 
     if (image.channels != 3) {
-        Logger::Error("ֵ֧ͼʽ");
+        Logger::Error("不支持的图像格式");
         return ImageData();
     }
 
-    // תΪRGBA
-    ImageData result(image.width, image.height, 4);
+    // 转换为RGBA，结果缓冲会被完整写入
+    ImageData result;
+    result.width = image.width;
+    result.height = image.height;
+    result.channels = 4;
+    result.posX = image.posX;
+    result.posY = image.posY;
+    result.data.AllocateUninitialized(static_cast<size_t>(image.width) * image.height * 4);
+    PixelKernels::RgbToRgba(image.data.data(), result.data.data(),
+        static_cast<size_t>(image.width) * image.height);
 
-    for (int y = 0; y < image.height; y++) {
-        for (int x = 0; x < image.width; x++) {
-            const uint8_t* srcPixel = GetPixelPtr(image, x, y);
-            uint8_t* destPixel = GetPixelPtr(result, x, y);
-
-            if (srcPixel && destPixel) {
-                destPixel[0] = srcPixel[0]; // R
-                destPixel[1] = srcPixel[1]; // G
-                destPixel[2] = srcPixel[2]; // B
-                destPixel[3] = 255;         // A
-            }
-        }
+    return result;
+}
+
+bool ImageProcessor::EnsureRGBA(ImageData& image) {
+    if (!IsValid(image)) {
+        Logger::Error("无效的图像数据");
+        return false;
+    }
+    if (image.channels == 4) {
+        return true;
     }
 
-    return result;
+    ImageData converted = ConvertToRGBA(image);
+    if (!IsValid(converted)) {
+        return false;
+    }
+    image = std::move(converted);
+    return true;
 }
 
 bool ImageProcessor::IsValid(const ImageData& image) {
@@ -865,26 +974,303 @@ void ImageProcessor::FreeImage(ImageData& image) {
     image.data.shrink_to_fit();
 }
 
+bool ImageProcessor::WriteFileData(const std::string& filePath, const std::vector<uint8_t>& data) {
+    FILE* file = Compat::OpenFile(filePath.c_str(), "wb");
+    if (!file) {
+        Logger::Error("无法创建文件: " + filePath);
+        return false;
+    }
+
+    bool success = fwrite(data.data(), 1, data.size(), file) == data.size();
+    success = fclose(file) == 0 && success;
+    if (!success) {
+        Logger::Error("写入文件失败: " + filePath);
+        return false;
+    }
+
+    Logger::Debug("成功保存文件: " + filePath + " (" + std::to_string(data.size()) + " 字节)");
+    return true;
+}
+
+bool ImageProcessor::DecodePng(const uint8_t* pngData, size_t dataSize, ImageData& imageData,
+    bool readPos, const std::string& source) {
+    // 检查PNG签名
+    if (dataSize < PNG_SIGNATURE_SIZE || png_sig_cmp(pngData, 0, PNG_SIGNATURE_SIZE) != 0) {
+        Logger::Error("文件不是有效的PNG格式: " + source);
+        return false;
+    }
+
+    // 常见的8位RGB/RGBA走快速路径，其余格式或异常数据交给libpng
+    std::vector<std::string> comments;
+    bool decoded = false;
+    if (pngDecodeOptions.fastPath) {
+        decoded = PngDecoder::Decode(pngData, dataSize, imageData, pngDecodeOptions.verifyCrc,
+            readPos ? &comments : nullptr);
+        if (!decoded) {
+            Logger::Debug("快速解码不适用，使用libpng: " + source);
+            comments.clear();
+        }
+    }
+    if (!decoded && !ReadPngWithLibpng(pngData, dataSize, imageData, readPos ? &comments : nullptr)) {
+        return false;
+    }
+
+    if (readPos) {
+        // tEXt块:tEXtcomment?pos,209,511,232,192
+        int x = 0, y = 0;
+        for (const auto& text : comments) {
+            if (ParsePosComment(text, x, y)) {
+                break;
+            }
+        }
+        Logger::Info("tEXt块中的位置信息: " + std::to_string(x) + "," + std::to_string(y));
+        imageData.posX = x;
+        imageData.posY = y;
+    }
+
+    return true;
+}
+
+bool ImageProcessor::ReadPngWithLibpng(const uint8_t* pngData, size_t dataSize, ImageData& imageData,
+    std::vector<std::string>* comments) {
+    // 初始化libpng结构
+    png_structp pngPtr = nullptr;
+    png_infop infoPtr = nullptr;
+
+    if (!InitPngRead(pngPtr, infoPtr)) {
+        return false;
+    }
+
+    // 设置错误处理
+    if (setjmp(png_jmpbuf(pngPtr))) {
+        CleanupPngRead(pngPtr, infoPtr);
+        return false;
+    }
+
+    // 创建内存读取结构
+    struct PngMemoryReader {
+        const uint8_t* data;
+        size_t size;
+        size_t offset;
+    };
+
+    PngMemoryReader reader;
+    reader.data = pngData;
+    reader.size = dataSize;
+    reader.offset = PNG_SIGNATURE_SIZE; // 跳过签名
+
+    // 设置读取函数
+    png_set_read_fn(pngPtr, &reader, [](png_structp pngPtr, png_bytep data, png_size_t length) {
+        PngMemoryReader* reader = static_cast<PngMemoryReader*>(png_get_io_ptr(pngPtr));
+
+        if (reader->offset + length > reader->size) {
+            png_error(pngPtr, "读取超出内存范围");
+            return;
+        }
+
+        memcpy(data, reader->data + reader->offset, length);
+        reader->offset += length;
+        });
+
+    // 设置签名字节
+    png_set_sig_bytes(pngPtr, PNG_SIGNATURE_SIZE);
+
+    // 可信输入忽略CRC错误
+    if (!pngDecodeOptions.verifyCrc) {
+        png_set_crc_action(pngPtr, PNG_CRC_QUIET_USE, PNG_CRC_QUIET_USE);
+    }
+
+    // 读取PNG信息
+    png_read_info(pngPtr, infoPtr);
+
+    // 获取comment文本
+    if (comments) {
+        png_textp textPtr = nullptr;
+        int numText = 0;
+        png_get_text(pngPtr, infoPtr, &textPtr, &numText);
+        for (int i = 0; i < numText; i++) {
+            if (strcmp(textPtr[i].key, "comment") == 0) {
+                comments->emplace_back(textPtr[i].text);
+            }
+        }
+    }
+
+    // 读取像素并统一转换为RGBA
+    if (!ReadPngPixels(pngPtr, infoPtr, imageData)) {
+        CleanupPngRead(pngPtr, infoPtr);
+        return false;
+    }
+
+    // 清理
+    CleanupPngRead(pngPtr, infoPtr);
+    return true;
+}
+
+void ImageProcessor::ApplyPngEncodeOptions(png_structp pngPtr, const PngEncodeOptions& options) {
+    png_set_compression_level(pngPtr, options.level);
+    if (options.strategy >= 0) {
+        png_set_compression_strategy(pngPtr, options.strategy);
+    }
+    png_set_filter(pngPtr, PNG_FILTER_TYPE_BASE, options.filters);
+}
+
+bool ImageProcessor::ReadPngPixels(png_structp pngPtr, png_infop infoPtr, ImageData& imageData) {
+    // 临时行缓冲在调用setjmp的函数之外构造：setjmp之后被修改的非volatile局部变量在跳转回来后取值不确定，
+    // 不能再安全析构
+    BufferPool::Buffer scratch;
+    return ReadPngRows(pngPtr, infoPtr, imageData, scratch);
+}
+
+bool ImageProcessor::ReadPngRows(png_structp pngPtr, png_infop infoPtr, ImageData& imageData,
+    BufferPool::Buffer& scratch) {
+    // 接管错误处理，调用方的跳转点在此之后不再使用
+    if (setjmp(png_jmpbuf(pngPtr))) {
+        return false;
+    }
+
+    png_uint_32 width = png_get_image_width(pngPtr, infoPtr);
+    png_uint_32 height = png_get_image_height(pngPtr, infoPtr);
+    png_byte colorType = png_get_color_type(pngPtr, infoPtr);
+    png_byte bitDepth = png_get_bit_depth(pngPtr, infoPtr);
+    bool hasTrns = png_get_valid(pngPtr, infoPtr, PNG_INFO_tRNS) != 0;
+
+    // 转换为8位深度
+    if (bitDepth == 16) {
+        png_set_strip_16(pngPtr);
+    }
+
+    // 低位深：调色板展开为每像素1字节索引，灰度扩展为8位
+    if (bitDepth < 8) {
+        if (colorType == PNG_COLOR_TYPE_PALETTE) {
+            png_set_packing(pngPtr);
+        }
+        else {
+            png_set_expand_gray_1_2_4_to_8(pngPtr);
+        }
+    }
+
+    // 调色板的透明度由查找表处理，灰度/RGB的色键透明仍交给libpng
+    if (hasTrns && colorType != PNG_COLOR_TYPE_PALETTE) {
+        png_set_tRNS_to_alpha(pngPtr);
+    }
+
+    int passes = png_set_interlace_handling(pngPtr);
+
+    // 更新信息
+    png_read_update_info(pngPtr, infoPtr);
+
+    int srcChannels = png_get_channels(pngPtr, infoPtr);
+    size_t rowBytes = png_get_rowbytes(pngPtr, infoPtr);
+
+    // 调色板查找表
+    uint32_t paletteLut[256];
+    if (colorType == PNG_COLOR_TYPE_PALETTE) {
+        png_colorp palette = nullptr;
+        int numPalette = 0;
+        png_bytep transAlpha = nullptr;
+        int numTrans = 0;
+        png_get_PLTE(pngPtr, infoPtr, &palette, &numPalette);
+        if (hasTrns) {
+            png_get_tRNS(pngPtr, infoPtr, &transAlpha, &numTrans, nullptr);
+        }
+
+        for (int i = 0; i < 256; i++) {
+            uint8_t alpha = (transAlpha && i < numTrans) ? transAlpha[i] : 255;
+            if (palette && i < numPalette) {
+                paletteLut[i] = PixelKernels::PackRGBA(palette[i].red, palette[i].green, palette[i].blue, alpha);
+            }
+            else {
+                paletteLut[i] = PixelKernels::PackRGBA(0, 0, 0, alpha);
+            }
+        }
+    }
+
+    // 分配图像数据
+    const int channels = 4; // RGBA
+    imageData.width = static_cast<int>(width);
+    imageData.height = static_cast<int>(height);
+    imageData.channels = channels;
+    imageData.data.AllocateUninitialized(static_cast<size_t>(width) * height * channels);
+
+    auto convertRow = [&](const uint8_t* src, uint8_t* dst) {
+        switch (srcChannels) {
+        case 1:
+            if (colorType == PNG_COLOR_TYPE_PALETTE) {
+                PixelKernels::PaletteToRgba(src, dst, width, paletteLut);
+            }
+            else {
+                PixelKernels::GrayToRgba(src, dst, width);
+            }
+            break;
+        case 2:
+            PixelKernels::GrayAlphaToRgba(src, dst, width);
+            break;
+        case 3:
+            PixelKernels::RgbToRgba(src, dst, width);
+            break;
+        default:
+            memcpy(dst, src, static_cast<size_t>(width) * channels);
+            break;
+        }
+    };
+
+    uint8_t* pixels = imageData.data.data();
+    const size_t dstRowBytes = static_cast<size_t>(width) * channels;
+    if (srcChannels == channels) {
+        // 已是RGBA，直接逐行解码到目标缓冲；隔行图像每一遍都在已有内容上补全
+        for (int pass = 0; pass < passes; pass++) {
+            for (png_uint_32 y = 0; y < height; y++) {
+                png_read_row(pngPtr, pixels + y * dstRowBytes, nullptr);
+            }
+        }
+    }
+    else if (passes > 1) {
+        // 隔行扫描需要完整的原始图像，读完后整体转换
+        scratch.Allocate(rowBytes * height);
+        for (int pass = 0; pass < passes; pass++) {
+            for (png_uint_32 y = 0; y < height; y++) {
+                png_read_row(pngPtr, scratch.data() + y * rowBytes, nullptr);
+            }
+        }
+        for (png_uint_32 y = 0; y < height; y++) {
+            convertRow(scratch.data() + y * rowBytes, pixels + y * dstRowBytes);
+        }
+    }
+    else {
+        // 逐行读取原始格式并转换，只需一行临时缓冲
+        scratch.Allocate(rowBytes);
+        for (png_uint_32 y = 0; y < height; y++) {
+            png_read_row(pngPtr, scratch.data(), nullptr);
+            convertRow(scratch.data(), pixels + y * dstRowBytes);
+        }
+    }
+
+    // 读取结束
+    png_read_end(pngPtr, nullptr);
+
+    return true;
+}
+
 void ImageProcessor::PngErrorHandler(png_structp png_ptr, png_const_charp error_msg) {
-    Logger::Error("libpng: " + std::string(error_msg));
+    Logger::Error("libpng错误: " + std::string(error_msg));
     longjmp(png_jmpbuf(png_ptr), 1);
 }
 
 void ImageProcessor::PngWarningHandler(png_structp png_ptr, png_const_charp warning_msg) {
-    Logger::Warning("libpng: " + std::string(warning_msg));
+    Logger::Warning("libpng警告: " + std::string(warning_msg));
 }
 
 bool ImageProcessor::InitPngRead(png_structp& pngPtr, png_infop& infoPtr) {
     pngPtr = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, PngErrorHandler, PngWarningHandler);
     if (!pngPtr) {
-        Logger::Error("޷PNGȡṹ");
+        Logger::Error("无法创建PNG读取结构");
         return false;
     }
 
     infoPtr = png_create_info_struct(pngPtr);
     if (!infoPtr) {
         png_destroy_read_struct(&pngPtr, nullptr, nullptr);
-        Logger::Error("޷PNGϢṹ");
+        Logger::Error("无法创建PNG信息结构");
         return false;
     }
 
@@ -894,14 +1280,14 @@ bool ImageProcessor::InitPngRead(png_structp& pngPtr, png_infop& infoPtr) {
 bool ImageProcessor::InitPngWrite(png_structp& pngPtr, png_infop& infoPtr) {
     pngPtr = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, PngErrorHandler, PngWarningHandler);
     if (!pngPtr) {
-        Logger::Error("޷PNGдṹ");
+        Logger::Error("无法创建PNG写入结构");
         return false;
     }
 
     infoPtr = png_create_info_struct(pngPtr);
     if (!infoPtr) {
         png_destroy_write_struct(&pngPtr, nullptr);
-        Logger::Error("޷PNGϢṹ");
+        Logger::Error("无法创建PNG信息结构");
         return false;
     }
 
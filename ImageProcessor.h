@@ -4,16 +4,160 @@
 #include <cstdint>
 #include <string>
 #include <memory>
+#include <functional>
+#include <cstring>
 #include <png.h>
+#include <zlib.h>
 #include "Config.h"
+#include "BufferPool.h"
 
-// ͼݽṹ
+// 一行中透明度不为0的像素范围 [begin, end)
+struct AlphaSpan {
+    uint32_t begin;
+    uint32_t end;
+};
+
+// 像素缓冲：自有存储，或引用外部只读内存 (如映射的缓存文件)
+// 接口与std::vector一致；引用外部内存时，任何可写访问都会先复制为自有存储
+// 自有存储从BufferPool申请，释放后供下一个同级别的缓冲复用
+class PixelBuffer {
+public:
+    PixelBuffer() = default;
+    explicit PixelBuffer(size_t size) { resize(size); }
+
+    // 复制总是得到自有存储
+    PixelBuffer(const PixelBuffer& other) : alphaSpans(other.alphaSpans) {
+        storage.Allocate(other.size());
+        if (storage.size() > 0) {
+            memcpy(storage.data(), other.data(), storage.size());
+        }
+    }
+    PixelBuffer(PixelBuffer&& other) noexcept {
+        *this = std::move(other);
+    }
+    PixelBuffer& operator=(const PixelBuffer& other) {
+        if (this != &other) {
+            *this = PixelBuffer(other);
+        }
+        return *this;
+    }
+    PixelBuffer& operator=(PixelBuffer&& other) noexcept {
+        storage = std::move(other.storage);
+        view = other.view;
+        viewSize = other.viewSize;
+        owner = std::move(other.owner);
+        alphaSpans = std::move(other.alphaSpans);
+        other.view = nullptr;
+        other.viewSize = 0;
+        return *this;
+    }
+
+    /**
+     * @brief 创建引用外部内存的缓冲
+     * @param data 像素数据
+     * @param size 数据长度
+     * @param owner 外部内存的所有者，缓冲存在期间保持其存活
+     */
+    static PixelBuffer View(const uint8_t* data, size_t size, std::shared_ptr<const void> owner) {
+        PixelBuffer buffer;
+        buffer.view = data;
+        buffer.viewSize = size;
+        buffer.owner = std::move(owner);
+        return buffer;
+    }
+
+    bool IsView() const { return view != nullptr; }
+
+    size_t size() const { return view ? viewSize : storage.size(); }
+    bool empty() const { return size() == 0; }
+    const uint8_t* data() const { return view ? view : storage.data(); }
+    const uint8_t& operator[](size_t index) const { return data()[index]; }
+
+    uint8_t* data() { MakeWritable(); return storage.data(); }
+    uint8_t& operator[](size_t index) { MakeWritable(); return storage[index]; }
+    uint8_t* begin() { MakeWritable(); return storage.data(); }
+    uint8_t* end() { MakeWritable(); return storage.data() + storage.size(); }
+
+    // 与std::vector一致，新增部分填0
+    void resize(size_t size) {
+        MakeWritable();
+        size_t oldSize = storage.size();
+        storage.Resize(size);
+        if (size > oldSize) {
+            memset(storage.data() + oldSize, 0, size - oldSize);
+        }
+    }
+    void insert(uint8_t* pos, size_t count, uint8_t value) {
+        MakeWritable();
+        size_t offset = pos - storage.data();
+        size_t oldSize = storage.size();
+        storage.Resize(oldSize + count);
+        memmove(storage.data() + offset + count, storage.data() + offset, oldSize - offset);
+        memset(storage.data() + offset, value, count);
+    }
+    void clear() {
+        storage.Reset();
+        view = nullptr;
+        viewSize = 0;
+        owner.reset();
+        alphaSpans.reset();
+    }
+    void shrink_to_fit() {
+        if (storage.size() == 0) {
+            storage.Reset();
+        }
+    }
+
+    /**
+     * @brief 分配指定大小的自有存储，原内容丢弃，新内容未初始化
+     * @param size 字节数
+     * @note 用于随后会被完整写入的缓冲，省去清零
+     */
+    void AllocateUninitialized(size_t size) {
+        view = nullptr;
+        viewSize = 0;
+        owner.reset();
+        alphaSpans.reset();
+        storage.Allocate(size);
+    }
+
+    /**
+     * @brief 每行的非透明范围，未知时返回nullptr
+     * @note 像素被写入后自动失效
+     */
+    const AlphaSpan* AlphaSpans() const { return alphaSpans.get(); }
+    void SetAlphaSpans(std::shared_ptr<const AlphaSpan> spans) { alphaSpans = std::move(spans); }
+
+private:
+    void MakeWritable() {
+        if (view) {
+            const uint8_t* source = view;
+            size_t size = viewSize;
+            std::shared_ptr<const void> keepAlive = std::move(owner);
+            view = nullptr;
+            viewSize = 0;
+            storage.Allocate(size);
+            if (size > 0) {
+                memcpy(storage.data(), source, size);
+            }
+        }
+        alphaSpans.reset();
+    }
+
+    BufferPool::Buffer storage;
+    const uint8_t* view = nullptr;
+    size_t viewSize = 0;
+    std::shared_ptr<const void> owner;
+    std::shared_ptr<const AlphaSpan> alphaSpans;
+};
+
+// 图像数据结构
 struct ImageData {
-    int posX, posY;             // λ
-    int width;                  // ͼ
-    int height;                 // ͼ߶
-    int channels;               // ͨ (3-RGB, 4-RGBA)
-    std::vector<uint8_t> data;  // ͼ
+    int posX, posY;             // 位置
+    int width;                  // 图像宽度
+    int height;                 // 图像高度
+    int channels;               // 通道数 (3-RGB, 4-RGBA)
+    PixelBuffer data;           // 图像像素数据
 
     ImageData() : width(0), height(0), channels(0), posX(0), posY(0) {}
     ImageData(int w, int h, int c, int x = 0, int y = 0) : width(w), height(h), channels(c), posX(x), posY(y) {
@@ -21,201 +165,566 @@ struct ImageData {
     }
 };
 
+// 只读图像视图：不持有像素，可指向图像中的任意矩形区域
+// 解码的部件、映射的缓存和画布都可以不经复制地以视图参与运算
+struct ImageView {
+    const uint8_t* pixels = nullptr;        // 左上角像素
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    size_t stride = 0;                      // 相邻两行的字节距离
+    int posX = 0;                           // 左上角的坐标
+    int posY = 0;
+    const AlphaSpan* alphaSpans = nullptr;  // 每行非透明范围，未知或列被裁剪时为nullptr
+
+    ImageView() = default;
+    ImageView(const ImageData& image)
+        : pixels(image.data.data()), width(image.width), height(image.height), channels(image.channels),
+        stride(static_cast<size_t>(image.width) * image.channels), posX(image.posX), posY(image.posY),
+        alphaSpans(image.data.AlphaSpans()) {
+    }
+
+    const uint8_t* Row(int y) const { return pixels + y * stride; }
+
+    /**
+     * @brief 取子矩形视图，调用方保证矩形在视图范围内
+     */
+    ImageView SubView(int x, int y, int w, int h) const {
+        ImageView view = *this;
+        view.pixels = pixels + y * stride + static_cast<size_t>(x) * channels;
+        view.width = w;
+        view.height = h;
+        view.posX = posX + x;
+        view.posY = posY + y;
+        view.alphaSpans = (alphaSpans && x == 0 && w == width) ? alphaSpans + y : nullptr;
+        return view;
+    }
+};
+
+// 可写图像视图
+struct ImageSpan {
+    uint8_t* pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    size_t stride = 0;
+    int posX = 0;
+    int posY = 0;
+
+    ImageSpan() = default;
+    ImageSpan(uint8_t* data, int w, int h, int c, size_t rowStride, int x = 0, int y = 0)
+        : pixels(data), width(w), height(h), channels(c), stride(rowStride), posX(x), posY(y) {
+    }
+    ImageSpan(ImageData& image)
+        : pixels(image.data.data()), width(image.width), height(image.height), channels(image.channels),
+        stride(static_cast<size_t>(image.width) * image.channels), posX(image.posX), posY(image.posY) {
+    }
+
+    uint8_t* Row(int y) const { return pixels + y * stride; }
+
+    ImageSpan SubView(int x, int y, int w, int h) const {
+        return ImageSpan(pixels + y * stride + static_cast<size_t>(x) * channels, w, h, channels, stride,
+            posX + x, posY + y);
+    }
+
+    operator ImageView() const {
+        ImageView view;
+        view.pixels = pixels;
+        view.width = width;
+        view.height = height;
+        view.channels = channels;
+        view.stride = stride;
+        view.posX = posX;
+        view.posY = posY;
+        return view;
+    }
+};
+
+// 只读取文件头得到的PNG信息
+struct PngInfo {
+    int width = 0;
+    int height = 0;
+    int posX = 0;               // tEXt块中的坐标，没有时为0
+    int posY = 0;
+    bool hasPos = false;        // 是否找到坐标信息
+};
+
+// PNG编码器
+enum class PngEncoderType {
+    Libpng,     // libpng单流编码
+    Parallel,   // 分带并行压缩，适合少量超大图像
+    Fast,       // 内置快速deflate，适合大批量RGBA立绘
+};
+
+// PNG编码参数
+struct PngEncodeOptions {
+    PngEncoderType encoder = PngEncoderType::Libpng;
+    int level = 6;                          // zlib压缩级别 (0-9)
+    int filters = PNG_ALL_FILTERS;          // 行过滤器掩码，PNG_ALL_FILTERS为逐行自适应
+    int strategy = -1;                      // zlib压缩策略，-1表示由libpng决定
+};
+
+// PNG解码参数
+struct PngDecodeOptions {
+    bool fastPath = true;                   // 8位RGB/RGBA非隔行图像使用内置解码器
+    bool verifyCrc = true;                  // 校验块CRC和adler32，可信输入可关闭
+};
+
 class ImageProcessor {
 public:
     /**
-     * @brief PNGͼļ
-     * @param filePath PNGļ·
-     * @param imageData ͼ
-     * @return ɹطtrue򷵻false
+     * @brief 加载PNG图像文件
+     * @param filePath PNG文件路径
+     * @param imageData 输出的图像数据
+     * @return 成功加载返回true，否则返回false
      */
     static bool LoadPng(const std::string& filePath, ImageData& imageData);
 
     /**
-     * @brief PNGͼļϢ
-     * @param filePath PNGļ·
-     * @param imageData Ϣͼ
-     * @return ɹطtrue򷵻false
+     * @brief 加载PNG图像文件和坐标信息
+     * @param filePath PNG文件路径
+     * @param imageData 输出带坐标信息的图像数据
+     * @return 成功加载返回true，否则返回false
      */
     static bool LoadPngWithPos(const std::string& filePath, ImageData& imageData);
 
     /**
-     * @brief ڴݼPNGͼ
-     * @param pngData PNGָ
-     * @param dataSize ݴС
-     * @param imageData ͼ
-     * @return ɹطtrue򷵻false
+     * @brief 从内存数据加载PNG图像
+     * @param pngData PNG数据指针
+     * @param dataSize 数据大小
+     * @param imageData 输出的图像数据
+     * @param readPos 是否读取tEXt块中的坐标信息
+     * @return 成功加载返回true，否则返回false
+     */
+    static bool LoadPngFromMemory(const uint8_t* pngData, size_t dataSize, ImageData& imageData, bool readPos = false);
+
+    /**
+     * @brief 只读取PNG文件头，获取尺寸和坐标信息，不解压像素
+     * @param filePath PNG文件路径
+     * @param info 输出的PNG信息
+     * @return 成功读取返回true，否则返回false
+     * @note 坐标只从IDAT之前的tEXt块中查找，与本程序写出的文件一致
      */
-    static bool LoadPngFromMemory(const uint8_t* pngData, size_t dataSize, ImageData& imageData);
+    static bool ProbePng(const std::string& filePath, PngInfo& info);
 
     /**
-     * @brief ͼΪPNGļ
-     * @param filePath ļ·
-     * @param imageData ͼ
-     * @return ɹ淵true򷵻false
+     * @brief 从内存数据读取PNG文件头
+     * @param pngData PNG数据指针
+     * @param dataSize 数据大小
+     * @param info 输出的PNG信息
+     * @return 成功读取返回true，否则返回false
+     */
+    static bool ProbePngFromMemory(const uint8_t* pngData, size_t dataSize, PngInfo& info);
+
+    /**
+     * @brief 保存图像为PNG文件
+     * @param filePath 输出文件路径
+     * @param imageData 图像数据
+     * @return 成功保存返回true，否则返回false
      */
     static bool SavePng(const std::string& filePath, const ImageData& imageData);
 
     /**
-     * @brief ͼΪPNGļдϢ
-     * @param filePath ļ·
-     * @param imageData ͼ
-     * @return ɹ淵true򷵻false
+     * @brief 保存图像为PNG文件，并写入坐标信息
+     * @param filePath 输出文件路径
+     * @param imageData 图像数据
+     * @return 成功保存返回true，否则返回false
      */
     static bool SavePngWithPos(const std::string& filePath, const ImageData& imageData);
 
     /**
-     * @brief ͼΪPNGʽڴ
-     * @param imageData ͼ
-     * @param pngData PNG
-     * @return ɹ뷵true򷵻false
+     * @brief 逐带生成图像行并直接交给libpng写出，不保存完整图像
+     * @param filePath 输出文件路径
+     * @param header 输出图像的尺寸和坐标，不使用其中的像素数据
+     * @param writePos 是否写入坐标信息
+     * @param bandRows 每次生成的行数
+     * @param produceRows 填充从firstRow开始的rowCount行RGBA数据，返回false时中止写出
+     * @return 成功保存返回true，否则返回false
+     * @note 内存占用只与宽度和bandRows有关；总是使用libpng编码，编码器类型设置不生效；
+     *       先写入同目录的临时文件，成功后再替换，失败时删除临时文件
+     */
+    static bool SavePngStreamed(const std::string& filePath, const ImageData& header, bool writePos, int bandRows,
+        const std::function<bool(int firstRow, int rowCount, uint8_t* rows)>& produceRows);
+
+    /**
+     * @brief 将图像编码为PNG格式到内存
+     * @param imageData 图像数据
+     * @param pngData 输出的PNG数据
+     * @return 成功编码返回true，否则返回false
      */
     static bool EncodePng(const ImageData& imageData, std::vector<uint8_t>& pngData);
 
     /**
-     * @brief ָСĿհͼ
-     * @param width ͼ
-     * @param height ͼ߶
-     * @param channels ͨ (34)
-     * @param fillColor ɫ (RGBAʽĬ͸)
-     * @return ͼ
+     * @brief 按指定编码参数将图像编码为PNG格式到内存
+     * @param imageData 图像数据
+     * @param pngData 输出的PNG数据
+     * @param options 编码参数
+     * @param writePos 是否写入坐标信息
+     * @return 成功编码返回true，否则返回false
+     */
+    static bool EncodePng(const ImageData& imageData, std::vector<uint8_t>& pngData, const PngEncodeOptions& options,
+        bool writePos = false);
+
+    /**
+     * @brief 加载QOI图像文件
+     * @param filePath QOI文件路径
+     * @param imageData 输出的RGBA图像数据
+     * @param readPos 是否读取文件尾部的坐标信息
+     * @return 成功加载返回true，否则返回false
+     */
+    static bool LoadQoi(const std::string& filePath, ImageData& imageData, bool readPos);
+
+    /**
+     * @brief 只读取QOI文件头和尾部的坐标信息，不解码像素
+     * @param filePath QOI文件路径
+     * @param info 输出的尺寸和坐标
+     * @return 成功读取返回true，否则返回false
+     */
+    static bool ProbeQoi(const std::string& filePath, PngInfo& info);
+
+    /**
+     * @brief 保存图像为QOI文件
+     * @param filePath 输出文件路径
+     * @param imageData 图像数据
+     * @param writePos 是否在文件尾部写入坐标信息，内容与PNG的tEXt注释相同
+     * @return 成功保存返回true，否则返回false
+     * @note 编码不压缩，速度远快于PNG，适合预览输出和中间文件
+     */
+    static bool SaveQoi(const std::string& filePath, const ImageData& imageData, bool writePos);
+
+    /**
+     * @brief 将图像编码为QOI格式到内存
+     * @param imageData 图像数据
+     * @param qoiData 输出的QOI数据
+     * @param writePos 是否在尾部写入坐标信息
+     * @return 成功编码返回true，否则返回false
+     */
+    static bool EncodeQoi(const ImageData& imageData, std::vector<uint8_t>& qoiData, bool writePos);
+
+    /**
+     * @brief 设置保存和编码PNG时使用的默认参数
+     * @param options 编码参数
+     */
+    static void SetPngEncodeOptions(const PngEncodeOptions& options);
+
+    /**
+     * @brief 获取当前的PNG编码参数
+     * @return 编码参数
+     */
+    static const PngEncodeOptions& GetPngEncodeOptions();
+
+    /**
+     * @brief 设置加载PNG时使用的解码参数
+     * @param options 解码参数
+     */
+    static void SetPngDecodeOptions(const PngDecodeOptions& options);
+
+    /**
+     * @brief 获取当前的PNG解码参数
+     * @return 解码参数
+     */
+    static const PngDecodeOptions& GetPngDecodeOptions();
+
+    /**
+     * @brief 解析编码器名称 (libpng, parallel, fast)
+     * @param name 编码器名称
+     * @param encoder 输出的编码器类型
+     * @return 名称有效返回true，否则返回false
+     */
+    static bool ParsePngEncoder(const std::string& name, PngEncoderType& encoder);
+
+    /**
+     * @brief 解析行过滤器名称 (none, sub, up, avg, paeth, all)
+     * @param name 过滤器名称
+     * @param filters 输出的libpng过滤器掩码
+     * @return 名称有效返回true，否则返回false
+     */
+    static bool ParsePngFilter(const std::string& name, int& filters);
+
+    /**
+     * @brief 解析zlib压缩策略名称 (default, filtered, huffman, rle, fixed)
+     * @param name 策略名称
+     * @param strategy 输出的zlib策略
+     * @return 名称有效返回true，否则返回false
+     */
+    static bool ParsePngStrategy(const std::string& name, int& strategy);
+
+    /**
+     * @brief 生成编码参数的可读描述
+     * @param options 编码参数
+     * @return 描述字符串
+     */
+    static std::string DescribePngOptions(const PngEncodeOptions& options);
+
+    /**
+     * @brief 生成写入tEXt块的坐标信息
+     * @param imageData 图像数据
+     * @return 格式为pos,左,上,右,下的字符串
+     */
+    static std::string FormatPosComment(const ImageData& imageData);
+
+    /**
+     * @brief 解析坐标信息
+     * @param text 以pos,左,上开头的字符串，其后的字段被忽略
+     * @param x 输出的左坐标
+     * @param y 输出的上坐标
+     * @return 格式正确返回true，否则不修改坐标
+     */
+    static bool ParsePosComment(const std::string& text, int& x, int& y);
+
+    /**
+     * @brief 创建指定大小的空白图像
+     * @param width 图像宽度
+     * @param height 图像高度
+     * @param channels 通道数 (3或4)
+     * @param fillColor 填充颜色 (RGBA格式，默认透明)
+     * @return 创建的图像数据
      */
     static ImageData CreateImage(int width, int height, int channels = 4, uint32_t fillColor = 0x00000000);
 
     /**
-     * @brief ͼ
-     * @param source Դͼ
-     * @param dest Ŀͼ
-     * @param srcX ԴͼеX
-     * @param srcY ԴͼеY
-     * @param destX ĿͼеX
-     * @param destY ĿͼеY
-     * @param width ҪƵĿ
-     * @param height ҪƵĸ߶
-     * @return ɹƷtrue򷵻false
+     * @brief 复制图像区域
+     * @param source 源图像
+     * @param dest 目标图像
+     * @param srcX 源图像中的X坐标
+     * @param srcY 源图像中的Y坐标
+     * @param destX 目标图像中的X坐标
+     * @param destY 目标图像中的Y坐标
+     * @param width 要复制的宽度
+     * @param height 要复制的高度
+     * @return 成功复制返回true，否则返回false
      */
     static bool CopyImageRegion(const ImageData& source, ImageData& dest,
         int srcX, int srcY, int destX, int destY,
         int width, int height);
 
     /**
-     * @brief ͼӻ, 
-     * @param bg ͼ
-     * @param fg ǰͼ
-     * @param x X
-     * @param y Y
-     * @return ϲͼ
+     * @brief 图层叠加混合, 并更新坐标
+     * @param bg 背景图像
+     * @param fg 前景图像
+     * @param x X坐标
+     * @param y Y坐标
+     * @return 合并后的图像数据
      */
     static ImageData Blend(const ImageData& bg, const ImageData& fg, int x = 0, int y = 0);
 
     /**
-     * @brief ǷͼΧ
-     * @param image ͼ
-     * @param x X
-     * @param y Y
-     * @return ڷΧڷtrue򷵻false
+     * @brief 图层叠加混合，结果写入输出参数
+     * @param bg 背景图像 (RGBA)
+     * @param fg 前景图像 (RGBA)
+     * @param result 输出的合并图像，已有缓冲容量足够时直接复用；不能与bg或fg共用像素
+     * @param x 前景相对背景的X偏移，与y同为0时按两者坐标计算
+     * @param y 前景相对背景的Y偏移
+     * @return 成功返回true，否则返回false
+     */
+    static bool Blend(const ImageView& bg, const ImageView& fg, ImageData& result, int x = 0, int y = 0);
+
+    /**
+     * @brief 将图像复制到目标视图的指定位置，超出目标的部分被裁剪
+     * @param dest 目标视图
+     * @param source 源图像，通道数需与目标一致
+     * @param x 源图像左上角在目标中的X坐标
+     * @param y 源图像左上角在目标中的Y坐标
+     */
+    static void CopyInto(const ImageSpan& dest, const ImageView& source, int x, int y);
+
+    /**
+     * @brief 将RGBA前景原地混合到目标视图的指定位置，超出目标的部分被裁剪
+     * @param dest 目标视图 (RGBA)
+     * @param fg 前景图像 (RGBA)，有行范围信息时只处理非透明部分
+     * @param x 前景左上角在目标中的X坐标
+     * @param y 前景左上角在目标中的Y坐标
+     */
+    static void BlendInto(const ImageSpan& dest, const ImageView& fg, int x, int y);
+
+    /**
+     * @brief 将视图内的像素全部清零 (透明)
+     * @param dest 目标视图
+     */
+    static void Clear(const ImageSpan& dest);
+
+    /**
+     * @brief 计算并附加每行的非透明范围，供Blend跳过透明区域
+     * @param image RGBA图像
+     */
+    static void UpdateAlphaSpans(ImageData& image);
+
+    /**
+     * @brief 检查坐标是否在图像范围内
+     * @param image 图像数据
+     * @param x X坐标
+     * @param y Y坐标
+     * @return 在范围内返回true，否则返回false
      */
     static bool IsPosValid(const ImageData& image, int x, int y);
 
     /**
-     * @brief ȡֵָ
-     * @param image ͼ
-     * @param x X
-     * @param y Y
-     * @return ָ룬Ч귵nullptr
+     * @brief 获取像素值的指针
+     * @param image 图像数据
+     * @param x X坐标
+     * @param y Y坐标
+     * @return 像素数据指针，无效坐标返回nullptr
      */
     static uint8_t* GetPixelPtr(ImageData& image, int x, int y);
 
     /**
-     * @brief ȡֵĳָ
-     * @param image ͼ
-     * @param x X
-     * @param y Y
-     * @return ָ룬Ч귵nullptr
+     * @brief 获取像素值的常量指针
+     * @param image 图像数据
+     * @param x X坐标
+     * @param y Y坐标
+     * @return 像素数据指针，无效坐标返回nullptr
      */
     static const uint8_t* GetPixelPtr(const ImageData& image, int x, int y);
 
     /**
-     * @brief ֵ
-     * @param image ͼ
-     * @param x X
-     * @param y Y
-     * @param r ɫ
-     * @param g ɫ
-     * @param b ɫ
-     * @param a ͸ȷ
-     * @return ɹ÷true򷵻false
+     * @brief 设置像素值
+     * @param image 图像数据
+     * @param x X坐标
+     * @param y Y坐标
+     * @param r 红色分量
+     * @param g 绿色分量
+     * @param b 蓝色分量
+     * @param a 透明度分量
+     * @return 成功设置返回true，否则返回false
      */
     static bool SetPixel(ImageData& image, int x, int y,
         uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255);
 
     /**
-     * @brief ȡֵ
-     * @param image ͼ
-     * @param x X
-     * @param y Y
-     * @param r ĺɫ
-     * @param g ɫ
-     * @param b ɫ
-     * @param a ͸ȷ
-     * @return ɹȡtrue򷵻false
+     * @brief 获取像素值
+     * @param image 图像数据
+     * @param x X坐标
+     * @param y Y坐标
+     * @param r 输出的红色分量
+     * @param g 输出的绿色分量
+     * @param b 输出的蓝色分量
+     * @param a 输出的透明度分量
+     * @return 成功获取返回true，否则返回false
      */
     static bool GetPixel(const ImageData& image, int x, int y,
         uint8_t& r, uint8_t& g, uint8_t& b, uint8_t& a);
 
     /**
-     * @brief ͼתΪRGBAʽ
-     * @param image ͼ
-     * @return תRGBAͼ
+     * @brief 将图像转换为RGBA格式
+     * @param image 输入图像
+     * @return 转换后的RGBA图像
      */
     static ImageData ConvertToRGBA(const ImageData& image);
 
     /**
-     * @brief ͼǷЧ
-     * @param image ͼ
-     * @return Чtrue򷵻false
+     * @brief 将图像原地转换为RGBA格式，已是RGBA时不做任何操作
+     * @param image 输入输出图像
+     * @return 成功返回true，否则返回false
+     */
+    static bool EnsureRGBA(ImageData& image);
+
+    /**
+     * @brief 检查图像数据是否有效
+     * @param image 图像数据
+     * @return 有效返回true，否则返回false
      */
     static bool IsValid(const ImageData& image);
 
     /**
-     * @brief ͷͼԴ
-     * @param image ͼ
+     * @brief 释放图像资源
+     * @param image 图像数据
      */
     static void FreeImage(ImageData& image);
 
+    /**
+     * @brief 将内存数据写入文件，已存在时覆盖
+     * @param filePath 输出文件路径
+     * @param data 文件内容
+     * @return 成功写入返回true，否则返回false
+     */
+    static bool WriteFileData(const std::string& filePath, const std::vector<uint8_t>& data);
+
 private:
-    // libpng;洦
+    // libpng错误和警告处理函数
     static void PngErrorHandler(png_structp png_ptr, png_const_charp error_msg);
     static void PngWarningHandler(png_structp png_ptr, png_const_charp warning_msg);
 
+    // 当前的PNG编码参数
+    static PngEncodeOptions pngEncodeOptions;
+
+    // 当前的PNG解码参数
+    static PngDecodeOptions pngDecodeOptions;
+
+    /**
+     * @brief 解码内存中的PNG数据，三个加载接口共用
+     * @param pngData PNG数据指针
+     * @param dataSize 数据大小
+     * @param imageData 输出的图像数据
+     * @param readPos 是否读取tEXt块中的坐标信息
+     * @param source 日志中显示的数据来源
+     * @return 成功解码返回true，否则返回false
+     * @note 优先使用PngDecoder快速路径，不支持的格式回退到libpng
+     */
+    static bool DecodePng(const uint8_t* pngData, size_t dataSize, ImageData& imageData,
+        bool readPos, const std::string& source);
+
+    /**
+     * @brief 使用libpng解码内存中的PNG数据
+     * @param pngData PNG数据指针
+     * @param dataSize 数据大小
+     * @param imageData 输出的图像数据
+     * @param comments 非空时输出所有键为comment的文本
+     * @return 成功解码返回true，否则返回false
+     */
+    static bool ReadPngWithLibpng(const uint8_t* pngData, size_t dataSize, ImageData& imageData,
+        std::vector<std::string>* comments);
+
+    /**
+     * @brief 将编码参数应用到libpng写入结构
+     * @param pngPtr png_struct指针
+     * @param options 编码参数
+     */
+    static void ApplyPngEncodeOptions(png_structp pngPtr, const PngEncodeOptions& options);
+
+    /**
+     * @brief 读取PNG像素数据并转换为RGBA
+     * @param pngPtr 已完成png_read_info的png_struct指针
+     * @param infoPtr png_info指针
+     * @param imageData 输出的图像数据
+     * @return 成功读取返回true，否则返回false
+     * @note 调色板、灰度和RGB由PixelKernels按行转换，不使用libpng的填充/扩展变换
+     */
+    static bool ReadPngPixels(png_structp pngPtr, png_infop infoPtr, ImageData& imageData);
+
+    /**
+     * @brief ReadPngPixels的实现，设置跳转点后逐行读取
+     * @param scratch 转换用的临时行缓冲，由调用方持有
+     */
+    static bool ReadPngRows(png_structp pngPtr, png_infop infoPtr, ImageData& imageData, BufferPool::Buffer& scratch);
+
     /**
-     * @brief ʼlibpngȡṹ
-     * @param pngPtr png_structָ
-     * @param infoPtr png_infoָ
-     * @return ɹʼtrue򷵻false
+     * @brief 初始化libpng读取结构
+     * @param pngPtr 输出的png_struct指针
+     * @param infoPtr 输出的png_info指针
+     * @return 成功初始化返回true，否则返回false
      */
     static bool InitPngRead(png_structp& pngPtr, png_infop& infoPtr);
 
     /**
-     * @brief ʼlibpngдṹ
-     * @param pngPtr png_structָ
-     * @param infoPtr png_infoָ
-     * @return ɹʼtrue򷵻false
+     * @brief 初始化libpng写入结构
+     * @param pngPtr 输出的png_struct指针
+     * @param infoPtr 输出的png_info指针
+     * @return 成功初始化返回true，否则返回false
      */
     static bool InitPngWrite(png_structp& pngPtr, png_infop& infoPtr);
 
     /**
-     * @brief libpngȡṹ
-     * @param pngPtr png_structָ
-     * @param infoPtr png_infoָ
-     * @param rowPointers ָ
+     * @brief 清理libpng读取结构
+     * @param pngPtr png_struct指针
+     * @param infoPtr png_info指针
+     * @param rowPointers 行指针数组
      */
     static void CleanupPngRead(png_structp pngPtr, png_infop infoPtr, png_bytep* rowPointers = nullptr);
 
     /**
-     * @brief libpngдṹ
-     * @param pngPtr png_structָ
-     * @param infoPtr png_infoָ
+     * @brief 清理libpng写入结构
+     * @param pngPtr png_struct指针
+     * @param infoPtr png_info指针
      */
     static void CleanupPngWrite(png_structp pngPtr, png_infop infoPtr);
 };
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+// 输出索引、服务响应等JSON文本时使用的辅助函数
+class Json {
+public:
+    /**
+     * @brief 转义字符串，用于JSON字符串值
+     * @param text 原始字符串，非ASCII字符原样保留
+     * @return 转义后的字符串，不含两侧引号
+     */
+    static std::string Escape(const std::string& text) {
+        std::string result;
+        for (char c : text) {
+            switch (c) {
+            case '"': result += "\\\""; break;
+            case '\\': result += "\\\\"; break;
+            case '\n': result += "\\n"; break;
+            case '\r': result += "\\r"; break;
+            case '\t': result += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buffer[8];
+                    snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<int>(c));
+                    result += buffer;
+                }
+                else {
+                    result += c;
+                }
+            }
+        }
+        return result;
+    }
+};
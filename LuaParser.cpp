@@ -1,67 +1,184 @@
 #include "LuaParser.h"
+#include "Checksum.h"
 #include "Config.h"
+#include "MappedFile.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <vector>
 
 LuaParser::LuaParser() : L(nullptr), isLoaded(false) {
-    L = luaL_newstate();
+}
+
+bool LuaParser::ensureState() {
+    // 坐标表通常按字面量解析，只有回退到执行脚本时才创建状态机
     if (L) {
-        luaL_openlibs(L);
+        return true;
     }
-    else {
-        Logger::Error("Lua״̬ʼʧ");
+    L = luaL_newstate();
+    if (!L) {
+        Logger::Error("Lua状态机初始化失败");
+        return false;
+    }
+    luaL_openlibs(L);
+    return true;
+}
+
+void LuaParser::resetGroups() {
+    indexFields.clear();
+    expandedGroups.clear();
+    nameIndexBuilt = false;
+    groupPos.clear();
+}
+
+bool LuaParser::loadTable(const char* data, size_t size, const std::string& name) {
+    tableLoaded = false;
+    if (!fastPathEnabled) {
+        return false;
     }
+    if (!table.Parse(data, size)) {
+        Logger::Debug("无法按字面量解析 (" + table.Error() + ")，改为通过Lua执行: " + name);
+        return false;
+    }
+    tableLoaded = true;
+    return true;
 }
 
 LuaParser::~LuaParser() {
     if (L) {
         lua_close(L);
         L = nullptr;
-        Logger::Debug("Lua״̬ر");
+        Logger::Debug("Lua状态机关闭");
     }
 }
 
 bool LuaParser::loadLuaFile(const std::string& path) {
-    Logger::Debug("ԼLuaļ: " + path);
+    Logger::Debug("尝试加载Lua文件: " + path);
+    resetGroups();
+
+    MappedFile file;
+    const bool mapped = (fastPathEnabled || !indexDirectory.empty()) && file.Open(path);
+    if (mapped && openIndex(reinterpret_cast<const char*>(file.data()), file.size())) {
+        currentFilePath = path;
+        isLoaded = true;
+        Logger::Info("已加载坐标索引: " + path);
+        return true;
+    }
+    if (mapped && loadTable(reinterpret_cast<const char*>(file.data()), file.size(), path)) {
+        currentFilePath = path;
+        isLoaded = true;
+        Logger::Info("Lua文件加载成功: " + path);
+        writeIndex();
+        return true;
+    }
 
-    if (!L) {
-        Logger::Error("Lua״̬δʼ");
+    if (!ensureState()) {
         return false;
     }
 
     int result = luaL_dofile(L, path.c_str());
     if (result != LUA_OK) {
-        Logger::Error("Luaļʧ: " + path);
-        Logger::Error("Ϣ: " + std::string(lua_tostring(L, -1)));
+        Logger::Error("Lua文件加载失败: " + path);
+        Logger::Error("错误信息: " + std::string(lua_tostring(L, -1)));
         lua_pop(L, 1);
         return false;
     }
 
     currentFilePath = path;
     isLoaded = true;
-    Logger::Info("Luaļسɹ: " + path);
+    Logger::Info("Lua文件加载成功: " + path);
+    if (mapped) {
+        writeIndex();
+    }
+    return true;
+}
+
+bool LuaParser::loadLuaBuffer(const char* data, size_t size, const std::string& name) {
+    Logger::Debug("尝试从内存加载Lua脚本: " + name);
+    resetGroups();
+
+    if (openIndex(data, size)) {
+        currentFilePath.clear();
+        isLoaded = true;
+        Logger::Info("已加载坐标索引: " + name);
+        return true;
+    }
+    if (loadTable(data, size, name)) {
+        currentFilePath.clear();
+        isLoaded = true;
+        Logger::Info("Lua脚本加载成功: " + name);
+        writeIndex();
+        return true;
+    }
+
+    if (!ensureState()) {
+        return false;
+    }
+
+    std::string chunkName = "=" + name;
+    int result = luaL_loadbuffer(L, data, size, chunkName.c_str());
+    if (result == LUA_OK) {
+        result = lua_pcall(L, 0, LUA_MULTRET, 0);
+    }
+    if (result != LUA_OK) {
+        Logger::Error("Lua脚本加载失败: " + name);
+        Logger::Error("错误信息: " + std::string(lua_tostring(L, -1)));
+        lua_pop(L, 1);
+        return false;
+    }
+
+    currentFilePath.clear();
+    isLoaded = true;
+    Logger::Info("Lua脚本加载成功: " + name);
+    writeIndex();
     return true;
 }
 
 bool LuaParser::parseFgPos() {
-    Logger::Debug("Խfgpos");
+    Logger::Debug("尝试解析fgpos表");
 
     if (!isLoaded) {
-        Logger::Error("Luaļδ");
+        Logger::Error("Lua文件未加载");
         return false;
     }
 
+    int groupCount = 0;
+    int fileCount = 0;
+
+    if (indexLoaded) {
+        fgPos.clear();
+        for (uint32_t i = 0; i < posIndex.GroupCount(); i++) {
+            const FgPosIndex::Group& group = posIndex.GroupAt(i);
+            expandIndexGroup(i, fgPos[std::string(posIndex.Name(group.nameOffset, group.nameLength))]);
+            fileCount += group.fileCount;
+            groupCount++;
+        }
+        Logger::Info("fgpos解析完成，包含" + std::to_string(groupCount) + "个组，" + std::to_string(fileCount) + "个文件");
+        return true;
+    }
+
+    if (tableLoaded) {
+        fgPos.clear();
+        for (const FgPosTable::Group& group : table.Groups()) {
+            PosMap posMap;
+            fileCount += mergeTableGroup(group, posMap);
+            fgPos[std::string(table.Name(group.nameOffset, group.nameLength))] = std::move(posMap);
+            groupCount++;
+        }
+        Logger::Info("fgpos解析完成，包含" + std::to_string(groupCount) + "个组，" + std::to_string(fileCount) + "个文件");
+        return true;
+    }
+
     lua_getglobal(L, "fgpos");
     if (!lua_istable(L, -1)) {
-        Logger::Error("fgposǱδҵ");
+        Logger::Error("fgpos不是表或未找到");
         lua_pop(L, 1);
         return false;
     }
 
-    int groupCount = 0;
-    int fileCount = 0;
     fgPos.clear();
 
     lua_pushnil(L);
@@ -72,7 +189,7 @@ bool LuaParser::parseFgPos() {
         }
 
         std::string groupName = lua_tostring(L, -2);
-        Logger::Debug(": " + groupName);
+        Logger::Debug("解析组: " + groupName);
 
         if (lua_istable(L, -1)) {
             PosMap posMap;
@@ -100,56 +217,84 @@ bool LuaParser::parseFgPos() {
 
                             posMap[fileName] = Pos(x, y);
                             currontFileCount++;
-                            Logger::Debug("ļ: " + fileName + 
-                                ": (" + std::to_string(x) + 
+                            Logger::Debug("解析文件: " + fileName + 
+                                "，坐标: (" + std::to_string(x) + 
                                 ", " + std::to_string(y) + ")");
                         }
                         else {
                             lua_pop(L, 1);
-                            Logger::Warning("ļ" + fileName + "ȱy");
+                            Logger::Warning("文件" + fileName + "缺少y坐标");
                         }
                     }
                     else {
                         lua_pop(L, 1);
-                        Logger::Warning("ļ" + fileName + "ȱx");
+                        Logger::Warning("文件" + fileName + "缺少x坐标");
                     }
                 }
 
                 lua_pop(L, 1);
             }
 
-            fgPos[groupName] = std::move(posMap); // ʹƶ
+            fgPos[groupName] = std::move(posMap); // 使用移动语义
             groupCount++;
             fileCount += currontFileCount;
-            Logger::Debug("" + groupName + "ɣ" + std::to_string(currontFileCount) + "ļ");
+            Logger::Debug("组" + groupName + "解析完成，包含" + std::to_string(currontFileCount) + "个文件");
         }
 
         lua_pop(L, 1);
     }
 
     lua_pop(L, 1);
-    Logger::Info("fgposɣ" + std::to_string(groupCount) + "飬" + std::to_string(fileCount) + "ļ");
+    Logger::Info("fgpos解析完成，包含" + std::to_string(groupCount) + "个组，" + std::to_string(fileCount) + "个文件");
     return true;
 }
 
 bool LuaParser::parseGroup(const std::string& group) {
-    Logger::Debug("Խ: " + group);
+    Logger::Debug("尝试解析组: " + group);
 
     if (!isLoaded) {
-        Logger::Error("Luaļδ");
+        Logger::Error("Lua文件未加载");
+        return false;
+    }
+
+    if (indexLoaded) {
+        const int32_t indexGroup = posIndex.FindGroup(group);
+        if (indexGroup >= 0) {
+            PosMap posMap;
+            expandIndexGroup(indexGroup, posMap);
+            const int fileCount = static_cast<int>(posMap.size());
+            fgPos[group] = std::move(posMap);
+            Logger::Info("组" + group + "解析完成，包含" + std::to_string(fileCount) + "个文件");
+            return true;
+        }
+        Logger::Error("组" + group + "未找到或不是表");
+        return false;
+    }
+
+    if (tableLoaded) {
+        for (const FgPosTable::Group& tableGroup : table.Groups()) {
+            if (table.Name(tableGroup.nameOffset, tableGroup.nameLength) == group) {
+                PosMap posMap;
+                int fileCount = mergeTableGroup(tableGroup, posMap);
+                fgPos[group] = std::move(posMap);
+                Logger::Info("组" + group + "解析完成，包含" + std::to_string(fileCount) + "个文件");
+                return true;
+            }
+        }
+        Logger::Error("组" + group + "未找到或不是表");
         return false;
     }
 
     lua_getglobal(L, "fgpos");
     if (!lua_istable(L, -1)) {
-        Logger::Error("fgposǱδҵ");
+        Logger::Error("fgpos不是表或未找到");
         lua_pop(L, 1);
         return false;
     }
 
     lua_getfield(L, -1, group.c_str());
     if (!lua_istable(L, -1)) {
-        Logger::Error("" + group + "δҵǱ");
+        Logger::Error("组" + group + "未找到或不是表");
         lua_pop(L, 2);
         return false;
     }
@@ -177,149 +322,444 @@ bool LuaParser::parseGroup(const std::string& group) {
                     int y = lua_tointeger(L, -1);
                     lua_pop(L, 1);
 
-                    // ͻ
+                    // 检测冲突
                     if (posMap.find(fileName) != posMap.end()) {
-                        Logger::Warning("ͬļͻ: " + fileName);
+                        Logger::Warning("同名文件冲突: " + fileName);
                     }
 
                     posMap[fileName] = Pos(x, y);
                     fileCount++;
-                    Logger::Debug("ļ: " + fileName + ": (" + std::to_string(x) + ", " + std::to_string(y) + ")");
+                    Logger::Debug("解析文件: " + fileName + "，坐标: (" + std::to_string(x) + ", " + std::to_string(y) + ")");
                 }
                 else {
                     lua_pop(L, 1);
-                    Logger::Warning("ļ" + fileName + "ȱy");
+                    Logger::Warning("文件" + fileName + "缺少y坐标");
                 }
             }
             else {
                 lua_pop(L, 1);
-                Logger::Warning("ļ" + fileName + "ȱx");
+                Logger::Warning("文件" + fileName + "缺少x坐标");
             }
         }
 
         lua_pop(L, 1);
     }
 
-    fgPos[group] = std::move(posMap); // ʹƶ
+    fgPos[group] = std::move(posMap); // 使用移动语义
     lua_pop(L, 2);
-    Logger::Info("" + group + "ɣ" + std::to_string(fileCount) + "ļ");
+    Logger::Info("组" + group + "解析完成，包含" + std::to_string(fileCount) + "个文件");
     return true;
 }
 
 bool LuaParser::parseGroups(const std::string& field) {
-    Logger::Debug("Խֶ: " + field + "ƥ");
+    return parseGroups(std::vector<std::string>{ field });
+}
 
+bool LuaParser::parseGroups(const std::vector<std::string>& fields) {
     if (!isLoaded) {
-        Logger::Error("Luaļδ");
+        Logger::Error("Lua文件未加载");
+        return false;
+    }
+    if (!buildNameIndex()) {
         return false;
     }
 
-    lua_getglobal(L, "fgpos");
-    if (!lua_istable(L, -1)) {
-        Logger::Error("fgposǱδҵ");
+    // 先在组名索引中查出各字段匹配的组，再一次提取用到的所有组
+    std::vector<std::vector<uint32_t>> matches;
+    std::vector<bool> needed(nameIndex.Size(), false);
+    matches.reserve(fields.size());
+    for (const std::string& field : fields) {
+        Logger::Debug("尝试解析字段: " + field + "匹配的所有组");
+        matches.push_back(nameIndex.FindSubstring(field));
+        for (uint32_t group : matches.back()) {
+            needed[group] = true;
+        }
+    }
+
+    // 索引模式下坐标直接从映射中查找，不需要提取
+    if (tableLoaded) {
+        const auto& groups = table.Groups();
+        for (uint32_t i = 0; i < nameIndex.Size(); i++) {
+            std::string groupName(nameIndex.NameAt(i));
+            if (needed[i] && groupPos.find(groupName) == groupPos.end()) {
+                mergeTableGroup(groups[i], groupPos[groupName]);
+            }
+        }
+    }
+    else if (!indexLoaded) {
+        std::unordered_map<std::string_view, uint32_t> pending;
+        for (uint32_t i = 0; i < nameIndex.Size(); i++) {
+            if (needed[i] && groupPos.find(std::string(nameIndex.NameAt(i))) == groupPos.end()) {
+                pending[nameIndex.NameAt(i)] = i;
+            }
+        }
+        if (!pending.empty()) {
+            lua_getglobal(L, "fgpos");
+            lua_pushnil(L);
+            while (lua_next(L, -2) != 0) {
+                if (lua_isstring(L, -2) && lua_istable(L, -1)) {
+                    // 复制键再转换，避免数字键被原地改为字符串而打断遍历
+                    lua_pushvalue(L, -2);
+                    std::string groupName = lua_tostring(L, -1);
+                    lua_pop(L, 1);
+                    if (pending.find(groupName) != pending.end()) {
+                        Logger::Debug("匹配到组: " + groupName);
+                        readLuaGroup(groupPos[groupName]);
+                    }
+                }
+                lua_pop(L, 1);
+            }
+            lua_pop(L, 1);
+        }
+    }
+
+    for (size_t i = 0; i < fields.size(); i++) {
+        const std::string& field = fields[i];
+        const std::vector<uint32_t>& matched = matches[i];
+        if (matched.empty()) {
+            Logger::Warning("未找到匹配的字段: " + field);
+            continue;
+        }
+
+        size_t fileCount = 0;
+        if (indexLoaded) {
+            for (uint32_t group : matched) {
+                fileCount += posIndex.GroupAt(group).fileCount;
+            }
+            fgPos.erase(field);
+            expandedGroups.erase(field);
+            indexFields[field] = matched;
+        }
+        else {
+            // 同名文件以靠后的组为准
+            PosMap posMap;
+            for (uint32_t group : matched) {
+                const PosMap& groupMap = groupPos[std::string(nameIndex.NameAt(group))];
+                fileCount += groupMap.size();
+                for (const auto& [fileName, pos] : groupMap) {
+                    posMap[fileName] = pos;
+                }
+            }
+            fgPos[field] = std::move(posMap); // 使用移动语义
+        }
+        Logger::Info("字段" + field + "匹配的组解析完成，包含" + std::to_string(matched.size()) + "个组，" + std::to_string(fileCount) + "个文件");
+    }
+    return true;
+}
+
+bool LuaParser::buildNameIndex() {
+    if (nameIndexBuilt) {
+        return true;
+    }
+
+    nameIndex.Clear();
+    if (indexLoaded) {
+        for (uint32_t i = 0; i < posIndex.GroupCount(); i++) {
+            const FgPosIndex::Group& group = posIndex.GroupAt(i);
+            nameIndex.Add(posIndex.Name(group.nameOffset, group.nameLength));
+        }
+    }
+    else if (tableLoaded) {
+        for (const FgPosTable::Group& group : table.Groups()) {
+            nameIndex.Add(table.Name(group.nameOffset, group.nameLength));
+        }
+    }
+    else {
+        lua_getglobal(L, "fgpos");
+        if (!lua_istable(L, -1)) {
+            Logger::Error("fgpos不是表或未找到");
+            lua_pop(L, 1);
+            return false;
+        }
+        lua_pushnil(L);
+        while (lua_next(L, -2) != 0) {
+            if (lua_isstring(L, -2) && lua_istable(L, -1)) {
+                lua_pushvalue(L, -2);
+                nameIndex.Add(lua_tostring(L, -1));
+                lua_pop(L, 1);
+            }
+            lua_pop(L, 1);
+        }
         lua_pop(L, 1);
-        return false;
     }
 
-    int groupCount = 0;
-    int fileCount = 0;
-    PosMap posMap;
+    nameIndex.Build();
+    nameIndexBuilt = true;
+    Logger::Debug("组名索引建立完成，包含" + std::to_string(nameIndex.Size()) + "个组");
+    return true;
+}
 
+int LuaParser::readLuaGroup(PosMap& posMap) {
+    int fileCount = 0;
     lua_pushnil(L);
     while (lua_next(L, -2) != 0) {
-        if (!lua_isstring(L, -2)) {
+        if (lua_isstring(L, -2) && lua_istable(L, -1)) {
+            lua_pushvalue(L, -2);
+            std::string fileName = lua_tostring(L, -1);
             lua_pop(L, 1);
-            continue;
-        }
 
-        std::string groupName = lua_tostring(L, -2);
-        if (groupName.find(field) != std::string::npos) {
-            Logger::Debug("ƥ䵽: " + groupName);
+            lua_getfield(L, -1, "x");
+            lua_getfield(L, -2, "y");
+            if (!lua_isnumber(L, -2)) {
+                Logger::Warning("文件" + fileName + "缺少x坐标");
+            }
+            else if (!lua_isnumber(L, -1)) {
+                Logger::Warning("文件" + fileName + "缺少y坐标");
+            }
+            else {
+                posMap[fileName] = Pos(static_cast<int>(lua_tointeger(L, -2)), static_cast<int>(lua_tointeger(L, -1)));
+                fileCount++;
+            }
+            lua_pop(L, 2);
+        }
+        lua_pop(L, 1);
+    }
+    return fileCount;
+}
 
-            if (lua_istable(L, -1)) {
-                lua_pushnil(L);
-                while (lua_next(L, -2) != 0) {
-                    if (!lua_isstring(L, -2)) {
-                        lua_pop(L, 1);
-                        continue;
-                    }
+int LuaParser::mergeTableGroup(const FgPosTable::Group& group, PosMap& posMap) const {
+    int fileCount = 0;
+    const auto& entries = table.Entries();
+    for (uint32_t i = group.firstEntry; i < group.firstEntry + group.entryCount; i++) {
+        const FgPosTable::Entry& entry = entries[i];
+        std::string fileName(table.Name(entry.nameOffset, entry.nameLength));
+        if (!entry.hasX) {
+            Logger::Warning("文件" + fileName + "缺少x坐标");
+            continue;
+        }
+        if (!entry.hasY) {
+            Logger::Warning("文件" + fileName + "缺少y坐标");
+            continue;
+        }
+        posMap[fileName] = Pos(entry.x, entry.y);
+        fileCount++;
+    }
+    return fileCount;
+}
 
-                    std::string fileName = lua_tostring(L, -2);
-                    if (lua_istable(L, -1)) {
-                        lua_getfield(L, -1, "x");
-                        if (lua_isnumber(L, -1)) {
-                            int x = lua_tointeger(L, -1);
-                            lua_pop(L, 1);
+bool LuaParser::Benchmark(const std::string& path, int iterations) {
+    // 两种方式分别完整加载并解析整个fgpos表，期间只输出错误，坐标缺失等警告不重复输出
+    const Logger::Level savedLevel = Logger::GetLevel();
+    double elapsed[2] = { 0.0, 0.0 };
+    bool succeeded[2] = { true, true };
+    FgPos results[2];
+
+    Logger::SetLevel(Logger::Level::ERROR);
+    for (int mode = 0; mode < 2; mode++) {
+        for (int i = 0; i < iterations && succeeded[mode]; i++) {
+            auto startTime = std::chrono::steady_clock::now();
+            LuaParser parser;
+            parser.setFastPathEnabled(mode == 0);
+            succeeded[mode] = parser.loadLuaFile(path) && parser.parseFgPos() && (mode == 1 || parser.tableLoaded);
+            elapsed[mode] += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+            if (succeeded[mode] && i == 0) {
+                results[mode] = parser.fgPos;
+            }
+        }
+    }
+    Logger::SetLevel(savedLevel);
 
-                            lua_getfield(L, -1, "y");
-                            if (lua_isnumber(L, -1)) {
-                                int y = lua_tointeger(L, -1);
-                                lua_pop(L, 1);
-
-                                posMap[fileName] = Pos(x, y);
-                                fileCount++;
-                                Logger::Debug("ļ: " + fileName + ": (" + std::to_string(x) + ", " + std::to_string(y) + ")");
-                            }
-                            else {
-                                lua_pop(L, 1);
-                                Logger::Warning("ļ" + fileName + "ȱy");
-                            }
-                        }
-                        else {
-                            lua_pop(L, 1);
-                            Logger::Warning("ļ" + fileName + "ȱx");
-                        }
-                    }
-                    lua_pop(L, 1);
+    const char* modeNames[2] = { "字面量解析", "Lua执行" };
+    for (int mode = 0; mode < 2; mode++) {
+        if (succeeded[mode]) {
+            Logger::Info(std::string(modeNames[mode]) + ": 平均 " + std::to_string(elapsed[mode] / iterations) + " ms");
+        }
+        else {
+            Logger::Warning(std::string(modeNames[mode]) + ": 失败");
+        }
+    }
+    if (succeeded[0] && succeeded[1]) {
+        size_t fileCount = 0;
+        for (const auto& [groupName, posMap] : results[0]) {
+            fileCount += posMap.size();
+        }
+        Logger::Info("共 " + std::to_string(results[0].size()) + " 个组, " + std::to_string(fileCount) +
+            " 个文件, 加速 " + std::to_string(elapsed[1] / elapsed[0]) + " 倍");
+
+        // 逐项对比两种方式的结果
+        bool same = results[0].size() == results[1].size();
+        for (const auto& [groupName, posMap] : results[0]) {
+            auto it = results[1].find(groupName);
+            if (!same || it == results[1].end() || it->second.size() != posMap.size()) {
+                same = false;
+                break;
+            }
+            for (const auto& [fileName, pos] : posMap) {
+                auto fileIt = it->second.find(fileName);
+                if (fileIt == it->second.end() || fileIt->second.x != pos.x || fileIt->second.y != pos.y) {
+                    same = false;
+                    break;
                 }
             }
-            groupCount++;
         }
-        lua_pop(L, 1);
+        if (same) {
+            Logger::Info("两种方式的解析结果一致");
+        }
+        else {
+            Logger::Warning("两种方式的解析结果不一致");
+        }
     }
-    lua_pop(L, 1);
+    return succeeded[0] || succeeded[1];
+}
 
-    if (groupCount == 0) {
-        Logger::Warning("δҵƥֶ: " + field);
+bool LuaParser::openIndex(const char* data, size_t size) {
+    indexLoaded = false;
+    if (indexDirectory.empty()) {
+        return false;
+    }
+    sourceHash = Checksum::Hash64(reinterpret_cast<const uint8_t*>(data), size);
+    sourceSize = size;
+    indexLoaded = posIndex.Open(indexFilePath(), sourceHash, sourceSize);
+    return indexLoaded;
+}
+
+void LuaParser::writeIndex() {
+    if (indexDirectory.empty()) {
+        return;
+    }
+
+    // 字面量解析按源文件中的顺序建立，Lua执行时顺序由遍历决定
+    std::vector<FgPosIndex::SourceGroup> groups;
+    if (tableLoaded) {
+        for (const FgPosTable::Group& group : table.Groups()) {
+            PosMap posMap;
+            mergeTableGroup(group, posMap);
+            FgPosIndex::SourceGroup& source = groups.emplace_back();
+            source.name = table.Name(group.nameOffset, group.nameLength);
+            for (const auto& [fileName, pos] : posMap) {
+                source.files.push_back({ fileName, pos.x, pos.y });
+            }
+        }
     }
     else {
-        fgPos[field] = std::move(posMap); // ʹƶ
-        Logger::Info("ֶ" + field + "ƥɣ" + std::to_string(groupCount) + "飬" + std::to_string(fileCount) + "ļ");
+        if (!parseFgPos()) {
+            return;
+        }
+        for (const auto& [groupName, posMap] : fgPos) {
+            FgPosIndex::SourceGroup& source = groups.emplace_back();
+            source.name = groupName;
+            for (const auto& [fileName, pos] : posMap) {
+                source.files.push_back({ fileName, pos.x, pos.y });
+            }
+        }
+        fgPos.clear();
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(indexDirectory, ec);
+    const std::string path = indexFilePath();
+    if (FgPosIndex::Write(path, sourceHash, sourceSize, groups) && posIndex.Open(path, sourceHash, sourceSize)) {
+        indexLoaded = true;
+        tableLoaded = false;
+    }
+}
+
+std::string LuaParser::indexFilePath() const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.fgidx", static_cast<unsigned long long>(sourceHash));
+    return (std::filesystem::path(indexDirectory) / name).string();
+}
+
+bool LuaParser::hasIndexedGroup(const std::string& group) const {
+    return indexFields.find(group) != indexFields.end() || posIndex.FindGroup(group) >= 0;
+}
+
+const FgPosIndex::File* LuaParser::findIndexedFile(const std::string& group, const std::string& file) const {
+    auto fieldIt = indexFields.find(group);
+    if (fieldIt != indexFields.end()) {
+        for (auto it = fieldIt->second.rbegin(); it != fieldIt->second.rend(); ++it) {
+            if (const FgPosIndex::File* entry = posIndex.FindFile(*it, file)) {
+                return entry;
+            }
+        }
+        return nullptr;
+    }
+    const int32_t indexGroup = posIndex.FindGroup(group);
+    return indexGroup >= 0 ? posIndex.FindFile(indexGroup, file) : nullptr;
+}
+
+bool LuaParser::expandIndexed(const std::string& group, PosMap& posMap) const {
+    auto fieldIt = indexFields.find(group);
+    if (fieldIt != indexFields.end()) {
+        for (uint32_t indexGroup : fieldIt->second) {
+            expandIndexGroup(indexGroup, posMap);
+        }
+        return true;
+    }
+    const int32_t indexGroup = posIndex.FindGroup(group);
+    if (indexGroup < 0) {
+        return false;
     }
+    expandIndexGroup(indexGroup, posMap);
     return true;
 }
 
+void LuaParser::expandIndexGroup(uint32_t group, PosMap& posMap) const {
+    const FgPosIndex::Group& indexGroup = posIndex.GroupAt(group);
+    for (uint32_t i = 0; i < indexGroup.fileCount; i++) {
+        const FgPosIndex::File& file = posIndex.FileAt(indexGroup.firstFile + i);
+        posMap[std::string(posIndex.Name(file.nameOffset, file.nameLength))] = Pos(file.x, file.y);
+    }
+}
+
 const PosMap* LuaParser::getGroupPos(const std::string& group) const {
     auto it = fgPos.find(group);
     if (it == fgPos.end()) {
-        return nullptr;
+        auto groupIt = groupPos.find(group);
+        if (groupIt != groupPos.end()) {
+            return &(groupIt->second);
+        }
+        if (!indexLoaded) {
+            return nullptr;
+        }
+        auto expandedIt = expandedGroups.find(group);
+        if (expandedIt == expandedGroups.end()) {
+            PosMap posMap;
+            if (!expandIndexed(group, posMap)) {
+                return nullptr;
+            }
+            expandedIt = expandedGroups.emplace(group, std::move(posMap)).first;
+        }
+        return &(expandedIt->second);
     }
-    return &(it->second); // ָ룬⿽
+    return &(it->second); // 返回指针，避免拷贝
 }
 
 const std::pair<int, int> LuaParser::getFilePos(const std::string& group, const std::string& file) const {
     auto groupIt = fgPos.find(group);
+    if (groupIt == fgPos.end() && indexLoaded && hasIndexedGroup(group)) {
+        // 索引查找不分配字符串，只在调试级别拼接日志
+        const FgPosIndex::File* entry = findIndexedFile(group, file);
+        if (!entry) {
+            Logger::Error("文件" + file + "未找到");
+            return { 0, 0 };
+        }
+        if (Logger::GetLevel() == Logger::Level::DEBUG) {
+            Logger::Debug("获取文件位置: " + group + "/" + file + " -> (" + std::to_string(entry->x) + "," + std::to_string(entry->y) + ")");
+        }
+        return { entry->x, entry->y };
+    }
     if (groupIt == fgPos.end()) {
-        Logger::Error("" + group + "δҵ");
+        Logger::Error("组" + group + "未找到");
         return { 0, 0 };
     }
     auto fileIt = groupIt->second.find(file);
     if (fileIt == groupIt->second.end()) {
-        Logger::Error("ļ" + file + "δҵ");
+        Logger::Error("文件" + file + "未找到");
         return { 0, 0 };
     }
-    Logger::Debug("ȡļλ: " + group + "/" + file + " -> (" + std::to_string(fileIt->second.x) + "," + std::to_string(fileIt->second.y) + ")");
+    Logger::Debug("获取文件位置: " + group + "/" + file + " -> (" + std::to_string(fileIt->second.x) + "," + std::to_string(fileIt->second.y) + ")");
     return  { fileIt->second.x, fileIt->second.y };
 }
 
 bool LuaParser::hasGroup(const std::string& group) const {
-    return fgPos.find(group) != fgPos.end();
+    return fgPos.find(group) != fgPos.end() || (indexLoaded && hasIndexedGroup(group));
 }
 
 bool LuaParser::hasFile(const std::string& group, const std::string& file) const {
     auto groupIt = fgPos.find(group);
     if (groupIt == fgPos.end()) {
-        return false;
+        return indexLoaded && findIndexedFile(group, file) != nullptr;
     }
     return groupIt->second.find(file) != groupIt->second.end();
 }
@@ -331,6 +771,11 @@ std::vector<std::string> LuaParser::getGroupNames() const {
     for (const auto& pair : fgPos) {
         names.push_back(pair.first);
     }
+    for (const auto& pair : indexFields) {
+        if (fgPos.find(pair.first) == fgPos.end()) {
+            names.push_back(pair.first);
+        }
+    }
 
     return names;
 }
@@ -345,31 +790,50 @@ std::vector<std::string> LuaParser::getFileNames(const std::string& group) const
             names.push_back(pair.first);
         }
     }
+    else if (const PosMap* posMap = indexLoaded ? getGroupPos(group) : nullptr) {
+        names.reserve(posMap->size());
+        for (const auto& pair : *posMap) {
+            names.push_back(pair.first);
+        }
+    }
 
     return names;
 }
 
 void LuaParser::setFilePos(const std::string& group, const std::string& file, const Pos& pos) {
     bool existed = hasFile(group, file);
+
+    // 修改索引中的组时先展开，之后该组从映射表中查找
+    if (indexLoaded && fgPos.find(group) == fgPos.end()) {
+        expandIndexed(group, fgPos[group]);
+        expandedGroups.erase(group);
+    }
     fgPos[group][file] = pos;
 
     if (existed) {
-        Logger::Debug("ļλ: " + group + "/" + file + " -> (" + std::to_string(pos.x) + "," + std::to_string(pos.y) + ")");
+        Logger::Debug("更新文件位置: " + group + "/" + file + " -> (" + std::to_string(pos.x) + "," + std::to_string(pos.y) + ")");
     }
     else {
-        Logger::Debug("ļλ: " + group + "/" + file + " -> (" + std::to_string(pos.x) + "," + std::to_string(pos.y) + ")");
+        Logger::Debug("添加文件位置: " + group + "/" + file + " -> (" + std::to_string(pos.x) + "," + std::to_string(pos.y) + ")");
     }
 }
 
 bool LuaParser::saveToFile(const std::string& path) {
     std::string savePath = path.empty() ? currentFilePath : path;
-    Logger::Debug("ԱLuaļ: " + savePath);
+    Logger::Debug("尝试保存Lua文件到: " + savePath);
     if (savePath.empty()) {
-        Logger::Error("δָļ·");
+        Logger::Error("未指定文件路径");
         return false;
     }
 
-    // ʹֱַLua룬ⴴµLua״̬
+    // 索引模式下parseGroups的字段没有合并到映射表，保存前展开
+    for (const auto& pair : indexFields) {
+        if (fgPos.find(pair.first) == fgPos.end()) {
+            expandIndexed(pair.first, fgPos[pair.first]);
+        }
+    }
+
+    // 使用字符串流直接生成Lua代码，避免创建新的Lua状态
     std::stringstream luaCode;
     luaCode << "fgpos = {\n";
 
@@ -388,27 +852,27 @@ bool LuaParser::saveToFile(const std::string& path) {
         }
 
         fileCount += currentFileCount;
-        Logger::Debug("" + groupPair.first + "," + std::to_string(currentFileCount) + "ļ");
+        Logger::Debug("保存组" + groupPair.first + ",包含" + std::to_string(currentFileCount) + "个文件");
         luaCode << "    },\n";
     }
 
     luaCode << "}\n";
 
-    // ֱдļ
+    // 直接写入文件
     std::ofstream file(savePath);
     if (!file.is_open()) {
-        Logger::Error("޷ļд: " + savePath);
+        Logger::Error("无法打开文件进行写入: " + savePath);
         return false;
     }
 
     file << luaCode.str();
     file.close();
 
-    Logger::Info("Luaļɹ" + std::to_string(groupCount) + "飬" + std::to_string(fileCount) + "ļ");
+    Logger::Info("Lua文件保存成功，包含" + std::to_string(groupCount) + "个组，" + std::to_string(fileCount) + "个文件");
     return true;
 }
 
-// 
+// 辅助方法
 bool LuaParser::pushFgPosToLua() {
     lua_newtable(L);
 
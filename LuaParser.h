@@ -1,8 +1,12 @@
 #pragma once
 
 #include "lua.hpp"
+#include "FgPosIndex.h"
+#include "FgPosTable.h"
+#include "GroupNameIndex.h"
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 //fgpos = {
 //	tak_bca = {
@@ -34,98 +38,227 @@ public:
     ~LuaParser();
 
     /**
-    * @brief Luaļ״̬
-    * @param path Luaļ·
-    * @return bool:Ƿسɹ
+    * @brief 加载Lua文件到状态机
+    * @param path Lua文件路径
+    * @return bool:是否加载成功
     */
     bool loadLuaFile(const std::string& path);
 
     /**
-     * @brief Luaļfgpos
-     * @return bool:Ƿɹ
+    * @brief 从内存加载Lua脚本到状态机
+    * @param data 脚本内容
+    * @param size 内容长度
+    * @param name 脚本名称，用于错误信息
+    * @return bool:是否加载成功
+    * @note 用于直接读取归档中的脚本，saveToFile需要另外指定路径
+    */
+    bool loadLuaBuffer(const char* data, size_t size, const std::string& name);
+
+    /**
+     * @brief 解析Lua文件的fgpos表
+     * @return bool:是否解析成功
      */
     bool parseFgPos();
 
     /**
-     * @brief Luaļض
-     * @param group 
-     * @return bool:Ƿɹ
+     * @brief 解析Lua文件的特定组
+     * @param group 组名
+     * @return bool:是否解析成功
      */
     bool parseGroup(const std::string& group);
 
     /**
-     * @brief ƥһӳ
-     * @param field ƥֶ
-     * @return bool:Ƿɹ
+     * @brief 解析多个匹配组至一个映射表
+     * @param field 匹配字段
+     * @return bool:是否解析成功
      */
     bool parseGroups(const std::string& field);
 
     /**
-     * @brief ȡ
-     * @param group 
-     * @return const PosMap*:ӳ
+     * @brief 一次解析多个字段，各字段匹配的组分别合并到以字段为名的映射表
+     * @param fields 匹配字段列表
+     * @return bool:是否解析成功
+     * @note 组名索引只建立一次，用到的组只提取一次；各组的映射表与合并结果并存，可通过getGroupPos按组名获取
+     */
+    bool parseGroups(const std::vector<std::string>& fields);
+
+    /**
+     * @brief 获取整个组的坐标
+     * @param group 组名
+     * @return const PosMap*:坐标映射表
      */
     const PosMap* getGroupPos(const std::string& group) const;
 
     /**
-     * @brief ȡضض
-     * @param group 
-     * @param file ļ
-     * @return pair<int, int>:
+     * @brief 获取特定组的特定坐标
+     * @param group 组名
+     * @param file 文件名
+     * @return pair<int, int>:坐标
      */
     const std::pair<int, int> getFilePos(const std::string& group, const std::string& file) const;
 
     /**
-     * @brief Ƿ
-     * @param group 
-     * @return bool:Ƿ
+     * @brief 检查组是否存在
+     * @param group 组名
+     * @return bool:是否存在
      */
     bool hasGroup(const std::string& group) const;
 
     /**
-     * @brief ضļǷ
-     * @param group 
-     * @param file ļ
-     * @return bool:Ƿ
+     * @brief 检查特定文件是否存在
+     * @param group 组名
+     * @param file 文件名
+     * @return bool:是否存在
      */
     bool hasFile(const std::string& group, const std::string& file) const;
 
     /**
-     * @brief ȡб
-     * @return std::vector<std::string>:б
+     * @brief 获取所有组名的列表
+     * @return std::vector<std::string>:组名列表
      */
     std::vector<std::string> getGroupNames() const;
 
     /**
-     * @brief ȡضļб
-     * @param group 
-     * @return std::vector<std::string>:ļб
+     * @brief 获取特定组中所有文件名的列表
+     * @param group 组名
+     * @return std::vector<std::string>:文件名列表
      */
     std::vector<std::string> getFileNames(const std::string& group) const;
 
     /**
-     * @brief ꣨ڸ£
-     * @param group 
-     * @param file ļ
-     * @param pos 
-     * @note ļڣԶ
+     * @brief 设置坐标（用于更新）
+     * @param group 组名
+     * @param file 文件名
+     * @param pos 坐标
+     * @note 如果文件不存在，会自动创建
      */
     void setFilePos(const std::string& group, const std::string& file, const Pos& pos);
 
     /**
-     * @brief ޸ĻLuaļ
-     * @param path Luaļ·
-     * @return bool:Ƿ񱣴ɹ
+     * @brief 保存修改回Lua文件
+     * @param path Lua文件路径
+     * @return bool:是否保存成功
      */
     bool saveToFile(const std::string& path = "");
 
     bool Loaded() const { return isLoaded; }
 
+    /**
+     * @brief 设置是否优先使用字面量解析器
+     * @param enabled 关闭后总是通过Lua执行脚本，用于对比和排查
+     */
+    void setFastPathEnabled(bool enabled) { fastPathEnabled = enabled; }
+
+    /**
+     * @brief 设置坐标索引目录
+     * @param directory 索引按脚本内容哈希命名保存在此目录，空表示不使用索引
+     * @note 需在加载脚本前设置；找到对应的索引时直接映射，不再解析脚本
+     */
+    void setIndexDirectory(const std::string& directory) { indexDirectory = directory; }
+
+    /**
+     * @brief 对比字面量解析器与Lua执行的加载和解析耗时
+     * @param path Lua文件路径
+     * @param iterations 每种方式的重复次数
+     * @return 至少一种方式成功返回true
+     */
+    static bool Benchmark(const std::string& path, int iterations);
+
 private:
     lua_State* L;
     FgPos fgPos;
     bool isLoaded;
     std::string currentFilePath;
+    FgPosTable table;               // 字面量解析结果
+    bool tableLoaded = false;       // 为true时坐标来自table，不使用Lua状态机
+    bool fastPathEnabled = true;
+    FgPosIndex posIndex;            // 二进制索引，加载后坐标直接从映射中查找
+    bool indexLoaded = false;
+    std::string indexDirectory;
+    uint64_t sourceHash = 0;        // 当前脚本的内容哈希和长度，用于定位索引
+    uint64_t sourceSize = 0;
+    std::unordered_map<std::string, std::vector<uint32_t>> indexFields;    // parseGroups的字段->匹配的索引组
+    mutable FgPos expandedGroups;   // 索引模式下为getGroupPos展开的组
+    GroupNameIndex nameIndex;       // 组名索引，首次按字段解析时建立
+    bool nameIndexBuilt = false;
+    FgPos groupPos;                 // 按字段解析时提取的各组，与fgPos中的合并结果并存
+
+    /**
+     * @brief 创建Lua状态机，只在需要执行脚本时调用
+     * @return 成功返回true
+     */
+    bool ensureState();
+
+    /**
+     * @brief 加载新脚本前清除按字段解析的中间结果
+     */
+    void resetGroups();
+
+    /**
+     * @brief 尝试按字面量解析脚本
+     * @param data 脚本内容
+     * @param size 内容长度
+     * @param name 脚本名称，用于日志
+     * @return 解析成功返回true，失败时应改用Lua执行
+     */
+    bool loadTable(const char* data, size_t size, const std::string& name);
+
+    /**
+     * @brief 把字面量解析得到的一个组合并到坐标映射表
+     * @param group 组
+     * @param posMap 目标映射表
+     * @return 合并的文件数
+     */
+    int mergeTableGroup(const FgPosTable::Group& group, PosMap& posMap) const;
+
+    /**
+     * @brief 建立组名索引，下标与字面量解析或二进制索引中的组下标一致
+     * @return fgpos表不存在时返回false
+     */
+    bool buildNameIndex();
+
+    /**
+     * @brief 读取栈顶的组表到坐标映射表
+     * @param posMap 目标映射表
+     * @return 读取的文件数
+     */
+    int readLuaGroup(PosMap& posMap);
+
+    /**
+     * @brief 按脚本内容查找并映射已有的索引
+     * @param data 脚本内容
+     * @param size 内容长度
+     * @return 找到有效索引返回true
+     */
+    bool openIndex(const char* data, size_t size);
+
+    /**
+     * @brief 脚本解析成功后生成索引并切换为从索引查找
+     */
+    void writeIndex();
+
+    std::string indexFilePath() const;
+
+    /**
+     * @brief 检查组名或parseGroups的字段是否在索引中
+     */
+    bool hasIndexedGroup(const std::string& group) const;
+
+    /**
+     * @brief 在索引中查找文件
+     * @param group 组名或parseGroups的字段
+     * @param file 文件名
+     * @return 文件指针，不存在时返回nullptr
+     * @note 字段匹配多个组时，同名文件以靠后的组为准，与合并到一个映射表的结果一致
+     */
+    const FgPosIndex::File* findIndexedFile(const std::string& group, const std::string& file) const;
+
+    /**
+     * @brief 把索引中的组或字段展开为坐标映射表
+     * @return 组或字段存在返回true
+     */
+    bool expandIndexed(const std::string& group, PosMap& posMap) const;
+    void expandIndexGroup(uint32_t group, PosMap& posMap) const;
 
     bool pushFgPosToLua();
     bool pushPosMapToLua(const PosMap& posMap);
@@ -0,0 +1,231 @@
+#include "MappedFile.h"
+#include <algorithm>
+#include <cerrno>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& filePath, bool readAhead) {
+    Close();
+
+    // 允许其他进程读取，并允许在映射期间替换文件
+    HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    opened = true;
+    if (fileSize.QuadPart == 0) {
+        return true;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        Close();
+        return false;
+    }
+    mappingHandle = mapping;
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        Close();
+        return false;
+    }
+
+    mappedData = static_cast<const uint8_t*>(view);
+    mappedSize = static_cast<size_t>(fileSize.QuadPart);
+    return true;
+}
+
+void MappedFile::Prefetch(const std::string& filePath) {
+    // 以顺序读取方式打开会触发系统预读，读入一页即可启动
+    HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    char buffer[4096];
+    DWORD bytesRead = 0;
+    ReadFile(file, buffer, sizeof(buffer), &bytesRead, nullptr);
+    CloseHandle(file);
+}
+
+bool MappedFile::ReadAll(const std::string& filePath, BufferPool::Buffer& buffer) {
+    HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    // ReadFile单次最多读取DWORD长度，分段读取
+    const size_t size = static_cast<size_t>(fileSize.QuadPart);
+    buffer.Allocate(size);
+    size_t offset = 0;
+    while (offset < size) {
+        DWORD bytesRead = 0;
+        const DWORD chunk = static_cast<DWORD>(std::min<size_t>(size - offset, 1u << 30));
+        if (!ReadFile(file, buffer.data() + offset, chunk, &bytesRead, nullptr) || bytesRead == 0) {
+            break;
+        }
+        offset += bytesRead;
+    }
+    CloseHandle(file);
+    return offset == size;
+}
+
+void MappedFile::PrefetchRange(size_t offset, size_t size) const {
+    if (!mappedData || offset >= mappedSize) {
+        return;
+    }
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = const_cast<uint8_t*>(mappedData + offset);
+    range.NumberOfBytes = std::min(size, mappedSize - offset);
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+void MappedFile::Close() {
+    if (mappedData) {
+        UnmapViewOfFile(mappedData);
+    }
+    if (mappingHandle) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle) {
+        CloseHandle(fileHandle);
+    }
+    mappedData = nullptr;
+    mappedSize = 0;
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+    opened = false;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& filePath, bool readAhead) {
+    Close();
+
+    int fd = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+
+    opened = true;
+    if (info.st_size == 0) {
+        close(fd);
+        return true;
+    }
+
+    // 映射建立后即可关闭文件描述符
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) {
+        opened = false;
+        return false;
+    }
+
+    // 解码器从头到尾读取整个文件，提前发起预读
+    if (readAhead) {
+        madvise(view, static_cast<size_t>(info.st_size), MADV_WILLNEED);
+    }
+
+    mappedData = static_cast<const uint8_t*>(view);
+    mappedSize = static_cast<size_t>(info.st_size);
+    return true;
+}
+
+void MappedFile::Prefetch(const std::string& filePath) {
+    int fd = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    // 预读请求在关闭描述符后继续进行，数据进入页缓存
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    close(fd);
+}
+
+bool MappedFile::ReadAll(const std::string& filePath, BufferPool::Buffer& buffer) {
+    int fd = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+
+    // 按打开时的长度读取，读取期间文件变短时读到的字节数不足
+    const size_t size = static_cast<size_t>(info.st_size);
+    buffer.Allocate(size);
+    size_t offset = 0;
+    while (offset < size) {
+        ssize_t bytesRead = pread(fd, buffer.data() + offset, size - offset, static_cast<off_t>(offset));
+        if (bytesRead < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytesRead <= 0) {
+            break;
+        }
+        offset += static_cast<size_t>(bytesRead);
+    }
+    close(fd);
+    return offset == size;
+}
+
+void MappedFile::PrefetchRange(size_t offset, size_t size) const {
+    if (!mappedData || offset >= mappedSize) {
+        return;
+    }
+    // madvise要求起始地址按页对齐
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t begin = offset & ~(pageSize - 1);
+    const size_t end = std::min(offset + size, mappedSize);
+    madvise(const_cast<uint8_t*>(mappedData + begin), end - begin, MADV_WILLNEED);
+}
+
+void MappedFile::Close() {
+    if (mappedData) {
+        munmap(const_cast<uint8_t*>(mappedData), mappedSize);
+    }
+    mappedData = nullptr;
+    mappedSize = 0;
+    opened = false;
+}
+
+#endif
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include "BufferPool.h"
+
+// 只读内存映射文件
+// 映射期间多个进程打开同一文件时共享系统页缓存
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief 以只读方式映射整个文件
+     * @param filePath 文件路径
+     * @param readAhead 是否提示系统预读整个文件，只访问少量内容时应关闭
+     * @return 成功映射返回true，否则返回false
+     * @note 空文件视为成功，data()返回nullptr
+     */
+    bool Open(const std::string& filePath, bool readAhead = true);
+
+    /**
+     * @brief 解除映射并关闭文件
+     */
+    void Close();
+
+    /**
+     * @brief 提示系统预读文件，不等待读取完成
+     * @param filePath 文件路径
+     * @note 用于在处理当前文件时提前读取后续文件，隐藏网络存储等的读取延迟
+     */
+    static void Prefetch(const std::string& filePath);
+
+    /**
+     * @brief 把整个文件读入缓冲，不建立映射
+     * @param filePath 文件路径
+     * @param buffer 输出的文件内容
+     * @return 读到打开时的完整长度返回true
+     * @note 用于可能正被截断重写的文件：映射的页面在文件变短后访问会触发SIGBUS，读取只会得到不完整的内容
+     */
+    static bool ReadAll(const std::string& filePath, BufferPool::Buffer& buffer);
+
+    /**
+     * @brief 提示系统预读映射中的一段数据，不等待读取完成
+     * @param offset 起始偏移
+     * @param size 长度
+     * @note 用于归档等只访问大文件中少量区段的场合，超出映射的部分被忽略
+     */
+    void PrefetchRange(size_t offset, size_t size) const;
+
+    const uint8_t* data() const { return mappedData; }
+    size_t size() const { return mappedSize; }
+    bool IsOpen() const { return opened; }
+
+private:
+    const uint8_t* mappedData = nullptr;
+    size_t mappedSize = 0;
+    bool opened = false;
+
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
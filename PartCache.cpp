@@ -0,0 +1,396 @@
+#include "PartCache.h"
+#include "Checksum.h"
+#include "Compat.h"
+#include <filesystem>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+
+// 缓存文件标识
+static const char CACHE_MAGIC[4] = { 'A', 'F', 'G', 'C' };
+
+// 文件格式版本，结构变化时递增
+constexpr uint32_t FORMAT_VERSION = 1;
+
+// 解码器版本，解码输出 (像素、坐标解析) 变化时递增，旧缓存随之失效
+constexpr uint32_t DECODER_VERSION = 1;
+
+// 像素数据按缓存行对齐
+constexpr uint64_t DATA_ALIGNMENT = 64;
+
+// 条目连续这么多次更新未被使用时淘汰，使轮流处理的多个目录可以共用一个缓存
+constexpr uint32_t MAX_ENTRY_AGE = 8;
+
+PartCache::~PartCache() {
+    if (output) {
+        fclose(output);
+        std::error_code ec;
+        std::filesystem::remove(outputPath, ec);
+    }
+}
+
+bool PartCache::Open(const std::string& cachePath) {
+    static_assert(sizeof(Header) == 64, "缓存文件头应为64字节");
+    static_assert(sizeof(Entry) == 64, "缓存条目应为64字节");
+
+    path = cachePath;
+    const std::vector<uint64_t> generations = FindGenerations();
+    if (generations.empty()) {
+        Logger::Info("缓存文件不存在，将新建: " + cachePath);
+        return true;
+    }
+
+    // 新缓存总是写到已有的最新一代之后
+    generation = generations.front();
+    for (uint64_t candidate : generations) {
+        if (MapGeneration(candidate)) {
+            Logger::Info("已加载缓存文件: " + GenerationPath(candidate) + " (" + std::to_string(index.size()) + " 个部件)");
+            return true;
+        }
+    }
+
+    Logger::Warning("缓存文件无效或版本不符，将重新生成: " + GenerationPath(generation));
+    return true;
+}
+
+std::string PartCache::GenerationPath(uint64_t number) const {
+    return number == 0 ? path : path + "." + std::to_string(number);
+}
+
+std::vector<uint64_t> PartCache::FindGenerations() const {
+    std::vector<uint64_t> generations;
+    const std::filesystem::path cachePath(path);
+    const std::string baseName = cachePath.filename().string();
+    std::filesystem::path directory = cachePath.parent_path();
+    if (directory.empty()) {
+        directory = ".";
+    }
+
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+        const std::string name = it->path().filename().string();
+        if (name == baseName) {
+            generations.push_back(0);
+            continue;
+        }
+        // 临时文件的后缀以".tmp"开头，不会被当作某一代
+        if (name.size() <= baseName.size() + 1 || name.compare(0, baseName.size(), baseName) != 0 ||
+            name[baseName.size()] != '.') {
+            continue;
+        }
+        const std::string suffix = name.substr(baseName.size() + 1);
+        if (suffix.size() <= 19 && std::all_of(suffix.begin(), suffix.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            generations.push_back(std::stoull(suffix));
+        }
+    }
+
+    std::sort(generations.begin(), generations.end(), std::greater<uint64_t>());
+    return generations;
+}
+
+bool PartCache::MapGeneration(uint64_t number) {
+    entries = nullptr;
+    index.clear();
+    entryUsed.clear();
+    usedEntries.clear();
+
+    mapped = std::make_shared<MappedFile>();
+    if (mapped->Open(GenerationPath(number)) && ValidateMapped()) {
+        return true;
+    }
+    mapped.reset();
+    entries = nullptr;
+    index.clear();
+    entryUsed.clear();
+    return false;
+}
+
+bool PartCache::ValidateMapped() {
+    uint32_t entryCount = 0;
+    entries = ValidateFile(*mapped, entryCount);
+    if (!entries) {
+        return false;
+    }
+    for (uint32_t i = 0; i < entryCount; i++) {
+        index[entries[i].hash] = i;
+    }
+    entryUsed.assign(entryCount, false);
+    return true;
+}
+
+const PartCache::Entry* PartCache::ValidateFile(const MappedFile& file, uint32_t& entryCount) {
+    const uint8_t* base = file.data();
+    const uint64_t size = file.size();
+    if (size < sizeof(Header)) {
+        return nullptr;
+    }
+
+    // 缓存只在本机使用，按本机字节序存储
+    Header header;
+    memcpy(&header, base, sizeof(header));
+    if (memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+        header.formatVersion != FORMAT_VERSION || header.decoderVersion != DECODER_VERSION) {
+        return nullptr;
+    }
+    if (header.tableOffset % alignof(Entry) != 0 || header.tableOffset > size ||
+        static_cast<uint64_t>(header.entryCount) * sizeof(Entry) > size - header.tableOffset) {
+        return nullptr;
+    }
+
+    const Entry* table = reinterpret_cast<const Entry*>(base + header.tableOffset);
+    for (uint32_t i = 0; i < header.entryCount; i++) {
+        const Entry& entry = table[i];
+        uint64_t pixelBytes = static_cast<uint64_t>(entry.width) * entry.height * entry.channels;
+        uint64_t spanBytes = static_cast<uint64_t>(entry.height) * sizeof(AlphaSpan);
+        if (entry.width <= 0 || entry.height <= 0 || entry.channels != 4 ||
+            entry.pixelOffset > size || pixelBytes > size - entry.pixelOffset ||
+            entry.spanOffset % alignof(AlphaSpan) != 0 || entry.spanOffset > size || spanBytes > size - entry.spanOffset) {
+            return nullptr;
+        }
+    }
+    entryCount = header.entryCount;
+    return table;
+}
+
+bool PartCache::Load(const std::string& filePath, bool readPos, ImageData& imageData) {
+    MappedFile file;
+    if (!file.Open(filePath)) {
+        Logger::Error("无法打开文件: " + filePath);
+        return false;
+    }
+
+    const uint64_t hash = Checksum::Hash64(file.data(), file.size());
+
+    // 命中：直接引用映射的像素数据
+    auto it = index.find(hash);
+    if (it != index.end() && entries[it->second].fileSize == file.size()) {
+        const Entry& entry = entries[it->second];
+        const uint8_t* base = mapped->data();
+        const AlphaSpan* spans = reinterpret_cast<const AlphaSpan*>(base + entry.spanOffset);
+
+        bool spansValid = true;
+        for (int32_t y = 0; y < entry.height && spansValid; y++) {
+            spansValid = spans[y].begin <= spans[y].end && spans[y].end <= static_cast<uint32_t>(entry.width);
+        }
+        if (spansValid) {
+            imageData.width = entry.width;
+            imageData.height = entry.height;
+            imageData.channels = entry.channels;
+            imageData.posX = readPos ? entry.posX : 0;
+            imageData.posY = readPos ? entry.posY : 0;
+            imageData.data = PixelBuffer::View(base + entry.pixelOffset,
+                static_cast<size_t>(entry.width) * entry.height * entry.channels, mapped);
+            imageData.data.SetAlphaSpans(std::shared_ptr<const AlphaSpan>(mapped, spans));
+
+            if (readPos) {
+                Logger::Info("tEXt块中的位置信息: " + std::to_string(entry.posX) + "," + std::to_string(entry.posY));
+            }
+            Logger::Debug("缓存命中: " + filePath);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!entryUsed[it->second]) {
+                entryUsed[it->second] = true;
+                usedEntries.push_back(it->second);
+            }
+            hits++;
+            return true;
+        }
+    }
+
+    // 未命中：解码并写入新缓存，坐标总是读取以便以后两种模式共用
+    if (!ImageProcessor::LoadPngFromMemory(file.data(), file.size(), imageData, true)) {
+        return false;
+    }
+    ImageProcessor::UpdateAlphaSpans(imageData);
+
+    // 内容相同的文件只写入一次
+    std::lock_guard<std::mutex> lock(mutex);
+    misses++;
+    bool duplicate = !newHashes.insert(hash).second;
+    if (!duplicate && imageData.channels == 4 && (output || BeginWrite())) {
+        Entry entry{};
+        entry.hash = hash;
+        entry.fileSize = file.size();
+        entry.width = imageData.width;
+        entry.height = imageData.height;
+        entry.channels = imageData.channels;
+        entry.posX = imageData.posX;
+        entry.posY = imageData.posY;
+        const ImageData& decoded = imageData;
+        AppendEntry(entry, decoded.data.data(), decoded.data.AlphaSpans());
+    }
+
+    if (!readPos) {
+        imageData.posX = 0;
+        imageData.posY = 0;
+    }
+    return true;
+}
+
+bool PartCache::BeginWrite() {
+    if (writeFailed) {
+        return false;
+    }
+
+    // 临时文件名带时间戳，避免并发进程互相覆盖
+    outputPath = path + ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    output = Compat::OpenFile(outputPath.c_str(), "wb");
+    if (!output) {
+        Logger::Warning("无法创建缓存文件: " + outputPath);
+        output = nullptr;
+        writeFailed = true;
+        return false;
+    }
+
+    // 文件头在写完后回填
+    Header header{};
+    writeFailed = fwrite(&header, sizeof(header), 1, output) != 1;
+    outputOffset = sizeof(header);
+    return !writeFailed;
+}
+
+bool PartCache::PadOutput() {
+    static const uint8_t zeros[DATA_ALIGNMENT] = {};
+    uint64_t padding = (DATA_ALIGNMENT - outputOffset % DATA_ALIGNMENT) % DATA_ALIGNMENT;
+    if (padding > 0 && fwrite(zeros, 1, static_cast<size_t>(padding), output) != padding) {
+        return false;
+    }
+    outputOffset += padding;
+    return true;
+}
+
+bool PartCache::AppendEntry(Entry entry, const uint8_t* pixels, const AlphaSpan* spans) {
+    if (writeFailed) {
+        return false;
+    }
+
+    size_t pixelBytes = static_cast<size_t>(entry.width) * entry.height * entry.channels;
+    size_t spanBytes = static_cast<size_t>(entry.height) * sizeof(AlphaSpan);
+
+    bool success = PadOutput();
+    entry.pixelOffset = outputOffset;
+    success = success && fwrite(pixels, 1, pixelBytes, output) == pixelBytes;
+    outputOffset += pixelBytes;
+
+    success = success && PadOutput();
+    entry.spanOffset = outputOffset;
+    success = success && fwrite(spans, 1, spanBytes, output) == spanBytes;
+    outputOffset += spanBytes;
+
+    if (!success) {
+        Logger::Warning("写入缓存文件失败: " + outputPath);
+        writeFailed = true;
+        return false;
+    }
+    newEntries.push_back(entry);
+    return true;
+}
+
+bool PartCache::CopyEntry(const MappedFile& source, const Entry& entry) {
+    return AppendEntry(entry, source.data() + entry.pixelOffset,
+        reinterpret_cast<const AlphaSpan*>(source.data() + entry.spanOffset));
+}
+
+bool PartCache::Finish() {
+    // 全部命中时无需更新，未用到的条目留在原文件中
+    if (!output && !writeFailed && misses == 0) {
+        return true;
+    }
+    if (!output && !BeginWrite()) {
+        return false;
+    }
+
+    // 新解码的部件已写入；本次用到的旧条目重新计龄，未用到的增加一次，超过上限的淘汰
+    std::unordered_set<uint64_t> written;
+    for (const Entry& entry : newEntries) {
+        written.insert(entry.hash);
+    }
+    for (uint32_t i : usedEntries) {
+        Entry entry = entries[i];
+        entry.age = 0;
+        if (written.insert(entry.hash).second) {
+            CopyEntry(*mapped, entry);
+        }
+    }
+    for (uint32_t i = 0; i < entryUsed.size(); i++) {
+        Entry entry = entries[i];
+        if (!entryUsed[i] && entry.age + 1 < MAX_ENTRY_AGE && written.insert(entry.hash).second) {
+            entry.age++;
+            CopyEntry(*mapped, entry);
+        }
+    }
+
+    // 其他进程在本次运行期间写出了更新的一代时，合并其中的条目，避免各自解码的部件互相覆盖
+    uint64_t nextGeneration = generation + 1;
+    const std::vector<uint64_t> generations = FindGenerations();
+    if (!generations.empty() && generations.front() > generation) {
+        nextGeneration = generations.front() + 1;
+        MappedFile latest;
+        uint32_t latestCount = 0;
+        const Entry* latestEntries = latest.Open(GenerationPath(generations.front())) ?
+            ValidateFile(latest, latestCount) : nullptr;
+        for (uint32_t i = 0; latestEntries && i < latestCount; i++) {
+            if (written.insert(latestEntries[i].hash).second) {
+                CopyEntry(latest, latestEntries[i]);
+            }
+        }
+    }
+
+    Header header{};
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.formatVersion = FORMAT_VERSION;
+    header.decoderVersion = DECODER_VERSION;
+    header.entryCount = static_cast<uint32_t>(newEntries.size());
+
+    bool success = !writeFailed && PadOutput();
+    header.tableOffset = outputOffset;
+    success = success && (newEntries.empty() ||
+        fwrite(newEntries.data(), sizeof(Entry), newEntries.size(), output) == newEntries.size());
+    success = success && fseek(output, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, output) == 1;
+    success = fclose(output) == 0 && success;
+    output = nullptr;
+
+    // 写到新一代文件名而不替换旧文件：Windows下已映射的文件不能被替换，
+    // 而本进程加载的部件和其他进程可能仍在引用旧映射
+    const std::string nextPath = GenerationPath(nextGeneration);
+    std::error_code ec;
+    if (success) {
+        // 以硬链接提交，另一进程同时写出了同一代时失败而不覆盖它
+        std::filesystem::create_hard_link(outputPath, nextPath, ec);
+        std::error_code existsError;
+        if (ec && !std::filesystem::exists(nextPath, existsError)) {
+            // 文件系统不支持硬链接
+            ec.clear();
+            std::filesystem::rename(outputPath, nextPath, ec);
+        }
+        else if (!ec) {
+            std::filesystem::remove(outputPath, existsError);
+        }
+        success = !ec;
+    }
+    if (!success) {
+        Logger::Warning("更新缓存文件失败: " + nextPath + (ec ? " (" + ec.message() + ")" : ""));
+        std::filesystem::remove(outputPath, ec);
+        return false;
+    }
+    Logger::Info("缓存文件已更新: " + nextPath + " (" + std::to_string(newEntries.size()) + " 个部件)");
+
+    // 切换到新一代，旧映射由引用它的部件持有直到释放
+    generation = nextGeneration;
+    newEntries.clear();
+    newHashes.clear();
+    if (!MapGeneration(generation)) {
+        Logger::Warning("无法映射新的缓存文件: " + nextPath);
+    }
+
+    // 删除更早的各代，仍被映射而删除失败的留待下次
+    for (uint64_t old : FindGenerations()) {
+        if (old < generation) {
+            std::filesystem::remove(GenerationPath(old), ec);
+            if (ec) {
+                Logger::Debug("暂时无法删除旧缓存文件: " + GenerationPath(old) + " (" + ec.message() + ")");
+            }
+        }
+    }
+    return true;
+}
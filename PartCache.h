@@ -0,0 +1,162 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdio>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include "ImageProcessor.h"
+#include "MappedFile.h"
+
+// 已解码部件的持久缓存
+// 缓存文件以内容哈希为键保存解码后的像素、尺寸、坐标和每行非透明范围，
+// 启动时整体映射到内存，命中的部件直接引用映射内容而不复制
+// 更新时写出下一代文件 (路径后加".代数")，不替换可能仍被映射的旧文件
+class PartCache {
+public:
+    PartCache() = default;
+    ~PartCache();
+
+    PartCache(const PartCache&) = delete;
+    PartCache& operator=(const PartCache&) = delete;
+
+    /**
+     * @brief 打开缓存文件，不存在或版本不符时从空缓存开始
+     * @param cachePath 缓存文件路径
+     * @return 始终返回true；已有缓存无效时记录警告
+     * @note 存在多代缓存文件时使用最新的有效一代
+     */
+    bool Open(const std::string& cachePath);
+
+    /**
+     * @brief 加载PNG部件，优先使用缓存
+     * @param filePath PNG文件路径
+     * @param readPos 是否需要tEXt块中的坐标信息
+     * @param imageData 输出的图像数据，命中时引用缓存内容
+     * @return 成功加载返回true，否则返回false
+     * @note 可在多个线程中同时调用，批量模式下各目录共用一个缓存
+     */
+    bool Load(const std::string& filePath, bool readPos, ImageData& imageData);
+
+    /**
+     * @brief 有新解码的部件时生成下一代缓存文件并切换到它
+     * @return 无需更新或成功更新返回true，否则返回false
+     * @note 本次未用到的条目保留，连续多次更新未被使用后才淘汰；其他进程在此期间写出的新一代
+     *       缓存被合并进来。已加载部件引用的旧映射保持有效；旧文件随后删除，
+     *       Windows下仍被本进程或其他进程映射时删除失败，留待以后的更新删除
+     */
+    bool Finish();
+
+    int HitCount() const { return hits; }
+    int MissCount() const { return misses; }
+
+private:
+    // 文件头
+    struct Header {
+        char magic[4];
+        uint32_t formatVersion;
+        uint32_t decoderVersion;
+        uint32_t entryCount;
+        uint64_t tableOffset;
+        uint8_t reserved[40];
+    };
+
+    // 条目表中的一项
+    struct Entry {
+        uint64_t hash;              // PNG文件内容哈希
+        uint64_t fileSize;          // PNG文件大小
+        uint64_t pixelOffset;       // 像素数据偏移
+        uint64_t spanOffset;        // 每行非透明范围偏移
+        int32_t width;
+        int32_t height;
+        int32_t channels;
+        int32_t posX;               // tEXt块中的坐标
+        int32_t posY;
+        uint32_t age;               // 连续多少次更新中未被使用，超过上限时淘汰
+        uint32_t reserved[2];
+    };
+
+    /**
+     * @brief 第number代缓存文件的路径，第0代为path本身
+     */
+    std::string GenerationPath(uint64_t number) const;
+
+    /**
+     * @brief 查找磁盘上已有的各代缓存文件
+     * @return 代数，从新到旧排列
+     */
+    std::vector<uint64_t> FindGenerations() const;
+
+    /**
+     * @brief 映射指定一代缓存文件，替换当前的索引
+     * @return 文件有效返回true，否则清空索引并返回false
+     */
+    bool MapGeneration(uint64_t number);
+
+    /**
+     * @brief 校验映射的缓存文件并建立索引
+     * @return 有效返回true
+     */
+    bool ValidateMapped();
+
+    /**
+     * @brief 校验缓存文件的文件头和条目表
+     * @param file 映射的缓存文件
+     * @param entryCount 输出的条目数
+     * @return 有效返回条目表，否则返回nullptr
+     */
+    static const Entry* ValidateFile(const MappedFile& file, uint32_t& entryCount);
+
+    /**
+     * @brief 从映射的缓存文件复制一个条目到新缓存
+     * @return 成功返回true
+     */
+    bool CopyEntry(const MappedFile& source, const Entry& entry);
+
+    /**
+     * @brief 开始写入临时缓存文件
+     * @return 成功返回true
+     */
+    bool BeginWrite();
+
+    /**
+     * @brief 向临时缓存文件追加一个部件
+     * @param entry 条目信息，偏移由本函数填写
+     * @param pixels 像素数据
+     * @param spans 每行非透明范围
+     * @return 成功返回true
+     */
+    bool AppendEntry(Entry entry, const uint8_t* pixels, const AlphaSpan* spans);
+
+    /**
+     * @brief 写入对齐填充
+     * @return 成功返回true
+     */
+    bool PadOutput();
+
+    std::string path;
+    uint64_t generation = 0;        // 当前映射或最新一代缓存文件的代数
+    std::shared_ptr<MappedFile> mapped;
+    const Entry* entries = nullptr;
+    std::unordered_map<uint64_t, uint32_t> index;      // 哈希 -> 条目下标
+
+    // 本次命中的旧条目，需要写入新缓存时从旧缓存复制
+    std::vector<uint32_t> usedEntries;
+    std::vector<bool> entryUsed;
+
+    // 新缓存的条目表
+    std::vector<Entry> newEntries;
+    std::unordered_set<uint64_t> newHashes;
+
+    std::mutex mutex;               // 保护命中记录和新缓存的写入，映射的旧缓存只读
+    FILE* output = nullptr;
+    std::string outputPath;
+    uint64_t outputOffset = 0;
+    bool writeFailed = false;
+
+    int hits = 0;
+    int misses = 0;
+};
@@ -0,0 +1,213 @@
+#include "PfsArchive.h"
+#include "Config.h"
+#include <algorithm>
+#include <cstring>
+
+// 文件头: "pf" + 版本号字符 + 索引长度(4字节)，索引从第7字节开始
+constexpr size_t PFS_HEADER_SIZE = 7;
+
+// 密钥长度与8字节的最小公倍数，解密时按8字节异或
+constexpr size_t PFS_KEY_SPAN = 40;
+
+namespace {
+
+// 带边界检查的小端读取
+class IndexReader {
+public:
+    IndexReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    bool ReadU32(uint32_t& value) {
+        if (size - pos < 4) {
+            return false;
+        }
+        value = static_cast<uint32_t>(data[pos]) | (static_cast<uint32_t>(data[pos + 1]) << 8) |
+            (static_cast<uint32_t>(data[pos + 2]) << 16) | (static_cast<uint32_t>(data[pos + 3]) << 24);
+        pos += 4;
+        return true;
+    }
+
+    bool ReadString(size_t length, std::string& value) {
+        if (size - pos < length) {
+            return false;
+        }
+        value.assign(reinterpret_cast<const char*>(data + pos), length);
+        pos += length;
+        return true;
+    }
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+};
+
+}
+
+bool PfsArchive::Open(const std::string& path) {
+    entries.clear();
+    index.clear();
+
+    // 归档通常有数GB，只访问索引和用到的条目，不预读整个文件
+    if (!file.Open(path, false)) {
+        Logger::Error("无法打开PFS归档: " + path);
+        return false;
+    }
+
+    const uint8_t* data = file.data();
+    const size_t fileSize = file.size();
+    if (fileSize < PFS_HEADER_SIZE || data[0] != 'p' || data[1] != 'f') {
+        Logger::Error("不是PFS归档: " + path);
+        file.Close();
+        return false;
+    }
+    const char version = static_cast<char>(data[2]);
+    if (version != '6' && version != '8') {
+        Logger::Error("不支持的PFS版本 pf" + std::string(1, version) + ": " + path);
+        file.Close();
+        return false;
+    }
+
+    const uint32_t indexSize = static_cast<uint32_t>(data[3]) | (static_cast<uint32_t>(data[4]) << 8) |
+        (static_cast<uint32_t>(data[5]) << 16) | (static_cast<uint32_t>(data[6]) << 24);
+    if (indexSize > fileSize - PFS_HEADER_SIZE) {
+        Logger::Error("PFS索引长度超出文件范围: " + path);
+        file.Close();
+        return false;
+    }
+
+    // 条目: 名称长度、名称、保留字段、偏移、长度
+    IndexReader reader(data + PFS_HEADER_SIZE, indexSize);
+    uint32_t fileCount = 0;
+    bool valid = reader.ReadU32(fileCount);
+    for (uint32_t i = 0; valid && i < fileCount; i++) {
+        Entry entry;
+        uint32_t nameLength = 0;
+        uint32_t reserved = 0;
+        valid = reader.ReadU32(nameLength) && reader.ReadString(nameLength, entry.name) &&
+            reader.ReadU32(reserved) && reader.ReadU32(entry.offset) && reader.ReadU32(entry.size);
+        if (!valid) {
+            break;
+        }
+        if (entry.offset > fileSize || entry.size > fileSize - entry.offset) {
+            Logger::Warning("PFS条目超出文件范围，跳过: " + entry.name);
+            continue;
+        }
+        std::replace(entry.name.begin(), entry.name.end(), '\\', '/');
+        index[NormalizeName(entry.name)] = entries.size();
+        entries.push_back(std::move(entry));
+    }
+    if (!valid) {
+        Logger::Error("PFS索引损坏: " + path);
+        entries.clear();
+        index.clear();
+        file.Close();
+        return false;
+    }
+
+    encrypted = version == '8';
+    if (encrypted) {
+        Checksum::Sha1(data + PFS_HEADER_SIZE, indexSize, key);
+    }
+
+    Logger::Info("已打开PFS归档: " + path + " (pf" + std::string(1, version) + ", " +
+        std::to_string(entries.size()) + " 个条目)");
+    return true;
+}
+
+const PfsArchive::Entry* PfsArchive::Find(const std::string& name) const {
+    auto it = index.find(NormalizeName(name));
+    return it != index.end() ? &entries[it->second] : nullptr;
+}
+
+std::vector<const PfsArchive::Entry*> PfsArchive::List(const std::string& directory) const {
+    std::string prefix = NormalizeName(directory);
+    while (!prefix.empty() && prefix.back() == '/') {
+        prefix.pop_back();
+    }
+    if (!prefix.empty()) {
+        prefix += '/';
+    }
+
+    std::vector<const Entry*> result;
+    for (const Entry& entry : entries) {
+        if (entry.name.size() <= prefix.size() ||
+            NormalizeName(entry.name.substr(0, prefix.size())) != prefix ||
+            entry.name.find('/', prefix.size()) != std::string::npos) {
+            continue;
+        }
+        result.push_back(&entry);
+    }
+    return result;
+}
+
+std::vector<std::string> PfsArchive::Directories(const std::string& directory) const {
+    std::string prefix = NormalizeName(directory);
+    while (!prefix.empty() && prefix.back() == '/') {
+        prefix.pop_back();
+    }
+    if (!prefix.empty()) {
+        prefix += '/';
+    }
+
+    std::vector<std::string> result;
+    std::unordered_set<std::string> seen;
+    for (const Entry& entry : entries) {
+        const size_t slash = entry.name.rfind('/');
+        if (slash == std::string::npos || slash + 1 < prefix.size()) {
+            continue;
+        }
+        std::string parent = entry.name.substr(0, slash);
+        std::string normalized = NormalizeName(parent);
+        if (normalized.compare(0, prefix.size(), prefix) != 0 && normalized + '/' != prefix) {
+            continue;
+        }
+        if (seen.insert(normalized).second) {
+            result.push_back(std::move(parent));
+        }
+    }
+    return result;
+}
+
+const uint8_t* PfsArchive::Read(const Entry& entry, BufferPool::Buffer& scratch) const {
+    const uint8_t* source = file.data() + entry.offset;
+    if (!encrypted || entry.size == 0) {
+        return source;
+    }
+
+    // 密钥从每个条目的起点开始循环，展开到40字节后按8字节异或
+    uint8_t span[PFS_KEY_SPAN];
+    for (size_t i = 0; i < PFS_KEY_SPAN; i++) {
+        span[i] = key[i % Checksum::SHA1_SIZE];
+    }
+    uint64_t spanWords[PFS_KEY_SPAN / 8];
+    memcpy(spanWords, span, sizeof(spanWords));
+
+    scratch.Allocate(entry.size);
+    uint8_t* output = scratch.data();
+    size_t pos = 0;
+    for (; pos + PFS_KEY_SPAN <= entry.size; pos += PFS_KEY_SPAN) {
+        for (size_t w = 0; w < PFS_KEY_SPAN / 8; w++) {
+            uint64_t word;
+            memcpy(&word, source + pos + w * 8, 8);
+            word ^= spanWords[w];
+            memcpy(output + pos + w * 8, &word, 8);
+        }
+    }
+    for (; pos < entry.size; pos++) {
+        output[pos] = source[pos] ^ span[pos % PFS_KEY_SPAN];
+    }
+    return output;
+}
+
+std::string PfsArchive::NormalizeName(const std::string& name) {
+    std::string result = name;
+    for (char& c : result) {
+        if (c == '\\') {
+            c = '/';
+        }
+        else if (c >= 'A' && c <= 'Z') {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+    return result;
+}
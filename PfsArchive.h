@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "BufferPool.h"
+#include "Checksum.h"
+#include "MappedFile.h"
+
+// Artemis引擎的PFS归档 (pf6/pf8)
+// 整个归档以内存映射方式打开，只解析索引，条目数据直接在映射中访问，不解包到磁盘。
+// pf8的条目数据以索引区的SHA-1摘要为密钥循环异或加密，读取时解密到临时缓冲；
+// pf6不加密，直接返回映射中的数据
+class PfsArchive {
+public:
+    struct Entry {
+        std::string name;       // 归档内路径，分隔符统一为'/'
+        uint32_t offset;        // 数据在归档中的偏移
+        uint32_t size;          // 数据长度
+    };
+
+    PfsArchive() = default;
+
+    PfsArchive(const PfsArchive&) = delete;
+    PfsArchive& operator=(const PfsArchive&) = delete;
+
+    /**
+     * @brief 映射归档并解析索引
+     * @param path 归档路径，如root.pfs.002
+     * @return 成功返回true，格式不支持或索引损坏时返回false
+     */
+    bool Open(const std::string& path);
+
+    bool IsOpen() const { return file.IsOpen(); }
+
+    /**
+     * @brief 按路径查找条目，不区分大小写，'\\'与'/'等价
+     * @param name 归档内路径
+     * @return 条目指针，不存在时返回nullptr
+     */
+    const Entry* Find(const std::string& name) const;
+
+    /**
+     * @brief 列出目录下的直接子条目
+     * @param directory 归档内目录，不区分大小写
+     * @return 条目列表，按索引中的顺序排列
+     */
+    std::vector<const Entry*> List(const std::string& directory) const;
+
+    /**
+     * @brief 递归列出目录及其下各级子目录中直接含有条目的目录
+     * @param directory 归档内目录，不区分大小写，空表示整个归档
+     * @return 目录路径，按在索引中首次出现的顺序排列
+     */
+    std::vector<std::string> Directories(const std::string& directory) const;
+
+    /**
+     * @brief 读取条目内容
+     * @param entry 条目
+     * @param scratch 加密条目解密到此缓冲
+     * @return 数据指针，未加密时直接指向映射；长度为entry.size
+     */
+    const uint8_t* Read(const Entry& entry, BufferPool::Buffer& scratch) const;
+
+    /**
+     * @brief 提示系统预读条目数据
+     * @param entry 条目
+     */
+    void Prefetch(const Entry& entry) const { file.PrefetchRange(entry.offset, entry.size); }
+
+    size_t EntryCount() const { return entries.size(); }
+
+private:
+    /**
+     * @brief 统一为小写和'/'分隔，用作查找键
+     */
+    static std::string NormalizeName(const std::string& name);
+
+    MappedFile file;
+    bool encrypted = false;
+    uint8_t key[Checksum::SHA1_SIZE] = {};
+    std::vector<Entry> entries;
+    std::unordered_map<std::string, size_t> index;     // 规范化路径->条目下标
+};
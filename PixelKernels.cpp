@@ -0,0 +1,336 @@
+#include "PixelKernels.h"
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define PIXEL_KERNELS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// SSSE3和AVX2内核总是编译，运行时按CPU支持的指令集选择，不依赖/arch或-m编译选项
+#if defined(_M_X64) || defined(__x86_64__)
+#define PIXEL_KERNELS_SSSE3 1
+#define PIXEL_KERNELS_AVX2 1
+#include <tmmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define PIXEL_KERNELS_TARGET_SSSE3
+#define PIXEL_KERNELS_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define PIXEL_KERNELS_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define PIXEL_KERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+#if defined(PIXEL_KERNELS_SSSE3)
+
+// CPU支持的指令集
+struct CpuFeatures {
+    bool ssse3 = false;
+    bool avx2 = false;
+};
+
+static CpuFeatures DetectCpuFeatures() {
+    unsigned int ecx1 = 0, ebx7 = 0;
+    unsigned long long xcr0 = 0;
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    ecx1 = static_cast<unsigned int>(info[2]);
+    if (maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        ebx7 = static_cast<unsigned int>(info[1]);
+    }
+#else
+    unsigned int eax = 0, ebx = 0, edx = 0;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx1, &edx)) {
+        return CpuFeatures();
+    }
+    unsigned int ecx7 = 0;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx7, &ecx7, &edx)) {
+        ebx7 = 0;
+    }
+#endif
+
+    const unsigned int SSSE3 = 1u << 9;
+    const unsigned int OSXSAVE = 1u << 27;
+    const unsigned int AVX2 = 1u << 5;
+    // AVX2还需要操作系统保存YMM寄存器
+    if (ecx1 & OSXSAVE) {
+#if defined(_MSC_VER)
+        xcr0 = _xgetbv(0);
+#else
+        unsigned int xcr0Lo = 0, xcr0Hi = 0;
+        __asm__("xgetbv" : "=a"(xcr0Lo), "=d"(xcr0Hi) : "c"(0));
+        xcr0 = (static_cast<unsigned long long>(xcr0Hi) << 32) | xcr0Lo;
+#endif
+    }
+
+    CpuFeatures features;
+    features.ssse3 = (ecx1 & SSSE3) != 0;
+    features.avx2 = (ebx7 & AVX2) != 0 && (xcr0 & 0x6) == 0x6;
+    return features;
+}
+
+static const CpuFeatures& GetCpuFeatures() {
+    static const CpuFeatures features = DetectCpuFeatures();
+    return features;
+}
+
+// 以下内核返回已处理的像素数，剩余像素由调用方逐个处理
+
+PIXEL_KERNELS_TARGET_SSSE3
+static size_t RgbToRgbaSsse3(const uint8_t* src, uint8_t* dst, size_t pixelCount, uint8_t alpha) {
+    size_t i = 0;
+    // 每次处理16个像素：读取48字节，拆成4组各4个像素
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(static_cast<uint32_t>(alpha) << 24));
+    for (; i + 16 <= pixelCount; i += 16) {
+        const __m128i* in = reinterpret_cast<const __m128i*>(src + i * 3);
+        __m128i* out = reinterpret_cast<__m128i*>(dst + i * 4);
+        __m128i a = _mm_loadu_si128(in + 0);
+        __m128i b = _mm_loadu_si128(in + 1);
+        __m128i c = _mm_loadu_si128(in + 2);
+
+        __m128i p0 = _mm_shuffle_epi8(a, shuffle);
+        __m128i p1 = _mm_shuffle_epi8(_mm_alignr_epi8(b, a, 12), shuffle);
+        __m128i p2 = _mm_shuffle_epi8(_mm_alignr_epi8(c, b, 8), shuffle);
+        __m128i p3 = _mm_shuffle_epi8(_mm_srli_si128(c, 4), shuffle);
+
+        _mm_storeu_si128(out + 0, _mm_or_si128(p0, alphaMask));
+        _mm_storeu_si128(out + 1, _mm_or_si128(p1, alphaMask));
+        _mm_storeu_si128(out + 2, _mm_or_si128(p2, alphaMask));
+        _mm_storeu_si128(out + 3, _mm_or_si128(p3, alphaMask));
+    }
+    return i;
+}
+
+PIXEL_KERNELS_TARGET_SSSE3
+static size_t GrayAlphaToRgbaSsse3(const uint8_t* src, uint8_t* dst, size_t pixelCount) {
+    size_t i = 0;
+    // 每次处理8个像素 (16字节)
+    const __m128i shuffleLo = _mm_setr_epi8(0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4, 5, 6, 6, 6, 7);
+    const __m128i shuffleHi = _mm_setr_epi8(8, 8, 8, 9, 10, 10, 10, 11, 12, 12, 12, 13, 14, 14, 14, 15);
+    for (; i + 8 <= pixelCount; i += 8) {
+        __m128i ga = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+        __m128i* out = reinterpret_cast<__m128i*>(dst + i * 4);
+        _mm_storeu_si128(out + 0, _mm_shuffle_epi8(ga, shuffleLo));
+        _mm_storeu_si128(out + 1, _mm_shuffle_epi8(ga, shuffleHi));
+    }
+    return i;
+}
+
+PIXEL_KERNELS_TARGET_AVX2
+static size_t PaletteToRgbaAvx2(const uint8_t* src, uint8_t* dst, size_t pixelCount, const uint32_t* lut) {
+    size_t i = 0;
+    // 每次查表8个像素
+    for (; i + 8 <= pixelCount; i += 8) {
+        __m128i index8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i));
+        __m256i index32 = _mm256_cvtepu8_epi32(index8);
+        __m256i colors = _mm256_i32gather_epi32(reinterpret_cast<const int*>(lut), index32, 4);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), colors);
+    }
+    return i;
+}
+
+#endif
+
+uint32_t PixelKernels::PackRGBA(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+    const uint8_t bytes[4] = { r, g, b, a };
+    uint32_t packed;
+    memcpy(&packed, bytes, sizeof(packed));
+    return packed;
+}
+
+void PixelKernels::FillRGBA(uint8_t* dst, size_t pixelCount, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+    // 四个分量相同时（如全透明）直接memset
+    if (r == g && g == b && b == a) {
+        memset(dst, r, pixelCount * 4);
+        return;
+    }
+
+    const uint32_t packed = PackRGBA(r, g, b, a);
+    size_t i = 0;
+
+#if defined(PIXEL_KERNELS_SSE2)
+    const __m128i color = _mm_set1_epi32(static_cast<int>(packed));
+    for (; i + 16 <= pixelCount; i += 16) {
+        __m128i* out = reinterpret_cast<__m128i*>(dst + i * 4);
+        _mm_storeu_si128(out + 0, color);
+        _mm_storeu_si128(out + 1, color);
+        _mm_storeu_si128(out + 2, color);
+        _mm_storeu_si128(out + 3, color);
+    }
+    for (; i + 4 <= pixelCount; i += 4) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), color);
+    }
+#endif
+
+    for (; i < pixelCount; i++) {
+        memcpy(dst + i * 4, &packed, 4);
+    }
+}
+
+void PixelKernels::FillRGB(uint8_t* dst, size_t pixelCount, uint8_t r, uint8_t g, uint8_t b) {
+    if (r == g && g == b) {
+        memset(dst, r, pixelCount * 3);
+        return;
+    }
+
+    // 16个RGB像素恰好是3个16字节块，先生成一组图案再成块复制
+    uint8_t pattern[48];
+    for (int i = 0; i < 16; i++) {
+        pattern[i * 3] = r;
+        pattern[i * 3 + 1] = g;
+        pattern[i * 3 + 2] = b;
+    }
+
+    size_t i = 0;
+
+#if defined(PIXEL_KERNELS_SSE2)
+    const __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern));
+    const __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern + 16));
+    const __m128i p2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern + 32));
+    for (; i + 16 <= pixelCount; i += 16) {
+        __m128i* out = reinterpret_cast<__m128i*>(dst + i * 3);
+        _mm_storeu_si128(out + 0, p0);
+        _mm_storeu_si128(out + 1, p1);
+        _mm_storeu_si128(out + 2, p2);
+    }
+#else
+    for (; i + 16 <= pixelCount; i += 16) {
+        memcpy(dst + i * 3, pattern, sizeof(pattern));
+    }
+#endif
+
+    memcpy(dst + i * 3, pattern, (pixelCount - i) * 3);
+}
+
+void PixelKernels::RgbToRgba(const uint8_t* src, uint8_t* dst, size_t pixelCount, uint8_t alpha) {
+    size_t i = 0;
+
+#if defined(PIXEL_KERNELS_SSSE3)
+    if (GetCpuFeatures().ssse3) {
+        i = RgbToRgbaSsse3(src, dst, pixelCount, alpha);
+    }
+#endif
+
+    for (; i < pixelCount; i++) {
+        dst[i * 4] = src[i * 3];
+        dst[i * 4 + 1] = src[i * 3 + 1];
+        dst[i * 4 + 2] = src[i * 3 + 2];
+        dst[i * 4 + 3] = alpha;
+    }
+}
+
+void PixelKernels::GrayToRgba(const uint8_t* src, uint8_t* dst, size_t pixelCount) {
+    size_t i = 0;
+
+#if defined(PIXEL_KERNELS_SSE2)
+    // 每次处理16个像素：g -> gg, g0xFF -> ggg0xFF
+    const __m128i opaque = _mm_set1_epi8(static_cast<char>(0xFF));
+    for (; i + 16 <= pixelCount; i += 16) {
+        __m128i gray = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i* out = reinterpret_cast<__m128i*>(dst + i * 4);
+
+        __m128i ggLo = _mm_unpacklo_epi8(gray, gray);
+        __m128i ggHi = _mm_unpackhi_epi8(gray, gray);
+        __m128i gaLo = _mm_unpacklo_epi8(gray, opaque);
+        __m128i gaHi = _mm_unpackhi_epi8(gray, opaque);
+
+        _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(ggLo, gaLo));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(ggLo, gaLo));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(ggHi, gaHi));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(ggHi, gaHi));
+    }
+#endif
+
+    for (; i < pixelCount; i++) {
+        dst[i * 4] = src[i];
+        dst[i * 4 + 1] = src[i];
+        dst[i * 4 + 2] = src[i];
+        dst[i * 4 + 3] = 255;
+    }
+}
+
+void PixelKernels::GrayAlphaToRgba(const uint8_t* src, uint8_t* dst, size_t pixelCount) {
+    size_t i = 0;
+
+#if defined(PIXEL_KERNELS_SSSE3)
+    if (GetCpuFeatures().ssse3) {
+        i = GrayAlphaToRgbaSsse3(src, dst, pixelCount);
+    }
+#endif
+
+    for (; i < pixelCount; i++) {
+        dst[i * 4] = src[i * 2];
+        dst[i * 4 + 1] = src[i * 2];
+        dst[i * 4 + 2] = src[i * 2];
+        dst[i * 4 + 3] = src[i * 2 + 1];
+    }
+}
+
+void PixelKernels::PaletteToRgba(const uint8_t* src, uint8_t* dst, size_t pixelCount, const uint32_t* lut) {
+    size_t i = 0;
+
+#if defined(PIXEL_KERNELS_AVX2)
+    if (GetCpuFeatures().avx2) {
+        i = PaletteToRgbaAvx2(src, dst, pixelCount, lut);
+    }
+#endif
+
+    for (; i < pixelCount; i++) {
+        memcpy(dst + i * 4, &lut[src[i]], 4);
+    }
+}
+
+void PixelKernels::FindAlphaSpan(const uint8_t* rgba, size_t pixelCount, size_t& begin, size_t& end) {
+    size_t first = 0;
+
+#if defined(PIXEL_KERNELS_SSE2)
+    // 每次检查4个像素的透明度字节
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(PackRGBA(0, 0, 0, 255)));
+    const __m128i zero = _mm_setzero_si128();
+    auto opaqueMask = [&](size_t i) {
+        __m128i v = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + i * 4)), alphaMask);
+        return ~_mm_movemask_epi8(_mm_cmpeq_epi32(v, zero)) & 0xFFFF;
+    };
+    for (; first + 4 <= pixelCount && !opaqueMask(first); first += 4) {
+    }
+#endif
+
+    while (first < pixelCount && rgba[first * 4 + 3] == 0) {
+        first++;
+    }
+    if (first == pixelCount) {
+        begin = end = 0;
+        return;
+    }
+
+    size_t last = pixelCount;
+#if defined(PIXEL_KERNELS_SSE2)
+    for (; last >= first + 4 && !opaqueMask(last - 4); last -= 4) {
+    }
+#endif
+    while (rgba[(last - 1) * 4 + 3] == 0) {
+        last--;
+    }
+
+    begin = first;
+    end = last;
+}
+
+void PixelKernels::BlendRgba(const uint8_t* src, uint8_t* dst, size_t pixelCount) {
+    for (size_t i = 0; i < pixelCount; i++) {
+        const uint8_t* s = src + i * 4;
+        uint8_t* d = dst + i * 4;
+        const int a = s[3];
+        d[0] = static_cast<uint8_t>((s[0] * a + d[0] * (255 - a)) / 255);
+        d[1] = static_cast<uint8_t>((s[1] * a + d[1] * (255 - a)) / 255);
+        d[2] = static_cast<uint8_t>((s[2] * a + d[2] * (255 - a)) / 255);
+        d[3] = static_cast<uint8_t>(a + d[3] * (255 - a) / 255);
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// 按行处理的像素格式转换与填充内核
+// 所有函数只处理连续像素，调用方负责按行传入（或整幅连续图像一次传入）
+class PixelKernels {
+public:
+    /**
+     * @brief 用同一RGBA颜色填充像素
+     * @param dst 目标像素 (RGBA)
+     * @param pixelCount 像素数量
+     * @param r 红色分量
+     * @param g 绿色分量
+     * @param b 蓝色分量
+     * @param a 透明度分量
+     */
+    static void FillRGBA(uint8_t* dst, size_t pixelCount, uint8_t r, uint8_t g, uint8_t b, uint8_t a);
+
+    /**
+     * @brief 用同一RGB颜色填充像素
+     * @param dst 目标像素 (RGB)
+     * @param pixelCount 像素数量
+     * @param r 红色分量
+     * @param g 绿色分量
+     * @param b 蓝色分量
+     */
+    static void FillRGB(uint8_t* dst, size_t pixelCount, uint8_t r, uint8_t g, uint8_t b);
+
+    /**
+     * @brief RGB转RGBA
+     * @param src 源像素 (RGB)
+     * @param dst 目标像素 (RGBA)，不能与src重叠
+     * @param pixelCount 像素数量
+     * @param alpha 填充的透明度
+     */
+    static void RgbToRgba(const uint8_t* src, uint8_t* dst, size_t pixelCount, uint8_t alpha = 255);
+
+    /**
+     * @brief 灰度转RGBA
+     * @param src 源像素 (Gray)
+     * @param dst 目标像素 (RGBA)，不能与src重叠
+     * @param pixelCount 像素数量
+     */
+    static void GrayToRgba(const uint8_t* src, uint8_t* dst, size_t pixelCount);
+
+    /**
+     * @brief 灰度+透明度转RGBA
+     * @param src 源像素 (Gray, Alpha)
+     * @param dst 目标像素 (RGBA)，不能与src重叠
+     * @param pixelCount 像素数量
+     */
+    static void GrayAlphaToRgba(const uint8_t* src, uint8_t* dst, size_t pixelCount);
+
+    /**
+     * @brief 调色板索引转RGBA
+     * @param src 源像素 (每像素1字节索引)
+     * @param dst 目标像素 (RGBA)，不能与src重叠
+     * @param pixelCount 像素数量
+     * @param lut 256项调色板，每项按内存顺序存放R、G、B、A
+     */
+    static void PaletteToRgba(const uint8_t* src, uint8_t* dst, size_t pixelCount, const uint32_t* lut);
+
+    /**
+     * @brief 查找一行中透明度不为0的像素范围
+     * @param rgba 像素 (RGBA)
+     * @param pixelCount 像素数量
+     * @param begin 输出的第一个非透明像素下标
+     * @param end 输出的最后一个非透明像素下标+1，整行透明时begin与end均为0
+     */
+    static void FindAlphaSpan(const uint8_t* rgba, size_t pixelCount, size_t& begin, size_t& end);
+
+    /**
+     * @brief 按前景透明度将前景像素叠加到背景
+     * @param src 前景像素 (RGBA)
+     * @param dst 背景像素 (RGBA)，原地更新
+     * @param pixelCount 像素数量
+     * @note 与ImageProcessor::Blend的混合公式逐位一致
+     */
+    static void BlendRgba(const uint8_t* src, uint8_t* dst, size_t pixelCount);
+
+    /**
+     * @brief 将RGBA四个分量打包为按内存顺序排列的32位值
+     */
+    static uint32_t PackRGBA(uint8_t r, uint8_t g, uint8_t b, uint8_t a);
+};
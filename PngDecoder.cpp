@@ -0,0 +1,348 @@
+#include "PngDecoder.h"
+#include "Checksum.h"
+#include "PixelKernels.h"
+#include <zlib.h>
+#include <cstring>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define PNG_DECODER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// PNG文件签名长度
+constexpr size_t PNG_SIGNATURE_SIZE = 8;
+
+// 与libpng默认限制一致的最大宽高
+constexpr uint32_t MAX_DIMENSION = 1000000;
+
+// 颜色类型
+constexpr uint8_t COLOR_TYPE_RGB = 2;
+constexpr uint8_t COLOR_TYPE_RGBA = 6;
+
+static inline uint32_t ReadU32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+        (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+static inline uint8_t PaethPredictor(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = std::abs(p - a);
+    int pb = std::abs(p - b);
+    int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return static_cast<uint8_t>(a);
+    if (pb <= pc) return static_cast<uint8_t>(b);
+    return static_cast<uint8_t>(c);
+}
+
+#if defined(PNG_DECODER_SSE2)
+
+// 读写一个像素，BPP为编译期常量以便内联为单条指令
+template <int BPP>
+static inline __m128i LoadPixel(const uint8_t* p) {
+    uint32_t value = 0;
+    memcpy(&value, p, BPP);
+    return _mm_cvtsi32_si128(static_cast<int>(value));
+}
+
+template <int BPP>
+static inline void StorePixel(uint8_t* p, __m128i v) {
+    uint32_t value = static_cast<uint32_t>(_mm_cvtsi128_si32(v));
+    memcpy(p, &value, BPP);
+}
+
+static inline __m128i Abs16(__m128i v) {
+    return _mm_max_epi16(v, _mm_sub_epi16(_mm_setzero_si128(), v));
+}
+
+// 左邻依赖逐像素传递，每次处理一个像素的所有通道
+template <int BPP>
+static void UnfilterSub(uint8_t* row, size_t rowBytes) {
+    __m128i a = _mm_setzero_si128();
+    for (size_t i = 0; i < rowBytes; i += BPP) {
+        a = _mm_add_epi8(LoadPixel<BPP>(row + i), a);
+        StorePixel<BPP>(row + i, a);
+    }
+}
+
+// floor((a+b)/2) = 向上取整平均值 - ((a^b)&1)
+template <int BPP>
+static void UnfilterAvg(uint8_t* row, const uint8_t* prev, size_t rowBytes) {
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i a = _mm_setzero_si128();
+    for (size_t i = 0; i < rowBytes; i += BPP) {
+        __m128i b = LoadPixel<BPP>(prev + i);
+        __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+        a = _mm_add_epi8(LoadPixel<BPP>(row + i), avg);
+        StorePixel<BPP>(row + i, a);
+    }
+}
+
+// 在16位通道上计算Paeth预测，a/c沿行传递
+template <int BPP>
+static void UnfilterPaeth(uint8_t* row, const uint8_t* prev, size_t rowBytes) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i a = zero;
+    __m128i c = zero;
+    for (size_t i = 0; i < rowBytes; i += BPP) {
+        __m128i b = _mm_unpacklo_epi8(LoadPixel<BPP>(prev + i), zero);
+
+        __m128i pa = _mm_sub_epi16(b, c);
+        __m128i pb = _mm_sub_epi16(a, c);
+        __m128i pc = Abs16(_mm_add_epi16(pa, pb));
+        pa = Abs16(pa);
+        pb = Abs16(pb);
+
+        // pa最小取a，否则pb不大于pc取b，否则取c
+        __m128i notA = _mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc));
+        __m128i notB = _mm_cmpgt_epi16(pb, pc);
+        __m128i bc = _mm_or_si128(_mm_andnot_si128(notB, b), _mm_and_si128(notB, c));
+        __m128i pred = _mm_or_si128(_mm_andnot_si128(notA, a), _mm_and_si128(notA, bc));
+
+        __m128i x = _mm_add_epi8(LoadPixel<BPP>(row + i), _mm_packus_epi16(pred, pred));
+        StorePixel<BPP>(row + i, x);
+
+        a = _mm_unpacklo_epi8(x, zero);
+        c = b;
+    }
+}
+
+#endif
+
+bool PngDecoder::UnfilterRow(int type, uint8_t* row, const uint8_t* prev, size_t rowBytes, int bpp) {
+#if !defined(PNG_DECODER_SSE2)
+    const size_t step = static_cast<size_t>(bpp);
+#endif
+
+    switch (type) {
+    case 0:
+        return true;
+
+    case 1:
+#if defined(PNG_DECODER_SSE2)
+        if (bpp == 4) UnfilterSub<4>(row, rowBytes);
+        else UnfilterSub<3>(row, rowBytes);
+#else
+        for (size_t i = step; i < rowBytes; i++) {
+            row[i] = static_cast<uint8_t>(row[i] + row[i - step]);
+        }
+#endif
+        return true;
+
+    case 2: {
+        size_t i = 0;
+#if defined(PNG_DECODER_SSE2)
+        for (; i + 16 <= rowBytes; i += 16) {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), _mm_add_epi8(x, b));
+        }
+#endif
+        for (; i < rowBytes; i++) {
+            row[i] = static_cast<uint8_t>(row[i] + prev[i]);
+        }
+        return true;
+    }
+
+    case 3:
+#if defined(PNG_DECODER_SSE2)
+        if (bpp == 4) UnfilterAvg<4>(row, prev, rowBytes);
+        else UnfilterAvg<3>(row, prev, rowBytes);
+#else
+        for (size_t i = 0; i < rowBytes; i++) {
+            int left = i >= step ? row[i - step] : 0;
+            row[i] = static_cast<uint8_t>(row[i] + ((left + prev[i]) >> 1));
+        }
+#endif
+        return true;
+
+    case 4:
+#if defined(PNG_DECODER_SSE2)
+        if (bpp == 4) UnfilterPaeth<4>(row, prev, rowBytes);
+        else UnfilterPaeth<3>(row, prev, rowBytes);
+#else
+        for (size_t i = 0; i < rowBytes; i++) {
+            bool hasLeft = i >= step;
+            int left = hasLeft ? row[i - step] : 0;
+            int upLeft = hasLeft ? prev[i - step] : 0;
+            row[i] = static_cast<uint8_t>(row[i] + PaethPredictor(left, prev[i], upLeft));
+        }
+#endif
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+bool PngDecoder::Decode(const uint8_t* data, size_t size, ImageData& imageData,
+    bool verifyCrc, std::vector<std::string>* comments) {
+    struct Span {
+        const uint8_t* data;
+        size_t size;
+    };
+
+    if (!data || size < PNG_SIGNATURE_SIZE) {
+        return false;
+    }
+
+    // 遍历数据块，收集IDAT位置，不复制压缩数据
+    uint32_t width = 0, height = 0;
+    uint8_t colorType = 0;
+    bool headerSeen = false, endSeen = false;
+    std::vector<Span> idats;
+
+    size_t offset = PNG_SIGNATURE_SIZE;
+    while (!endSeen) {
+        if (size - offset < 12) {
+            return false;
+        }
+        uint32_t length = ReadU32(data + offset);
+        const uint8_t* type = data + offset + 4;
+        const uint8_t* body = data + offset + 8;
+        if (length > 0x7FFFFFFFu || length > size - offset - 12) {
+            return false;
+        }
+        if (verifyCrc && Checksum::Crc32(0, type, length + 4) != ReadU32(body + length)) {
+            return false;
+        }
+        offset += 12 + static_cast<size_t>(length);
+
+        if (!headerSeen) {
+            // IHDR必须是第一个块
+            if (memcmp(type, "IHDR", 4) != 0 || length != 13) {
+                return false;
+            }
+            width = ReadU32(body);
+            height = ReadU32(body + 4);
+            colorType = body[9];
+            if (width == 0 || height == 0 || width > MAX_DIMENSION || height > MAX_DIMENSION ||
+                body[8] != 8 || (colorType != COLOR_TYPE_RGB && colorType != COLOR_TYPE_RGBA) ||
+                body[10] != 0 || body[11] != 0 || body[12] != 0) {
+                return false;
+            }
+            headerSeen = true;
+        }
+        else if (memcmp(type, "IDAT", 4) == 0) {
+            if (length > 0) {
+                idats.push_back({ body, length });
+            }
+        }
+        else if (memcmp(type, "IEND", 4) == 0) {
+            endSeen = true;
+        }
+        else if (memcmp(type, "tRNS", 4) == 0) {
+            // RGB色键透明交给libpng转换
+            return false;
+        }
+        else if (memcmp(type, "tEXt", 4) == 0) {
+            if (comments) {
+                const char* text = reinterpret_cast<const char*>(body);
+                size_t keyLength = strnlen(text, length);
+                if (keyLength < length && strcmp(text, "comment") == 0) {
+                    comments->emplace_back(text + keyLength + 1, length - keyLength - 1);
+                }
+            }
+        }
+        else if (memcmp(type, "zTXt", 4) == 0 || memcmp(type, "iTXt", 4) == 0) {
+            // 压缩文本中的坐标信息交给libpng读取
+            if (comments) {
+                return false;
+            }
+        }
+        else if (!(type[0] & 0x20) && memcmp(type, "PLTE", 4) != 0) {
+            // 未知的关键块
+            return false;
+        }
+    }
+    if (idats.empty()) {
+        return false;
+    }
+
+    // 不校验时跳过zlib头，以原始deflate流解压，同时省去adler32计算
+    z_stream stream{};
+    int windowBits = 15;
+    if (!verifyCrc) {
+        const uint8_t* header = idats.front().data;
+        if (idats.front().size < 2 || (header[0] & 0x0F) != Z_DEFLATED || (header[0] >> 4) > 7 ||
+            (header[0] * 256 + header[1]) % 31 != 0 || (header[1] & 0x20)) {
+            return false;
+        }
+        idats.front().data += 2;
+        idats.front().size -= 2;
+        windowBits = -15;
+    }
+    if (inflateInit2(&stream, windowBits) != Z_OK) {
+        return false;
+    }
+
+    size_t nextIdat = 0;
+    bool streamEnded = false;
+    auto inflateTo = [&](uint8_t* out, size_t count) {
+        stream.next_out = out;
+        stream.avail_out = static_cast<uInt>(count);
+        while (stream.avail_out > 0 && !streamEnded) {
+            if (stream.avail_in == 0) {
+                if (nextIdat >= idats.size()) {
+                    return false;
+                }
+                stream.next_in = const_cast<Bytef*>(idats[nextIdat].data);
+                stream.avail_in = static_cast<uInt>(idats[nextIdat].size);
+                nextIdat++;
+            }
+            int ret = inflate(&stream, Z_NO_FLUSH);
+            if (ret == Z_STREAM_END) {
+                streamEnded = true;
+            }
+            else if (ret != Z_OK) {
+                return false;
+            }
+        }
+        return stream.avail_out == 0;
+    };
+
+    const int srcChannels = colorType == COLOR_TYPE_RGBA ? 4 : 3;
+    const size_t rowBytes = static_cast<size_t>(width) * srcChannels;
+    const size_t dstRowBytes = static_cast<size_t>(width) * 4;
+
+    imageData.width = static_cast<int>(width);
+    imageData.height = static_cast<int>(height);
+    imageData.channels = 4;
+    imageData.data.AllocateUninitialized(dstRowBytes * height);
+
+    // RGB先在两行临时缓冲中反过滤，再扩展为RGBA；只有首行参考的全零行需要清零
+    BufferPool::Buffer rows(srcChannels == 4 ? rowBytes : rowBytes * 3);
+    memset(rows.data(), 0, rowBytes);
+    const uint8_t* zeroRow = rows.data();
+    uint8_t* current = srcChannels == 4 ? nullptr : rows.data() + rowBytes;
+    uint8_t* previous = srcChannels == 4 ? nullptr : rows.data() + rowBytes * 2;
+
+    bool success = true;
+    for (uint32_t y = 0; y < height && success; y++) {
+        uint8_t* dst = &imageData.data[y * dstRowBytes];
+        uint8_t filterType = 0;
+        if (srcChannels == 4) {
+            const uint8_t* prev = y > 0 ? dst - dstRowBytes : zeroRow;
+            success = inflateTo(&filterType, 1) && inflateTo(dst, rowBytes) &&
+                UnfilterRow(filterType, dst, prev, rowBytes, 4);
+        }
+        else {
+            const uint8_t* prev = y > 0 ? previous : zeroRow;
+            success = inflateTo(&filterType, 1) && inflateTo(current, rowBytes) &&
+                UnfilterRow(filterType, current, prev, rowBytes, 3);
+            if (success) {
+                PixelKernels::RgbToRgba(current, dst, width);
+                std::swap(current, previous);
+            }
+        }
+    }
+
+    // 校验模式下要求压缩流正常结束，以完成adler32检查
+    if (success && verifyCrc && !streamEnded) {
+        uint8_t extra = 0;
+        success = !inflateTo(&extra, 1) && streamEnded;
+    }
+    inflateEnd(&stream);
+
+    return success;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <string>
+#include "ImageProcessor.h"
+
+// 不经过libpng的PNG解码器，只处理8位RGB/RGBA非隔行图像
+class PngDecoder {
+public:
+    /**
+     * @brief 快速解码PNG数据为RGBA
+     * @param data PNG数据 (含签名)
+     * @param size 数据长度
+     * @param imageData 输出的图像数据
+     * @param verifyCrc 是否校验块CRC和zlib的adler32，可信输入可关闭
+     * @param comments 非空时输出所有键为comment的tEXt文本
+     * @return 成功解码返回true；格式不在支持范围内或数据有误时返回false，由调用方回退到libpng
+     * @note 压缩数据按行解压到目标缓冲后就地反过滤，RGB在反过滤后扩展为RGBA
+     */
+    static bool Decode(const uint8_t* data, size_t size, ImageData& imageData,
+        bool verifyCrc, std::vector<std::string>* comments);
+
+private:
+    /**
+     * @brief 反过滤一行扫描线
+     * @param type 过滤类型 (0-4)
+     * @param row 当前行，输入为残差，输出为原始数据
+     * @param prev 上一行原始数据，首行传入全零行
+     * @param rowBytes 行字节数
+     * @param bpp 每像素字节数 (3或4)
+     * @return 过滤类型有效返回true
+     */
+    static bool UnfilterRow(int type, uint8_t* row, const uint8_t* prev, size_t rowBytes, int bpp);
+};
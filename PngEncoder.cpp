@@ -0,0 +1,481 @@
+#include "PngEncoder.h"
+#include "Checksum.h"
+#include "FastDeflate.h"
+#include <png.h>
+#include <zlib.h>
+#include <cstring>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define PNG_ENCODER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// PNG文件签名
+static const uint8_t PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+// 每带至少包含的原始字节数，过小的带会明显降低压缩率
+constexpr size_t MIN_BAND_BYTES = 1 << 20;
+
+// deflate窗口大小，每带以上一带末尾数据作为预置字典
+constexpr size_t DEFLATE_WINDOW = 32768;
+
+// 单个IDAT块的最大数据长度
+constexpr size_t MAX_IDAT_SIZE = 1 << 30;
+
+// 单次送入deflate的最大长度，zlib的avail_in、avail_out为uInt
+constexpr size_t DEFLATE_MAX_CHUNK = 1u << 30;
+
+// 输出缓冲剩余不足此长度时扩容
+constexpr size_t DEFLATE_MIN_OUT = 4096;
+
+static void AppendU32(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static void StoreU32(uint8_t* out, uint32_t value) {
+    out[0] = static_cast<uint8_t>(value >> 24);
+    out[1] = static_cast<uint8_t>(value >> 16);
+    out[2] = static_cast<uint8_t>(value >> 8);
+    out[3] = static_cast<uint8_t>(value);
+}
+
+static inline uint8_t PaethPredictor(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = std::abs(p - a);
+    int pb = std::abs(p - b);
+    int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return static_cast<uint8_t>(a);
+    if (pb <= pc) return static_cast<uint8_t>(b);
+    return static_cast<uint8_t>(c);
+}
+
+// 按过滤类型计算一行残差
+static void ApplyFilter(int type, const uint8_t* row, const uint8_t* prev, size_t rowBytes, int bpp, uint8_t* out) {
+    switch (type) {
+    case 0:
+        memcpy(out, row, rowBytes);
+        break;
+    case 1:
+        for (size_t i = 0; i < rowBytes; i++) {
+            out[i] = static_cast<uint8_t>(row[i] - (i >= static_cast<size_t>(bpp) ? row[i - bpp] : 0));
+        }
+        break;
+    case 2:
+        for (size_t i = 0; i < rowBytes; i++) {
+            out[i] = static_cast<uint8_t>(row[i] - prev[i]);
+        }
+        break;
+    case 3:
+        for (size_t i = 0; i < rowBytes; i++) {
+            int left = i >= static_cast<size_t>(bpp) ? row[i - bpp] : 0;
+            out[i] = static_cast<uint8_t>(row[i] - ((left + prev[i]) >> 1));
+        }
+        break;
+    default:
+        for (size_t i = 0; i < rowBytes; i++) {
+            bool hasLeft = i >= static_cast<size_t>(bpp);
+            int left = hasLeft ? row[i - bpp] : 0;
+            int upLeft = hasLeft ? prev[i - bpp] : 0;
+            out[i] = static_cast<uint8_t>(row[i] - PaethPredictor(left, prev[i], upLeft));
+        }
+        break;
+    }
+}
+
+// 残差按有符号数的绝对值和，与libpng的自适应启发式一致
+static uint64_t SumAbs(const uint8_t* data, size_t size) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < size; i++) {
+        sum += data[i] < 128 ? data[i] : 256 - data[i];
+    }
+    return sum;
+}
+
+void PngEncoder::FilterRow(const uint8_t* row, const uint8_t* prev, size_t rowBytes, int bpp,
+    int filters, uint8_t* out, uint8_t* scratch) {
+    static const int FILTER_MASKS[5] = { PNG_FILTER_NONE, PNG_FILTER_SUB, PNG_FILTER_UP, PNG_FILTER_AVG, PNG_FILTER_PAETH };
+
+    int bestType = -1;
+    uint64_t bestSum = 0;
+    for (int type = 0; type < 5; type++) {
+        if (!(filters & FILTER_MASKS[type])) {
+            continue;
+        }
+        if (bestType < 0) {
+            ApplyFilter(type, row, prev, rowBytes, bpp, out + 1);
+            bestType = type;
+            bestSum = SumAbs(out + 1, rowBytes);
+            continue;
+        }
+        ApplyFilter(type, row, prev, rowBytes, bpp, scratch);
+        uint64_t sum = SumAbs(scratch, rowBytes);
+        if (sum < bestSum) {
+            memcpy(out + 1, scratch, rowBytes);
+            bestType = type;
+            bestSum = sum;
+        }
+    }
+
+    if (bestType < 0) {
+        bestType = 0;
+        memcpy(out + 1, row, rowBytes);
+    }
+    out[0] = static_cast<uint8_t>(bestType);
+}
+
+#if defined(PNG_ENCODER_SSE2)
+
+// 16字节残差的绝对值和 (按有符号数)
+static inline __m128i CostSse2(__m128i residual) {
+    __m128i negated = _mm_sub_epi8(_mm_setzero_si128(), residual);
+    return _mm_sad_epu8(_mm_min_epu8(residual, negated), _mm_setzero_si128());
+}
+
+// 16位通道上的Paeth预测
+static inline __m128i PaethSse2(__m128i a, __m128i b, __m128i c) {
+    __m128i pa = _mm_sub_epi16(b, c);
+    __m128i pb = _mm_sub_epi16(a, c);
+    __m128i pc = _mm_add_epi16(pa, pb);
+    pa = _mm_max_epi16(pa, _mm_sub_epi16(_mm_setzero_si128(), pa));
+    pb = _mm_max_epi16(pb, _mm_sub_epi16(_mm_setzero_si128(), pb));
+    pc = _mm_max_epi16(pc, _mm_sub_epi16(_mm_setzero_si128(), pc));
+
+    __m128i useA = _mm_andnot_si128(_mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc)), _mm_set1_epi16(-1));
+    __m128i useB = _mm_andnot_si128(_mm_cmpgt_epi16(pb, pc), _mm_set1_epi16(-1));
+    __m128i bc = _mm_or_si128(_mm_and_si128(useB, b), _mm_andnot_si128(useB, c));
+    return _mm_or_si128(_mm_and_si128(useA, a), _mm_andnot_si128(useA, bc));
+}
+
+#endif
+
+void PngEncoder::FilterRowRgba(const uint8_t* row, const uint8_t* prev, size_t rowBytes,
+    int filters, uint8_t* out, uint8_t* scratch) {
+    // scratch按过滤类型1-4分为四段
+    uint8_t* residuals[5] = { nullptr, scratch, scratch + rowBytes, scratch + rowBytes * 2, scratch + rowBytes * 3 };
+    uint64_t costs[5] = {};
+    const size_t bpp = 4;
+
+    // 首像素没有左邻，按标量计算
+    const size_t head = std::min(bpp, rowBytes);
+    for (size_t i = 0; i < head; i++) {
+        residuals[1][i] = row[i];
+        residuals[2][i] = static_cast<uint8_t>(row[i] - prev[i]);
+        residuals[3][i] = static_cast<uint8_t>(row[i] - (prev[i] >> 1));
+        residuals[4][i] = static_cast<uint8_t>(row[i] - prev[i]);
+    }
+
+    size_t i = head;
+#if defined(PNG_ENCODER_SSE2)
+    __m128i costNone = _mm_setzero_si128();
+    __m128i costSub = _mm_setzero_si128();
+    __m128i costUp = _mm_setzero_si128();
+    __m128i costAvg = _mm_setzero_si128();
+    __m128i costPaeth = _mm_setzero_si128();
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+
+    for (; i + 16 <= rowBytes; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i - bpp));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + i));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + i - bpp));
+
+        __m128i sub = _mm_sub_epi8(x, a);
+        __m128i up = _mm_sub_epi8(x, b);
+        // floor((a+b)/2) = 向上取整平均值 - ((a^b)&1)
+        __m128i avg = _mm_sub_epi8(x, _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one)));
+        __m128i predLo = PaethSse2(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(c, zero));
+        __m128i predHi = PaethSse2(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(c, zero));
+        __m128i paeth = _mm_sub_epi8(x, _mm_packus_epi16(predLo, predHi));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(residuals[1] + i), sub);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(residuals[2] + i), up);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(residuals[3] + i), avg);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(residuals[4] + i), paeth);
+
+        costNone = _mm_add_epi64(costNone, CostSse2(x));
+        costSub = _mm_add_epi64(costSub, CostSse2(sub));
+        costUp = _mm_add_epi64(costUp, CostSse2(up));
+        costAvg = _mm_add_epi64(costAvg, CostSse2(avg));
+        costPaeth = _mm_add_epi64(costPaeth, CostSse2(paeth));
+    }
+
+    __m128i sums[5] = { costNone, costSub, costUp, costAvg, costPaeth };
+    for (int type = 0; type < 5; type++) {
+        alignas(16) uint64_t lanes[2];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), sums[type]);
+        costs[type] = lanes[0] + lanes[1];
+    }
+#endif
+
+    const size_t vectorEnd = i;
+    for (; i < rowBytes; i++) {
+        int a = row[i - bpp], b = prev[i], c = prev[i - bpp];
+        residuals[1][i] = static_cast<uint8_t>(row[i] - a);
+        residuals[2][i] = static_cast<uint8_t>(row[i] - b);
+        residuals[3][i] = static_cast<uint8_t>(row[i] - ((a + b) >> 1));
+        residuals[4][i] = static_cast<uint8_t>(row[i] - PaethPredictor(a, b, c));
+    }
+
+    // 向量循环以外的部分补充计入代价
+    costs[0] += SumAbs(row, head) + SumAbs(row + vectorEnd, rowBytes - vectorEnd);
+    for (int type = 1; type < 5; type++) {
+        costs[type] += SumAbs(residuals[type], head) + SumAbs(residuals[type] + vectorEnd, rowBytes - vectorEnd);
+    }
+
+    static const int FILTER_MASKS[5] = { PNG_FILTER_NONE, PNG_FILTER_SUB, PNG_FILTER_UP, PNG_FILTER_AVG, PNG_FILTER_PAETH };
+    int bestType = -1;
+    for (int type = 0; type < 5; type++) {
+        if ((filters & FILTER_MASKS[type]) && (bestType < 0 || costs[type] < costs[bestType])) {
+            bestType = type;
+        }
+    }
+    if (bestType < 0) {
+        bestType = 0;
+    }
+
+    out[0] = static_cast<uint8_t>(bestType);
+    memcpy(out + 1, bestType == 0 ? row : residuals[bestType], rowBytes);
+}
+
+void PngEncoder::AppendChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size) {
+    AppendU32(out, static_cast<uint32_t>(size));
+    out.insert(out.end(), type, type + 4);
+    if (size > 0) {
+        out.insert(out.end(), data, data + size);
+    }
+    uint32_t crc = Checksum::Crc32(0, reinterpret_cast<const uint8_t*>(type), 4);
+    if (size > 0) {
+        crc = Checksum::Crc32(crc, data, size);
+    }
+    AppendU32(out, crc);
+}
+
+void PngEncoder::AppendHeader(std::vector<uint8_t>& out, const ImageData& imageData, bool writePos) {
+    out.insert(out.end(), PNG_SIGNATURE, PNG_SIGNATURE + sizeof(PNG_SIGNATURE));
+
+    uint8_t ihdr[13];
+    StoreU32(ihdr, static_cast<uint32_t>(imageData.width));
+    StoreU32(ihdr + 4, static_cast<uint32_t>(imageData.height));
+    ihdr[8] = 8;                                                            // 位深
+    ihdr[9] = imageData.channels == 4 ? PNG_COLOR_TYPE_RGBA : PNG_COLOR_TYPE_RGB;
+    ihdr[10] = 0;                                                           // 压缩方法
+    ihdr[11] = 0;                                                           // 过滤方法
+    ihdr[12] = 0;                                                           // 非隔行
+    AppendChunk(out, "IHDR", ihdr, sizeof(ihdr));
+
+    if (writePos) {
+        std::string text = "comment";
+        text.push_back('\0');
+        text += ImageProcessor::FormatPosComment(imageData);
+        AppendChunk(out, "tEXt", reinterpret_cast<const uint8_t*>(text.data()), text.size());
+    }
+}
+
+bool PngEncoder::Encode(const ImageData& imageData, std::vector<uint8_t>& pngData,
+    const PngEncodeOptions& options, bool writePos) {
+    if (options.encoder == PngEncoderType::Fast) {
+        return EncodeFast(imageData, pngData, options, writePos);
+    }
+    return EncodeParallel(imageData, pngData, options, writePos);
+}
+
+bool PngEncoder::EncodeParallel(const ImageData& imageData, std::vector<uint8_t>& pngData,
+    const PngEncodeOptions& options, bool writePos) {
+    const int bpp = imageData.channels;
+    const size_t rowBytes = static_cast<size_t>(imageData.width) * bpp;
+    const size_t height = static_cast<size_t>(imageData.height);
+    const size_t filteredRowBytes = rowBytes + 1;
+
+    // 划分带数：不超过线程数，且每带至少MIN_BAND_BYTES
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+    size_t rowsPerBand = std::max<size_t>(1, (MIN_BAND_BYTES + filteredRowBytes - 1) / filteredRowBytes);
+    size_t bandCount = std::min<size_t>(static_cast<size_t>(threads), (height + rowsPerBand - 1) / rowsPerBand);
+    bandCount = std::max<size_t>(1, bandCount);
+    rowsPerBand = (height + bandCount - 1) / bandCount;
+    bandCount = (height + rowsPerBand - 1) / rowsPerBand;
+
+    // libpng对过滤后的数据默认使用Z_FILTERED
+    int strategy = options.strategy;
+    if (strategy < 0) {
+        strategy = options.filters == PNG_FILTER_NONE ? Z_DEFAULT_STRATEGY : Z_FILTERED;
+    }
+
+    // 过滤后的全部扫描线，后一带的预置字典取自前一带末尾
+    BufferPool::Buffer filtered(filteredRowBytes * height);
+    std::vector<std::vector<uint8_t>> compressed(bandCount);
+    std::vector<uLong> adlers(bandCount, 0);
+    std::vector<size_t> bandSizes(bandCount, 0);
+    std::vector<int> results(bandCount, Z_OK);
+    const std::vector<uint8_t> zeroRow(rowBytes, 0);
+    const uint8_t* pixels = imageData.data.data();
+
+    // 第一阶段：逐带过滤
+#pragma omp parallel for schedule(static)
+    for (long long band = 0; band < static_cast<long long>(bandCount); band++) {
+        size_t firstRow = static_cast<size_t>(band) * rowsPerBand;
+        size_t lastRow = std::min(height, firstRow + rowsPerBand);
+        BufferPool::Buffer scratch(rowBytes);
+        for (size_t y = firstRow; y < lastRow; y++) {
+            const uint8_t* row = pixels + y * rowBytes;
+            const uint8_t* prev = y > 0 ? row - rowBytes : zeroRow.data();
+            FilterRow(row, prev, rowBytes, bpp, options.filters, &filtered[y * filteredRowBytes], scratch.data());
+        }
+    }
+
+    // 第二阶段：逐带压缩
+#pragma omp parallel for schedule(dynamic)
+    for (long long band = 0; band < static_cast<long long>(bandCount); band++) {
+        size_t begin = static_cast<size_t>(band) * rowsPerBand * filteredRowBytes;
+        size_t end = std::min(height, (static_cast<size_t>(band) + 1) * rowsPerBand) * filteredRowBytes;
+        size_t size = end - begin;
+        bool last = band + 1 == static_cast<long long>(bandCount);
+
+        bandSizes[band] = size;
+        adlers[band] = adler32_z(adler32(0L, Z_NULL, 0), &filtered[begin], size);
+
+        z_stream stream{};
+        int ret = deflateInit2(&stream, options.level, Z_DEFLATED, -15, 8, strategy);
+        if (ret != Z_OK) {
+            results[band] = ret;
+            continue;
+        }
+
+        if (band > 0) {
+            size_t dictSize = std::min(begin, DEFLATE_WINDOW);
+            deflateSetDictionary(&stream, &filtered[begin - dictSize], static_cast<uInt>(dictSize));
+        }
+
+        // avail_in、avail_out为uInt，超过DEFLATE_MAX_CHUNK的带分段送入
+        std::vector<uint8_t>& out = compressed[band];
+        out.reserve(size + size / 256 + 1024);
+        stream.next_in = &filtered[begin];
+        size_t remaining = size;
+        size_t used = 0;
+        do {
+            size_t chunk = std::min(remaining, DEFLATE_MAX_CHUNK);
+            remaining -= chunk;
+            stream.avail_in = static_cast<uInt>(chunk);
+
+            // 非末尾带以完全刷新结束，保证字节对齐且可直接拼接
+            int flush = remaining > 0 ? Z_NO_FLUSH : last ? Z_FINISH : Z_FULL_FLUSH;
+            do {
+                if (out.size() - used < DEFLATE_MIN_OUT) {
+                    size_t grow = deflateBound(&stream, static_cast<uLong>(chunk)) + 16;
+                    out.resize(used + std::clamp(grow, DEFLATE_MIN_OUT, DEFLATE_MAX_CHUNK));
+                }
+                stream.next_out = out.data() + used;
+                stream.avail_out = static_cast<uInt>(std::min(out.size() - used, DEFLATE_MAX_CHUNK));
+                uInt available = stream.avail_out;
+                ret = deflate(&stream, flush);
+                used += available - stream.avail_out;
+            } while (ret == Z_OK && stream.avail_out == 0);
+        } while (remaining > 0 && ret == Z_OK);
+
+        // 刷新恰好填满输出时再次调用可能返回Z_BUF_ERROR，此时数据已完整
+        if (!last && ret == Z_BUF_ERROR && stream.avail_in == 0) {
+            ret = Z_OK;
+        }
+
+        if ((last && ret != Z_STREAM_END) || (!last && ret != Z_OK)) {
+            results[band] = ret == Z_OK ? Z_BUF_ERROR : ret;
+        }
+        out.resize(used);
+        deflateEnd(&stream);
+    }
+
+    for (size_t band = 0; band < bandCount; band++) {
+        if (results[band] != Z_OK) {
+            Logger::Error("PNG分带压缩失败: zlib错误 " + std::to_string(results[band]));
+            return false;
+        }
+    }
+
+    // zlib头：CMF为32K窗口的deflate，FLG携带压缩级别并满足校验
+    uint8_t cmf = 0x78;
+    uint8_t flevel = options.level <= 1 ? 0 : options.level <= 5 ? 1 : options.level == 6 ? 2 : 3;
+    uint8_t flg = static_cast<uint8_t>(flevel << 6);
+    flg = static_cast<uint8_t>(flg + (31 - (cmf * 256 + flg) % 31));
+
+    // 合并各带的adler32
+    uLong adler = adlers[0];
+    for (size_t band = 1; band < bandCount; band++) {
+        adler = adler32_combine64(adler, adlers[band], static_cast<z_off64_t>(bandSizes[band]));
+    }
+
+    compressed.front().insert(compressed.front().begin(), { cmf, flg });
+    uint8_t trailer[4];
+    StoreU32(trailer, static_cast<uint32_t>(adler));
+    compressed.back().insert(compressed.back().end(), trailer, trailer + 4);
+
+    // 写出：每带一个IDAT块，超过MAX_IDAT_SIZE的带拆成多块
+    size_t total = 0;
+    for (const auto& part : compressed) {
+        total += part.size() + (part.size() / MAX_IDAT_SIZE + 1) * 12;
+    }
+    pngData.clear();
+    pngData.reserve(total + 128);
+    AppendHeader(pngData, imageData, writePos);
+    for (const auto& part : compressed) {
+        for (size_t offset = 0; offset < part.size(); offset += MAX_IDAT_SIZE) {
+            size_t size = std::min(MAX_IDAT_SIZE, part.size() - offset);
+            AppendChunk(pngData, "IDAT", part.data() + offset, size);
+        }
+    }
+    AppendChunk(pngData, "IEND", nullptr, 0);
+
+    return true;
+}
+
+bool PngEncoder::EncodeFast(const ImageData& imageData, std::vector<uint8_t>& pngData,
+    const PngEncodeOptions& options, bool writePos) {
+    if (imageData.channels != 4) {
+        return EncodeParallel(imageData, pngData, options, writePos);
+    }
+
+    const size_t rowBytes = static_cast<size_t>(imageData.width) * 4;
+    const size_t height = static_cast<size_t>(imageData.height);
+    const size_t filteredRowBytes = rowBytes + 1;
+    const uint8_t* pixels = imageData.data.data();
+
+    // 过滤全部扫描线
+    BufferPool::Buffer filtered(filteredRowBytes * height);
+    const std::vector<uint8_t> zeroRow(rowBytes, 0);
+
+#pragma omp parallel
+    {
+        BufferPool::Buffer scratch(rowBytes * 4);
+#pragma omp for schedule(static)
+        for (long long y = 0; y < static_cast<long long>(height); y++) {
+            const uint8_t* row = pixels + y * rowBytes;
+            const uint8_t* prev = y > 0 ? row - rowBytes : zeroRow.data();
+            FilterRowRgba(row, prev, rowBytes, options.filters, &filtered[y * filteredRowBytes], scratch.data());
+        }
+    }
+
+    std::vector<uint8_t> compressed;
+    compressed.reserve(filtered.size() / 4 + 1024);
+    FastDeflate::Compress(filtered.data(), filtered.size(), compressed);
+
+    pngData.clear();
+    pngData.reserve(compressed.size() + 128);
+    AppendHeader(pngData, imageData, writePos);
+    for (size_t offset = 0; offset < compressed.size(); offset += MAX_IDAT_SIZE) {
+        size_t size = std::min(MAX_IDAT_SIZE, compressed.size() - offset);
+        AppendChunk(pngData, "IDAT", compressed.data() + offset, size);
+    }
+    AppendChunk(pngData, "IEND", nullptr, 0);
+
+    return true;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <string>
+#include "ImageProcessor.h"
+
+// 不经过libpng的PNG编码器，只处理8位RGB/RGBA非隔行图像
+class PngEncoder {
+public:
+    /**
+     * @brief 按options.encoder选择的编码器编码PNG
+     * @param imageData 图像数据
+     * @param pngData 输出的PNG数据
+     * @param options 编码参数
+     * @param writePos 是否写入坐标信息tEXt块
+     * @return 成功编码返回true，否则返回false
+     */
+    static bool Encode(const ImageData& imageData, std::vector<uint8_t>& pngData,
+        const PngEncodeOptions& options, bool writePos);
+
+    /**
+     * @brief 分带并行压缩编码PNG
+     * @param imageData 图像数据
+     * @param pngData 输出的PNG数据
+     * @param options 编码参数 (压缩级别、过滤器、压缩策略)
+     * @param writePos 是否写入坐标信息tEXt块
+     * @return 成功编码返回true，否则返回false
+     * @note 扫描行按行数分带，每带在独立线程中过滤并压缩为以完全刷新结尾的deflate片段，
+     *       拼接为一个zlib流后合并adler32，并作为多个IDAT块写出
+     */
+    static bool EncodeParallel(const ImageData& imageData, std::vector<uint8_t>& pngData,
+        const PngEncodeOptions& options, bool writePos);
+
+    /**
+     * @brief 使用内置deflate快速编码PNG
+     * @param imageData 图像数据
+     * @param pngData 输出的PNG数据
+     * @param options 编码参数，只使用过滤器掩码
+     * @param writePos 是否写入坐标信息tEXt块
+     * @return 成功编码返回true，否则返回false
+     * @note 面向8位RGBA立绘：SIMD计算各过滤器残差并选择代价最小者，
+     *       再以单候选哈希的贪心LZ77和动态Huffman压缩，速度远快于zlib的最低级别。
+     *       非RGBA图像回退到EncodeParallel
+     */
+    static bool EncodeFast(const ImageData& imageData, std::vector<uint8_t>& pngData,
+        const PngEncodeOptions& options, bool writePos);
+
+private:
+    /**
+     * @brief 写入PNG签名、IHDR块和可选的坐标tEXt块
+     * @param out 输出缓冲
+     * @param imageData 图像数据
+     * @param writePos 是否写入坐标信息
+     */
+    static void AppendHeader(std::vector<uint8_t>& out, const ImageData& imageData, bool writePos);
+
+    /**
+     * @brief 追加一个完整的PNG块 (长度、类型、数据、CRC)
+     * @param out 输出缓冲
+     * @param type 4字节块类型
+     * @param data 块数据
+     * @param size 数据长度
+     */
+    static void AppendChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size);
+
+    /**
+     * @brief 过滤一行扫描线
+     * @param row 当前行原始数据
+     * @param prev 上一行原始数据，首行传入全零行
+     * @param rowBytes 行字节数
+     * @param bpp 每像素字节数
+     * @param filters 允许的过滤器掩码，多个时按最小绝对值和选择
+     * @param out 输出 (1字节过滤类型 + rowBytes字节数据)
+     * @param scratch 至少rowBytes字节的临时缓冲
+     */
+    static void FilterRow(const uint8_t* row, const uint8_t* prev, size_t rowBytes, int bpp,
+        int filters, uint8_t* out, uint8_t* scratch);
+
+    /**
+     * @brief 过滤一行RGBA扫描线 (SIMD版本)
+     * @param row 当前行原始数据
+     * @param prev 上一行原始数据，首行传入全零行
+     * @param rowBytes 行字节数
+     * @param filters 允许的过滤器掩码
+     * @param out 输出 (1字节过滤类型 + rowBytes字节数据)
+     * @param scratch 至少4*rowBytes字节的临时缓冲
+     */
+    static void FilterRowRgba(const uint8_t* row, const uint8_t* prev, size_t rowBytes,
+        int filters, uint8_t* out, uint8_t* scratch);
+};
@@ -0,0 +1,274 @@
+#include "QoiCodec.h"
+#include <cstring>
+#include <cstdio>
+
+// 文件头: "qoif" + 宽 + 高 + 通道数 + 色彩空间
+constexpr size_t QOI_HEADER_SIZE = 14;
+
+// 结束标记: 7个0x00和1个0x01
+constexpr size_t QOI_END_SIZE = 8;
+static const uint8_t QOI_END_MARKER[QOI_END_SIZE] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+
+// 坐标尾部段: 注释文本 + 4字节文本长度 + 4字节标识，从文件末尾向前解析
+constexpr size_t QOI_POS_TRAILER_SIZE = 8;
+static const char QOI_POS_MAGIC[4] = { 'a', 'p', 'o', 's' };
+
+// 与参考实现一致的最大像素数
+constexpr uint64_t QOI_PIXELS_MAX = 400000000;
+
+// 操作码
+constexpr uint8_t QOI_OP_INDEX = 0x00;
+constexpr uint8_t QOI_OP_DIFF = 0x40;
+constexpr uint8_t QOI_OP_LUMA = 0x80;
+constexpr uint8_t QOI_OP_RUN = 0xc0;
+constexpr uint8_t QOI_OP_RGB = 0xfe;
+constexpr uint8_t QOI_OP_RGBA = 0xff;
+constexpr uint8_t QOI_MASK_2 = 0xc0;
+
+// 游程最长62，63和64与RGB/RGBA操作码冲突
+constexpr int QOI_MAX_RUN = 62;
+
+static inline uint32_t ReadU32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+        (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+static inline void AppendU32(uint8_t* p, uint32_t value) {
+    p[0] = static_cast<uint8_t>(value >> 24);
+    p[1] = static_cast<uint8_t>(value >> 16);
+    p[2] = static_cast<uint8_t>(value >> 8);
+    p[3] = static_cast<uint8_t>(value);
+}
+
+static inline int PixelHash(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+    return (r * 3 + g * 5 + b * 7 + a * 11) & 63;
+}
+
+bool QoiCodec::Encode(const ImageView& image, std::vector<uint8_t>& qoiData, const std::string& posComment) {
+    if (!image.pixels || image.width <= 0 || image.height <= 0 ||
+        (image.channels != 3 && image.channels != 4) ||
+        static_cast<uint64_t>(image.width) * image.height > QOI_PIXELS_MAX) {
+        return false;
+    }
+
+    // 最坏情况每个像素都是RGBA操作码
+    const size_t pixelCount = static_cast<size_t>(image.width) * image.height;
+    const size_t maxSize = QOI_HEADER_SIZE + pixelCount * (image.channels + 1) + QOI_END_SIZE +
+        posComment.size() + QOI_POS_TRAILER_SIZE;
+    qoiData.resize(maxSize);
+    uint8_t* out = qoiData.data();
+
+    memcpy(out, "qoif", 4);
+    AppendU32(out + 4, static_cast<uint32_t>(image.width));
+    AppendU32(out + 8, static_cast<uint32_t>(image.height));
+    out[12] = static_cast<uint8_t>(image.channels);
+    out[13] = 0;    // sRGB，alpha非预乘
+    size_t p = QOI_HEADER_SIZE;
+
+    uint32_t index[64] = {};
+    uint8_t pr = 0, pg = 0, pb = 0, pa = 255;
+    int run = 0;
+    const int channels = image.channels;
+    for (int y = 0; y < image.height; y++) {
+        const uint8_t* row = image.Row(y);
+        for (int x = 0; x < image.width; x++) {
+            const uint8_t* px = row + x * channels;
+            const uint8_t r = px[0];
+            const uint8_t g = px[1];
+            const uint8_t b = px[2];
+            const uint8_t a = channels == 4 ? px[3] : 255;
+
+            if (r == pr && g == pg && b == pb && a == pa) {
+                if (++run == QOI_MAX_RUN) {
+                    out[p++] = static_cast<uint8_t>(QOI_OP_RUN | (run - 1));
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0) {
+                out[p++] = static_cast<uint8_t>(QOI_OP_RUN | (run - 1));
+                run = 0;
+            }
+
+            const uint32_t packed = (static_cast<uint32_t>(r) << 24) | (static_cast<uint32_t>(g) << 16) |
+                (static_cast<uint32_t>(b) << 8) | a;
+            const int hash = PixelHash(r, g, b, a);
+            if (index[hash] == packed) {
+                out[p++] = static_cast<uint8_t>(QOI_OP_INDEX | hash);
+            }
+            else {
+                index[hash] = packed;
+                if (a == pa) {
+                    const int8_t vr = static_cast<int8_t>(r - pr);
+                    const int8_t vg = static_cast<int8_t>(g - pg);
+                    const int8_t vb = static_cast<int8_t>(b - pb);
+                    const int8_t vgr = static_cast<int8_t>(vr - vg);
+                    const int8_t vgb = static_cast<int8_t>(vb - vg);
+                    if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                        out[p++] = static_cast<uint8_t>(QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+                    }
+                    else if (vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8) {
+                        out[p++] = static_cast<uint8_t>(QOI_OP_LUMA | (vg + 32));
+                        out[p++] = static_cast<uint8_t>((vgr + 8) << 4 | (vgb + 8));
+                    }
+                    else {
+                        out[p++] = QOI_OP_RGB;
+                        out[p++] = r;
+                        out[p++] = g;
+                        out[p++] = b;
+                    }
+                }
+                else {
+                    out[p++] = QOI_OP_RGBA;
+                    out[p++] = r;
+                    out[p++] = g;
+                    out[p++] = b;
+                    out[p++] = a;
+                }
+            }
+            pr = r;
+            pg = g;
+            pb = b;
+            pa = a;
+        }
+    }
+    if (run > 0) {
+        out[p++] = static_cast<uint8_t>(QOI_OP_RUN | (run - 1));
+    }
+
+    memcpy(out + p, QOI_END_MARKER, QOI_END_SIZE);
+    p += QOI_END_SIZE;
+
+    if (!posComment.empty()) {
+        memcpy(out + p, posComment.data(), posComment.size());
+        p += posComment.size();
+        AppendU32(out + p, static_cast<uint32_t>(posComment.size()));
+        memcpy(out + p + 4, QOI_POS_MAGIC, 4);
+        p += QOI_POS_TRAILER_SIZE;
+    }
+
+    qoiData.resize(p);
+    return true;
+}
+
+bool QoiCodec::Decode(const uint8_t* data, size_t size, ImageData& imageData, bool readPos) {
+    PngInfo info;
+    if (!Probe(data, size, info)) {
+        return false;
+    }
+
+    const size_t pixelCount = static_cast<size_t>(info.width) * info.height;
+    imageData.width = info.width;
+    imageData.height = info.height;
+    imageData.channels = 4;
+    imageData.data.AllocateUninitialized(pixelCount * 4);
+    uint8_t* out = imageData.data.data();
+
+    size_t p = QOI_HEADER_SIZE;
+    // 结束标记后可能有坐标尾部段，只按数据总长检查越界
+    uint8_t index[64][4] = {};
+    uint8_t px[4] = { 0, 0, 0, 255 };
+    int run = 0;
+    for (size_t i = 0; i < pixelCount; i++) {
+        if (run > 0) {
+            run--;
+        }
+        else {
+            if (p >= size) {
+                return false;
+            }
+            const uint8_t op = data[p++];
+            if (op == QOI_OP_RGB) {
+                if (p + 3 > size) {
+                    return false;
+                }
+                px[0] = data[p];
+                px[1] = data[p + 1];
+                px[2] = data[p + 2];
+                p += 3;
+            }
+            else if (op == QOI_OP_RGBA) {
+                if (p + 4 > size) {
+                    return false;
+                }
+                memcpy(px, data + p, 4);
+                p += 4;
+            }
+            else if ((op & QOI_MASK_2) == QOI_OP_INDEX) {
+                memcpy(px, index[op], 4);
+            }
+            else if ((op & QOI_MASK_2) == QOI_OP_DIFF) {
+                px[0] = static_cast<uint8_t>(px[0] + ((op >> 4) & 0x03) - 2);
+                px[1] = static_cast<uint8_t>(px[1] + ((op >> 2) & 0x03) - 2);
+                px[2] = static_cast<uint8_t>(px[2] + (op & 0x03) - 2);
+            }
+            else if ((op & QOI_MASK_2) == QOI_OP_LUMA) {
+                if (p >= size) {
+                    return false;
+                }
+                const uint8_t b2 = data[p++];
+                const int vg = (op & 0x3f) - 32;
+                px[0] = static_cast<uint8_t>(px[0] + vg - 8 + ((b2 >> 4) & 0x0f));
+                px[1] = static_cast<uint8_t>(px[1] + vg);
+                px[2] = static_cast<uint8_t>(px[2] + vg - 8 + (b2 & 0x0f));
+            }
+            else {
+                run = op & 0x3f;
+            }
+            memcpy(index[PixelHash(px[0], px[1], px[2], px[3])], px, 4);
+        }
+        memcpy(out + i * 4, px, 4);
+    }
+
+    if (readPos) {
+        imageData.posX = info.posX;
+        imageData.posY = info.posY;
+    }
+    return true;
+}
+
+bool QoiCodec::Probe(const uint8_t* data, size_t size, PngInfo& info) {
+    info = PngInfo();
+    if (!data || size < QOI_HEADER_SIZE + QOI_END_SIZE || memcmp(data, "qoif", 4) != 0) {
+        return false;
+    }
+
+    const uint32_t width = ReadU32(data + 4);
+    const uint32_t height = ReadU32(data + 8);
+    const uint8_t channels = data[12];
+    if (width == 0 || height == 0 || (channels != 3 && channels != 4) ||
+        static_cast<uint64_t>(width) * height > QOI_PIXELS_MAX) {
+        return false;
+    }
+    info.width = static_cast<int>(width);
+    info.height = static_cast<int>(height);
+    info.hasPos = ReadPosTrailer(data, size, info.posX, info.posY);
+    return true;
+}
+
+bool QoiCodec::ReadPosTrailer(const uint8_t* data, size_t size, int& posX, int& posY) {
+    posX = 0;
+    posY = 0;
+    const size_t minSize = QOI_HEADER_SIZE + QOI_END_SIZE + QOI_POS_TRAILER_SIZE;
+    if (size < minSize || memcmp(data + size - 4, QOI_POS_MAGIC, 4) != 0) {
+        return false;
+    }
+
+    // 注释文本前必须紧接结束标记
+    const size_t length = ReadU32(data + size - QOI_POS_TRAILER_SIZE);
+    if (length > size - minSize) {
+        return false;
+    }
+    const size_t textOffset = size - QOI_POS_TRAILER_SIZE - length;
+    if (memcmp(data + textOffset - QOI_END_SIZE, QOI_END_MARKER, QOI_END_SIZE) != 0) {
+        return false;
+    }
+
+    std::string text(reinterpret_cast<const char*>(data + textOffset), length);
+    if (!ImageProcessor::ParsePosComment(text, posX, posY)) {
+        posX = 0;
+        posY = 0;
+        return false;
+    }
+    return true;
+}
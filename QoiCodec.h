@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <string>
+#include "ImageProcessor.h"
+
+// QOI格式编解码器
+// QOI逐像素编码为索引、差值、游程等短操作码，不做熵编码，编解码速度远快于PNG，
+// 适合只需预览的输出和中间缓存。坐标信息以尾部附加段保存在结束标记之后，
+// 内容与PNG的tEXt注释相同，其他QOI解码器会忽略该段
+class QoiCodec {
+public:
+    /**
+     * @brief 编码QOI图像
+     * @param image 图像视图 (3或4通道)
+     * @param qoiData 输出的QOI数据
+     * @param posComment 非空时作为坐标信息附加在文件尾部
+     * @return 成功编码返回true，否则返回false
+     */
+    static bool Encode(const ImageView& image, std::vector<uint8_t>& qoiData, const std::string& posComment);
+
+    /**
+     * @brief 解码QOI数据为RGBA
+     * @param data QOI数据
+     * @param size 数据长度
+     * @param imageData 输出的图像数据，3通道图像扩展为RGBA
+     * @param readPos 是否读取尾部的坐标信息
+     * @return 成功解码返回true，格式错误或数据不完整时返回false
+     */
+    static bool Decode(const uint8_t* data, size_t size, ImageData& imageData, bool readPos);
+
+    /**
+     * @brief 只读取文件头和尾部的坐标信息
+     * @param data QOI数据
+     * @param size 数据长度
+     * @param info 输出的尺寸和坐标
+     * @return 文件头有效返回true
+     */
+    static bool Probe(const uint8_t* data, size_t size, PngInfo& info);
+
+private:
+    /**
+     * @brief 从文件尾部读取坐标信息
+     * @param data QOI数据
+     * @param size 数据长度
+     * @param posX 输出的左坐标
+     * @param posY 输出的上坐标
+     * @return 找到有效的坐标信息返回true
+     */
+    static bool ReadPosTrailer(const uint8_t* data, size_t size, int& posX, int& posY);
+};
@@ -0,0 +1,58 @@
+#include "ResultCache.h"
+
+std::shared_ptr<const ResultCache::Result> ResultCache::Find(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(key);
+    if (it == index.end()) {
+        misses++;
+        return nullptr;
+    }
+    hits++;
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->second;
+}
+
+void ResultCache::Insert(const std::string& key, std::shared_ptr<const Result> result) {
+    const size_t size = result->body.size();
+    if (size > maxBytes) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    // 多个请求同时合成同一结果时保留后到的
+    auto it = index.find(key);
+    if (it != index.end()) {
+        bytes -= it->second->second->body.size();
+        entries.erase(it->second);
+        index.erase(it);
+    }
+
+    while (!entries.empty() && bytes + size > maxBytes) {
+        bytes -= entries.back().second->body.size();
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+    entries.emplace_front(key, std::move(result));
+    index.emplace(key, entries.begin());
+    bytes += size;
+}
+
+size_t ResultCache::HitCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hits;
+}
+
+size_t ResultCache::MissCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return misses;
+}
+
+size_t ResultCache::EntryCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+size_t ResultCache::ByteCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytes;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 合成结果的LRU缓存
+// 按结果占用的字节数限制容量，超出时淘汰最久未使用的结果。结果以共享指针返回，
+// 被淘汰后正在发送的结果仍然有效；可在多个线程同时使用
+class ResultCache {
+public:
+    // 一个合成结果
+    struct Result {
+        std::vector<uint8_t> body;  // 编码后的图像或原始RGBA像素
+        int width = 0;
+        int height = 0;
+        int posX = 0;               // 合成结果的坐标
+        int posY = 0;
+    };
+
+    /**
+     * @param maxBytes 缓存结果的总字节数上限，0表示不缓存
+     */
+    explicit ResultCache(size_t maxBytes) : maxBytes(maxBytes) {}
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    /**
+     * @brief 查找结果，找到时标记为最近使用
+     * @param key 结果的键
+     * @return 结果，不存在时返回nullptr
+     */
+    std::shared_ptr<const Result> Find(const std::string& key);
+
+    /**
+     * @brief 加入结果，超出容量时淘汰最久未使用的结果
+     * @param key 结果的键，已存在时替换
+     * @param result 结果
+     * @note 单个结果超过容量上限时不缓存
+     */
+    void Insert(const std::string& key, std::shared_ptr<const Result> result);
+
+    size_t HitCount() const;
+    size_t MissCount() const;
+    size_t EntryCount() const;
+    size_t ByteCount() const;
+
+private:
+    using Entry = std::pair<std::string, std::shared_ptr<const Result>>;
+
+    std::list<Entry> entries;   // 最近使用的在前
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    size_t maxBytes;
+    size_t bytes = 0;
+    size_t hits = 0;
+    size_t misses = 0;
+    mutable std::mutex mutex;
+};
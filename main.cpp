@@ -1,16 +1,27 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <csignal>
 #include <filesystem>
+#include "BatchRunner.h"
+#include "ComposeServer.h"
 #include "Config.h"
 #include "FgComposer.h"
+#include "LuaParser.h"
 
 namespace fs = std::filesystem;
 
 void PrintUsage(const char* programName);
 
+// 监视和服务模式下收到Ctrl+C时置位，主循环在下一次等待超时后退出
+static volatile std::sig_atomic_t stopRequested = 0;
+
+static void RequestStop(int) {
+    stopRequested = 1;
+}
+
 int main(int argc, char* argv[]) {
-    // Ϸ
+    // 拖放
     if (argc == 2 && fs::is_directory(argv[1])) {
         std::string inputDir = argv[1];
 
@@ -22,55 +33,115 @@ int main(int argc, char* argv[]) {
             success = composer.process();
         }
         catch (const std::exception& e) {
-            Logger::Error("쳣: " + std::string(e.what()));
+            Logger::Error("发生异常: " + std::string(e.what()));
             success = false;
         }
-        std::cout << "\n...";
+        std::cout << "\n按任意键继续...";
         std::cin.get();
         return success ? 0 : 1;
     }
 
-    // в
+    // 解析命令行参数
     Config config = Config::Parse(argc, argv);
 
-    // 
+    // 帮助
     if (config.helpRequested) {
         PrintUsage(argv[0]);
-        std::cout << "\n...";
+        std::cout << "\n按任意键继续...";
         std::cin.get();
         return 0;
     }
 
     Logger::SetLevel(config.verbose ? Logger::Level::DEBUG : Logger::Level::INFO);
+    // 归档写到标准输出时日志改走标准错误，避免混入归档数据
+    if (config.archivePath == "-") {
+        Logger::SetUseStderr(true);
+    }
+
+    // 只对比坐标表解析耗时，不需要输入目录
+    if (!config.benchLuaPath.empty()) {
+        return LuaParser::Benchmark(config.benchLuaPath, 20) ? 0 : 1;
+    }
 
-    // ֤
+    // 验证输入
     if (!config.Validate()) {
         return 1;
     }
 
     try {
+        // 递归或按任务文件批量处理多个目录
+        if (config.recursive || !config.jobFile.empty()) {
+            BatchRunner runner(config);
+            return runner.Run() ? 0 : 1;
+        }
+        // 监视输入目录，文件变化时只重新合成受影响的组合
+        if (config.watch) {
+            std::signal(SIGINT, RequestStop);
+            std::signal(SIGTERM, RequestStop);
+            FgComposer composer(config);
+            return composer.watch([] { return stopRequested != 0; }) ? 0 : 1;
+        }
+        // 部件常驻内存，通过本机HTTP按需合成
+        if (config.servePort > 0) {
+            std::signal(SIGINT, RequestStop);
+            std::signal(SIGTERM, RequestStop);
+            ComposeServer server(config);
+            return server.Run([] { return stopRequested != 0; }) ? 0 : 1;
+        }
         FgComposer composer(config);
         bool success = composer.process();
         return success ? 0 : 1;
     }
     catch (const std::exception& e) {
-        Logger::Error("쳣: " + std::string(e.what()));
+        Logger::Error("发生异常: " + std::string(e.what()));
         return 1;
     }
 }
 
-// ӡ
+// 打印帮助
 void PrintUsage(const char* programName) {
-    std::cout << "÷: " << programName << " [ѡ] <Ŀ¼>\n"
-              << "ѡ:\n"
-              << "  --help, -h              ʾϢ\n"
-              << "  --verbose, -v           ϸ־\n"
-              << "  --write-pos-back, -w    λϢдļԶκϳ\n"
-              << "  --lua-path, -l <·>   ϢLuaű·\n"
-              << "  --output, -o <·>     Ŀ¼, ĬϱĿ¼ͬoutputļ\n"
-              << "  <Ŀ¼>              Ŀ¼\n"
+    std::cout << "用法: " << programName << " [选项] <输入目录>\n"
+              << "选项:\n"
+              << "  --help, -h              显示帮助信息\n"
+              << "  --verbose, -v           输出详细日志\n"
+              << "  --write-pos-back, -w    将位置信息写回文件以二次合成\n"
+              << "  --stream                逐带合成并直接写出, 内存只与画布宽度有关, 固定使用libpng编码\n"
+              << "  --huge-pages            2MB以上的画布和缓冲尝试使用大页内存\n"
+              << "  --dry-run, -n           只读取PNG文件头, 预估组合数量、画布大小和内存, 不输出图像\n"
+              << "  --watch                 合成后监视输入目录和坐标表, 文件变化时只重新合成受影响的组合\n"
+              << "  --serve <端口>          加载部件后在127.0.0.1上提供HTTP合成服务, 按需合成指定的组合\n"
+              << "  --serve-cache <MB>      合成服务缓存结果的上限, 默认256\n"
+              << "  --recursive, -r         查找输入目录下所有含有图像的目录并批量合成\n"
+              << "  --job-file <路径>       批量任务文件, 每行一个输入目录, 可用制表符分隔指定输出目录\n"
+              << "  --batch-threads <数量>  批量模式同时处理的目录数, 默认与CPU核心数相同\n"
+              << "  --lua-path, -l <路径>   含有坐标信息的Lua脚本路径\n"
+              << "  --lua-index <目录>      坐标表解析结果保存为索引，之后的运行直接映射索引\n"
+              << "  --bench-lua <路径>      对比坐标表的字面量解析与Lua执行耗时后退出\n"
+              << "  --output, -o <路径>     输出目录, 默认保存在输入目录同级的output文件夹\n"
+              << "  --cache <路径>          已解码部件缓存文件, 重复运行时跳过PNG解码\n"
+              << "  --pfs <归档>            直接从PFS归档读取部件, 输入目录为归档内的路径\n"
+              << "  --format <png|qoi>      输出格式, 默认png; qoi编码极快但不压缩, 适合预览\n"
+              << "  --atlas                 按基础图像把合成结果装入图集, 并输出JSON索引\n"
+              << "  --atlas-size <像素>     图集的最大宽高, 默认4096\n"
+              << "  --delta                 基础图像只输出一次, 各组合只输出部件覆盖的区域, 并输出JSON清单\n"
+              << "  --archive <路径>        所有输出写入一个归档文件, \"-\"表示写到标准输出\n"
+              << "  --archive-format <zip|tar> 归档格式, 默认按扩展名判断, 其他情况为zip\n"
+              << "  --write-queue <MB>      后台写出的在途数据上限, 默认256; 0为在合成线程同步写出\n"
+              << "  --png-encoder <名称>    PNG编码器: libpng(默认), parallel(分带并行压缩, 适合超大图像),\n"
+              << "                          fast(内置快速压缩, 忽略压缩级别和策略)\n"
+              << "  --png-level <0-9|auto>  PNG压缩级别, 默认6, auto为抽样试编码自动选择参数\n"
+              << "  --png-filter <名称>     PNG行过滤器: none, sub, up, avg, paeth, all(默认)\n"
+              << "  --png-strategy <名称>   zlib压缩策略: default, filtered, huffman, rle, fixed\n"
+              << "  --png-target-speed <MB/s>  auto模式: 在满足编码速度的参数中选体积最小的\n"
+              << "  --png-target-ratio <%>     auto模式: 在满足压缩率的参数中选速度最快的\n"
+              << "  --png-decoder <名称>    PNG解码器: fast(默认, 8位RGB/RGBA使用内置解码), libpng\n"
+              << "  --png-skip-crc          跳过PNG的CRC和adler32校验, 仅用于可信输入\n"
+              << "  <输入目录>              输入目录\n"
               << std::endl;
-    std::cout << "ʾ: " << programName << " -v -w -l ./list_windows.tbl ./input" << std::endl;
-    std::cout << "ʾ: " << programName << " --output ./output ./input" << std::endl;
-    std::cout << "ʾ: " << programName << " ./input" << std::endl;
+    std::cout << "示例: " << programName << " -v -w -l ./list_windows.tbl ./input" << std::endl;
+    std::cout << "示例: " << programName << " --output ./output ./input" << std::endl;
+    std::cout << "示例: " << programName << " -r -l ./list_windows.tbl ./fgimage" << std::endl;
+    std::cout << "示例: " << programName << " --watch -l ./list_windows.tbl ./input" << std::endl;
+    std::cout << "示例: " << programName << " --serve 8700 -l ./list_windows.tbl ./input" << std::endl;
+    std::cout << "示例: " << programName << " ./input" << std::endl;
 }
\ No newline at end of file
@@ -1,6 +1,6 @@
 //{{NO_DEPENDENCIES}}
-// Microsoft Visual C++ ɵİļ
-//  Resource.rc ʹ
+// Microsoft Visual C++ 生成的包含文件。
+// 供 Resource.rc 使用
 //
 #define IDI_ICON1                       101
 
@@ -0,0 +1,222 @@
+// 合成服务的往返测试
+// 生成一组部件，启动服务后用本机客户端请求各个组合，结果应与直接合成一致
+
+#include "ComposeServer.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "失败: " << message << std::endl;
+        failures++;
+    }
+}
+
+// 生成带坐标的RGBA部件，内容随坐标变化以便区分
+static bool writePart(const fs::path& path, int width, int height, int posX, int posY, uint8_t alpha) {
+    ImageData image(width, height, 4, posX, posY);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t* pixel = image.data.data() + (static_cast<size_t>(y) * width + x) * 4;
+            pixel[0] = static_cast<uint8_t>(x * 7 + posX);
+            pixel[1] = static_cast<uint8_t>(y * 5 + posY);
+            pixel[2] = static_cast<uint8_t>((x ^ y) * 3);
+            pixel[3] = (x + y) % 5 == 0 ? 0 : alpha;
+        }
+    }
+    return ImageProcessor::SavePngWithPos(path.string(), image);
+}
+
+// 向系统申请一个空闲端口
+static int findFreePort() {
+    int probe = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    int port = 0;
+    if (bind(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0 &&
+        getsockname(probe, reinterpret_cast<sockaddr*>(&address), &length) == 0) {
+        port = ntohs(address.sin_port);
+    }
+    close(probe);
+    return port;
+}
+
+// 连接服务，服务在加载部件期间尚未监听，重试到超时
+static int connectServer(int port) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (std::chrono::steady_clock::now() < deadline) {
+        int client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(static_cast<uint16_t>(port));
+        if (connect(client, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0) {
+            return client;
+        }
+        close(client);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return -1;
+}
+
+struct HttpResponse {
+    int status = 0;
+    std::string head;
+    std::string body;
+
+    std::string Header(const std::string& name) const {
+        size_t begin = head.find("\r\n" + name + ": ");
+        if (begin == std::string::npos) {
+            return "";
+        }
+        begin += name.size() + 4;
+        return head.substr(begin, head.find("\r\n", begin) - begin);
+    }
+};
+
+// 在保持的连接上发送一个GET请求并读取完整响应
+static bool request(int client, const std::string& target, std::string& pending, HttpResponse& response) {
+    const std::string text = "GET " + target + " HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    if (send(client, text.data(), text.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(text.size())) {
+        return false;
+    }
+
+    char chunk[4096];
+    auto receive = [&]() {
+        ssize_t received = recv(client, chunk, sizeof(chunk), 0);
+        if (received <= 0) {
+            return false;
+        }
+        pending.append(chunk, static_cast<size_t>(received));
+        return true;
+    };
+
+    size_t headEnd;
+    while ((headEnd = pending.find("\r\n\r\n")) == std::string::npos) {
+        if (!receive()) {
+            return false;
+        }
+    }
+    response.head = pending.substr(0, headEnd + 2);
+    pending.erase(0, headEnd + 4);
+    response.status = std::atoi(response.head.c_str() + response.head.find(' ') + 1);
+
+    const size_t bodySize = std::stoull(response.Header("Content-Length"));
+    while (pending.size() < bodySize) {
+        if (!receive()) {
+            return false;
+        }
+    }
+    response.body = pending.substr(0, bodySize);
+    pending.erase(0, bodySize);
+    return true;
+}
+
+static bool samePixels(const std::string& body, const ImageData& image) {
+    return body.size() == image.data.size() && memcmp(body.data(), image.data.data(), body.size()) == 0;
+}
+
+int main() {
+    Logger::SetLevel(Logger::Level::WARNING);
+
+    const fs::path root = fs::temp_directory_path() / ("afc_server_test_" + std::to_string(getpid()));
+    const fs::path inputDir = root / "chr" / "no";
+    fs::create_directories(inputDir);
+    bool written = writePart(inputDir / "chr_noa0001.png", 48, 64, 100, 50, 255) &&
+        writePart(inputDir / "a0010.png", 16, 12, 110, 60, 200) &&
+        writePart(inputDir / "a0020.png", 20, 10, 120, 70, 128) &&
+        writePart(inputDir / "a0091.png", 12, 12, 130, 80, 96);
+    check(written, "生成部件");
+
+    Config config(inputDir.string());
+    config.servePort = findFreePort();
+    check(config.servePort > 0, "申请空闲端口");
+
+    // 直接合成的结果作为参照
+    FgComposer reference(config);
+    check(reference.prepare(), "参照合成器加载部件");
+    const size_t combinationCount = static_cast<size_t>(reference.getCombinationCount());
+    check(combinationCount > 0, "生成组合");
+
+    std::atomic<bool> stop{ false };
+    bool served = false;
+    ComposeServer server(config);
+    std::thread serverThread([&] { served = server.Run([&] { return stop.load(); }); });
+
+    int client = connectServer(config.servePort);
+    check(client >= 0, "连接服务");
+    if (client >= 0) {
+        std::string pending;
+        HttpResponse response;
+
+        // 同一连接上依次请求每个组合两次，第二次应命中缓存
+        for (size_t i = 0; i < combinationCount; i++) {
+            const std::vector<std::string> parts = reference.getCombinationParts(i);
+            std::string name;
+            for (const std::string& part : parts) {
+                name += (name.empty() ? "" : "_") + part;
+            }
+            ImageData expected;
+            check(reference.composeParts(parts, expected), "参照合成 " + name);
+
+            for (const char* cacheState : { "miss", "hit" }) {
+                check(request(client, "/compose?name=" + name + "&format=rgba", pending, response), "请求 " + name);
+                check(response.status == 200, "状态码 " + name);
+                check(response.Header("X-Cache") == cacheState, "缓存状态 " + name + " " + cacheState);
+                check(response.Header("X-Image-Width") == std::to_string(expected.width) &&
+                    response.Header("X-Image-Height") == std::to_string(expected.height) &&
+                    response.Header("X-Image-PosX") == std::to_string(expected.posX) &&
+                    response.Header("X-Image-PosY") == std::to_string(expected.posY), "尺寸和坐标 " + name);
+                check(samePixels(response.body, expected), "像素 " + name);
+            }
+        }
+
+        // 按部件列表合成并编码为PNG，解码后应与直接合成一致
+        ImageData expected;
+        check(reference.composeParts({ "chr_noa0001", "a0010", "a0091" }, expected), "参照合成部件列表");
+        check(request(client, "/compose?parts=chr_noa0001,a0010,a0091&format=png", pending, response), "请求部件列表");
+        ImageData decoded;
+        check(response.status == 200 && response.Header("Content-Type") == "image/png" &&
+            ImageProcessor::LoadPngFromMemory(reinterpret_cast<const uint8_t*>(response.body.data()),
+                response.body.size(), decoded) &&
+            decoded.width == expected.width && decoded.height == expected.height &&
+            decoded.data.size() == expected.data.size() &&
+            memcmp(decoded.data.data(), expected.data.data(), decoded.data.size()) == 0, "PNG结果");
+
+        check(request(client, "/compose?name=chr_noa0001_missing", pending, response) && response.status == 404,
+            "未知组合返回404");
+        check(request(client, "/combinations", pending, response) && response.status == 200 &&
+            response.body.find("\"chr_noa0001\"") != std::string::npos, "组合列表");
+        check(request(client, "/stats", pending, response) && response.status == 200 &&
+            response.body.find("\"cacheHits\": " + std::to_string(combinationCount)) != std::string::npos, "统计");
+        close(client);
+    }
+
+    stop = true;
+    serverThread.join();
+    check(served, "服务正常停止");
+
+    std::error_code ec;
+    fs::remove_all(root, ec);
+
+    if (failures > 0) {
+        std::cerr << failures << " 项检查失败" << std::endl;
+        return 1;
+    }
+    std::cout << "合成服务测试通过" << std::endl;
+    return 0;
+}
@@ -0,0 +1,187 @@
+// 坐标索引测试
+// 写出的索引应能查到每个键，不存在的键不会落到其他键的槽位，截断、损坏或过期的索引不被使用
+
+#include "Checksum.h"
+#include "Config.h"
+#include "FgPosIndex.h"
+#include "ImageProcessor.h"
+#include "LuaParser.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "失败: " << message << std::endl;
+        failures++;
+    }
+}
+
+// 各组含有本组独有的文件和所有组共有的同名文件
+static std::vector<FgPosIndex::SourceGroup> makeGroups() {
+    std::vector<FgPosIndex::SourceGroup> groups;
+    for (int g = 0; g < 64; g++) {
+        FgPosIndex::SourceGroup& group = groups.emplace_back();
+        group.name = "chr_" + std::to_string(g);
+        group.files.push_back({ "common", g, -g });
+        for (int i = 0; i < g % 23; i++) {
+            group.files.push_back({ "g" + std::to_string(g) + "_" + std::to_string(i), g * 100 + i, -(g * 100 + i) });
+        }
+    }
+    return groups;
+}
+
+static std::vector<uint8_t> readFile(const fs::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    check(!data.empty(), "读取 " + path.string());
+    return data;
+}
+
+static void writeFile(const fs::path& path, const uint8_t* data, size_t size) {
+    check(ImageProcessor::WriteFileData(path.string(), std::vector<uint8_t>(data, data + size)), "写入 " + path.string());
+}
+
+static std::string indexName(const std::string& script) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.fgidx", static_cast<unsigned long long>(
+        Checksum::Hash64(reinterpret_cast<const uint8_t*>(script.data()), script.size())));
+    return name;
+}
+
+static bool loadScript(LuaParser& parser, const std::string& script) {
+    return parser.loadLuaBuffer(script.data(), script.size(), "test") && parser.parseFgPos();
+}
+
+int main() {
+    Logger::SetLevel(Logger::Level::ERROR);
+
+    const fs::path root = fs::temp_directory_path() / ("afc_pos_index_test_" + std::to_string(getpid()));
+    fs::create_directories(root);
+
+    constexpr uint64_t SOURCE_HASH = 0x0123456789ABCDEFull;
+    constexpr uint64_t SOURCE_SIZE = 4096;
+    const std::vector<FgPosIndex::SourceGroup> groups = makeGroups();
+    const fs::path indexPath = root / "valid.fgidx";
+    check(FgPosIndex::Write(indexPath.string(), SOURCE_HASH, SOURCE_SIZE, groups), "写出索引");
+
+    // 写出后打开，每个组和文件都能查到
+    {
+        FgPosIndex index;
+        check(index.Open(indexPath.string(), SOURCE_HASH, SOURCE_SIZE), "打开索引");
+        check(index.GroupCount() == groups.size(), "组数");
+        for (uint32_t g = 0; g < groups.size() && index.IsOpen(); g++) {
+            const int32_t found = index.FindGroup(groups[g].name);
+            check(found == static_cast<int32_t>(g), "查找组 " + groups[g].name);
+            if (found < 0) {
+                continue;
+            }
+            const FgPosIndex::Group& group = index.GroupAt(found);
+            check(index.Name(group.nameOffset, group.nameLength) == groups[g].name && group.fileCount == groups[g].files.size(),
+                "组内容 " + groups[g].name);
+            for (const FgPosIndex::SourceFile& source : groups[g].files) {
+                const FgPosIndex::File* file = index.FindFile(found, source.name);
+                check(file != nullptr && index.Name(file->nameOffset, file->nameLength) == source.name &&
+                    file->x == source.x && file->y == source.y, "查找文件 " + groups[g].name + "/" + source.name);
+            }
+        }
+
+        // 不存在的键返回未找到，不会得到其他键
+        for (int i = 0; i < 4096 && index.IsOpen(); i++) {
+            check(index.FindGroup("missing_" + std::to_string(i)) < 0, "不存在的组 " + std::to_string(i));
+        }
+        for (uint32_t g = 0; g < groups.size() && index.IsOpen(); g++) {
+            for (int i = 0; i < 64; i++) {
+                check(index.FindFile(g, "missing_" + std::to_string(i)) == nullptr, "不存在的文件 " + groups[g].name);
+            }
+            // 其他组独有的文件在本组中不存在
+            const FgPosIndex::SourceGroup& other = groups[(g + 1) % groups.size()];
+            for (size_t i = 1; i < other.files.size(); i++) {
+                check(index.FindFile(g, other.files[i].name) == nullptr, "其他组的文件 " + other.files[i].name);
+            }
+        }
+        check(!index.IsOpen() || index.FindFile(static_cast<uint32_t>(groups.size()), "common") == nullptr, "越界的组下标");
+
+        // 空索引
+        const fs::path emptyPath = root / "empty.fgidx";
+        FgPosIndex empty;
+        check(FgPosIndex::Write(emptyPath.string(), SOURCE_HASH, 0, {}) && empty.Open(emptyPath.string(), SOURCE_HASH, 0) &&
+            empty.FindGroup("chr_0") < 0 && empty.FindFile(0, "common") == nullptr, "空索引");
+    }
+
+    // 源文件不符、截断或损坏的索引不被打开
+    {
+        FgPosIndex index;
+        check(!index.Open(indexPath.string(), SOURCE_HASH + 1, SOURCE_SIZE), "源文件哈希不符");
+        check(!index.Open(indexPath.string(), SOURCE_HASH, SOURCE_SIZE + 1), "源文件长度不符");
+        check(!index.Open((root / "absent.fgidx").string(), SOURCE_HASH, SOURCE_SIZE), "索引不存在");
+
+        const std::vector<uint8_t> original = readFile(indexPath);
+        const fs::path damagedPath = root / "damaged.fgidx";
+        for (size_t size : { size_t(0), size_t(16), original.size() / 2, original.size() - 1 }) {
+            writeFile(damagedPath, original.data(), size);
+            check(!index.Open(damagedPath.string(), SOURCE_HASH, SOURCE_SIZE), "截断到 " + std::to_string(size) + " 字节");
+        }
+
+        std::vector<uint8_t> extended = original;
+        extended.push_back(0);
+        writeFile(damagedPath, extended.data(), extended.size());
+        check(!index.Open(damagedPath.string(), SOURCE_HASH, SOURCE_SIZE), "末尾多出数据");
+
+        // 文件头和各段中的字节逐一损坏
+        const size_t step = std::max<size_t>(1, original.size() / 97);
+        for (size_t offset = 0; offset < original.size(); offset += step) {
+            std::vector<uint8_t> damaged = original;
+            damaged[offset] ^= 0x5A;
+            writeFile(damagedPath, damaged.data(), damaged.size());
+            check(!index.Open(damagedPath.string(), SOURCE_HASH, SOURCE_SIZE), "损坏第 " + std::to_string(offset) + " 字节");
+        }
+        check(index.Open(indexPath.string(), SOURCE_HASH, SOURCE_SIZE), "无效索引之后仍能打开有效索引");
+    }
+
+    // 过期的索引：源文件变化后按新内容解析，并重新生成索引
+    {
+        const fs::path indexDirectory = root / "lua";
+        const std::string oldScript = "fgpos = { chr_a = { a0010 = {x = 1, y = 2}, a0020 = {x = 3, y = 4} } }\n";
+        const std::string newScript = "fgpos = { chr_a = { a0010 = {x = 5, y = 6} }, chr_b = { b0010 = {x = 7, y = 8} } }\n";
+
+        LuaParser first;
+        first.setIndexDirectory(indexDirectory.string());
+        check(loadScript(first, oldScript) && first.getFilePos("chr_a", "a0020") == std::make_pair(3, 4), "首次加载");
+        check(fs::exists(indexDirectory / indexName(oldScript)), "生成索引");
+
+        // 用旧内容的索引冒充新内容的索引，哈希不符时应重新解析
+        fs::copy_file(indexDirectory / indexName(oldScript), indexDirectory / indexName(newScript));
+        LuaParser stale;
+        stale.setIndexDirectory(indexDirectory.string());
+        check(loadScript(stale, newScript), "加载变化后的脚本");
+        check(stale.getFilePos("chr_a", "a0010") == std::make_pair(5, 6) && !stale.hasFile("chr_a", "a0020") &&
+            stale.getFilePos("chr_b", "b0010") == std::make_pair(7, 8), "过期索引被忽略");
+
+        // 重新生成的索引对应新内容
+        FgPosIndex regenerated;
+        check(regenerated.Open((indexDirectory / indexName(newScript)).string(),
+            Checksum::Hash64(reinterpret_cast<const uint8_t*>(newScript.data()), newScript.size()), newScript.size()) &&
+            regenerated.FindGroup("chr_b") >= 0, "重新生成索引");
+
+        LuaParser reloaded;
+        reloaded.setIndexDirectory(indexDirectory.string());
+        check(loadScript(reloaded, newScript) && reloaded.getFilePos("chr_b", "b0010") == std::make_pair(7, 8), "从索引加载");
+    }
+
+    std::error_code ec;
+    fs::remove_all(root, ec);
+
+    if (failures > 0) {
+        std::cerr << failures << " 项检查失败" << std::endl;
+        return 1;
+    }
+    std::cout << "坐标索引测试通过" << std::endl;
+    return 0;
+}
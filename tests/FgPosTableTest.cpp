@@ -0,0 +1,175 @@
+// 坐标表字面量解析器测试
+// 字面量解析的结果应与Lua虚拟机执行脚本的结果完全一致，含有其他语法的脚本应改用Lua执行
+
+#include "Config.h"
+#include "LuaParser.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// 未链接可用的Lua时只运行不依赖虚拟机的检查，返回此值由ctest标记为跳过
+constexpr int SKIP_RETURN_CODE = 77;
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "失败: " << message << std::endl;
+        failures++;
+    }
+}
+
+// 覆盖注释、长括号、转义、负数和十六进制数、重复的组和多次赋值
+static const char* LITERAL_FIXTURE = R"LUA(-- 坐标表
+--[[ 块注释中的赋值不生效
+fgpos = { chr_bogus = { a0001 = {x = 1, y = 1} } }
+]]
+--[==[ 含有 ]] 的长注释 ]==]
+fgpos = { chr_old = { a0001 = {x = 9, y = 9} } }
+list = { "a", 'b\n', [[long]], [=[x]]y]=], n = -1.5, e = 1e3, nested = { 1, 2, { 3 } }, ok = true, none = nil }
+fgpos = {
+	chr_a = {
+		a0010 = {x = 10, y = 20},
+		a0020 = {x = -5, y = 0x10},
+		["a\0480\x33\z
+		  0"] = {x = 0X1f, y = -0x2},
+		[ [[a0040]] ] = {x = 7; y = 8};
+		['a0050'] = {y = 3, x = -0},
+		a0060 = {x = 3},
+		a0070 = {y = 4},
+		a0010 = {x = 12, y = 22},
+	},
+	["chr_b"] = {
+		b0010 = {x = 1, y = 2, extra = "ignored"},
+		[1] = {x = 5, y = 6},
+	},
+	chr_c = {
+		c0010 = {x = 1, y = 1},
+		c0020 = {x = 2, y = 2},
+	},
+	chr_c = {
+		c0010 = {x = 3, y = 4},
+	},
+}
+)LUA";
+
+// 直接检查字面量解析的结果，不依赖Lua
+struct Expected {
+    const char* group;
+    const char* file;
+    int x;
+    int y;
+};
+
+static const Expected LITERAL_EXPECTED[] = {
+    { "chr_a", "a0010", 12, 22 },
+    { "chr_a", "a0020", -5, 16 },
+    { "chr_a", "a0030", 31, -2 },
+    { "chr_a", "a0040", 7, 8 },
+    { "chr_a", "a0050", 0, 3 },
+    { "chr_b", "b0010", 1, 2 },
+    { "chr_b", "1", 5, 6 },
+    { "chr_c", "c0010", 3, 4 },
+};
+
+// 各自需要改用Lua执行的脚本：运算、函数调用、字符串连接、变量、非整数坐标、不支持的转义
+struct FallbackCase {
+    const char* name;
+    const char* script;
+    bool validLua;      // Lua能否执行，无效的脚本两种方式都应失败
+};
+
+static const FallbackCase FALLBACK_CASES[] = {
+    { "运算", "fgpos = { chr_a = { a0010 = {x = 1 + 2, y = -(4 * 2)} } }", true },
+    { "函数调用", "local function p(x, y) return {x = x, y = y} end\nfgpos = { chr_a = { a0010 = p(3, 4) } }", true },
+    { "字符串连接", "fgpos = { chr_a = { [\"a00\" .. \"10\"] = {x = 5, y = 6} } }", true },
+    { "变量引用", "local base = 100\nfgpos = { chr_a = { a0010 = {x = base, y = base + 1} } }", true },
+    { "小数坐标", "fgpos = { chr_a = { a0010 = {x = 1.5, y = 2} } }", true },
+    { "不支持的转义", "fgpos = { chr_a = { [\"a\\u{30}010\"] = {x = 7, y = 8} } }", true },
+    { "无效的转义", "fgpos = { chr_a = { [\"a\\q\"] = {x = 1, y = 2} } }", false },
+};
+
+static std::vector<std::string> sorted(std::vector<std::string> names) {
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+// 逐组逐文件比较两个解析器的结果
+static void compareParsers(const LuaParser& fast, const LuaParser& vm, const std::string& label) {
+    const std::vector<std::string> groups = sorted(fast.getGroupNames());
+    check(groups == sorted(vm.getGroupNames()), label + ": 组名");
+    for (const std::string& group : groups) {
+        const std::vector<std::string> files = sorted(fast.getFileNames(group));
+        check(files == sorted(vm.getFileNames(group)), label + ": " + group + " 的文件名");
+        for (const std::string& file : files) {
+            check(fast.getFilePos(group, file) == vm.getFilePos(group, file), label + ": " + group + "/" + file + " 的坐标");
+        }
+    }
+}
+
+static bool loadScript(LuaParser& parser, const char* script, bool fastPath) {
+    parser.setFastPathEnabled(fastPath);
+    return parser.loadLuaBuffer(script, strlen(script), "test") && parser.parseFgPos();
+}
+
+int main() {
+    Logger::SetLevel(Logger::Level::ERROR);
+
+    // 字面量脚本：字面量解析成功，结果与预期一致
+    FgPosTable table;
+    check(table.Parse(LITERAL_FIXTURE, strlen(LITERAL_FIXTURE)), "字面量解析: " + table.Error());
+
+    LuaParser fast;
+    check(loadScript(fast, LITERAL_FIXTURE, true), "按字面量加载");
+    check(sorted(fast.getGroupNames()) == std::vector<std::string>({ "chr_a", "chr_b", "chr_c" }), "组名");
+    for (const Expected& expected : LITERAL_EXPECTED) {
+        check(fast.hasFile(expected.group, expected.file) &&
+            fast.getFilePos(expected.group, expected.file) == std::make_pair(expected.x, expected.y),
+            std::string("坐标 ") + expected.group + "/" + expected.file);
+    }
+    check(!fast.hasFile("chr_a", "a0060") && !fast.hasFile("chr_a", "a0070"), "缺少坐标的文件被忽略");
+    check(!fast.hasFile("chr_c", "c0020"), "重复的组以后者为准");
+    check(fast.getFileNames("chr_a").size() == 5, "chr_a 的文件数");
+
+    // 需要改用Lua执行的脚本：字面量解析失败
+    for (const FallbackCase& fallback : FALLBACK_CASES) {
+        FgPosTable rejected;
+        check(!rejected.Parse(fallback.script, strlen(fallback.script)), std::string("字面量解析应失败: ") + fallback.name);
+    }
+
+    // 以下需要Lua虚拟机
+    LuaParser probe;
+    if (!loadScript(probe, "fgpos = {}", false)) {
+        std::cout << "Lua不可用，跳过与虚拟机结果的对比" << std::endl;
+        return failures > 0 ? 1 : SKIP_RETURN_CODE;
+    }
+
+    LuaParser vm;
+    check(loadScript(vm, LITERAL_FIXTURE, false), "通过Lua执行加载");
+    compareParsers(fast, vm, "字面量脚本");
+
+    // 按字段解析同样一致
+    LuaParser fastFields, vmFields;
+    check(loadScript(fastFields, LITERAL_FIXTURE, true) && fastFields.parseGroups("chr"), "按字面量解析字段");
+    check(loadScript(vmFields, LITERAL_FIXTURE, false) && vmFields.parseGroups("chr"), "通过Lua解析字段");
+    compareParsers(fastFields, vmFields, "字段");
+
+    // 字面量解析失败时改用Lua执行，结果与直接执行一致
+    for (const FallbackCase& fallback : FALLBACK_CASES) {
+        LuaParser fallbackFast, fallbackVm;
+        const bool fastLoaded = loadScript(fallbackFast, fallback.script, true);
+        const bool vmLoaded = loadScript(fallbackVm, fallback.script, false);
+        check(fastLoaded == fallback.validLua && vmLoaded == fallback.validLua, std::string("加载结果: ") + fallback.name);
+        if (fastLoaded && vmLoaded) {
+            check(fallbackFast.hasFile("chr_a", "a0010"), std::string("回退后的坐标: ") + fallback.name);
+            compareParsers(fallbackFast, fallbackVm, fallback.name);
+        }
+    }
+
+    if (failures > 0) {
+        std::cerr << failures << " 项检查失败" << std::endl;
+        return 1;
+    }
+    std::cout << "坐标表解析测试通过" << std::endl;
+    return 0;
+}
@@ -0,0 +1,131 @@
+// 部件缓存测试
+// 多个目录轮流或同时使用一个缓存文件时，各自解码的部件都应保留并在之后命中
+
+#include "PartCache.h"
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "失败: " << message << std::endl;
+        failures++;
+    }
+}
+
+// 生成内容由seed决定的RGBA部件
+static std::string writePart(const fs::path& directory, const std::string& name, int seed) {
+    ImageData image(24 + seed % 7, 16 + seed % 5, 4, seed, -seed);
+    for (size_t i = 0; i < image.data.size(); i++) {
+        image.data.data()[i] = static_cast<uint8_t>(i * 31 + seed * 17);
+    }
+    const std::string path = (directory / (name + ".png")).string();
+    check(ImageProcessor::SavePngWithPos(path, image), "生成部件 " + name);
+    return path;
+}
+
+// 一次运行：打开缓存，加载一组部件，写出缓存
+static void runSession(const std::string& cachePath, const std::vector<std::string>& files, int& hits, int& misses) {
+    PartCache cache;
+    cache.Open(cachePath);
+    for (const std::string& file : files) {
+        ImageData image;
+        check(cache.Load(file, true, image), "加载 " + file);
+
+        // 命中时的像素和坐标应与直接解码一致
+        ImageData expected;
+        check(ImageProcessor::LoadPngWithPos(file, expected) && image.width == expected.width &&
+            image.height == expected.height && image.posX == expected.posX && image.posY == expected.posY &&
+            memcmp(image.data.data(), expected.data.data(), expected.data.size()) == 0, "内容 " + file);
+    }
+    hits = cache.HitCount();
+    misses = cache.MissCount();
+    check(cache.Finish(), "写出缓存");
+}
+
+int main() {
+    Logger::SetLevel(Logger::Level::WARNING);
+
+    const fs::path root = fs::temp_directory_path() / ("afc_part_cache_test_" + std::to_string(getpid()));
+    fs::create_directories(root);
+
+    std::vector<std::string> setA, setB;
+    for (int i = 0; i < 3; i++) {
+        setA.push_back(writePart(root, "a" + std::to_string(i), i + 1));
+    }
+    for (int i = 0; i < 2; i++) {
+        setB.push_back(writePart(root, "b" + std::to_string(i), i + 11));
+    }
+
+    // 两个目录轮流使用同一缓存，第二轮全部命中
+    {
+        const std::string cachePath = (root / "alternate.cache").string();
+        int hits = 0, misses = 0;
+        runSession(cachePath, setA, hits, misses);
+        check(hits == 0 && misses == 3, "首次运行A全部未命中");
+        runSession(cachePath, setB, hits, misses);
+        check(hits == 0 && misses == 2, "首次运行B全部未命中");
+        runSession(cachePath, setA, hits, misses);
+        check(hits == 3 && misses == 0, "再次运行A全部命中");
+        runSession(cachePath, setB, hits, misses);
+        check(hits == 2 && misses == 0, "再次运行B全部命中");
+    }
+
+    // 两个进程同时使用同一缓存，后写出的一方合并先写出的一代
+    {
+        const std::string cachePath = (root / "concurrent.cache").string();
+        PartCache first, second;
+        first.Open(cachePath);
+        second.Open(cachePath);
+        for (const std::string& file : setA) {
+            ImageData image;
+            first.Load(file, true, image);
+        }
+        for (const std::string& file : setB) {
+            ImageData image;
+            second.Load(file, true, image);
+        }
+        check(first.Finish() && second.Finish(), "同时写出缓存");
+
+        int hits = 0, misses = 0;
+        std::vector<std::string> all = setA;
+        all.insert(all.end(), setB.begin(), setB.end());
+        runSession(cachePath, all, hits, misses);
+        check(hits == 5 && misses == 0, "同时写出的部件全部保留");
+    }
+
+    // 连续多次更新未被使用的条目被淘汰
+    {
+        const std::string cachePath = (root / "aging.cache").string();
+        int hits = 0, misses = 0;
+        runSession(cachePath, setA, hits, misses);
+        for (int i = 0; i < 8; i++) {
+            runSession(cachePath, { writePart(root, "c" + std::to_string(i), i + 21) }, hits, misses);
+        }
+        runSession(cachePath, setA, hits, misses);
+        check(hits == 0 && misses == 3, "长期未使用的条目被淘汰");
+    }
+
+    // 只保留最新的一代
+    size_t generationFiles = 0;
+    for (const auto& entry : fs::directory_iterator(root)) {
+        const std::string name = entry.path().filename().string();
+        generationFiles += name.rfind("alternate.cache", 0) == 0 ? 1 : 0;
+    }
+    check(generationFiles == 1, "旧的缓存文件已删除");
+
+    std::error_code ec;
+    fs::remove_all(root, ec);
+
+    if (failures > 0) {
+        std::cerr << failures << " 项检查失败" << std::endl;
+        return 1;
+    }
+    std::cout << "部件缓存测试通过" << std::endl;
+    return 0;
+}